@@ -0,0 +1,163 @@
+/// 媒体热路径微基准
+///
+/// 所有输入都是内存中合成的数据，结果可复现。每个基准自动加倍迭代次数直到
+/// 运行时间超过--min-time，输出ns/op、每次操作分配的字节数和分配次数。
+///
+/// usage: muduo_media_bench [--min-time 0.5] [filter]
+
+#include "bench.h"
+#include "logger/logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_alloc_count(0);
+std::atomic<uint64_t> g_alloc_bytes(0);
+
+struct BenchEntry {
+    const char *name;
+    bench::BenchFunc func;
+};
+
+std::vector<BenchEntry> &Registry() {
+    static std::vector<BenchEntry> entries;
+    return entries;
+}
+
+struct RunResult {
+    size_t iterations;
+    double seconds;
+    uint64_t allocs;
+    uint64_t bytes;
+};
+
+RunResult RunOnce(const bench::BenchFunc &func, size_t iterations) {
+    uint64_t allocs = g_alloc_count.load(std::memory_order_relaxed);
+    uint64_t bytes = g_alloc_bytes.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    func(iterations);
+
+    auto end = std::chrono::steady_clock::now();
+    RunResult result;
+    result.iterations = iterations;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.allocs = g_alloc_count.load(std::memory_order_relaxed) - allocs;
+    result.bytes = g_alloc_bytes.load(std::memory_order_relaxed) - bytes;
+    return result;
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+namespace bench {
+
+void Register(const char *name, const BenchFunc &func) {
+    Registry().push_back({name, func});
+}
+
+std::string MakeNalu(uint8_t nalu_header, size_t size) {
+    // 每个NALU类型固定种子
+    std::mt19937 rng(nalu_header * 7919u + (uint32_t)size);
+    std::uniform_int_distribution<int> dist(1, 255);
+
+    std::string nalu;
+    nalu.resize(size);
+    nalu[0] = (char)nalu_header;
+    for (size_t i = 1; i < size; ++i) {
+        nalu[i] = (char)dist(rng);
+    }
+    return nalu;
+}
+
+std::string MakeH264Stream(int gops, int gop_size, size_t idr_size,
+                           size_t p_size) {
+    static const char kStartCode[] = {0, 0, 0, 1};
+
+    std::string sps = MakeNalu(0x67, 16);
+    std::string pps = MakeNalu(0x68, 6);
+    std::string idr = MakeNalu(0x65, idr_size);
+    std::string p = MakeNalu(0x41, p_size);
+
+    std::string stream;
+    for (int g = 0; g < gops; ++g) {
+        stream.append(kStartCode, 4).append(sps);
+        stream.append(kStartCode, 4).append(pps);
+        stream.append(kStartCode, 4).append(idr);
+        for (int i = 1; i < gop_size; ++i) {
+            stream.append(kStartCode, 3).append(p);
+        }
+    }
+    return stream;
+}
+
+} // namespace bench
+
+int main(int argc, char *argv[]) {
+    double min_time = 0.5;
+    const char *filter = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    muduo::log::Logger::set_log_level(muduo::log::Logger::ERROR);
+
+    printf("%-36s %12s %12s %12s %12s\n", "benchmark", "iterations", "ns/op",
+           "B/op", "allocs/op");
+
+    for (auto &entry : Registry()) {
+        if (filter && !strstr(entry.name, filter)) {
+            continue;
+        }
+
+        // 预热一次
+        RunOnce(entry.func, 1);
+
+        size_t iterations = 1;
+        RunResult result = RunOnce(entry.func, iterations);
+        while (result.seconds < min_time && iterations < (1ul << 40)) {
+            double scale = result.seconds > 0
+                               ? min_time * 1.2 / result.seconds
+                               : 100;
+            if (scale > 100) {
+                scale = 100;
+            } else if (scale < 2) {
+                scale = 2;
+            }
+            iterations = (size_t)(iterations * scale);
+            result = RunOnce(entry.func, iterations);
+        }
+
+        printf("%-36s %12zu %12.1f %12.1f %12.2f\n", entry.name,
+               result.iterations, result.seconds * 1e9 / result.iterations,
+               (double)result.bytes / result.iterations,
+               (double)result.allocs / result.iterations);
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef C2E51A0B_6F3D_4C8E_9B27_5A1D03E8F4B6
+#define C2E51A0B_6F3D_4C8E_9B27_5A1D03E8F4B6
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace bench {
+
+/// 执行iterations次被测操作
+using BenchFunc = std::function<void(size_t iterations)>;
+
+void Register(const char *name, const BenchFunc &func);
+
+struct Registrar {
+    Registrar(const char *name, const BenchFunc &func) {
+        Register(name, func);
+    }
+};
+
+/// 防止编译器把结果优化掉
+template <typename T> inline void DoNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// 固定种子生成的Annex-B H.264码流：每个GOP为SPS、PPS、IDR和若干P帧。
+/// 负载字节不含0，不会出现伪起始码。
+std::string MakeH264Stream(int gops, int gop_size, size_t idr_size,
+                           size_t p_size);
+
+/// 生成单个NALU负载（含NALU头）
+std::string MakeNalu(uint8_t nalu_header, size_t size);
+
+} // namespace bench
+
+#endif /* C2E51A0B_6F3D_4C8E_9B27_5A1D03E8F4B6 */
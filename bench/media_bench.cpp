@@ -0,0 +1,164 @@
+#include "bench.h"
+#include "media/av_packet.h"
+#include "media/defs.h"
+#include "media/h264_file_source.h"
+#include "media/h264_video_rtp_sink.h"
+#include "media/rtcp.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace muduo_media;
+
+namespace {
+
+/// 打包结果只计数，不发送
+class CountingH264Sink : public H264VideoRtpSink {
+public:
+    CountingH264Sink(RtpTransProto transport)
+        : H264VideoRtpSink(transport, 0), output_bytes_(0) {}
+
+    size_t output_bytes() const { return output_bytes_; }
+
+protected:
+    void Output(const uint8_t *data, size_t len) override {
+        bench::DoNotOptimize(data[len - 1]);
+        output_bytes_ += len;
+    }
+
+private:
+    size_t output_bytes_;
+};
+
+AVPacket MakePacket(const std::string &nalu) {
+    AVPacket pkt;
+    pkt.prepend_size = defs::kBufPrependSize;
+    pkt.size = nalu.size();
+    pkt.buffer.reset(new uint8_t[pkt.prepend_size + pkt.size]);
+    memcpy(pkt.buffer.get() + pkt.prepend_size, nalu.data(), nalu.size());
+    pkt.type = nalu[0] & 0x1F;
+    return pkt;
+}
+
+void BenchSinkSend(RtpTransProto transport, size_t nalu_size,
+                   size_t iterations) {
+    CountingH264Sink sink(transport);
+    AVPacket pkt = MakePacket(bench::MakeNalu(0x65, nalu_size));
+    AVPacketInfo info;
+    info.payload_type = defs::kMediaFormatH264;
+    info.ssrc = 0x12345678;
+
+    for (size_t i = 0; i < iterations; ++i) {
+        info.timestamp += defs::kMediaTsDuration;
+        sink.Send(pkt, info);
+    }
+    bench::DoNotOptimize(sink.output_bytes());
+}
+
+// NALU切分: 每次操作取出一个NALU
+void BenchH264SourceNextNalu(size_t iterations) {
+    static const std::string stream =
+        bench::MakeH264Stream(4, 25, 30000, 3000);
+
+    FILE *file = fmemopen((void *)stream.data(), stream.size(), "rb");
+    H264FileSource source(file);
+
+    AVPacket pkt;
+    for (size_t i = 0; i < iterations; ++i) {
+        if (!source.GetNextFrame(&pkt)) {
+            rewind(file);
+            source.GetNextFrame(&pkt);
+        }
+        bench::DoNotOptimize(pkt.size);
+    }
+}
+
+void BenchSinkTcpIdr(size_t iterations) {
+    BenchSinkSend(RtpTransProto::kRtpOverTcp, 30000, iterations);
+}
+
+void BenchSinkTcpP(size_t iterations) {
+    BenchSinkSend(RtpTransProto::kRtpOverTcp, 1000, iterations);
+}
+
+void BenchSinkUdpFua(size_t iterations) {
+    BenchSinkSend(RtpTransProto::kRtpOverUdp, 30000, iterations);
+}
+
+void BenchSinkUdpSingle(size_t iterations) {
+    BenchSinkSend(RtpTransProto::kRtpOverUdp, 1000, iterations);
+}
+
+// 从小缓冲开始追加到64KB，覆盖扩容路径
+void BenchNaluAppendGrow(size_t iterations) {
+    static const std::string chunk = bench::MakeNalu(0x41, 1024);
+
+    for (size_t i = 0; i < iterations; ++i) {
+        H264Nalu nalu{};
+        nalu.prepend_size = defs::kBufPrependSize;
+        nalu.max_size = 4096;
+        nalu.buf.reset(new unsigned char[nalu.max_size]);
+        for (int c = 0; c < 64; ++c) {
+            nalu.AppendData((unsigned char *)chunk.data(), chunk.size());
+        }
+        bench::DoNotOptimize(nalu.len);
+    }
+}
+
+void BenchRtcpSRSerialize(size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+        RtcpSRMessage sr;
+        sr.header.ssrc = 0x12345678;
+        sr.sender_info.ts_msw = i;
+        sr.sender_info.rtp_ts = i * defs::kMediaTsDuration;
+        sr.sender_info.packets = i;
+        sr.sender_info.octets = i * 1400;
+        std::string binary = sr.Serialize();
+        bench::DoNotOptimize(binary.size());
+    }
+}
+
+// RR(1个report block) + SDES(CNAME)
+const unsigned char kRtcpRRCompound[] = {
+    0x81, 201,  0x00, 0x07, 0x11, 0x22, 0x33, 0x44, // RR header
+    0x12, 0x34, 0x56, 0x78, 0x02, 0x00, 0x00, 0x05, // report block
+    0x00, 0x01, 0x23, 0x45, 0x00, 0x00, 0x00, 0x30, //
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //
+    0x81, 202,  0x00, 0x03, 0x11, 0x22, 0x33, 0x44, // SDES
+    0x01, 0x04, 'h',  'o',  's',  't',  0x00, 0x00};
+
+void BenchRtcpParseView(size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+        RtcpReceiverStats stats;
+        stats.Accumulate((const char *)kRtcpRRCompound,
+                         sizeof(kRtcpRRCompound));
+        bench::DoNotOptimize(stats.jitter);
+    }
+}
+
+void BenchRtcpDeserializeMessage(size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+        std::unique_ptr<RtcpRRMessage> rr(new RtcpRRMessage);
+        rr->header.rc = 1;
+        rr->header.length = 7;
+        rr->Deserialize((const char *)kRtcpRRCompound + 8, 24);
+        bench::DoNotOptimize(rr->report_blocks.size());
+    }
+}
+
+bench::Registrar s_h264_source("h264_file_source/next_nalu",
+                               BenchH264SourceNextNalu);
+bench::Registrar s_sink_tcp_idr("h264_rtp_sink/tcp_idr_30k", BenchSinkTcpIdr);
+bench::Registrar s_sink_tcp_p("h264_rtp_sink/tcp_p_1k", BenchSinkTcpP);
+bench::Registrar s_sink_udp_fua("h264_rtp_sink/udp_fua_idr_30k",
+                                BenchSinkUdpFua);
+bench::Registrar s_sink_udp_single("h264_rtp_sink/udp_single_1k",
+                                   BenchSinkUdpSingle);
+bench::Registrar s_nalu_append("h264_nalu/append_grow_64k",
+                               BenchNaluAppendGrow);
+bench::Registrar s_rtcp_sr("rtcp/sr_serialize", BenchRtcpSRSerialize);
+bench::Registrar s_rtcp_view("rtcp/rr_parse_view", BenchRtcpParseView);
+bench::Registrar s_rtcp_message("rtcp/rr_deserialize_message",
+                                BenchRtcpDeserializeMessage);
+
+} // namespace
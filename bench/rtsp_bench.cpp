@@ -0,0 +1,73 @@
+#include "bench.h"
+#include "media/h264_live_subsession.h"
+#include "media/h264_parameter_sets.h"
+#include "net/buffer.h"
+#include "rtsp/media_session.h"
+#include "rtsp/rtsp_connection.h"
+
+#include <cstring>
+
+using namespace muduo_media;
+
+namespace {
+
+const char kDescribeRequest[] =
+    "DESCRIBE rtsp://127.0.0.1:8554/live RTSP/1.0\r\n"
+    "CSeq: 3\r\n"
+    "User-Agent: LibVLC/3.0.18 (LIVE555 Streaming Media v2016.11.28)\r\n"
+    "Accept: application/sdp\r\n"
+    "\r\n";
+
+void BenchParseRequestHead(size_t iterations) {
+    muduo::net::Buffer buf;
+    std::vector<std::string> gap_lines;
+
+    for (size_t i = 0; i < iterations; ++i) {
+        buf.Append(kDescribeRequest, sizeof(kDescribeRequest) - 1);
+
+        RtspRequestHead head;
+        gap_lines.clear();
+        RtspConnection::ParseRequestHead(&buf, gap_lines, &head);
+        bench::DoNotOptimize(head.cseq);
+
+        buf.RetrieveAll();
+    }
+}
+
+// 与bench::MakeH264Stream中的SPS/PPS相同
+H264ParameterSets BenchParameterSets() {
+    H264ParameterSets sets;
+    sets.sps = bench::MakeNalu(0x67, 16);
+    sets.pps = bench::MakeNalu(0x68, 6);
+    return sets;
+}
+
+void BenchBuildSdp(size_t iterations) {
+    // H264FileSubsession在GetSdp时会打开并扫描文件，这里用内存中的参数集
+    MediaSession session("live");
+    auto subsession = std::make_shared<H264LiveSubsession>(
+        std::make_shared<LiveStreamHub>());
+    subsession->set_fmtp(BenchParameterSets().FmtpParameters());
+    session.AddSubsession(subsession);
+
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string sdp = session.BuildSdp();
+        bench::DoNotOptimize(sdp.size());
+    }
+}
+
+bench::Registrar s_parse_request("rtsp/parse_request_head",
+                                 BenchParseRequestHead);
+void BenchFmtpParameters(size_t iterations) {
+    H264ParameterSets sets = BenchParameterSets();
+
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string fmtp = sets.FmtpParameters();
+        bench::DoNotOptimize(fmtp.size());
+    }
+}
+
+bench::Registrar s_build_sdp("sdp/build", BenchBuildSdp);
+bench::Registrar s_fmtp("sdp/h264_fmtp", BenchFmtpParameters);
+
+} // namespace
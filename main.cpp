@@ -1,31 +1,68 @@
 #include "logger/logger.h"
+#include "media/async_logging.h"
 #include "media/h264_file_subsession.h"
 #include "rtsp/media_session.h"
+#include "rtsp/metrics_http_server.h"
 #include "rtsp/rtsp_server.h"
+#include "rtsp/vod_catalog.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
-int main() {
+// usage: muduo_media_server [--root dir] [--vod-budget MB]
+//
+// 指定--root时为点播目录模式: rtsp://host:8554/a/b.mp4对应dir/a/b.mp4，
+// 会话在第一次请求时建立，不扫描目录；否则只提供test2.h264为"live"
+int main(int argc, char *argv[]) {
+    std::string root;
+    muduo_media::VodCatalogOptions catalog_options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) {
+            root = argv[++i];
+        } else if (strcmp(argv[i], "--vod-budget") == 0 && i + 1 < argc) {
+            catalog_options.memory_budget = (size_t)atoi(argv[++i]) << 20;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--root dir] [--vod-budget MB]" << std::endl;
+            return 1;
+        }
+    }
 
     muduo::log::Logger::set_log_level(muduo::log::Logger::TRACE);
 
+    // 日志由后台线程写出，不阻塞媒体loop
+    muduo_media::AsyncLogging async_logging;
+    async_logging.Start();
+
     muduo::net::InetAddress listen_addr(8554);
 
     muduo::event_loop::EventLoop loop;
 
     muduo_media::RtspServer rtsp_server(&loop, listen_addr, "RtspServer", true);
 
-    muduo_media::MediaSessionPtr session(new muduo_media::MediaSession("live"));
+    if (!root.empty()) {
+        rtsp_server.set_vod_catalog(std::make_shared<muduo_media::VodCatalog>(
+            &loop, root, catalog_options));
+    } else {
+        muduo_media::MediaSessionPtr session(
+            new muduo_media::MediaSession("live"));
 
-    std::shared_ptr<muduo_media::H264FileSubsession> h264_file(
-        new muduo_media::H264FileSubsession("test2.h264"));
-    std::shared_ptr<muduo_media::MediaSubsession> h264_subsession =
-        std::static_pointer_cast<muduo_media::MediaSubsession>(h264_file);
-    session->AddSubsession(h264_subsession);
+        std::shared_ptr<muduo_media::H264FileSubsession> h264_file(
+            new muduo_media::H264FileSubsession("test2.h264"));
+        std::shared_ptr<muduo_media::MediaSubsession> h264_subsession =
+            std::static_pointer_cast<muduo_media::MediaSubsession>(h264_file);
+        session->AddSubsession(h264_subsession);
 
-    rtsp_server.AddMediaSession(session);
+        rtsp_server.AddMediaSession(session);
+    }
 
     rtsp_server.Start();
 
+    // Prometheus采集端口，独立线程，不占用媒体loop
+    muduo_media::MetricsHttpServer metrics_server(
+        muduo::net::InetAddress(9554));
+    metrics_server.Start();
+
     loop.Loop();
 
     return 0;
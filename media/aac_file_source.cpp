@@ -0,0 +1,131 @@
+#include "aac_file_source.h"
+#include "defs.h"
+#include "media_log.h"
+
+#include <cstdio>
+#include <random>
+
+namespace muduo_media {
+
+// C++11中按引用传递(make_shared)时需要定义
+constexpr unsigned int AacFileSource::kSamplesPerFrame;
+
+static const unsigned int kAdtsSampleRates[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000,
+    22050, 16000, 12000, 11025, 8000,  7350};
+
+static constexpr size_t kAdtsHeaderSize = 7;
+static constexpr size_t kAdtsCrcSize = 2;
+
+unsigned int AdtsHeader::sample_rate() const {
+    return sampling_index < sizeof(kAdtsSampleRates) / sizeof(unsigned int)
+               ? kAdtsSampleRates[sampling_index]
+               : 0;
+}
+
+std::string AdtsHeader::AudioSpecificConfig() const {
+    // object type(5) | sampling index(4) | channels(4) | 000
+    uint16_t config = (object_type << 11) | (sampling_index << 7) |
+                      (channels << 3);
+    char hex[8] = {0};
+    snprintf(hex, sizeof(hex), "%04X", config);
+    return hex;
+}
+
+bool ParseAdtsHeader(const uint8_t *data, size_t size, AdtsHeader *header) {
+    /*
+     *  syncword(12) ID(1) layer(2) protection_absent(1)
+     *  profile(2) sampling_frequency_index(4) private(1)
+     *  channel_configuration(3) original(1) home(1)
+     *  copyright_id(2) frame_length(13) buffer_fullness(11) blocks(2)
+     */
+    if (size < kAdtsHeaderSize || data[0] != 0xFF ||
+        (data[1] & 0xF6) != 0xF0) {
+        return false;
+    }
+
+    header->object_type = ((data[2] >> 6) & 0x03) + 1;
+    header->sampling_index = (data[2] >> 2) & 0x0F;
+    header->channels = ((data[2] & 0x01) << 2) | ((data[3] >> 6) & 0x03);
+    header->frame_length =
+        ((data[3] & 0x03) << 11) | (data[4] << 3) | ((data[5] >> 5) & 0x07);
+    header->header_size =
+        (data[1] & 0x01) ? kAdtsHeaderSize : kAdtsHeaderSize + kAdtsCrcSize;
+
+    return header->sample_rate() > 0 &&
+           header->frame_length > header->header_size;
+}
+
+AacFileSource::AacFileSource(FILE *file) : MultiFrameFileSource(file) {
+    LOG_DEBUG << "AacFileSource::ctor at " << this;
+
+    std::random_device rd;
+    ssrc_ = rd() & 0xFFFFFFFF;
+}
+
+AacFileSource::~AacFileSource() {
+    LOG_DEBUG << "AacFileSource::dtor at " << this;
+}
+
+bool AacFileSource::Resync() {
+    int c;
+    while ((c = fgetc(file_)) != EOF) {
+        if (c != 0xFF) {
+            continue;
+        }
+        int next = fgetc(file_);
+        if (next == EOF) {
+            return false;
+        }
+        if ((next & 0xF6) == 0xF0) {
+            fseek(file_, -2, SEEK_CUR);
+            return true;
+        }
+        ungetc(next, file_);
+    }
+    return false;
+}
+
+bool AacFileSource::GetNextFrame(AVPacket *packet) {
+    if (!file_) {
+        return false;
+    }
+
+    uint8_t head[kAdtsHeaderSize];
+    AdtsHeader header;
+    for (;;) {
+        if (fread(head, 1, sizeof(head), file_) != sizeof(head)) {
+            return false;
+        }
+        if (ParseAdtsHeader(head, sizeof(head), &header)) {
+            break;
+        }
+
+        // 从下一个字节开始重新查找同步字
+        LOG_WARN << "ADTS sync lost at " << ftell(file_) - sizeof(head);
+        fseek(file_, 1 - (long)sizeof(head), SEEK_CUR);
+        if (!Resync()) {
+            return false;
+        }
+    }
+
+    if (header.header_size > kAdtsHeaderSize) {
+        fseek(file_, header.header_size - kAdtsHeaderSize, SEEK_CUR);
+    }
+
+    uint32_t size = header.frame_length - header.header_size;
+    std::shared_ptr<uint8_t[]> buffer(
+        new uint8_t[defs::kBufPrependSize + size]);
+    if (fread(buffer.get() + defs::kBufPrependSize, 1, size, file_) != size) {
+        return false;
+    }
+
+    packet->buffer = buffer;
+    packet->prepend_size = defs::kBufPrependSize;
+    packet->size = size;
+    packet->type = 0;
+    packet->frame_span = 1;
+    return true;
+}
+
+} // namespace muduo_media
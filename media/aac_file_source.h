@@ -0,0 +1,46 @@
+#ifndef A48F211B_575F_4036_96D9_BE1AA3B38B8E
+#define A48F211B_575F_4036_96D9_BE1AA3B38B8E
+
+#include "av_packet.h"
+#include "multi_frame_file_source.h"
+
+#include <string>
+
+namespace muduo_media {
+
+/// @brief ADTS头中的音频参数
+struct AdtsHeader {
+    uint8_t object_type;    // profile + 1，2为AAC-LC
+    uint8_t sampling_index; // 采样率下标
+    uint8_t channels;       // channel_configuration
+    uint16_t frame_length;  // 含头部
+    uint8_t header_size;    // 7，有CRC时为9
+
+    unsigned int sample_rate() const;
+
+    /// RFC 3640 config=，AudioSpecificConfig的十六进制
+    std::string AudioSpecificConfig() const;
+};
+
+/// 解析data开头的ADTS头，同步字或长度不对时返回false
+bool ParseAdtsHeader(const uint8_t *data, size_t size, AdtsHeader *header);
+
+/// @brief ADTS格式的AAC文件，每次读取一个access unit(不含ADTS头)
+class AacFileSource : public MultiFrameFileSource {
+public:
+    AacFileSource(FILE *file);
+    ~AacFileSource();
+
+    bool GetNextFrame(AVPacket *) override;
+
+    /// 每个AAC帧的采样数
+    static constexpr unsigned int kSamplesPerFrame = 1024;
+
+private:
+    // 丢弃数据直到下一个ADTS同步字，返回false表示文件结束
+    bool Resync();
+};
+
+} // namespace muduo_media
+
+#endif /* A48F211B_575F_4036_96D9_BE1AA3B38B8E */
@@ -0,0 +1,95 @@
+#include "aac_file_subsession.h"
+#include "aac_rtp_sink.h"
+#include "defs.h"
+#include "media_log.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+AacFileSubsession::AacFileSubsession(const std::string &filename,
+                                     int aus_per_packet)
+    : FileMediaSubsession(filename, 0, 0),
+      aus_per_packet_(aus_per_packet),
+      config_valid_(false) {
+    set_payload_type(defs::kMediaFormatAac);
+    ::bzero(&config_, sizeof(config_));
+}
+
+AacFileSubsession::~AacFileSubsession() {}
+
+void AacFileSubsession::ReadConfig() {
+    FILE *file = fopen(filename_.data(), "rb");
+    if (!file) {
+        LOG_ERROR << "open " << filename_ << " fail";
+        return;
+    }
+
+    uint8_t head[9];
+    size_t n = fread(head, 1, sizeof(head), file);
+    fclose(file);
+
+    config_valid_ = ParseAdtsHeader(head, n, &config_);
+    if (!config_valid_) {
+        LOG_ERROR << filename_ << " is not ADTS";
+        return;
+    }
+
+    unsigned int sample_rate = config_.sample_rate();
+    time_base_ = sample_rate;
+    fps_ = (sample_rate + AacFileSource::kSamplesPerFrame / 2) /
+           AacFileSource::kSamplesPerFrame;
+    set_frame_duration(AacFileSource::kSamplesPerFrame);
+
+    LOG_INFO << filename_ << " AAC object type " << (int)config_.object_type
+             << ", " << sample_rate << "Hz, channels "
+             << (int)config_.channels;
+}
+
+void AacFileSubsession::EnsureConfig() {
+    std::call_once(config_once_, [this]() { ReadConfig(); });
+}
+
+std::string AacFileSubsession::GetSdp() {
+    EnsureConfig();
+    if (!config_valid_) {
+        return std::string();
+    }
+
+    char media_sdp[400] = {0};
+    snprintf(media_sdp, sizeof(media_sdp),
+             "m=audio 0 %s %hu\r\n"
+             "a=rtpmap:%hu %s/%u/%u\r\n"
+             "a=fmtp:%hu streamtype=5;profile-level-id=1;mode=AAC-hbr;"
+             "sizelength=13;indexlength=3;indexdeltalength=3;config=%s\r\n"
+             "a=control:%s\r\n",
+             defs::kSdpMediaProtocol, payload_type_, payload_type_,
+             defs::kMimeTypeAac, time_base_, (unsigned int)config_.channels,
+             payload_type_, config_.AudioSpecificConfig().data(),
+             TrackId().data());
+    return media_sdp;
+}
+
+RtpSinkPtr AacFileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+    int8_t rtp_channel) {
+    return std::make_shared<AacRtpSink>(tcp_conn, rtp_channel,
+                                        AacFileSource::kSamplesPerFrame,
+                                        aus_per_packet_);
+}
+
+RtpSinkPtr AacFileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn) {
+    return std::make_shared<AacRtpSink>(
+        udp_conn, AacFileSource::kSamplesPerFrame, aus_per_packet_);
+}
+
+MultiFrameSourcePtr AacFileSubsession::NewMultiFrameSouce() {
+    // 没有DESCRIBE直接SETUP时，在开始播放前确定采样率
+    EnsureConfig();
+
+    FILE *file = fopen(filename_.data(), "rb");
+    return std::make_shared<AacFileSource>(file);
+}
+
+} // namespace muduo_media
@@ -0,0 +1,49 @@
+#ifndef CC3372DC_1FC2_4C64_B42E_7F82D5A14E4E
+#define CC3372DC_1FC2_4C64_B42E_7F82D5A14E4E
+
+#include "aac_file_source.h"
+#include "file_media_subsession.h"
+
+#include <mutex>
+
+namespace muduo_media {
+
+/// @brief ADTS文件，时间基为采样率，每帧1024个采样
+class AacFileSubsession : public FileMediaSubsession {
+
+public:
+    /// aus_per_packet为每个RTP包最多合并的AU数
+    AacFileSubsession(const std::string &filename,
+                      int aus_per_packet = kDefaultAusPerPacket);
+    ~AacFileSubsession();
+
+    std::string GetSdp() override;
+
+    RtpSinkPtr
+    NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+               int8_t rtp_channel) override;
+
+    RtpSinkPtr NewRtpSink(
+        const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn)
+        override;
+
+    MultiFrameSourcePtr NewMultiFrameSouce() override;
+
+    // 44.1kHz时约93ms一个包
+    static constexpr int kDefaultAusPerPacket = 4;
+
+private:
+    // 首次使用时读取第一个ADTS头，确定采样率和声道
+    void ReadConfig();
+    void EnsureConfig();
+
+private:
+    int aus_per_packet_;
+    std::once_flag config_once_;
+    bool config_valid_;
+    AdtsHeader config_;
+};
+
+} // namespace muduo_media
+
+#endif /* CC3372DC_1FC2_4C64_B42E_7F82D5A14E4E */
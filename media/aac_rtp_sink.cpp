@@ -0,0 +1,192 @@
+#include "aac_rtp_sink.h"
+#include "eventloop/endian.h"
+#include "media_log.h"
+
+#include <cstring>
+#include <random>
+
+namespace muduo_media {
+
+AacRtpSink::AacRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
+                       int8_t rtp_channel, unsigned int au_duration,
+                       int max_aus)
+    : AacRtpSink(RtpTransProto::kRtpOverTcp, rtp_channel, au_duration,
+                 max_aus) {
+    tcp_conn_ = tcp_conn;
+}
+
+AacRtpSink::AacRtpSink(const muduo::net::UdpVirtualConnectionPtr &udp_conn,
+                       unsigned int au_duration, int max_aus)
+    : AacRtpSink(RtpTransProto::kRtpOverUdp, -1, au_duration, max_aus) {
+    udp_conn_ = udp_conn;
+}
+
+AacRtpSink::AacRtpSink(RtpTransProto transport, int8_t rtp_channel,
+                       unsigned int au_duration, int max_aus)
+    : transport_(transport),
+      tcp_conn_(nullptr),
+      rtp_channel_(rtp_channel),
+      udp_conn_(nullptr),
+      au_duration_(au_duration),
+      max_aus_(max_aus > 0 ? max_aus : 1),
+      au_count_(0),
+      first_timestamp_(0) {
+
+    std::random_device rd;
+    init_seq_ = rd() & 0xFF; // limited
+    ::bzero(&header_, sizeof(header_));
+    LOG_DEBUG << "AacRtpSink::ctor at " << this;
+}
+
+AacRtpSink::~AacRtpSink() {
+    LOG_DEBUG << "AacRtpSink::dtor at " << this;
+    // 析构时子类已不存在，只会经由本类的Output发出
+    Flush();
+}
+
+void AacRtpSink::Output(const uint8_t *data, size_t len) {
+    if (tcp_conn_) {
+        tcp_conn_->Send(data, len);
+    } else if (udp_conn_) {
+        udp_conn_->Send(data, len);
+    }
+}
+
+size_t AacRtpSink::QueuedBytes() const {
+    return tcp_conn_ ? tcp_conn_->output_buffer()->ReadableBytes() : 0;
+}
+
+void AacRtpSink::Send(const unsigned char *data, int len,
+                      const std::shared_ptr<void> &info) {
+    SendPacket((RtpHeader *)info.get(), nullptr, 0, data, len);
+}
+
+void AacRtpSink::Send(const AVPacket &pkt, const AVPacketInfo &info) {
+    // 连接已断开，不再打包
+    if (tcp_conn_ && !tcp_conn_->Connected()) {
+        ++dropped_frames_;
+        au_headers_.clear();
+        au_data_.clear();
+        au_count_ = 0;
+        return;
+    }
+    if (pkt.size == 0 || pkt.size > 0x1FFF) { // 13位长度
+        ++dropped_frames_;
+        return;
+    }
+
+    // 时间戳不连续(seek、丢帧)时先发出已有的AU
+    if (au_count_ > 0 &&
+        info.timestamp != first_timestamp_ + au_count_ * au_duration_) {
+        Flush();
+    }
+
+    size_t payload = RTP_AAC_AU_HEADERS_LENGTH_SIZE + au_headers_.size() +
+                     au_data_.size() + RTP_AAC_AU_HEADER_SIZE + pkt.size;
+    if (au_count_ > 0 && payload > RTP_MAX_PAYLOAD_SIZE) {
+        Flush();
+    }
+
+    if (au_count_ == 0) {
+        ::bzero(&header_, sizeof(header_));
+        header_.version = RTP_VESION;
+        header_.payloadType = info.payload_type;
+        header_.timestamp = muduo::HostToNetwork32(info.timestamp);
+        header_.ssrc = muduo::HostToNetwork32(info.ssrc);
+        header_.marker = 1;
+        first_timestamp_ = info.timestamp;
+    }
+
+    const uint8_t *data = pkt.buffer.get() + pkt.prepend_size;
+    if (RTP_AAC_AU_HEADERS_LENGTH_SIZE + RTP_AAC_AU_HEADER_SIZE + pkt.size >
+        RTP_MAX_PAYLOAD_SIZE) {
+        SendFragments(pkt, &header_);
+        return;
+    }
+
+    // size(13) | index(3) = 0
+    au_headers_.push_back((char)(pkt.size >> 5));
+    au_headers_.push_back((char)((pkt.size & 0x1F) << 3));
+    au_data_.append((const char *)data, pkt.size);
+    if (++au_count_ >= max_aus_) {
+        Flush();
+    }
+}
+
+void AacRtpSink::Flush() {
+    if (au_count_ == 0) {
+        return;
+    }
+    if (tcp_conn_ && !tcp_conn_->Connected()) {
+        au_headers_.clear();
+        au_data_.clear();
+        au_count_ = 0;
+        return;
+    }
+
+    // AU-headers-length以bit为单位
+    uint16_t headers_bits = au_headers_.size() * 8;
+    au_headers_.insert(0, 1, (char)(headers_bits & 0xFF));
+    au_headers_.insert(0, 1, (char)(headers_bits >> 8));
+
+    SendPacket(&header_, (const uint8_t *)au_headers_.data(),
+               au_headers_.size(), (const uint8_t *)au_data_.data(),
+               au_data_.size());
+
+    au_headers_.clear();
+    au_data_.clear();
+    au_count_ = 0;
+}
+
+void AacRtpSink::SendFragments(const AVPacket &pkt, RtpHeader *header) {
+    const uint8_t *pdata = pkt.buffer.get() + pkt.prepend_size;
+    size_t data_len = pkt.size;
+
+    // 每一片都带完整AU的长度
+    uint8_t head[RTP_AAC_AU_HEADERS_LENGTH_SIZE + RTP_AAC_AU_HEADER_SIZE] = {
+        0, 16, (uint8_t)(pkt.size >> 5), (uint8_t)((pkt.size & 0x1F) << 3)};
+
+    size_t piece = RTP_MAX_PAYLOAD_SIZE - sizeof(head);
+    while (data_len > piece) {
+        header->marker = 0;
+        SendPacket(header, head, sizeof(head), pdata, piece);
+        pdata += piece;
+        data_len -= piece;
+    }
+
+    header->marker = 1;
+    SendPacket(header, head, sizeof(head), pdata, data_len);
+}
+
+void AacRtpSink::SendPacket(RtpHeader *header, const uint8_t *head,
+                            size_t head_len, const uint8_t *data,
+                            size_t len) {
+    size_t prefix = transport_ == RtpTransProto::kRtpOverTcp
+                        ? INTERLEAVED_FRAME_SIZE
+                        : 0;
+    size_t rtp_len = RTP_HEADER_SIZE + head_len + len;
+    std::unique_ptr<uint8_t[]> new_buf(new uint8_t[prefix + rtp_len]);
+
+    uint8_t *ptr = new_buf.get();
+    if (prefix) {
+        ptr[0] = '$';
+        ptr[1] = (uint8_t)rtp_channel_;
+        ptr[2] = (uint8_t)((rtp_len & 0xFF00) >> 8);
+        ptr[3] = (uint8_t)(rtp_len & 0xFF);
+    }
+
+    LOG_TRACE << "send seq " << init_seq_;
+    header->seq = muduo::HostToNetwork16(init_seq_++); // 随机初值，自动增长
+    memcpy(ptr + prefix, header, RTP_HEADER_SIZE);
+    if (head_len) {
+        memcpy(ptr + prefix + RTP_HEADER_SIZE, head, head_len);
+    }
+    memcpy(ptr + prefix + RTP_HEADER_SIZE + head_len, data, len);
+
+    Output(ptr, prefix + rtp_len);
+
+    ++packets_;
+    octets_ += prefix + rtp_len;
+}
+
+} // namespace muduo_media
@@ -0,0 +1,82 @@
+#ifndef B87707D5_832F_4C66_A3A3_E384493CBD9C
+#define B87707D5_832F_4C66_A3A3_E384493CBD9C
+
+#include "defs.h"
+#include "multi_frame_rtp_sink.h"
+#include "net/tcp_connection.h"
+#include "net/udp_virtual_connection.h"
+#include "rtp.h"
+
+#include <string>
+
+namespace muduo_media {
+
+/// @brief RFC 3640 mode=AAC-hbr打包
+///
+/// 连续的多个access unit合成一个RTP包:
+///
+/// +-------------------+-----------+-----+-----------+------+-----+------+
+/// | AU-headers-length | AU-header | ... | AU-header | AU 1 | ... | AU n |
+/// +-------------------+-----------+-----+-----------+------+-----+------+
+///
+/// AU-header为13位长度+3位index(delta)，index为0表示AU连续。凑满
+/// max_aus个、放不下或时间戳不连续时发出，时间戳为第一个AU的时间戳。
+/// 超过一个包的AU分片发送，AU-header中为完整长度，只有最后一片带marker。
+class AacRtpSink : public MultiFrameRtpSink {
+public:
+    AacRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
+               int8_t rtp_channel, unsigned int au_duration, int max_aus);
+
+    AacRtpSink(const muduo::net::UdpVirtualConnectionPtr &udp_conn,
+               unsigned int au_duration, int max_aus);
+
+    virtual ~AacRtpSink();
+
+    // data为完整的RTP载荷，info为RtpHeader
+    void Send(const unsigned char *data, int len,
+              const std::shared_ptr<void> &info) override;
+
+    void Send(const AVPacket &pkt, const AVPacketInfo &info) override;
+
+    size_t QueuedBytes() const override;
+    bool HasOutputQueue() const override { return tcp_conn_ != nullptr; }
+
+    void Flush() override;
+
+protected:
+    // 不绑定连接，子类通过Output接管打包后的数据
+    AacRtpSink(RtpTransProto transport, int8_t rtp_channel,
+               unsigned int au_duration, int max_aus);
+
+    virtual void Output(const uint8_t *data, size_t len);
+
+private:
+    // RTP载荷由head和data两段拼成，按传输方式加上interleaved头
+    void SendPacket(RtpHeader *header, const uint8_t *head, size_t head_len,
+                    const uint8_t *data, size_t len);
+
+    void SendFragments(const AVPacket &pkt, RtpHeader *header);
+
+private:
+    RtpTransProto transport_;
+    muduo::net::TcpConnectionPtr tcp_conn_;
+    int8_t rtp_channel_;
+
+    muduo::net::UdpVirtualConnectionPtr udp_conn_;
+
+    uint16_t init_seq_;
+
+    unsigned int au_duration_; // 每个AU的时间戳步进
+    int max_aus_;
+
+    // 暂存的AU
+    std::string au_headers_;
+    std::string au_data_;
+    int au_count_;
+    RtpHeader header_;
+    uint32_t first_timestamp_;
+};
+
+} // namespace muduo_media
+
+#endif /* B87707D5_832F_4C66_A3A3_E384493CBD9C */
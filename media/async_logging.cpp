@@ -0,0 +1,177 @@
+#include "async_logging.h"
+#include "logger/logger.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace muduo_media {
+
+static constexpr size_t kLogBufferSize = 4 * 1024 * 1024;
+// 后台积压超过这个数量说明写盘跟不上，只保留最早的两块
+static constexpr size_t kMaxPendingBuffers = 16;
+
+static AsyncLogging *g_async_logging = nullptr;
+
+static void AsyncOutput(const char *msg, int len) {
+    g_async_logging->Append(msg, len);
+}
+
+static void AsyncFlush() { g_async_logging->Flush(); }
+
+static void StdoutOutput(const char *msg, int len) {
+    fwrite(msg, 1, len, stdout);
+}
+
+static void StdoutFlush() { fflush(stdout); }
+
+class AsyncLogging::LogBuffer {
+public:
+    LogBuffer() : data_(new char[kLogBufferSize]), len_(0) {}
+
+    const char *data() const { return data_.get(); }
+    size_t length() const { return len_; }
+    size_t avail() const { return kLogBufferSize - len_; }
+
+    void Append(const char *msg, size_t len) {
+        memcpy(data_.get() + len_, msg, len);
+        len_ += len;
+    }
+
+    void Reset() { len_ = 0; }
+
+private:
+    std::unique_ptr<char[]> data_;
+    size_t len_;
+};
+
+AsyncLogging::AsyncLogging(FILE *file, double flush_interval)
+    : file_(file),
+      flush_interval_(flush_interval),
+      running_(false),
+      dropped_buffers_(0),
+      current_(NewBuffer()),
+      next_(NewBuffer()) {}
+
+AsyncLogging::~AsyncLogging() {
+    Stop();
+    if (g_async_logging == this) {
+        g_async_logging = nullptr;
+    }
+}
+
+AsyncLogging::LogBufferPtr AsyncLogging::NewBuffer() {
+    return LogBufferPtr(new LogBuffer);
+}
+
+void AsyncLogging::Start() {
+    assert(!g_async_logging);
+    running_ = true;
+    thread_ = std::thread(&AsyncLogging::ThreadFunc, this);
+
+    g_async_logging = this;
+    muduo::log::Logger::set_output(AsyncOutput);
+    muduo::log::Logger::set_flush(AsyncFlush);
+}
+
+void AsyncLogging::Stop() {
+    if (!running_) {
+        return;
+    }
+
+    // 其他线程可能还拿着旧的输出函数，g_async_logging留到析构再清空
+    muduo::log::Logger::set_output(StdoutOutput);
+    muduo::log::Logger::set_flush(StdoutFlush);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::Append(const char *msg, int len) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_->avail() < (size_t)len) {
+        buffers_.push_back(std::move(current_));
+        current_ = next_ ? std::move(next_) : NewBuffer();
+        cond_.notify_one();
+    }
+    if (current_->avail() >= (size_t)len) {
+        current_->Append(msg, len);
+    }
+}
+
+void AsyncLogging::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &buffer : buffers_) {
+        fwrite(buffer->data(), 1, buffer->length(), file_);
+    }
+    buffers_.clear();
+    fwrite(current_->data(), 1, current_->length(), file_);
+    current_->Reset();
+    fflush(file_);
+}
+
+void AsyncLogging::ThreadFunc() {
+    LogBufferPtr spare1 = NewBuffer();
+    LogBufferPtr spare2 = NewBuffer();
+    std::vector<LogBufferPtr> to_write;
+    bool running = true;
+
+    while (running) {
+        size_t dropped = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty() && running_) {
+                cond_.wait_for(lock, std::chrono::duration<double>(
+                                         flush_interval_));
+            }
+            running = running_;
+
+            // 交换缓冲，锁内只做指针移动
+            buffers_.push_back(std::move(current_));
+            current_ = std::move(spare1);
+            if (!next_) {
+                next_ = std::move(spare2);
+            }
+            to_write.swap(buffers_);
+
+            if (to_write.size() > kMaxPendingBuffers) {
+                dropped = to_write.size() - 2;
+                dropped_buffers_ += dropped;
+                to_write.resize(2);
+            }
+        }
+
+        if (dropped > 0) {
+            fprintf(file_, "async logging dropped %zu buffers, %zu total\n",
+                    dropped, dropped_buffers_);
+        }
+        for (const auto &buffer : to_write) {
+            fwrite(buffer->data(), 1, buffer->length(), file_);
+        }
+        fflush(file_);
+
+        // 回收两块给下一轮使用，其余释放
+        if (to_write.size() > 2) {
+            to_write.resize(2);
+        }
+        spare1 = std::move(to_write.back());
+        spare1->Reset();
+        to_write.pop_back();
+        if (!spare2) {
+            if (!to_write.empty()) {
+                spare2 = std::move(to_write.back());
+                spare2->Reset();
+                to_write.pop_back();
+            } else {
+                spare2 = NewBuffer();
+            }
+        }
+        to_write.clear();
+    }
+}
+
+} // namespace muduo_media
@@ -0,0 +1,58 @@
+#ifndef D92E7C41_B3A8_4F65_8E1D_07C4A5F3B962
+#define D92E7C41_B3A8_4F65_8E1D_07C4A5F3B962
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace muduo_media {
+
+/// @brief 双缓冲异步日志后端
+///
+/// 媒体loop只把格式化好的日志拷进当前缓冲，写满或定时由后台线程统一
+/// 写入文件，loop线程不会阻塞在write上。后台来不及写时丢弃多余的缓冲并
+/// 记录丢弃数量。
+class AsyncLogging {
+public:
+    explicit AsyncLogging(FILE *file = stdout, double flush_interval = 3.0);
+    ~AsyncLogging();
+
+    /// 启动后台线程，并接管muduo::log::Logger的输出
+    void Start();
+    /// 写出剩余日志，恢复同步输出
+    void Stop();
+
+    void Append(const char *msg, int len);
+
+    /// 同步写出所有已缓存的日志，用于FATAL
+    void Flush();
+
+private:
+    class LogBuffer;
+    using LogBufferPtr = std::unique_ptr<LogBuffer>;
+
+    void ThreadFunc();
+
+    LogBufferPtr NewBuffer();
+
+private:
+    FILE *file_;
+    const double flush_interval_;
+    bool running_;
+    size_t dropped_buffers_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+
+    LogBufferPtr current_;
+    LogBufferPtr next_;
+    std::vector<LogBufferPtr> buffers_;
+};
+
+} // namespace muduo_media
+
+#endif /* D92E7C41_B3A8_4F65_8E1D_07C4A5F3B962 */
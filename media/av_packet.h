@@ -11,6 +11,10 @@ struct AVPacket {
     uint32_t size = 0;                 /* 帧大小 */
     uint32_t prepend_size = 0;         /* 预留前置空间*/
     uint8_t type = 0;                  /* 帧类型 */
+    int64_t pts = -1;                  /* 90kHz, -1表示按帧率生成 */
+    uint32_t frame_span = 1;           /* 占的帧数，0为参数集等非图像 */
+    int32_t composition_offset = 0;    /* 展示-解码时间，时间戳单位 */
+    int64_t arrival_us = 0;            /* 转发的帧到达本机的时刻，0为无 */
     // uint32_t timestamp = 0;            /* 时间戳 */
 };
 
@@ -36,6 +40,19 @@ typedef enum {
     NALU_TYPE_FILL = 12,
 } H264NaluType;
 
+// H.265的NALU头为2字节，type = (byte0 >> 1) & 0x3F，小于32的是VCL
+typedef enum {
+    H265_NALU_TYPE_IDR_W_RADL = 19,
+    H265_NALU_TYPE_IDR_N_LP = 20,
+    H265_NALU_TYPE_CRA = 21,
+    H265_NALU_TYPE_VPS = 32,
+    H265_NALU_TYPE_SPS = 33,
+    H265_NALU_TYPE_PPS = 34,
+    H265_NALU_TYPE_AUD = 35,
+    H265_NALU_TYPE_SEI_PREFIX = 39,
+    H265_NALU_TYPE_SEI_SUFFIX = 40,
+} H265NaluType;
+
 typedef enum {
     NALU_PRIORITY_DISPOSABLE = 0,
     NALU_PRIRITY_LOW = 1,
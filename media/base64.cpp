@@ -0,0 +1,87 @@
+#include "base64.h"
+
+#include <cstdint>
+
+namespace muduo_media {
+namespace base64 {
+
+static const char kEncodeTable[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Encode(const std::string &in) {
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 3 <= in.size(); i += 3) {
+        uint32_t bits = (uint8_t)in[i] << 16 | (uint8_t)in[i + 1] << 8 |
+                        (uint8_t)in[i + 2];
+        out.push_back(kEncodeTable[(bits >> 18) & 0x3F]);
+        out.push_back(kEncodeTable[(bits >> 12) & 0x3F]);
+        out.push_back(kEncodeTable[(bits >> 6) & 0x3F]);
+        out.push_back(kEncodeTable[bits & 0x3F]);
+    }
+
+    size_t left = in.size() - i;
+    if (left > 0) {
+        uint32_t bits = (uint8_t)in[i] << 16;
+        if (left == 2) {
+            bits |= (uint8_t)in[i + 1] << 8;
+        }
+        out.push_back(kEncodeTable[(bits >> 18) & 0x3F]);
+        out.push_back(kEncodeTable[(bits >> 12) & 0x3F]);
+        out.push_back(left == 2 ? kEncodeTable[(bits >> 6) & 0x3F] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+static int DecodeChar(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    } else if (c == '+') {
+        return 62;
+    } else if (c == '/') {
+        return 63;
+    }
+    return -1;
+}
+
+bool Decode(const std::string &in, std::string *out) {
+    out->clear();
+    out->reserve(in.size() / 4 * 3);
+
+    uint32_t bits = 0;
+    int bit_count = 0;
+    size_t padding = 0;
+
+    for (char c : in) {
+        if (c == '=') {
+            ++padding;
+            continue;
+        }
+        // '='之后不能再有数据
+        int value = DecodeChar(c);
+        if (value < 0 || padding > 0) {
+            return false;
+        }
+
+        bits = (bits << 6) | (uint32_t)value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            out->push_back((char)((bits >> bit_count) & 0xFF));
+        }
+    }
+
+    // 剩余不足一个字节的位必须是补齐的0
+    return padding <= 2 && bit_count < 6 &&
+           (bits & ((1u << bit_count) - 1)) == 0;
+}
+
+} // namespace base64
+} // namespace muduo_media
@@ -0,0 +1,17 @@
+#ifndef B7E2D4A1_3C69_4F08_9A5E_61D0C8F24B73
+#define B7E2D4A1_3C69_4F08_9A5E_61D0C8F24B73
+
+#include <string>
+
+namespace muduo_media {
+namespace base64 {
+
+std::string Encode(const std::string &in);
+
+/// 解码失败(非法字符、长度不对)返回false
+bool Decode(const std::string &in, std::string *out);
+
+} // namespace base64
+} // namespace muduo_media
+
+#endif /* B7E2D4A1_3C69_4F08_9A5E_61D0C8F24B73 */
@@ -0,0 +1,80 @@
+#ifndef F7C29E41_0B6D_4A83_B5E2_93D14A8C6F05
+#define F7C29E41_0B6D_4A83_B5E2_93D14A8C6F05
+
+#include <cstddef>
+#include <cstdint>
+
+namespace muduo_media {
+
+/// @brief 按位读取RBSP，支持Exp-Golomb
+///
+/// 越界读取返回0并置overflow，调用方在解析结束后检查一次即可。
+/// 全部内联，索引文件时逐个解析SPS也没有额外开销。
+class BitReader {
+public:
+    BitReader(const uint8_t *data, size_t size)
+        : data_(data), size_bits_(size * 8), pos_(0), overflow_(false) {}
+
+    bool overflow() const { return overflow_; }
+    size_t bits_left() const { return size_bits_ - pos_; }
+
+    uint32_t ReadBit() {
+        if (pos_ >= size_bits_) {
+            overflow_ = true;
+            return 0;
+        }
+        uint32_t bit = (data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1;
+        ++pos_;
+        return bit;
+    }
+
+    /// n <= 32
+    uint32_t ReadBits(int n) {
+        uint32_t value = 0;
+        for (int i = 0; i < n; ++i) {
+            value = (value << 1) | ReadBit();
+        }
+        return value;
+    }
+
+    void SkipBits(size_t n) {
+        if (n > bits_left()) {
+            pos_ = size_bits_;
+            overflow_ = true;
+        } else {
+            pos_ += n;
+        }
+    }
+
+    /// ue(v)
+    uint32_t ReadUE() {
+        int leading_zeros = 0;
+        while (ReadBit() == 0) {
+            if (overflow_ || ++leading_zeros > 31) {
+                overflow_ = true;
+                return 0;
+            }
+        }
+        if (0 == leading_zeros) {
+            return 0;
+        }
+        return (uint32_t)((1ull << leading_zeros) - 1 +
+                          ReadBits(leading_zeros));
+    }
+
+    /// se(v)
+    int32_t ReadSE() {
+        uint32_t code = ReadUE();
+        return (code & 1) ? (int32_t)((code + 1) / 2) : -(int32_t)(code / 2);
+    }
+
+private:
+    const uint8_t *data_;
+    size_t size_bits_;
+    size_t pos_;
+    bool overflow_;
+};
+
+} // namespace muduo_media
+
+#endif /* F7C29E41_0B6D_4A83_B5E2_93D14A8C6F05 */
@@ -1,14 +1,23 @@
 #ifndef D6691F0E_BEE2_4A23_B41A_E551C272E83F
 #define D6691F0E_BEE2_4A23_B41A_E551C272E83F
 
+#include "av_packet.h"
 #include "multi_frame_file_source.h"
 
 namespace muduo_media {
 
+/// @brief Annex B字节流(起始码分隔的NALU)文件，H.264/H.265共用
 class ByteStreamFileSource : public MultiFrameFileSource {
 public:
-    ByteStreamFileSource() = default;
+    ByteStreamFileSource(FILE *file);
     virtual ~ByteStreamFileSource() = default;
+
+protected:
+    // 读取下一个NALU(不含起始码)，返回读取的字节数，<=0表示结束或出错
+    int GetNextNALU(H264Nalu *nalu);
+
+    // 读取下一个NALU到packet，type由子类按NALU头设置
+    bool ReadNalu(AVPacket *packet);
 };
 
 } // namespace muduo_media
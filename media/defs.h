@@ -11,6 +11,9 @@ constexpr auto kBufPrependSize = 20;
 constexpr auto kAppName = "Muduo Media Server";
 
 constexpr auto kMimeTypeH264 = "H264";
+constexpr auto kMimeTypeH265 = "H265";
+constexpr auto kMimeTypeAac = "mpeg4-generic";
+constexpr auto kMimeTypeMp2t = "MP2T";
 
 enum class MediaCodecID {
     CODEC_ID_NONE = 0,
@@ -35,6 +38,9 @@ enum class RtpTransportProtocol {
 };
 
 constexpr int kMediaFormatH264 = 96;
+constexpr int kMediaFormatH265 = 98;
+constexpr int kMediaFormatAac = 97;
+constexpr int kMediaFormatMp2t = 33; // RFC 3551静态类型
 constexpr int kMediaTsDuration = 3600; // 9000/25
 
 /*================ RTSP ==================*/
@@ -6,6 +6,10 @@
 namespace muduo_media {
 
 class FileMediaSubsession : public MediaSubsession {
+public:
+    // 时长还未知时也是点播
+    bool IsLive() const override { return false; }
+
 protected: // we're a virtual base class
     FileMediaSubsession(const std::string &filename, unsigned int fps = 25,
                         unsigned int time_base = 90000);
@@ -0,0 +1,393 @@
+#include "h264_file_index.h"
+#include "av_packet.h"
+#include "media_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+static constexpr size_t kScanChunkSize = 1 << 20;
+
+static const char kIndexMagic[8] = {'H', '2', '6', '4', 'I', 'D', 'X', '\0'};
+static constexpr uint32_t kIndexByteOrder = 0x01020304;
+
+// .idx文件头，各段紧随其后，偏移由数量推算
+struct H264IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t media_size;
+    int64_t media_mtime_ns;
+    uint64_t frame_count;
+    uint64_t nal_count;
+    uint64_t keyframe_count;
+    uint32_t sps_size;
+    uint32_t pps_size;
+};
+
+// 保证mmap后NALU数组按8字节对齐
+static_assert(sizeof(H264IndexFileHeader) % 8 == 0, "index header alignment");
+
+H264FileIndex::H264FileIndex()
+    : nals_(nullptr),
+      nal_count_(0),
+      keyframes_(nullptr),
+      keyframe_count_(0),
+      frame_count_(0),
+      mapping_(nullptr),
+      mapping_size_(0),
+      media_size_(0),
+      media_mtime_ns_(0),
+      sps_valid_(false) {}
+
+H264FileIndex::~H264FileIndex() {
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+    }
+}
+
+std::string H264FileIndex::IndexPath(const std::string &filename) {
+    return filename + ".idx";
+}
+
+bool H264FileIndex::StatMedia(const std::string &filename, uint64_t *size,
+                              int64_t *mtime_ns) {
+    struct stat st;
+    if (::stat(filename.data(), &st) != 0) {
+        return false;
+    }
+    *size = st.st_size;
+    *mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+bool H264FileIndex::IsFrameNal(uint8_t type) {
+    return type != NALU_TYPE_SPS && type != NALU_TYPE_PPS &&
+           type != NALU_TYPE_SEI && type != NALU_TYPE_AUD;
+}
+
+std::shared_ptr<H264FileIndex>
+H264FileIndex::Build(const std::string &filename) {
+    std::shared_ptr<H264FileIndex> index(new H264FileIndex);
+    // 扫描之前取文件状态，扫描期间文件被修改时下次加载会发现不一致
+    if (!StatMedia(filename, &index->media_size_, &index->media_mtime_ns_)) {
+        LOG_ERROR << "stat " << filename << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    FILE *file = fopen(filename.data(), "rb");
+    if (!file) {
+        LOG_ERROR << "open " << filename << " fail";
+        return nullptr;
+    }
+
+    std::vector<H264NalEntry> &nals = index->nal_storage_;
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[kScanChunkSize]);
+
+    // 逐字节查找起始码，跨块时zeros保留状态
+    uint64_t base = 0;
+    int zeros = 0;
+    bool want_header = false;
+    bool want_slice = false;
+    size_t n;
+    while ((n = fread(buf.get(), 1, kScanChunkSize, file)) > 0) {
+        const uint8_t *data = buf.get();
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t b = data[i];
+            if (want_slice) {
+                // first_mb_in_slice为ue(v)，首位为1时值为0
+                if (b & 0x80) {
+                    nals.back().flags |= kH264NalFirstSlice;
+                }
+                want_slice = false;
+            }
+            if (want_header) {
+                uint8_t type = b & 0x1F;
+                nals.back().type = type;
+                want_slice = type == NALU_TYPE_IDR || type == NALU_TYPE_SLICE;
+                want_header = false;
+            }
+            if (b == 0) {
+                ++zeros;
+                continue;
+            }
+            if (b == 1 && zeros >= 2) {
+                uint64_t start = base + i - (zeros >= 3 ? 3 : 2);
+                if (!nals.empty()) {
+                    nals.back().size = (uint32_t)(start - nals.back().offset);
+                }
+                nals.push_back({start, 0, 0, 0, 0});
+                want_header = true;
+                want_slice = false;
+            }
+            zeros = 0;
+        }
+        base += n;
+    }
+    if (!nals.empty()) {
+        nals.back().size = (uint32_t)(base - nals.back().offset);
+    }
+
+    index->Finish(file);
+    fclose(file);
+
+    LOG_INFO << "indexed " << filename << ", NALUs " << nals.size()
+             << ", frames " << index->frame_count_ << ", keyframes "
+             << index->keyframe_count_;
+    return index;
+}
+
+std::shared_ptr<H264FileIndex>
+H264FileIndex::FromNals(const std::string &filename,
+                        std::vector<H264NalEntry> nals) {
+    std::shared_ptr<H264FileIndex> index(new H264FileIndex);
+    if (!StatMedia(filename, &index->media_size_, &index->media_mtime_ns_)) {
+        LOG_ERROR << "stat " << filename << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    FILE *file = fopen(filename.data(), "rb");
+    if (!file) {
+        LOG_ERROR << "open " << filename << " fail";
+        return nullptr;
+    }
+
+    index->nal_storage_ = std::move(nals);
+    index->Finish(file);
+    fclose(file);
+    return index;
+}
+
+void H264FileIndex::Finish(FILE *file) {
+    keyframe_storage_.clear();
+    frame_count_ = 0;
+
+    // 帧之前连续的参数集/SEI，定位到IDR时一并发送
+    bool in_prefix = false;
+    uint64_t prefix_offset = 0;
+
+    const H264NalEntry *sps = nullptr;
+    const H264NalEntry *pps = nullptr;
+
+    for (const H264NalEntry &nal : nal_storage_) {
+        if (nal.type == NALU_TYPE_SPS && !sps) {
+            sps = &nal;
+        } else if (nal.type == NALU_TYPE_PPS && !pps) {
+            pps = &nal;
+        }
+
+        if (!IsFrameNal(nal.type)) {
+            if (!in_prefix) {
+                in_prefix = true;
+                prefix_offset = nal.offset;
+            }
+            continue;
+        }
+
+        // 多slice的IDR只在第一个slice建立关键帧
+        if (nal.type == NALU_TYPE_IDR && (nal.flags & kH264NalFirstSlice)) {
+            keyframe_storage_.push_back(
+                {frame_count_, in_prefix ? prefix_offset : nal.offset});
+        }
+        in_prefix = false;
+        ++frame_count_;
+    }
+
+    if (sps) {
+        parameter_sets_.sps = ReadNal(file, *sps);
+    }
+    if (pps) {
+        parameter_sets_.pps = ReadNal(file, *pps);
+    }
+    ParseSps();
+
+    nals_ = nal_storage_.data();
+    nal_count_ = nal_storage_.size();
+    keyframes_ = keyframe_storage_.data();
+    keyframe_count_ = keyframe_storage_.size();
+}
+
+void H264FileIndex::ParseSps() {
+    sps_valid_ = !parameter_sets_.sps.empty() &&
+                 ParseH264Sps((const uint8_t *)parameter_sets_.sps.data(),
+                              parameter_sets_.sps.size(), &sps_info_);
+}
+
+std::string H264FileIndex::ReadNal(FILE *file, const H264NalEntry &entry) {
+    std::string data(entry.size, '\0');
+    if (fseek(file, entry.offset, SEEK_SET) != 0 ||
+        fread(&data[0], 1, entry.size, file) != entry.size) {
+        return std::string();
+    }
+
+    // 去掉起始码
+    size_t pos = data.find('\x01');
+    return pos == std::string::npos ? std::string() : data.substr(pos + 1);
+}
+
+const H264KeyFrame *H264FileIndex::FindKeyFrame(uint64_t frame) const {
+    const H264KeyFrame *end = keyframes_ + keyframe_count_;
+    const H264KeyFrame *it = std::upper_bound(
+        keyframes_, end, frame,
+        [](uint64_t f, const H264KeyFrame &key) { return f < key.frame; });
+    if (it == keyframes_) {
+        return nullptr;
+    }
+    return it - 1;
+}
+
+std::shared_ptr<H264FileIndex>
+H264FileIndex::Load(const std::string &filename) {
+    uint64_t media_size = 0;
+    int64_t media_mtime_ns = 0;
+    if (!StatMedia(filename, &media_size, &media_mtime_ns)) {
+        return nullptr;
+    }
+
+    std::string path = IndexPath(filename);
+    int fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(H264IndexFileHeader)) {
+        ::close(fd);
+        LOG_WARN << path << " too short";
+        return nullptr;
+    }
+
+    size_t length = st.st_size;
+    void *addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOG_ERROR << "mmap " << path << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    // 之后由index负责munmap
+    std::shared_ptr<H264FileIndex> index(new H264FileIndex);
+    index->mapping_ = addr;
+    index->mapping_size_ = length;
+
+    const H264IndexFileHeader *header = (const H264IndexFileHeader *)addr;
+    if (memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+        header->version != kH264IndexVersion ||
+        header->byte_order != kIndexByteOrder) {
+        LOG_WARN << path << " unsupported format";
+        return nullptr;
+    }
+    if (header->media_size != media_size ||
+        header->media_mtime_ns != media_mtime_ns) {
+        LOG_INFO << path << " is stale";
+        return nullptr;
+    }
+
+    // 数量来自文件内容，先检查再计算长度，避免溢出
+    size_t max_entries = length / sizeof(H264NalEntry);
+    if (header->nal_count > max_entries ||
+        header->keyframe_count > max_entries) {
+        LOG_WARN << path << " corrupted";
+        return nullptr;
+    }
+    size_t nals_offset = sizeof(H264IndexFileHeader);
+    size_t keyframes_offset =
+        nals_offset + header->nal_count * sizeof(H264NalEntry);
+    size_t sps_offset =
+        keyframes_offset + header->keyframe_count * sizeof(H264KeyFrame);
+    size_t pps_offset = sps_offset + header->sps_size;
+    if (pps_offset + header->pps_size != length) {
+        LOG_WARN << path << " corrupted";
+        return nullptr;
+    }
+
+    const char *base = (const char *)addr;
+    index->nals_ = (const H264NalEntry *)(base + nals_offset);
+    index->nal_count_ = header->nal_count;
+    index->keyframes_ = (const H264KeyFrame *)(base + keyframes_offset);
+    index->keyframe_count_ = header->keyframe_count;
+    index->frame_count_ = header->frame_count;
+    index->media_size_ = media_size;
+    index->media_mtime_ns_ = media_mtime_ns;
+    index->parameter_sets_.sps.assign(base + sps_offset, header->sps_size);
+    index->parameter_sets_.pps.assign(base + pps_offset, header->pps_size);
+    index->ParseSps();
+
+    LOG_DEBUG << "loaded " << path << ", NALUs " << index->nal_count_
+              << ", keyframes " << index->keyframe_count_;
+    return index;
+}
+
+bool H264FileIndex::Save(const std::string &filename) const {
+    H264IndexFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.version = kH264IndexVersion;
+    header.byte_order = kIndexByteOrder;
+    header.media_size = media_size_;
+    header.media_mtime_ns = media_mtime_ns_;
+    header.frame_count = frame_count_;
+    header.nal_count = nal_count_;
+    header.keyframe_count = keyframe_count_;
+    header.sps_size = parameter_sets_.sps.size();
+    header.pps_size = parameter_sets_.pps.size();
+
+    struct Part {
+        const void *data;
+        size_t size;
+    } parts[] = {
+        {&header, sizeof(header)},
+        {nals_, nal_count_ * sizeof(H264NalEntry)},
+        {keyframes_, keyframe_count_ * sizeof(H264KeyFrame)},
+        {parameter_sets_.sps.data(), parameter_sets_.sps.size()},
+        {parameter_sets_.pps.data(), parameter_sets_.pps.size()},
+    };
+
+    // 同目录下的临时文件，rename保证读者看到的是完整的旧文件或新文件
+    std::string path = IndexPath(filename);
+    std::string tmp_path = path + ".tmp." + std::to_string(::getpid());
+    int fd = ::open(tmp_path.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd < 0) {
+        LOG_WARN << "create " << tmp_path << " fail, errno " << errno;
+        return false;
+    }
+
+    bool ok = true;
+    for (auto &&part : parts) {
+        const char *data = (const char *)part.data;
+        size_t left = part.size;
+        while (ok && left > 0) {
+            ssize_t n = ::write(fd, data, left);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            data += n;
+            left -= n;
+        }
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    ok = ok && ::rename(tmp_path.data(), path.data()) == 0;
+
+    if (!ok) {
+        LOG_WARN << "write " << path << " fail, errno " << errno;
+        ::unlink(tmp_path.data());
+        return false;
+    }
+    return true;
+}
+
+} // namespace muduo_media
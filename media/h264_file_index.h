@@ -0,0 +1,137 @@
+#ifndef C5A18F72_E93B_4D06_A7C4_2D8B61F0E539
+#define C5A18F72_E93B_4D06_A7C4_2D8B61F0E539
+
+#include "h264_parameter_sets.h"
+#include "h264_sps_parser.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace muduo_media {
+
+// 以下两个结构体原样写入.idx文件，修改布局时需要升级kH264IndexVersion
+struct H264NalEntry {
+    uint64_t offset; // 起始码在文件中的位置
+    uint32_t size;   // 含起始码
+    uint8_t type;
+    uint8_t flags;   // kH264NalFirstSlice
+    uint16_t reserved;
+};
+
+// slice的first_mb_in_slice为0，即一幅图像的第一个slice
+constexpr uint8_t kH264NalFirstSlice = 0x01;
+
+struct H264KeyFrame {
+    uint64_t frame;  // IDR的帧序号，从0开始
+    uint64_t offset; // IDR之前紧邻的SPS/PPS/SEI的起始位置，从这里读取
+};
+
+static_assert(sizeof(H264NalEntry) == 16, "H264NalEntry layout");
+static_assert(sizeof(H264KeyFrame) == 16, "H264KeyFrame layout");
+
+constexpr uint32_t kH264IndexVersion = 1;
+
+/// @brief H.264裸流文件的NALU和关键帧索引
+///
+/// 帧序号与PlayOnce的节奏一致: 除SPS/PPS/SEI/AUD之外的每个NALU算一帧。
+/// 关键帧按帧序号有序，定位为二分查找。
+///
+/// 索引可以保存为媒体文件旁的.idx文件:
+///
+/// +--------+--------------+----------------+-----+-----+
+/// | header | H264NalEntry | H264KeyFrame   | SPS | PPS |
+/// |        | x nal_count  | x keyframe_cnt |     |     |
+/// +--------+--------------+----------------+-----+-----+
+///
+/// header记录版本、字节序和媒体文件的大小/mtime，不一致时视为失效。
+/// Load直接mmap，NALU和关键帧数组不做拷贝，与文件大小无关。
+class H264FileIndex {
+public:
+    ~H264FileIndex();
+
+    /// 扫描整个文件，失败返回nullptr
+    static std::shared_ptr<H264FileIndex> Build(const std::string &filename);
+
+    /// 由已知的NALU位置建立索引(如录制时边写边记录)，只读取参数集，
+    /// 不扫描文件。文件须已写完
+    static std::shared_ptr<H264FileIndex>
+    FromNals(const std::string &filename, std::vector<H264NalEntry> nals);
+
+    /// 加载filename对应的.idx，不存在、损坏或与媒体文件不一致时返回nullptr
+    static std::shared_ptr<H264FileIndex> Load(const std::string &filename);
+
+    /// 写入filename对应的.idx，先写临时文件再rename
+    bool Save(const std::string &filename) const;
+
+    /// "file.h264" -> "file.h264.idx"
+    static std::string IndexPath(const std::string &filename);
+
+    const H264NalEntry *nals() const { return nals_; }
+    size_t nal_count() const { return nal_count_; }
+    const H264KeyFrame *keyframes() const { return keyframes_; }
+    size_t keyframe_count() const { return keyframe_count_; }
+    uint64_t frame_count() const { return frame_count_; }
+
+    /// 是否来自.idx文件
+    bool mapped() const { return mapping_ != nullptr; }
+
+    /// 第一组SPS/PPS
+    const H264ParameterSets &parameter_sets() const { return parameter_sets_; }
+
+    /// SPS解析结果，解析失败时sps_valid()为false
+    bool sps_valid() const { return sps_valid_; }
+    const H264SpsInfo &sps_info() const { return sps_info_; }
+
+    /// frame之前(含)最近的关键帧，没有时返回nullptr
+    const H264KeyFrame *FindKeyFrame(uint64_t frame) const;
+
+    /// 该NALU是否计为一帧
+    static bool IsFrameNal(uint8_t type);
+
+private:
+    H264FileIndex();
+
+    // 按nal_storage_补全关键帧、帧数和参数集
+    void Finish(FILE *file);
+
+    // 解析参数集中的SPS
+    void ParseSps();
+
+    static std::string ReadNal(FILE *file, const H264NalEntry &entry);
+
+    // 取得媒体文件的大小和mtime(ns)
+    static bool StatMedia(const std::string &filename, uint64_t *size,
+                          int64_t *mtime_ns);
+
+private:
+    // Build时的数据，Load时为空
+    std::vector<H264NalEntry> nal_storage_;
+    std::vector<H264KeyFrame> keyframe_storage_;
+
+    // 指向storage或者mmap
+    const H264NalEntry *nals_;
+    size_t nal_count_;
+    const H264KeyFrame *keyframes_;
+    size_t keyframe_count_;
+    uint64_t frame_count_;
+
+    void *mapping_;
+    size_t mapping_size_;
+
+    // 建立索引时媒体文件的状态
+    uint64_t media_size_;
+    int64_t media_mtime_ns_;
+
+    H264ParameterSets parameter_sets_;
+    bool sps_valid_;
+    H264SpsInfo sps_info_;
+};
+
+using H264FileIndexPtr = std::shared_ptr<const H264FileIndex>;
+
+} // namespace muduo_media
+
+#endif /* C5A18F72_E93B_4D06_A7C4_2D8B61F0E539 */
@@ -1,31 +1,24 @@
 #include "h264_file_source.h"
 #include "defs.h"
 #include "eventloop/timestamp.h"
-#include "logger/logger.h"
+#include "media_log.h"
 #include "media/av_packet.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <random>
 
 namespace muduo_media {
-
-
-
-static bool MatchStartCode3Bytes(unsigned char *Buf) {
-    if (Buf[0] != 0 || Buf[1] != 0 || Buf[2] != 1)
-        return false; // 0x000001?
-    else
-        return true;
-}
-
-static bool MatchStartCode4Bytes(unsigned char *Buf) {
-    if (Buf[0] != 0 || Buf[1] != 0 || Buf[2] != 0 || Buf[3] != 1)
-        return false; // 0x00000001?
-    else
-        return true;
-}
-
-H264FileSource::H264FileSource(FILE *file) : MultiFrameFileSource(file) {
+H264FileSource::H264FileSource(FILE *file)
+    : ByteStreamFileSource(file),
+      frame_interval_(0),
+      scale_(1.0),
+      keyframes_only_(false),
+      trick_next_(0),
+      trick_in_au_(false),
+      trick_au_end_(0),
+      trick_span_(1) {
     LOG_DEBUG << "H264FileSource::ctor at " << this;
 
     std::random_device rd;
@@ -36,141 +29,158 @@ H264FileSource::~H264FileSource() {
     LOG_DEBUG << "H264FileSource::dtor at " << this;
 }
 
-int H264FileSource::GetNextNALU(H264Nalu *nalu) {
-    nalu->len = 0; // reset immediately
-    nalu->statcode_length = 0;
-    // >= kInterleavedFrameSize + RTP_HEADER_SIZE
-    nalu->prepend_size = defs::kBufPrependSize;
-
-    size_t data_buf_len = 10000;
-    unsigned char *data_buf = new unsigned char[data_buf_len];
-
-    size_t read_len = fread(data_buf, 1, data_buf_len, file_);
-    if (read_len < 3) {
-        delete[] data_buf;
-        return 0;
+bool H264FileSource::EnsureIndex() {
+    if (!index_ && index_loader_) {
+        index_ = index_loader_();
+        if (index_) {
+            index_loader_ = nullptr;
+        }
     }
+    return index_ != nullptr;
+}
 
-    // data cursor
-    unsigned char *pdata = data_buf;
-    // pdata must be smaller than this
-    unsigned char *pdata_end = data_buf + read_len;
+bool H264FileSource::Seek(double npt, double *start_npt) {
+    if (!file_ || !EnsureIndex() || frame_interval_ <= 0) {
+        return false;
+    }
 
-    if (!MatchStartCode3Bytes(pdata)) {
-        if (read_len < 4) {
-            delete[] data_buf;
-            return 0;
-        }
-        if (!MatchStartCode4Bytes(pdata)) {
-            delete[] data_buf;
-            return -1;
-        } else {
-            nalu->statcode_length = 4;
-            pdata += 4;
-        }
-    } else {
-        nalu->statcode_length = 3;
-        pdata += 3;
+    uint64_t frame = npt > 0 ? (uint64_t)(npt / frame_interval_) : 0;
+    const H264KeyFrame *keyframe = index_->FindKeyFrame(frame);
+    if (!keyframe) {
+        return false;
     }
 
-    int next_startcode_length = 0;
+    if (0 != fseek(file_, keyframe->offset, SEEK_SET)) {
+        LOG_ERROR << "seek to " << keyframe->offset << " fail";
+        return false;
+    }
 
-    ssize_t rewind = 0;
+    trick_next_ = keyframe - index_->keyframes();
+    trick_in_au_ = false;
+    *start_npt = keyframe->frame * frame_interval_;
+    LOG_DEBUG << "seek npt " << npt << " -> keyframe " << keyframe->frame
+              << " at " << keyframe->offset;
+    return true;
+}
 
-    while (pdata != pdata_end) {
-        if (!MatchStartCode4Bytes(pdata)) {
-            if (MatchStartCode3Bytes(pdata)) {
-                next_startcode_length = 3;
-                break;
-            }
-        } else {
-            next_startcode_length = 4;
-            break;
-        }
+bool H264FileSource::SetScale(double scale) {
+    if (scale == 0) {
+        return false;
+    }
+    bool keyframes_only = scale < 0 || scale > kMaxFullFrameScale;
+    if (keyframes_only &&
+        (!file_ || !EnsureIndex() || !index_->keyframe_count())) {
+        return false;
+    }
 
-        ++pdata;
-
-        if (pdata == pdata_end) {
-            if (feof(file_)) {
-                break;
-            }
-
-            rewind = -3;
-            if (0 != fseek(file_, rewind, SEEK_CUR)) {
-                delete[] data_buf;
-                printf("GetNextNALU: Cannot fseek in the bit stream file");
-                return -1;
-            }
-
-            pdata -= 3;
-
-            ssize_t cur_data_len = pdata - data_buf;
-            if (nalu->len == 0) { // first buf
-                nalu->AppendData(data_buf + nalu->statcode_length,
-                                 cur_data_len - nalu->statcode_length);
-            } else {
-                nalu->AppendData(data_buf, cur_data_len);
-            }
-
-            read_len = fread(data_buf, 1, data_buf_len, file_);
-            if (read_len <= 0) {
-                delete[] data_buf;
-                return -1;
-            }
-            pdata_end = data_buf + read_len; // update
-            pdata = data_buf;
-        }
+    if (keyframes_only && !keyframes_only_) {
+        // 从当前位置所在的GOP开始
+        long pos = ftell(file_);
+        const H264KeyFrame *begin = index_->keyframes();
+        const H264KeyFrame *end = begin + index_->keyframe_count();
+        const H264KeyFrame *it = std::upper_bound(
+            begin, end, (uint64_t)std::max(pos, 0L),
+            [](uint64_t offset, const H264KeyFrame &key) {
+                return offset < key.offset;
+            });
+        trick_next_ = it == begin ? 0 : it - begin - 1;
+        trick_in_au_ = false;
     }
 
-    // Here, we have found another start code (and read length of startcode
-    // bytes more than we should have.  Hence, go back in the file
-    rewind = pdata - pdata_end;
+    scale_ = scale;
+    keyframes_only_ = keyframes_only;
+    return true;
+}
 
-    if (0 != fseek(file_, rewind, SEEK_CUR)) {
-        delete[] data_buf;
-        printf("GetNextNALU: Cannot fseek in the bit stream file");
-        return -1;
+bool H264FileSource::StartTrickKeyFrame() {
+    const H264KeyFrame *keyframes = index_->keyframes();
+    int64_t count = index_->keyframe_count();
+    if (trick_next_ < 0 || trick_next_ >= count) {
+        return false;
     }
 
-    ssize_t cur_data_len = pdata - data_buf;
-    if (nalu->len) {
-        nalu->AppendData(data_buf, cur_data_len);
-    } else {
-        nalu->AppendData(data_buf + nalu->statcode_length,
-                         cur_data_len - nalu->statcode_length);
+    // 跳过过密的关键帧，使两个关键帧之间至少间隔一个正常帧时长
+    int64_t current = trick_next_;
+    int64_t next = current;
+    int dir = scale_ > 0 ? 1 : -1;
+    uint64_t span = 0;
+    while (span < std::fabs(scale_)) {
+        next += dir;
+        if (next < 0 || next >= count) {
+            uint64_t last = dir > 0 ? index_->frame_count() : 0;
+            span = std::max<uint64_t>(
+                1, dir > 0 ? last - keyframes[current].frame
+                           : keyframes[current].frame - last);
+            break;
+        }
+        span = dir > 0 ? keyframes[next].frame - keyframes[current].frame
+                       : keyframes[current].frame - keyframes[next].frame;
     }
-    delete[] data_buf;
-
-    nalu->forbidden_bit = nalu->buf[nalu->prepend_size] & 0x80;     // 1 bit
-    nalu->nal_reference_idc = nalu->buf[nalu->prepend_size] & 0x60; // 2 bit
-    nalu->nal_unit_type = (nalu->buf[nalu->prepend_size]) & 0x1f;   // 5 bit
+    trick_next_ = next;
+    trick_span_ = (uint32_t)span;
+
+    // 关键帧之前的参数集，IDR的所有slice，到下一个NALU为止
+    const H264NalEntry *nals = index_->nals();
+    const H264NalEntry *nals_end = nals + index_->nal_count();
+    const H264NalEntry *nal = std::lower_bound(
+        nals, nals_end, keyframes[current].offset,
+        [](const H264NalEntry &entry, uint64_t offset) {
+            return entry.offset < offset;
+        });
+    while (nal != nals_end && !H264FileIndex::IsFrameNal(nal->type)) {
+        ++nal;
+    }
+    if (nal != nals_end) {
+        ++nal;
+    }
+    while (nal != nals_end && nal->type == NALU_TYPE_IDR &&
+           !(nal->flags & kH264NalFirstSlice)) {
+        ++nal;
+    }
+    trick_au_end_ = nal != nals_end
+                        ? nal->offset
+                        : nals_end[-1].offset + nals_end[-1].size;
 
-    return nalu->len + nalu->statcode_length;
+    if (0 != fseek(file_, keyframes[current].offset, SEEK_SET)) {
+        LOG_ERROR << "seek to " << keyframes[current].offset << " fail";
+        return false;
+    }
+    trick_in_au_ = true;
+    return true;
 }
 
 bool H264FileSource::GetNextFrame(AVPacket *packet) {
     if (!file_) {
         return false;
     }
+    if (!keyframes_only_) {
+        return ReadFrame(packet);
+    }
 
-    std::unique_ptr<H264Nalu> nalu(new H264Nalu);
-    ::bzero(nalu.get(), sizeof(H264Nalu));
-
-    int buffersize = 100000;
-    nalu->max_size = buffersize;
-    nalu->buf.reset(new unsigned char[buffersize]);
-
-    int data_lenth = GetNextNALU(nalu.get());
-    if (data_lenth > 0) {
-        packet->size = nalu->len;
-        packet->buffer = nalu->buf;
-        packet->prepend_size = nalu->prepend_size;
-        packet->type = nalu->nal_unit_type;
+    if (!trick_in_au_ && !StartTrickKeyFrame()) {
+        return false;
+    }
+    if (!ReadFrame(packet)) {
+        return false;
+    }
 
-        return true;
+    // 关键帧的最后一个NALU承担到下一个关键帧的时长
+    if ((uint64_t)ftell(file_) >= trick_au_end_) {
+        trick_in_au_ = false;
+        packet->frame_span = trick_span_;
+    } else {
+        packet->frame_span = 0;
     }
+    return true;
+}
 
-    return false;
+bool H264FileSource::ReadFrame(AVPacket *packet) {
+    if (!ReadNalu(packet)) {
+        return false;
+    }
+    packet->type = packet->buffer[packet->prepend_size] & 0x1F;
+    packet->frame_span = H264FileIndex::IsFrameNal(packet->type) ? 1 : 0;
+    return true;
 }
 
 } // namespace muduo_media
\ No newline at end of file
@@ -2,19 +2,63 @@
 #define BFF1D915_36C9_46D9_8CAE_4C2B2782D200
 
 #include "av_packet.h"
-#include "multi_frame_file_source.h"
+#include "h264_file_index.h"
+#include "byte_stream_file_source.h"
+
+#include <functional>
 
 namespace muduo_media {
 
-class H264FileSource : public MultiFrameFileSource {
+class H264FileSource : public ByteStreamFileSource {
 public:
     H264FileSource(FILE *file);
     ~H264FileSource();
 
     bool GetNextFrame(AVPacket *) override;
 
+    /// frame_interval为每帧的秒数
+    void set_index(const H264FileIndexPtr &index, double frame_interval) {
+        index_ = index;
+        frame_interval_ = frame_interval;
+    }
+
+    /// 索引还在后台建立时，Seek/SetScale需要索引时调用loader，取到后不再
+    /// 调用。loader须线程安全
+    void set_index_loader(const std::function<H264FileIndexPtr()> &loader,
+                          double frame_interval) {
+        index_loader_ = loader;
+        frame_interval_ = frame_interval;
+    }
+
+    bool Seek(double npt, double *start_npt) override;
+
+    /// |scale|不超过kMaxFullFrameScale时发送全部帧，由发送方加快节奏；
+    /// 更快或倒放时只发送关键帧，需要索引
+    bool SetScale(double scale) override;
+
+    static constexpr double kMaxFullFrameScale = 2.0;
+
 private:
-    int GetNextNALU(H264Nalu *nalu);
+    bool ReadFrame(AVPacket *packet);
+
+    // 有索引或者刚由index_loader_取得时返回true
+    bool EnsureIndex();
+
+    // 定位到trick_next_处的关键帧，并选出下一个关键帧
+    bool StartTrickKeyFrame();
+
+private:
+    H264FileIndexPtr index_;
+    std::function<H264FileIndexPtr()> index_loader_;
+    double frame_interval_;
+
+    // 只发送关键帧的快进/倒放
+    double scale_;
+    bool keyframes_only_;
+    int64_t trick_next_;     // 下一个要发送的关键帧下标，越界表示结束
+    bool trick_in_au_;       // 正在发送当前关键帧
+    uint64_t trick_au_end_;  // 当前关键帧最后一个slice的结束位置
+    uint32_t trick_span_;    // 当前关键帧到下一个关键帧的帧数
 };
 
 } // namespace muduo_media
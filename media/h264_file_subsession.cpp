@@ -1,20 +1,172 @@
 #include "h264_file_subsession.h"
 #include "defs.h"
 #include "h264_file_source.h"
+#include "h264_sps_parser.h"
 #include "h264_video_rtp_sink.h"
+#include "media_log.h"
+#include "metrics.h"
 
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <thread>
 
 namespace muduo_media {
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+namespace {
+
+/// 扫描整个文件建立索引的后台线程，所有文件共用，按提交顺序执行
+class IndexBuilder {
+public:
+    static IndexBuilder &Instance() {
+        // 不析构，退出时可能仍在扫描
+        static IndexBuilder *builder = new IndexBuilder;
+        return *builder;
+    }
+
+    void Post(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+        cond_.notify_one();
+    }
+
+private:
+    IndexBuilder() { std::thread([this]() { ThreadFunc(); }).detach(); }
+
+    void ThreadFunc() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this]() { return !tasks_.empty(); });
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<std::function<void()>> tasks_;
+};
+
+} // namespace
+
 H264FileSubsession::H264FileSubsession(const std::string &filename,
                                        unsigned int fps, unsigned int time_base)
-    : FileMediaSubsession(filename, fps, time_base) {
+    : FileMediaSubsession(filename, fps, time_base),
+      index_slot_(std::make_shared<IndexSlot>()) {
     set_payload_type(defs::kMediaFormatH264);
 }
 
 H264FileSubsession::~H264FileSubsession() {}
 
+H264FileIndexPtr H264FileSubsession::index() const {
+    std::lock_guard<std::mutex> lock(index_slot_->mutex);
+    return index_slot_->index;
+}
+
+void H264FileSubsession::ScanParameterSets() {
+    // 只读开头最多kMaxScanNalus个NALU，可以在loop中执行
+    int64_t start_us = NowMicros();
+    bool found = parameter_sets_.ScanFile(filename_);
+    int64_t cost_us = NowMicros() - start_us;
+    if (!found) {
+        LOG_WARN << filename_ << " no SPS/PPS before the first IDR";
+        return;
+    }
+    LOG_INFO << filename_ << " SPS " << parameter_sets_.sps.size()
+             << " bytes, PPS " << parameter_sets_.pps.size() << " bytes, scan "
+             << cost_us << "us";
+
+    H264SpsInfo sps_info;
+    if (!ParseH264Sps((const uint8_t *)parameter_sets_.sps.data(),
+                      parameter_sets_.sps.size(), &sps_info)) {
+        return;
+    }
+    LOG_INFO << filename_ << " profile " << (int)sps_info.profile_idc
+             << ", level " << (int)sps_info.level_idc << ", "
+             << sps_info.width << "x" << sps_info.height << ", fps "
+             << sps_info.fps();
+
+    unsigned int duration = sps_info.FrameDuration(time_base_);
+    if (duration > 0) {
+        fps_ = (unsigned int)(sps_info.fps() + 0.5);
+        set_frame_duration(duration);
+    }
+}
+
+void H264FileSubsession::StartIndex() {
+    // .idx只做mmap和校验，直接加载
+    int64_t start_us = NowMicros();
+    H264FileIndexPtr index = H264FileIndex::Load(filename_);
+    if (index) {
+        int64_t cost_us = NowMicros() - start_us;
+        LoopMetrics::Local()->latency.index_load.Record(cost_us);
+        LOG_INFO << filename_ << " index load " << cost_us << "us";
+        std::lock_guard<std::mutex> lock(index_slot_->mutex);
+        index_slot_->index = index;
+        return;
+    }
+
+    // 没有或已失效时整个文件扫描一遍，大文件要数秒，不能占用loop。
+    // 建好后保存，供下次启动使用
+    std::shared_ptr<IndexSlot> slot = index_slot_;
+    std::string filename = filename_;
+    IndexBuilder::Instance().Post([slot, filename]() {
+        int64_t start_us = NowMicros();
+        H264FileIndexPtr index = H264FileIndex::Build(filename);
+        if (index) {
+            index->Save(filename);
+        }
+        int64_t cost_us = NowMicros() - start_us;
+        LoopMetrics::Local()->latency.index_load.Record(cost_us);
+        if (index) {
+            LOG_INFO << filename << " index build " << cost_us << "us";
+        }
+
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        slot->index = index;
+    });
+}
+
+void H264FileSubsession::Prepare() {
+    ScanParameterSets();
+    StartIndex();
+}
+
+void H264FileSubsession::EnsurePrepared() {
+    std::call_once(prepare_once_, [this]() { Prepare(); });
+}
+
+double H264FileSubsession::PlayLength() {
+    EnsurePrepared();
+    H264FileIndexPtr index = this->index();
+    return index ? index->frame_count() * FrameInterval() : 0;
+}
+
+size_t H264FileSubsession::MemoryBytes() {
+    // 不触发加载。.idx映射的页面同样计入
+    H264FileIndexPtr index = this->index();
+    if (!index) {
+        return 0;
+    }
+    return index->nal_count() * sizeof(H264NalEntry) +
+           index->keyframe_count() * sizeof(H264KeyFrame);
+}
+
 std::string H264FileSubsession::GetSdp() {
+    EnsurePrepared();
+
     char media_sdp[200] = {0};
     snprintf(media_sdp, sizeof(media_sdp),
              "m=video 0 %s %hu\r\n"
@@ -23,7 +175,14 @@ std::string H264FileSubsession::GetSdp() {
              "a=control:%s\r\n",
              defs::kSdpMediaProtocol, payload_type_, payload_type_,
              defs::kMimeTypeH264, time_base_, fps_, TrackId().data());
-    return media_sdp;
+
+    std::string sdp(media_sdp);
+    sdp.append("a=fmtp:")
+        .append(std::to_string(payload_type_))
+        .append(" ")
+        .append(parameter_sets_.FmtpParameters())
+        .append("\r\n");
+    return sdp;
 }
 
 RtpSinkPtr H264FileSubsession::NewRtpSink(
@@ -38,10 +197,25 @@ RtpSinkPtr H264FileSubsession::NewRtpSink(
 }
 
 MultiFrameSourcePtr H264FileSubsession::NewMultiFrameSouce() {
+    // 没有DESCRIBE直接SETUP时，在开始播放前确定帧率
+    EnsurePrepared();
 
     FILE *file = fopen(filename_.data(), "rb");
 
+    // 索引还在建立时，源在定位或倍速时再取，建好之后同样支持
     std::shared_ptr<H264FileSource> filesource(new H264FileSource(file));
+    H264FileIndexPtr index = this->index();
+    if (index) {
+        filesource->set_index(index, FrameInterval());
+    } else {
+        std::shared_ptr<IndexSlot> slot = index_slot_;
+        filesource->set_index_loader(
+            [slot]() {
+                std::lock_guard<std::mutex> lock(slot->mutex);
+                return slot->index;
+            },
+            FrameInterval());
+    }
 
     return filesource;
 }
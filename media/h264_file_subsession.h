@@ -2,6 +2,11 @@
 #define A829ACA4_FC85_4098_AA0A_92C3C824D67E
 
 #include "file_media_subsession.h"
+#include "h264_file_index.h"
+#include "h264_parameter_sets.h"
+
+#include <memory>
+#include <mutex>
 
 namespace muduo_media {
 
@@ -14,6 +19,13 @@ public:
 
     std::string GetSdp() override;
 
+    double PlayLength() override;
+
+    size_t MemoryBytes() override;
+
+    // 索引就绪之后有效，之前或建立失败时为nullptr。可以在任意线程调用
+    H264FileIndexPtr index() const;
+
     RtpSinkPtr
     NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
                int8_t rtp_channel) override;
@@ -25,6 +37,24 @@ public:
     MultiFrameSourcePtr NewMultiFrameSouce() override;
 
 private:
+    // 后台线程写入索引，subsession析构后线程仍可能持有
+    struct IndexSlot {
+        std::mutex mutex;
+        H264FileIndexPtr index;
+    };
+
+    // 首次使用时执行一次: 从文件开头取得SPS/PPS，SPS带有VUI timing时按
+    // 码流设置帧率；有效的.idx直接加载，否则交给后台线程扫描整个文件，
+    // 不阻塞loop。索引就绪之前没有时长，SDP的范围为npt=0-
+    void Prepare();
+    void ScanParameterSets();
+    void StartIndex();
+    void EnsurePrepared();
+
+private:
+    std::once_flag prepare_once_;
+    H264ParameterSets parameter_sets_;
+    std::shared_ptr<IndexSlot> index_slot_;
 };
 
 } // namespace muduo_media
@@ -0,0 +1,55 @@
+#include "h264_live_subsession.h"
+#include "defs.h"
+#include "h264_video_rtp_sink.h"
+#include "live_frame_source.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+H264LiveSubsession::H264LiveSubsession(const LiveStreamHubPtr &hub,
+                                       unsigned int fps,
+                                       unsigned int time_base)
+    : MediaSubsession(fps, time_base), hub_(hub) {
+    set_payload_type(defs::kMediaFormatH264);
+}
+
+H264LiveSubsession::~H264LiveSubsession() {}
+
+std::string H264LiveSubsession::GetSdp() {
+    char media_sdp[200] = {0};
+    snprintf(media_sdp, sizeof(media_sdp),
+             "m=video 0 %s %hu\r\n"
+             "a=rtpmap:%hu %s/%u\r\n"
+             "a=framerate:%u\r\n"
+             "a=control:%s\r\n",
+             defs::kSdpMediaProtocol, payload_type_, payload_type_,
+             defs::kMimeTypeH264, time_base_, fps_, TrackId().data());
+
+    std::string sdp(media_sdp);
+    if (!fmtp_.empty()) {
+        sdp.append("a=fmtp:")
+            .append(std::to_string(payload_type_))
+            .append(" ")
+            .append(fmtp_)
+            .append("\r\n");
+    }
+    return sdp;
+}
+
+RtpSinkPtr H264LiveSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+    int8_t rtp_channel) {
+    return std::make_shared<H264VideoRtpSink>(tcp_conn, rtp_channel);
+}
+
+RtpSinkPtr H264LiveSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn) {
+    return std::make_shared<H264VideoRtpSink>(udp_conn);
+}
+
+MultiFrameSourcePtr H264LiveSubsession::NewMultiFrameSouce() {
+    return std::make_shared<LiveFrameSource>(hub_);
+}
+
+} // namespace muduo_media
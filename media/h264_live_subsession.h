@@ -0,0 +1,43 @@
+#ifndef D3B7A2E5_84C1_4F6A_9E20_B15C6F83D47A
+#define D3B7A2E5_84C1_4F6A_9E20_B15C6F83D47A
+
+#include "live_stream_hub.h"
+#include "media_subsession.h"
+
+namespace muduo_media {
+
+/// @brief 推流(ANNOUNCE/RECORD)得到的H.264直播流
+///
+/// 发布者的数据只解包一次，写入hub；每个观看者的LiveFrameSource订阅同一个
+/// hub。fmtp沿用发布者SDP中的参数。
+class H264LiveSubsession : public MediaSubsession {
+public:
+    H264LiveSubsession(const LiveStreamHubPtr &hub, unsigned int fps = 25,
+                       unsigned int time_base = 90000);
+    ~H264LiveSubsession();
+
+    const LiveStreamHubPtr &hub() const { return hub_; }
+
+    /// a=fmtp:<pt> 之后的参数部分
+    void set_fmtp(const std::string &fmtp) { fmtp_ = fmtp; }
+
+    std::string GetSdp() override;
+
+    RtpSinkPtr
+    NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+               int8_t rtp_channel) override;
+
+    RtpSinkPtr NewRtpSink(
+        const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn)
+        override;
+
+    MultiFrameSourcePtr NewMultiFrameSouce() override;
+
+private:
+    LiveStreamHubPtr hub_;
+    std::string fmtp_;
+};
+
+} // namespace muduo_media
+
+#endif /* D3B7A2E5_84C1_4F6A_9E20_B15C6F83D47A */
@@ -0,0 +1,59 @@
+#include "h264_parameter_sets.h"
+#include "av_packet.h"
+#include "base64.h"
+#include "h264_file_source.h"
+#include "media_log.h"
+
+#include <cstdio>
+
+namespace muduo_media {
+
+bool H264ParameterSets::ScanFile(const std::string &filename) {
+    FILE *file = fopen(filename.data(), "rb");
+    if (!file) {
+        LOG_ERROR << "open " << filename << " fail";
+        return false;
+    }
+
+    H264FileSource source(file);
+    AVPacket packet;
+    for (int i = 0; i < kMaxScanNalus && !complete(); ++i) {
+        if (!source.GetNextFrame(&packet)) {
+            break;
+        }
+
+        const char *data =
+            (const char *)packet.buffer.get() + packet.prepend_size;
+        if (packet.type == NALU_TYPE_SPS && sps.empty()) {
+            sps.assign(data, packet.size);
+        } else if (packet.type == NALU_TYPE_PPS && pps.empty()) {
+            pps.assign(data, packet.size);
+        } else if (packet.type == NALU_TYPE_IDR) {
+            break;
+        }
+    }
+
+    return complete();
+}
+
+std::string H264ParameterSets::FmtpParameters() const {
+    std::string fmtp("packetization-mode=1");
+
+    // profile_idc, constraint flags, level_idc
+    if (sps.size() >= 4) {
+        char profile_level_id[8] = {0};
+        snprintf(profile_level_id, sizeof(profile_level_id), "%02X%02X%02X",
+                 (uint8_t)sps[1], (uint8_t)sps[2], (uint8_t)sps[3]);
+        fmtp.append(";profile-level-id=").append(profile_level_id);
+    }
+
+    if (!sps.empty()) {
+        fmtp.append(";sprop-parameter-sets=").append(base64::Encode(sps));
+        if (!pps.empty()) {
+            fmtp.append(",").append(base64::Encode(pps));
+        }
+    }
+    return fmtp;
+}
+
+} // namespace muduo_media
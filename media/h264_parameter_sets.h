@@ -0,0 +1,29 @@
+#ifndef B2F86D14_C7A3_4E59_91D8_4A6E3C05F7B2
+#define B2F86D14_C7A3_4E59_91D8_4A6E3C05F7B2
+
+#include <string>
+
+namespace muduo_media {
+
+/// @brief H.264的SPS/PPS，不含起始码
+struct H264ParameterSets {
+    std::string sps;
+    std::string pps;
+
+    bool complete() const { return !sps.empty() && !pps.empty(); }
+
+    /// 从文件开头查找第一组SPS/PPS，遇到第一个IDR或读取kMaxScanNalus个
+    /// NALU后停止
+    bool ScanFile(const std::string &filename);
+
+    /// RFC 6184 fmtp参数:
+    /// packetization-mode=1;profile-level-id=xxxxxx;sprop-parameter-sets=...
+    /// 没有SPS时只有packetization-mode
+    std::string FmtpParameters() const;
+
+    static constexpr int kMaxScanNalus = 64;
+};
+
+} // namespace muduo_media
+
+#endif /* B2F86D14_C7A3_4E59_91D8_4A6E3C05F7B2 */
@@ -0,0 +1,162 @@
+#include "h264_rtp_depacketizer.h"
+#include "defs.h"
+#include "media_log.h"
+#include "rtp.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+static constexpr uint8_t kNaluTypeStapA = 24;
+static constexpr uint8_t kNaluTypeFuA = RTP_FU_A_TYPE;
+
+H264RtpDepacketizer::H264RtpDepacketizer(const NaluCallback &cb)
+    : cb_(cb),
+      have_seq_(false),
+      last_seq_(0),
+      have_ts_(false),
+      last_ts_(0),
+      pts_(0),
+      in_fragment_(false),
+      packets_(0),
+      lost_packets_(0),
+      dropped_nalus_(0) {}
+
+void H264RtpDepacketizer::Input(const uint8_t *data, size_t size) {
+    if (size < RTP_HEADER_SIZE || (data[0] >> 6) != RTP_VESION) {
+        LOG_DEBUG << "invalid RTP packet, size " << size;
+        return;
+    }
+
+    bool padding = data[0] & 0x20;
+    bool extension = data[0] & 0x10;
+    size_t csrc_count = data[0] & 0x0F;
+    uint16_t seq = (uint16_t)(data[2] << 8 | data[3]);
+    uint32_t timestamp = (uint32_t)data[4] << 24 | (uint32_t)data[5] << 16 |
+                         (uint32_t)data[6] << 8 | data[7];
+
+    size_t offset = RTP_HEADER_SIZE + csrc_count * 4;
+    if (extension) {
+        if (size < offset + 4) {
+            return;
+        }
+        size_t ext_words = data[offset + 2] << 8 | data[offset + 3];
+        offset += 4 + ext_words * 4;
+    }
+    if (padding && size > offset) {
+        size_t pad = data[size - 1];
+        size = pad <= size - offset ? size - pad : offset;
+    }
+    if (size <= offset) {
+        return;
+    }
+
+    ++packets_;
+
+    if (have_seq_) {
+        uint16_t expected = last_seq_ + 1;
+        if (seq != expected) {
+            int16_t gap = (int16_t)(seq - expected);
+            if (gap < 0) {
+                // 乱序或重复的旧包，直接丢弃
+                return;
+            }
+            lost_packets_ += gap;
+            if (in_fragment_) {
+                in_fragment_ = false;
+                ++dropped_nalus_;
+            }
+        }
+    }
+    have_seq_ = true;
+    last_seq_ = seq;
+
+    ExtendTimestamp(timestamp);
+
+    const uint8_t *payload = data + offset;
+    size_t payload_size = size - offset;
+    uint8_t nalu_type = payload[0] & 0x1F;
+
+    if (nalu_type >= 1 && nalu_type <= 23) {
+        Emit(payload, payload_size);
+    } else if (nalu_type == kNaluTypeStapA) {
+        // STAP-A: 1字节头 + (2字节长度 + NALU)*
+        size_t pos = 1;
+        while (pos + 2 <= payload_size) {
+            size_t nalu_size = payload[pos] << 8 | payload[pos + 1];
+            pos += 2;
+            if (nalu_size == 0 || pos + nalu_size > payload_size) {
+                LOG_DEBUG << "truncated STAP-A, seq " << seq;
+                break;
+            }
+            Emit(payload + pos, nalu_size);
+            pos += nalu_size;
+        }
+    } else if (nalu_type == kNaluTypeFuA) {
+        if (payload_size < RTP_FU_A_HEAD_LEN) {
+            return;
+        }
+        uint8_t fu_header = payload[1];
+        bool start = fu_header & 0x80;
+        bool end = fu_header & 0x40;
+
+        if (start) {
+            if (in_fragment_) {
+                ++dropped_nalus_;
+            }
+            // 每个NALU使用新的缓冲，输出时直接交出，不再拷贝
+            fragment_ = std::make_shared<std::vector<uint8_t>>();
+            fragment_->reserve(defs::kBufPrependSize + 4096);
+            fragment_->resize(defs::kBufPrependSize);
+            // 由FU indicator的F/NRI和FU header的type还原NALU头
+            fragment_->push_back((payload[0] & 0xE0) | (fu_header & 0x1F));
+            in_fragment_ = true;
+        } else if (!in_fragment_) {
+            return;
+        }
+
+        fragment_->insert(fragment_->end(), payload + RTP_FU_A_HEAD_LEN,
+                         payload + payload_size);
+        if (end) {
+            EmitFragment();
+        }
+    } else {
+        LOG_DEBUG << "unsupported NALU type " << (int)nalu_type;
+    }
+}
+
+int64_t H264RtpDepacketizer::ExtendTimestamp(uint32_t timestamp) {
+    if (have_ts_) {
+        // 有符号差值，处理回绕和偶尔的B帧回退
+        pts_ += (int32_t)(timestamp - last_ts_);
+    }
+    have_ts_ = true;
+    last_ts_ = timestamp;
+    return pts_;
+}
+
+void H264RtpDepacketizer::Emit(const uint8_t *nalu, size_t size) {
+    AVPacket packet;
+    packet.prepend_size = defs::kBufPrependSize;
+    packet.size = size;
+    packet.buffer.reset(new uint8_t[packet.prepend_size + size]);
+    memcpy(packet.buffer.get() + packet.prepend_size, nalu, size);
+    packet.type = nalu[0] & 0x1F;
+    packet.pts = pts_ < 0 ? 0 : pts_;
+    cb_(packet);
+}
+
+void H264RtpDepacketizer::EmitFragment() {
+    in_fragment_ = false;
+
+    AVPacket packet;
+    packet.prepend_size = defs::kBufPrependSize;
+    packet.size = fragment_->size() - defs::kBufPrependSize;
+    packet.buffer = std::shared_ptr<uint8_t[]>(fragment_, fragment_->data());
+    packet.type = (*fragment_)[defs::kBufPrependSize] & 0x1F;
+    packet.pts = pts_ < 0 ? 0 : pts_;
+    fragment_.reset();
+    cb_(packet);
+}
+
+} // namespace muduo_media
@@ -0,0 +1,61 @@
+#ifndef F1A63C28_5D7E_4B94_8E02_A7C3D91E5B46
+#define F1A63C28_5D7E_4B94_8E02_A7C3D91E5B46
+
+#include "av_packet.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace muduo_media {
+
+/// @brief RFC 6184 H.264 RTP解包
+///
+/// 支持Single NAL Unit、STAP-A和FU-A(packetization-mode 0/1)。输出的
+/// AVPacket不含起始码，预留defs::kBufPrependSize前置空间，可以直接交给
+/// H264VideoRtpSink。pts由RTP时间戳扩展为64位，从0开始。
+/// FU-A分片中间丢包时丢弃整个NALU，等下一个起始分片。
+class H264RtpDepacketizer {
+public:
+    using NaluCallback = std::function<void(const AVPacket &)>;
+
+    explicit H264RtpDepacketizer(const NaluCallback &cb);
+
+    /// 输入一个完整的RTP包
+    void Input(const uint8_t *data, size_t size);
+
+    uint64_t packets() const { return packets_; }
+    uint64_t lost_packets() const { return lost_packets_; }
+    uint64_t dropped_nalus() const { return dropped_nalus_; }
+
+private:
+    void Emit(const uint8_t *nalu, size_t size);
+    void EmitFragment();
+
+    // 32位RTP时间戳展开为从0开始的64位pts
+    int64_t ExtendTimestamp(uint32_t timestamp);
+
+private:
+    NaluCallback cb_;
+
+    bool have_seq_;
+    uint16_t last_seq_;
+
+    bool have_ts_;
+    uint32_t last_ts_;
+    int64_t pts_;
+
+    // 正在重组的FU-A，头部预留前置空间
+    std::shared_ptr<std::vector<uint8_t>> fragment_;
+    bool in_fragment_;
+
+    uint64_t packets_;
+    uint64_t lost_packets_;
+    uint64_t dropped_nalus_;
+};
+
+} // namespace muduo_media
+
+#endif /* F1A63C28_5D7E_4B94_8E02_A7C3D91E5B46 */
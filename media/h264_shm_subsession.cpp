@@ -0,0 +1,49 @@
+#include "h264_shm_subsession.h"
+#include "defs.h"
+#include "h264_video_rtp_sink.h"
+#include "live_frame_source.h"
+#include "shm_stream_reader.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+H264ShmSubsession::H264ShmSubsession(const std::string &shm_name,
+                                     unsigned int fps, unsigned int time_base)
+    : MediaSubsession(fps, time_base),
+      shm_name_(shm_name),
+      hub_(std::make_shared<LiveStreamHub>()),
+      reader_(new ShmStreamReader(shm_name, hub_)) {
+    set_payload_type(defs::kMediaFormatH264);
+}
+
+H264ShmSubsession::~H264ShmSubsession() {}
+
+std::string H264ShmSubsession::GetSdp() {
+    char media_sdp[200] = {0};
+    snprintf(media_sdp, sizeof(media_sdp),
+             "m=video 0 %s %hu\r\n"
+             "a=rtpmap:%hu %s/%u\r\n"
+             "a=framerate:%u\r\n"
+             "a=control:%s\r\n",
+             defs::kSdpMediaProtocol, payload_type_, payload_type_,
+             defs::kMimeTypeH264, time_base_, fps_, TrackId().data());
+    return media_sdp;
+}
+
+RtpSinkPtr H264ShmSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+    int8_t rtp_channel) {
+    return std::make_shared<H264VideoRtpSink>(tcp_conn, rtp_channel);
+}
+
+RtpSinkPtr H264ShmSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn) {
+    return std::make_shared<H264VideoRtpSink>(udp_conn);
+}
+
+MultiFrameSourcePtr H264ShmSubsession::NewMultiFrameSouce() {
+    return std::make_shared<LiveFrameSource>(hub_);
+}
+
+} // namespace muduo_media
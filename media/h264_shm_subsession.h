@@ -0,0 +1,44 @@
+#ifndef E7B3C510_9D2A_4E6F_8A41_5C0F96D2B8E3
+#define E7B3C510_9D2A_4E6F_8A41_5C0F96D2B8E3
+
+#include "live_stream_hub.h"
+#include "media_subsession.h"
+
+#include <memory>
+
+namespace muduo_media {
+
+class ShmStreamReader;
+
+/// @brief 本机编码器通过共享内存推送的H.264直播流
+///
+/// 环形队列是单消费者的，构造时起一个ShmStreamReader在后台attach并读取，
+/// 发布到hub，每个观看者一个LiveFrameSource，与ANNOUNCE推流的分发方式相同。
+/// hub缓存当前GOP，观看者不必等下一个IDR。
+class H264ShmSubsession : public MediaSubsession {
+public:
+    H264ShmSubsession(const std::string &shm_name, unsigned int fps = 25,
+                      unsigned int time_base = 90000);
+    ~H264ShmSubsession();
+
+    std::string GetSdp() override;
+
+    RtpSinkPtr
+    NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+               int8_t rtp_channel) override;
+
+    RtpSinkPtr NewRtpSink(
+        const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn)
+        override;
+
+    MultiFrameSourcePtr NewMultiFrameSouce() override;
+
+private:
+    std::string shm_name_;
+    LiveStreamHubPtr hub_;
+    std::unique_ptr<ShmStreamReader> reader_;
+};
+
+} // namespace muduo_media
+
+#endif /* E7B3C510_9D2A_4E6F_8A41_5C0F96D2B8E3 */
@@ -0,0 +1,175 @@
+#include "h264_sps_parser.h"
+#include "bit_reader.h"
+
+namespace muduo_media {
+
+// SPS通常几十字节，超出部分不会影响需要的字段
+static constexpr size_t kMaxRbspSize = 256;
+
+double H264SpsInfo::fps() const {
+    if (!timing_info_present || 0 == num_units_in_tick) {
+        return 0;
+    }
+    return (double)time_scale / (2.0 * num_units_in_tick);
+}
+
+unsigned int H264SpsInfo::FrameDuration(unsigned int time_base) const {
+    if (!timing_info_present || 0 == time_scale) {
+        return 0;
+    }
+    return (unsigned int)((2ull * num_units_in_tick * time_base +
+                           time_scale / 2) /
+                          time_scale);
+}
+
+// 去掉防竞争字节 00 00 03
+static size_t NaluToRbsp(const uint8_t *data, size_t size, uint8_t *rbsp) {
+    size_t out = 0;
+    int zeros = 0;
+    for (size_t i = 0; i < size && out < kMaxRbspSize; ++i) {
+        if (zeros >= 2 && data[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = data[i] == 0 ? zeros + 1 : 0;
+        rbsp[out++] = data[i];
+    }
+    return out;
+}
+
+static void SkipScalingList(BitReader *reader, int size) {
+    int last_scale = 8;
+    int next_scale = 8;
+    for (int i = 0; i < size && next_scale != 0; ++i) {
+        int32_t delta_scale = reader->ReadSE();
+        next_scale = (last_scale + delta_scale + 256) % 256;
+        if (next_scale != 0) {
+            last_scale = next_scale;
+        }
+    }
+}
+
+static void ParseVui(BitReader *reader, H264SpsInfo *info) {
+    if (reader->ReadBit()) { // aspect_ratio_info_present_flag
+        uint32_t aspect_ratio_idc = reader->ReadBits(8);
+        if (aspect_ratio_idc == 255) { // Extended_SAR
+            reader->SkipBits(32);
+        }
+    }
+    if (reader->ReadBit()) { // overscan_info_present_flag
+        reader->SkipBits(1);
+    }
+    if (reader->ReadBit()) { // video_signal_type_present_flag
+        reader->SkipBits(4);
+        if (reader->ReadBit()) { // colour_description_present_flag
+            reader->SkipBits(24);
+        }
+    }
+    if (reader->ReadBit()) { // chroma_loc_info_present_flag
+        reader->ReadUE();
+        reader->ReadUE();
+    }
+
+    info->timing_info_present = reader->ReadBit();
+    if (info->timing_info_present) {
+        info->num_units_in_tick = reader->ReadBits(32);
+        info->time_scale = reader->ReadBits(32);
+        info->fixed_frame_rate = reader->ReadBit();
+    }
+}
+
+bool ParseH264Sps(const uint8_t *data, size_t size, H264SpsInfo *info) {
+    if (size < 4 || (data[0] & 0x1F) != 7) {
+        return false;
+    }
+
+    uint8_t rbsp[kMaxRbspSize];
+    size_t rbsp_size = NaluToRbsp(data + 1, size - 1, rbsp);
+    BitReader reader(rbsp, rbsp_size);
+
+    info->profile_idc = reader.ReadBits(8);
+    info->constraint_flags = reader.ReadBits(8);
+    info->level_idc = reader.ReadBits(8);
+    reader.ReadUE(); // seq_parameter_set_id
+
+    uint32_t chroma_format_idc = 1;
+    bool separate_colour_plane = false;
+    switch (info->profile_idc) {
+    case 100: case 110: case 122: case 244: case 44: case 83:
+    case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+        chroma_format_idc = reader.ReadUE();
+        if (chroma_format_idc == 3) {
+            separate_colour_plane = reader.ReadBit();
+        }
+        reader.ReadUE();     // bit_depth_luma_minus8
+        reader.ReadUE();     // bit_depth_chroma_minus8
+        reader.SkipBits(1);  // qpprime_y_zero_transform_bypass_flag
+        if (reader.ReadBit()) { // seq_scaling_matrix_present_flag
+            int lists = chroma_format_idc != 3 ? 8 : 12;
+            for (int i = 0; i < lists; ++i) {
+                if (reader.ReadBit()) {
+                    SkipScalingList(&reader, i < 6 ? 16 : 64);
+                }
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    reader.ReadUE(); // log2_max_frame_num_minus4
+    uint32_t pic_order_cnt_type = reader.ReadUE();
+    if (pic_order_cnt_type == 0) {
+        reader.ReadUE(); // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pic_order_cnt_type == 1) {
+        reader.SkipBits(1); // delta_pic_order_always_zero_flag
+        reader.ReadSE();    // offset_for_non_ref_pic
+        reader.ReadSE();    // offset_for_top_to_bottom_field
+        uint32_t cycle = reader.ReadUE();
+        for (uint32_t i = 0; i < cycle && !reader.overflow(); ++i) {
+            reader.ReadSE();
+        }
+    }
+
+    reader.ReadUE();    // max_num_ref_frames
+    reader.SkipBits(1); // gaps_in_frame_num_value_allowed_flag
+
+    uint32_t width_in_mbs = reader.ReadUE() + 1;
+    uint32_t height_in_map_units = reader.ReadUE() + 1;
+    uint32_t frame_mbs_only = reader.ReadBit();
+    if (!frame_mbs_only) {
+        reader.SkipBits(1); // mb_adaptive_frame_field_flag
+    }
+    reader.SkipBits(1); // direct_8x8_inference_flag
+
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (reader.ReadBit()) { // frame_cropping_flag
+        crop_left = reader.ReadUE();
+        crop_right = reader.ReadUE();
+        crop_top = reader.ReadUE();
+        crop_bottom = reader.ReadUE();
+    }
+
+    // 裁剪单位，见H.264 7.4.2.1.1
+    uint32_t crop_unit_x = 1;
+    uint32_t crop_unit_y = 2 - frame_mbs_only;
+    if (chroma_format_idc != 0 && !separate_colour_plane) {
+        uint32_t sub_width = chroma_format_idc == 3 ? 1 : 2;
+        uint32_t sub_height = chroma_format_idc == 1 ? 2 : 1;
+        crop_unit_x = sub_width;
+        crop_unit_y *= sub_height;
+    }
+
+    info->width = width_in_mbs * 16 - crop_unit_x * (crop_left + crop_right);
+    info->height = (2 - frame_mbs_only) * height_in_map_units * 16 -
+                   crop_unit_y * (crop_top + crop_bottom);
+
+    if (reader.ReadBit()) { // vui_parameters_present_flag
+        ParseVui(&reader, info);
+    }
+
+    // VUI之后的字段不需要，只要前面没有越界即可
+    return !reader.overflow();
+}
+
+} // namespace muduo_media
@@ -0,0 +1,35 @@
+#ifndef A4D9B1E6_5F27_4C38_8E0A_C61B7D2F9354
+#define A4D9B1E6_5F27_4C38_8E0A_C61B7D2F9354
+
+#include <cstddef>
+#include <cstdint>
+
+namespace muduo_media {
+
+/// @brief SPS中与播放相关的字段
+struct H264SpsInfo {
+    uint8_t profile_idc = 0;
+    uint8_t constraint_flags = 0;
+    uint8_t level_idc = 0;
+
+    unsigned int width = 0; // 已减去裁剪
+    unsigned int height = 0;
+
+    // VUI timing_info，一帧 = 2 * num_units_in_tick / time_scale 秒
+    bool timing_info_present = false;
+    uint32_t num_units_in_tick = 0;
+    uint32_t time_scale = 0;
+    bool fixed_frame_rate = false;
+
+    double fps() const;
+
+    /// 一帧在time_base下的时间戳步进，没有timing_info时返回0
+    unsigned int FrameDuration(unsigned int time_base) const;
+};
+
+/// data为完整SPS NALU(含NALU头，不含起始码)，解析失败返回false
+bool ParseH264Sps(const uint8_t *data, size_t size, H264SpsInfo *info);
+
+} // namespace muduo_media
+
+#endif /* A4D9B1E6_5F27_4C38_8E0A_C61B7D2F9354 */
@@ -1,7 +1,7 @@
 #include "h264_video_rtp_sink.h"
 #include "defs.h"
 #include "eventloop/endian.h"
-#include "logger/logger.h"
+#include "media_log.h"
 #include "rtp.h"
 
 #include <random>
@@ -10,7 +10,10 @@
 namespace muduo_media {
 H264VideoRtpSink::H264VideoRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
                                    int8_t rtp_channel)
-    : tcp_conn_(tcp_conn), rtp_channel_(rtp_channel), udp_conn_(nullptr) {
+    : transport_(RtpTransProto::kRtpOverTcp),
+      tcp_conn_(tcp_conn),
+      rtp_channel_(rtp_channel),
+      udp_conn_(nullptr) {
 
     std::random_device rd;
     init_seq_ = rd() & 0xFF; // limited
@@ -19,7 +22,10 @@ H264VideoRtpSink::H264VideoRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
 
 H264VideoRtpSink::H264VideoRtpSink(
     const muduo::net::UdpVirtualConnectionPtr &udp_conn)
-    : tcp_conn_(nullptr), rtp_channel_(-1), udp_conn_(udp_conn) {
+    : transport_(RtpTransProto::kRtpOverUdp),
+      tcp_conn_(nullptr),
+      rtp_channel_(-1),
+      udp_conn_(udp_conn) {
     // udp_conn_->SetSendBufSize(128 * 1024);
 
     std::random_device rd;
@@ -27,20 +33,49 @@ H264VideoRtpSink::H264VideoRtpSink(
     LOG_DEBUG << "H264VideoRtpSink::ctor at " << this;
 }
 
+H264VideoRtpSink::H264VideoRtpSink(RtpTransProto transport,
+                                   int8_t rtp_channel)
+    : transport_(transport),
+      tcp_conn_(nullptr),
+      rtp_channel_(rtp_channel),
+      udp_conn_(nullptr) {
+
+    std::random_device rd;
+    init_seq_ = rd() & 0xFF; // limited
+    LOG_DEBUG << "H264VideoRtpSink::ctor at " << this;
+}
+
 H264VideoRtpSink::~H264VideoRtpSink() {
     LOG_DEBUG << "H264VideoRtpSink::dtor at " << this;
 }
 
+void H264VideoRtpSink::Output(const uint8_t *data, size_t len) {
+    if (tcp_conn_) {
+        tcp_conn_->Send(data, len);
+    } else if (udp_conn_) {
+        udp_conn_->Send(data, len);
+    }
+}
+
 void H264VideoRtpSink::Send(const unsigned char *data, int len,
                             const std::shared_ptr<void> &info) {
-    if (tcp_conn_) {
+    if (transport_ == RtpTransProto::kRtpOverTcp) {
         SendOverTcp(data, len, info);
     } else {
         SendOverUdp(data, len, info);
     }
 }
 
+size_t H264VideoRtpSink::QueuedBytes() const {
+    return tcp_conn_ ? tcp_conn_->output_buffer()->ReadableBytes() : 0;
+}
+
 void H264VideoRtpSink::Send(const AVPacket &pkt, const AVPacketInfo &info) {
+    // 连接已断开，不再打包
+    if (tcp_conn_ && !tcp_conn_->Connected()) {
+        ++dropped_frames_;
+        return;
+    }
 
     std::shared_ptr<RtpHeader> rtp_header = std::make_shared<RtpHeader>();
     ::bzero(rtp_header.get(), sizeof(RtpHeader));
@@ -61,7 +96,7 @@ void H264VideoRtpSink::Send(const AVPacket &pkt, const AVPacketInfo &info) {
         muduo::HostToNetwork32(info.timestamp); // 需要根据源计算 htonl()
     rtp_header->ssrc = muduo::HostToNetwork32(info.ssrc); // 信号源id
 
-    if (tcp_conn_) {
+    if (transport_ == RtpTransProto::kRtpOverTcp) {
         SendOverTcp(pkt, rtp_header);
     } else {
         SendOverUdp(pkt, rtp_header);
@@ -99,7 +134,7 @@ void H264VideoRtpSink::SendOverTcp(const AVPacket &pkt,
     memcpy(pdata, header.get(), RTP_HEADER_SIZE);
 
     uint32_t packet_len = INTERLEAVED_FRAME_SIZE + rtp_len;
-    tcp_conn_->Send(pdata_start, packet_len);
+    Output(pdata_start, packet_len);
 
     ++packets_;
     octets_ += packet_len;
@@ -127,7 +162,7 @@ void H264VideoRtpSink::SendOverUdp(const AVPacket &pkt,
         memcpy(pdata_start, header.get(), RTP_HEADER_SIZE);
 
         uint32_t packet_len = RTP_HEADER_SIZE + pkt.size;
-        udp_conn_->Send(pdata_start, packet_len);
+        Output(pdata_start, packet_len);
 
         ++packets_;
         octets_ += packet_len;
@@ -191,8 +226,7 @@ void H264VideoRtpSink::SendOverUdp(const AVPacket &pkt,
             memcpy(new_buf.get() + RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN, pdata,
                    RTP_MAX_PAYLOAD_SIZE - RTP_FU_A_HEAD_LEN);
 
-            udp_conn_->Send(new_buf.get(),
-                            RTP_HEADER_SIZE + RTP_MAX_PAYLOAD_SIZE);
+            Output(new_buf.get(), RTP_HEADER_SIZE + RTP_MAX_PAYLOAD_SIZE);
 
             ++packets_;
             octets_ += RTP_HEADER_SIZE + RTP_MAX_PAYLOAD_SIZE;
@@ -217,8 +251,7 @@ void H264VideoRtpSink::SendOverUdp(const AVPacket &pkt,
         memcpy(new_buf.get() + RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN, pdata,
                data_len);
 
-        udp_conn_->Send(new_buf.get(),
-                        RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN + data_len);
+        Output(new_buf.get(), RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN + data_len);
 
         ++packets_;
         octets_ += RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN + data_len;
@@ -251,8 +284,7 @@ void H264VideoRtpSink::SendOverTcp(const unsigned char *data, int len,
     memcpy(new_buf.get() + INTERLEAVED_FRAME_SIZE, header, RTP_HEADER_SIZE);
     memcpy(new_buf.get() + INTERLEAVED_FRAME_SIZE + RTP_HEADER_SIZE, data, len);
 
-    tcp_conn_->Send(new_buf.get(),
-                    INTERLEAVED_FRAME_SIZE + RTP_HEADER_SIZE + len);
+    Output(new_buf.get(), INTERLEAVED_FRAME_SIZE + RTP_HEADER_SIZE + len);
 
     ++packets_;
     octets_ += INTERLEAVED_FRAME_SIZE + RTP_HEADER_SIZE + len;
@@ -280,7 +312,7 @@ void H264VideoRtpSink::SendOverUdp(const unsigned char *data, int len,
         memcpy(new_buf.get(), header, RTP_HEADER_SIZE);
         memcpy(new_buf.get() + RTP_HEADER_SIZE, data, len);
 
-        udp_conn_->Send(new_buf.get(), RTP_HEADER_SIZE + len);
+        Output(new_buf.get(), RTP_HEADER_SIZE + len);
 
         ++packets_;
         octets_ += RTP_HEADER_SIZE + len;
@@ -344,8 +376,7 @@ void H264VideoRtpSink::SendOverUdp(const unsigned char *data, int len,
             memcpy(new_buf.get() + RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN, pdata,
                    RTP_MAX_PAYLOAD_SIZE - RTP_FU_A_HEAD_LEN);
 
-            udp_conn_->Send(new_buf.get(),
-                            RTP_HEADER_SIZE + RTP_MAX_PAYLOAD_SIZE);
+            Output(new_buf.get(), RTP_HEADER_SIZE + RTP_MAX_PAYLOAD_SIZE);
 
             ++packets_;
             octets_ += RTP_HEADER_SIZE + RTP_MAX_PAYLOAD_SIZE;
@@ -370,8 +401,7 @@ void H264VideoRtpSink::SendOverUdp(const unsigned char *data, int len,
         memcpy(new_buf.get() + RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN, pdata,
                data_len);
 
-        udp_conn_->Send(new_buf.get(),
-                        RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN + data_len);
+        Output(new_buf.get(), RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN + data_len);
 
         ++packets_;
         octets_ += RTP_HEADER_SIZE + RTP_FU_A_HEAD_LEN + data_len;
@@ -1,6 +1,7 @@
 #ifndef B7A4F4AA_EE3C_42C1_8257_3F5B5CF926CB
 #define B7A4F4AA_EE3C_42C1_8257_3F5B5CF926CB
 
+#include "defs.h"
 #include "multi_frame_rtp_sink.h"
 #include "net/tcp_connection.h"
 #include "net/udp_virtual_connection.h"
@@ -22,6 +23,15 @@ public:
 
     void Send(const AVPacket &pkt, const AVPacketInfo &info) override;
 
+    size_t QueuedBytes() const override;
+    bool HasOutputQueue() const override { return tcp_conn_ != nullptr; }
+
+protected:
+    // 不绑定连接，子类通过Output接管打包后的数据
+    H264VideoRtpSink(RtpTransProto transport, int8_t rtp_channel);
+
+    virtual void Output(const uint8_t *data, size_t len);
+
 private:
     void SendOverTcp(const unsigned char *data, int len,
                      const std::shared_ptr<void> &info);
@@ -35,6 +45,7 @@ private:
                      const std::shared_ptr<RtpHeader> &header);
 
 private:
+    RtpTransProto transport_;
     muduo::net::TcpConnectionPtr tcp_conn_;
     int8_t rtp_channel_;
 
@@ -0,0 +1,34 @@
+#include "h265_file_source.h"
+#include "media_log.h"
+
+#include <random>
+
+namespace muduo_media {
+
+H265FileSource::H265FileSource(FILE *file) : ByteStreamFileSource(file) {
+    LOG_DEBUG << "H265FileSource::ctor at " << this;
+
+    std::random_device rd;
+    ssrc_ = rd() & 0xFFFFFFFF;
+}
+
+H265FileSource::~H265FileSource() {
+    LOG_DEBUG << "H265FileSource::dtor at " << this;
+}
+
+bool H265FileSource::GetNextFrame(AVPacket *packet) {
+    if (!file_ || !ReadNalu(packet)) {
+        return false;
+    }
+    // 2字节NALU头
+    if (packet->size < 2) {
+        packet->type = 0;
+        packet->frame_span = 0;
+        return true;
+    }
+    packet->type = NaluType(packet->buffer.get() + packet->prepend_size);
+    packet->frame_span = IsVcl(packet->type) ? 1 : 0;
+    return true;
+}
+
+} // namespace muduo_media
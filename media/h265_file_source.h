@@ -0,0 +1,27 @@
+#ifndef D3A58487_3C3B_48FC_B004_CD4EEF11F7FA
+#define D3A58487_3C3B_48FC_B004_CD4EEF11F7FA
+
+#include "av_packet.h"
+#include "byte_stream_file_source.h"
+
+namespace muduo_media {
+
+/// @brief H.265 Annex B文件，每次读取一个NALU，type为H265NaluType
+class H265FileSource : public ByteStreamFileSource {
+public:
+    H265FileSource(FILE *file);
+    ~H265FileSource();
+
+    bool GetNextFrame(AVPacket *) override;
+
+    static uint8_t NaluType(const uint8_t *nalu) {
+        return (nalu[0] >> 1) & 0x3F;
+    }
+
+    /// VCL(图像)NALU按帧率发送，VPS/SPS/PPS/SEI与后面的图像同时发送
+    static bool IsVcl(uint8_t type) { return type < H265_NALU_TYPE_VPS; }
+};
+
+} // namespace muduo_media
+
+#endif /* D3A58487_3C3B_48FC_B004_CD4EEF11F7FA */
@@ -0,0 +1,65 @@
+#include "h265_file_subsession.h"
+#include "defs.h"
+#include "h265_file_source.h"
+#include "h265_video_rtp_sink.h"
+#include "media_log.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+H265FileSubsession::H265FileSubsession(const std::string &filename,
+                                       unsigned int fps, unsigned int time_base)
+    : FileMediaSubsession(filename, fps, time_base) {
+    set_payload_type(defs::kMediaFormatH265);
+}
+
+H265FileSubsession::~H265FileSubsession() {}
+
+void H265FileSubsession::ScanParameterSets() {
+    if (!parameter_sets_.ScanFile(filename_)) {
+        LOG_WARN << filename_ << " no VPS/SPS/PPS";
+    }
+}
+
+std::string H265FileSubsession::GetSdp() {
+    std::call_once(parameter_sets_once_, [this]() { ScanParameterSets(); });
+
+    char media_sdp[200] = {0};
+    snprintf(media_sdp, sizeof(media_sdp),
+             "m=video 0 %s %hu\r\n"
+             "a=rtpmap:%hu %s/%u\r\n"
+             "a=framerate:%u\r\n"
+             "a=control:%s\r\n",
+             defs::kSdpMediaProtocol, payload_type_, payload_type_,
+             defs::kMimeTypeH265, time_base_, fps_, TrackId().data());
+
+    std::string sdp(media_sdp);
+    std::string fmtp = parameter_sets_.FmtpParameters();
+    if (!fmtp.empty()) {
+        sdp.append("a=fmtp:")
+            .append(std::to_string(payload_type_))
+            .append(" ")
+            .append(fmtp)
+            .append("\r\n");
+    }
+    return sdp;
+}
+
+RtpSinkPtr H265FileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+    int8_t rtp_channel) {
+    return std::make_shared<H265VideoRtpSink>(tcp_conn, rtp_channel);
+}
+
+RtpSinkPtr H265FileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn) {
+    return std::make_shared<H265VideoRtpSink>(udp_conn);
+}
+
+MultiFrameSourcePtr H265FileSubsession::NewMultiFrameSouce() {
+    FILE *file = fopen(filename_.data(), "rb");
+    return std::make_shared<H265FileSource>(file);
+}
+
+} // namespace muduo_media
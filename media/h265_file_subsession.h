@@ -0,0 +1,41 @@
+#ifndef CA5752F7_5FA2_492B_973C_FBF3853B5730
+#define CA5752F7_5FA2_492B_973C_FBF3853B5730
+
+#include "file_media_subsession.h"
+#include "h265_parameter_sets.h"
+
+#include <mutex>
+
+namespace muduo_media {
+
+class H265FileSubsession : public FileMediaSubsession {
+
+public:
+    H265FileSubsession(const std::string &filename, unsigned int fps = 25,
+                       unsigned int time_base = 90000);
+    ~H265FileSubsession();
+
+    std::string GetSdp() override;
+
+    RtpSinkPtr
+    NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+               int8_t rtp_channel) override;
+
+    RtpSinkPtr NewRtpSink(
+        const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn)
+        override;
+
+    MultiFrameSourcePtr NewMultiFrameSouce() override;
+
+private:
+    // 首次GetSdp时扫描文件开头得到VPS/SPS/PPS，之后复用
+    void ScanParameterSets();
+
+private:
+    std::once_flag parameter_sets_once_;
+    H265ParameterSets parameter_sets_;
+};
+
+} // namespace muduo_media
+
+#endif /* CA5752F7_5FA2_492B_973C_FBF3853B5730 */
@@ -0,0 +1,57 @@
+#include "h265_parameter_sets.h"
+#include "av_packet.h"
+#include "base64.h"
+#include "h265_file_source.h"
+#include "media_log.h"
+
+#include <cstdio>
+
+namespace muduo_media {
+
+bool H265ParameterSets::ScanFile(const std::string &filename) {
+    FILE *file = fopen(filename.data(), "rb");
+    if (!file) {
+        LOG_ERROR << "open " << filename << " fail";
+        return false;
+    }
+
+    H265FileSource source(file);
+    AVPacket packet;
+    for (int i = 0; i < kMaxScanNalus && !complete(); ++i) {
+        if (!source.GetNextFrame(&packet)) {
+            break;
+        }
+
+        const char *data =
+            (const char *)packet.buffer.get() + packet.prepend_size;
+        if (packet.type == H265_NALU_TYPE_VPS && vps.empty()) {
+            vps.assign(data, packet.size);
+        } else if (packet.type == H265_NALU_TYPE_SPS && sps.empty()) {
+            sps.assign(data, packet.size);
+        } else if (packet.type == H265_NALU_TYPE_PPS && pps.empty()) {
+            pps.assign(data, packet.size);
+        } else if (H265FileSource::IsVcl(packet.type)) {
+            break;
+        }
+    }
+
+    return complete();
+}
+
+std::string H265ParameterSets::FmtpParameters() const {
+    std::string fmtp;
+    const std::pair<const char *, const std::string *> params[] = {
+        {"sprop-vps=", &vps}, {"sprop-sps=", &sps}, {"sprop-pps=", &pps}};
+    for (auto &&param : params) {
+        if (param.second->empty()) {
+            continue;
+        }
+        if (!fmtp.empty()) {
+            fmtp.append(";");
+        }
+        fmtp.append(param.first).append(base64::Encode(*param.second));
+    }
+    return fmtp;
+}
+
+} // namespace muduo_media
@@ -0,0 +1,30 @@
+#ifndef BE20DC85_285B_4622_B5E4_2F9A99130483
+#define BE20DC85_285B_4622_B5E4_2F9A99130483
+
+#include <string>
+
+namespace muduo_media {
+
+/// @brief H.265的VPS/SPS/PPS，不含起始码
+struct H265ParameterSets {
+    std::string vps;
+    std::string sps;
+    std::string pps;
+
+    bool complete() const {
+        return !vps.empty() && !sps.empty() && !pps.empty();
+    }
+
+    /// 从文件开头查找第一组VPS/SPS/PPS，遇到第一个图像或读取kMaxScanNalus个
+    /// NALU后停止
+    bool ScanFile(const std::string &filename);
+
+    /// RFC 7798 fmtp参数: sprop-vps=...;sprop-sps=...;sprop-pps=...
+    std::string FmtpParameters() const;
+
+    static constexpr int kMaxScanNalus = 64;
+};
+
+} // namespace muduo_media
+
+#endif /* BE20DC85_285B_4622_B5E4_2F9A99130483 */
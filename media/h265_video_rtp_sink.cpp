@@ -0,0 +1,247 @@
+#include "h265_video_rtp_sink.h"
+#include "eventloop/endian.h"
+#include "h265_file_source.h"
+#include "media_log.h"
+
+#include <cassert>
+#include <cstring>
+#include <random>
+
+namespace muduo_media {
+
+H265VideoRtpSink::H265VideoRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
+                                   int8_t rtp_channel)
+    : H265VideoRtpSink(RtpTransProto::kRtpOverTcp, rtp_channel) {
+    tcp_conn_ = tcp_conn;
+}
+
+H265VideoRtpSink::H265VideoRtpSink(
+    const muduo::net::UdpVirtualConnectionPtr &udp_conn)
+    : H265VideoRtpSink(RtpTransProto::kRtpOverUdp, -1) {
+    udp_conn_ = udp_conn;
+}
+
+H265VideoRtpSink::H265VideoRtpSink(RtpTransProto transport,
+                                   int8_t rtp_channel)
+    : transport_(transport),
+      tcp_conn_(nullptr),
+      rtp_channel_(rtp_channel),
+      udp_conn_(nullptr),
+      max_payload_(transport == RtpTransProto::kRtpOverTcp
+                       ? 0xFFFF - RTP_HEADER_SIZE
+                       : RTP_MAX_PAYLOAD_SIZE),
+      ap_count_(0) {
+
+    std::random_device rd;
+    init_seq_ = rd() & 0xFF; // limited
+    ::bzero(&ap_header_, sizeof(ap_header_));
+    ::bzero(ap_nalu_header_, sizeof(ap_nalu_header_));
+    LOG_DEBUG << "H265VideoRtpSink::ctor at " << this;
+}
+
+H265VideoRtpSink::~H265VideoRtpSink() {
+    LOG_DEBUG << "H265VideoRtpSink::dtor at " << this;
+}
+
+void H265VideoRtpSink::Output(const uint8_t *data, size_t len) {
+    if (tcp_conn_) {
+        tcp_conn_->Send(data, len);
+    } else if (udp_conn_) {
+        udp_conn_->Send(data, len);
+    }
+}
+
+size_t H265VideoRtpSink::QueuedBytes() const {
+    return tcp_conn_ ? tcp_conn_->output_buffer()->ReadableBytes() : 0;
+}
+
+void H265VideoRtpSink::Send(const unsigned char *data, int len,
+                            const std::shared_ptr<void> &info) {
+    SendPacket((RtpHeader *)info.get(), nullptr, 0, data, len);
+}
+
+void H265VideoRtpSink::Send(const AVPacket &pkt, const AVPacketInfo &info) {
+    // 连接已断开，不再打包
+    if (tcp_conn_ && !tcp_conn_->Connected()) {
+        ++dropped_frames_;
+        ap_payload_.clear();
+        ap_count_ = 0;
+        return;
+    }
+    if (pkt.size < RTP_H265_NALU_HEAD_LEN) {
+        return;
+    }
+
+    RtpHeader header;
+    ::bzero(&header, sizeof(header));
+    header.version = RTP_VESION;
+    header.payloadType = info.payload_type;
+    header.timestamp = muduo::HostToNetwork32(info.timestamp);
+    header.ssrc = muduo::HostToNetwork32(info.ssrc);
+
+    const uint8_t *nalu = pkt.buffer.get() + pkt.prepend_size;
+    uint8_t type = H265FileSource::NaluType(nalu);
+    bool vcl = H265FileSource::IsVcl(type);
+
+    // AP只合并同一时间戳的NALU
+    if (ap_count_ > 0 && ap_header_.timestamp != header.timestamp) {
+        FlushAggregation();
+    }
+
+    if (!vcl) {
+        // PayloadHdr + 已暂存的 + 2字节长度 + NALU，TCP也按MTU合并
+        size_t need = 2 + pkt.size;
+        if (ap_count_ > 0 && RTP_H265_NALU_HEAD_LEN + ap_payload_.size() +
+                                     need > RTP_MAX_PAYLOAD_SIZE) {
+            FlushAggregation();
+        }
+        if (RTP_H265_NALU_HEAD_LEN + need <= RTP_MAX_PAYLOAD_SIZE) {
+            if (ap_count_ == 0) {
+                ap_header_ = header;
+                memcpy(ap_nalu_header_, nalu, RTP_H265_NALU_HEAD_LEN);
+            }
+            ap_payload_.push_back((char)(pkt.size >> 8));
+            ap_payload_.push_back((char)(pkt.size & 0xFF));
+            ap_payload_.append((const char *)nalu, pkt.size);
+            ++ap_count_;
+            return;
+        }
+    }
+
+    FlushAggregation();
+
+    // 图像NALU标记一帧的结束
+    header.marker = vcl ? 1 : 0;
+    if (pkt.size <= max_payload_) {
+        SendSingle(pkt, &header);
+    } else {
+        SendFragments(pkt, &header);
+    }
+}
+
+void H265VideoRtpSink::FlushAggregation() {
+    if (ap_count_ == 0) {
+        return;
+    }
+
+    if (ap_count_ == 1) {
+        // 只有一个NALU时单独发送，去掉长度字段
+        SendPacket(&ap_header_, nullptr, 0,
+                   (const uint8_t *)ap_payload_.data() + 2,
+                   ap_payload_.size() - 2);
+    } else {
+        /*
+         *  PayloadHdr (Type=48)
+         *  +---------------+---------------+
+         *  |F|   Type    |  LayerId  | TID |
+         *  +-------------+-----------------+
+         *  后面依次是 NALU size(16 bit) + NALU
+         */
+        uint8_t payload_header[RTP_H265_NALU_HEAD_LEN];
+        payload_header[0] =
+            (ap_nalu_header_[0] & 0x81) | (RTP_H265_AP_TYPE << 1);
+        payload_header[1] = ap_nalu_header_[1];
+        SendPacket(&ap_header_, payload_header, sizeof(payload_header),
+                   (const uint8_t *)ap_payload_.data(), ap_payload_.size());
+    }
+
+    ap_payload_.clear();
+    ap_count_ = 0;
+}
+
+void H265VideoRtpSink::SendPacket(RtpHeader *header, const uint8_t *head,
+                                  size_t head_len, const uint8_t *data,
+                                  size_t len) {
+    size_t prefix = transport_ == RtpTransProto::kRtpOverTcp
+                        ? INTERLEAVED_FRAME_SIZE
+                        : 0;
+    size_t rtp_len = RTP_HEADER_SIZE + head_len + len;
+    std::unique_ptr<uint8_t[]> new_buf(new uint8_t[prefix + rtp_len]);
+
+    uint8_t *ptr = new_buf.get();
+    if (prefix) {
+        ptr[0] = '$';
+        ptr[1] = (uint8_t)rtp_channel_;
+        ptr[2] = (uint8_t)((rtp_len & 0xFF00) >> 8);
+        ptr[3] = (uint8_t)(rtp_len & 0xFF);
+    }
+
+    LOG_TRACE << "send seq " << init_seq_;
+    header->seq = muduo::HostToNetwork16(init_seq_++); // 随机初值，自动增长
+    memcpy(ptr + prefix, header, RTP_HEADER_SIZE);
+    if (head_len) {
+        memcpy(ptr + prefix + RTP_HEADER_SIZE, head, head_len);
+    }
+    memcpy(ptr + prefix + RTP_HEADER_SIZE + head_len, data, len);
+
+    Output(ptr, prefix + rtp_len);
+
+    ++packets_;
+    octets_ += prefix + rtp_len;
+}
+
+void H265VideoRtpSink::SendSingle(const AVPacket &pkt, RtpHeader *header) {
+    size_t prefix = transport_ == RtpTransProto::kRtpOverTcp
+                        ? INTERLEAVED_FRAME_SIZE
+                        : 0;
+    assert(pkt.prepend_size >= prefix + RTP_HEADER_SIZE);
+
+    uint8_t *pdata_start =
+        pkt.buffer.get() + (pkt.prepend_size - prefix - RTP_HEADER_SIZE);
+    uint32_t rtp_len = RTP_HEADER_SIZE + pkt.size;
+    if (prefix) {
+        pdata_start[0] = '$';
+        pdata_start[1] = (uint8_t)rtp_channel_;
+        pdata_start[2] = (uint8_t)((rtp_len & 0xFF00) >> 8);
+        pdata_start[3] = (uint8_t)(rtp_len & 0xFF);
+    }
+
+    LOG_TRACE << "send seq " << init_seq_;
+    header->seq = muduo::HostToNetwork16(init_seq_++); // 随机初值，自动增长
+    memcpy(pdata_start + prefix, header, RTP_HEADER_SIZE);
+
+    Output(pdata_start, prefix + rtp_len);
+
+    ++packets_;
+    octets_ += prefix + rtp_len;
+}
+
+void H265VideoRtpSink::SendFragments(const AVPacket &pkt, RtpHeader *header) {
+    /*
+     *  PayloadHdr (Type=49)            FU header
+     *  +---------------+---------------+---------------+
+     *  |F|   Type    |  LayerId  | TID |S|E|  FuType   |
+     *  +-------------+-----------------+---------------+
+     *  FU载荷去掉原NALU的2字节头，FuType为原NALU类型
+     */
+    const uint8_t *pdata = pkt.buffer.get() + pkt.prepend_size;
+    size_t data_len = pkt.size;
+
+    uint8_t fu[RTP_H265_FU_HEAD_LEN];
+    fu[0] = (pdata[0] & 0x81) | (RTP_H265_FU_TYPE << 1);
+    fu[1] = pdata[1];
+    fu[2] = 0x80 | H265FileSource::NaluType(pdata);
+
+    pdata += RTP_H265_NALU_HEAD_LEN;
+    data_len -= RTP_H265_NALU_HEAD_LEN;
+
+    uint8_t marker = header->marker;
+    size_t piece = max_payload_ - RTP_H265_FU_HEAD_LEN;
+    while (data_len > piece) {
+        header->marker = 0;
+        SendPacket(header, fu, sizeof(fu), pdata, piece);
+
+        pdata += piece;
+        data_len -= piece;
+
+        // set S 0
+        fu[2] &= ~0x80;
+    }
+
+    // last RTP piece
+    fu[2] |= 0x40;
+    header->marker = marker;
+    SendPacket(header, fu, sizeof(fu), pdata, data_len);
+}
+
+} // namespace muduo_media
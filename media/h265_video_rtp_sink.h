@@ -0,0 +1,76 @@
+#ifndef F40D867E_179C_4902_A5EF_AEAF23CC0E9B
+#define F40D867E_179C_4902_A5EF_AEAF23CC0E9B
+
+#include "defs.h"
+#include "multi_frame_rtp_sink.h"
+#include "net/tcp_connection.h"
+#include "net/udp_virtual_connection.h"
+#include "rtp.h"
+
+#include <string>
+
+namespace muduo_media {
+
+/// @brief RFC 7798 H.265打包
+///
+/// 能放进一个包的NALU单独发送，过大的用FU(49)分片。VPS/SPS/PPS/SEI这类
+/// 小NALU先暂存，与同一时间戳的其他非图像NALU合成一个AP(48)，在下一个
+/// 图像NALU或时间戳变化时发出。
+class H265VideoRtpSink : public MultiFrameRtpSink {
+public:
+    H265VideoRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
+                     int8_t rtp_channel);
+
+    H265VideoRtpSink(const muduo::net::UdpVirtualConnectionPtr &udp_conn);
+
+    virtual ~H265VideoRtpSink();
+
+    // data为完整的RTP载荷，info为RtpHeader
+    void Send(const unsigned char *data, int len,
+              const std::shared_ptr<void> &info) override;
+
+    void Send(const AVPacket &pkt, const AVPacketInfo &info) override;
+
+    size_t QueuedBytes() const override;
+    bool HasOutputQueue() const override { return tcp_conn_ != nullptr; }
+
+protected:
+    // 不绑定连接，子类通过Output接管打包后的数据
+    H265VideoRtpSink(RtpTransProto transport, int8_t rtp_channel);
+
+    virtual void Output(const uint8_t *data, size_t len);
+
+private:
+    // RTP载荷由head和data两段拼成，按传输方式加上interleaved头
+    void SendPacket(RtpHeader *header, const uint8_t *head, size_t head_len,
+                    const uint8_t *data, size_t len);
+
+    // 利用AVPacket的预留前置空间填写头部，不拷贝NALU
+    void SendSingle(const AVPacket &pkt, RtpHeader *header);
+
+    void SendFragments(const AVPacket &pkt, RtpHeader *header);
+
+    void FlushAggregation();
+
+private:
+    RtpTransProto transport_;
+    muduo::net::TcpConnectionPtr tcp_conn_;
+    int8_t rtp_channel_;
+
+    muduo::net::UdpVirtualConnectionPtr udp_conn_;
+
+    uint16_t init_seq_;
+
+    // 单个RTP包的最大载荷，UDP受MTU限制，TCP受interleaved长度限制
+    size_t max_payload_;
+
+    // 暂存的AP: 每个NALU前有2字节长度
+    std::string ap_payload_;
+    int ap_count_;
+    RtpHeader ap_header_;
+    uint8_t ap_nalu_header_[RTP_H265_NALU_HEAD_LEN];
+};
+
+} // namespace muduo_media
+
+#endif /* F40D867E_179C_4902_A5EF_AEAF23CC0E9B */
@@ -0,0 +1,228 @@
+#include "live_frame_source.h"
+#include "eventloop/event_loop.h"
+#include "media_log.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+
+namespace muduo_media {
+
+// 时移读取时pts跳变超过该值(90kHz)则重新对齐时钟，不按跳变等待
+static constexpr int64_t kMaxPtsGap = 10 * 90000;
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+LiveFrameSource::LiveFrameSource(const LiveStreamHubPtr &hub)
+    : hub_(hub),
+      subscription_(0),
+      loop_(nullptr),
+      pending_base_pts_(0),
+      pending_start_us_(0),
+      time_shifted_(false),
+      shifting_(false),
+      need_parameter_sets_(false),
+      shift_generation_(0),
+      shift_position_(0),
+      shift_base_pts_(-1),
+      shift_start_us_(0),
+      shift_last_pts_(0) {
+    std::random_device rd;
+    ssrc_ = rd();
+}
+
+LiveFrameSource::~LiveFrameSource() { StopPush(); }
+
+bool LiveFrameSource::StartPush(muduo::event_loop::EventLoop *loop,
+                                const FramePushCallback &cb) {
+    if (subscription_ != 0 || shifting_) {
+        return true;
+    }
+
+    loop_ = loop;
+    cb_ = cb;
+
+    if (time_shifted_) {
+        shifting_ = true;
+        shift_base_pts_ = -1;
+        DrainTimeShift(++shift_generation_);
+        return true;
+    }
+
+    std::vector<AVPacket> burst;
+    subscription_ = hub_->Subscribe(
+        loop, [this](const AVPacket &packet) { OnLivePacket(packet); },
+        &burst);
+
+    if (!burst.empty()) {
+        pending_.assign(burst.begin(), burst.end());
+        pending_base_pts_ = pending_.front().pts;
+        pending_start_us_ = NowMicros();
+        DrainPending();
+    }
+    return true;
+}
+
+void LiveFrameSource::StopPush() {
+    if (subscription_ != 0) {
+        hub_->Unsubscribe(subscription_);
+        subscription_ = 0;
+    }
+    pending_.clear();
+
+    if (shifting_) {
+        shifting_ = false;
+        ++shift_generation_;
+    }
+}
+
+void LiveFrameSource::OnLivePacket(const AVPacket &packet) {
+    if (pending_.empty()) {
+        cb_(packet);
+    } else {
+        pending_.push_back(packet);
+    }
+}
+
+void LiveFrameSource::DrainPending() {
+    while (!pending_.empty()) {
+        const AVPacket &packet = pending_.front();
+        int64_t due_us = pending_start_us_ +
+                         (int64_t)((packet.pts - pending_base_pts_) * 1000000 /
+                                   90000 / kCatchUpSpeed);
+        int64_t now_us = NowMicros();
+        if (due_us > now_us) {
+            // 定时器里只持有weak_ptr，观看者可能已经离开
+            std::weak_ptr<LiveFrameSource> weak_self(shared_from_this());
+            loop_->RunAfter((due_us - now_us) / 1e6, [weak_self]() {
+                auto self = weak_self.lock();
+                if (self) {
+                    self->DrainPending();
+                }
+            });
+            return;
+        }
+
+        // cb_可能触发StopPush清空队列，先取出。缓存回放的帧不计入转发延迟
+        AVPacket front = packet;
+        front.arrival_us = 0;
+        pending_.pop_front();
+        cb_(front);
+    }
+}
+
+bool LiveFrameSource::TimeShift(double offset, double *start_offset) {
+    const TimeShiftBufferPtr &buffer = hub_->time_shift_buffer();
+    if (!buffer) {
+        return false;
+    }
+
+    if (offset >= 0) {
+        StopPush();
+        time_shifted_ = false;
+        *start_offset = 0;
+        return true;
+    }
+
+    int64_t now_us = TimeShiftBuffer::WallMicros();
+    TimeShiftBuffer::KeyFrame key;
+    if (!buffer->FindKeyFrame(now_us + (int64_t)(offset * 1000000), &key)) {
+        return false;
+    }
+
+    // 下次StartPush从新位置开始
+    StopPush();
+    time_shifted_ = true;
+    need_parameter_sets_ = true;
+    shift_position_ = key.position;
+    *start_offset = (key.wall_us - now_us) / 1000000.0;
+    return true;
+}
+
+void LiveFrameSource::ScheduleTimeShift(uint32_t generation, double delay) {
+    std::weak_ptr<LiveFrameSource> weak_self(shared_from_this());
+    loop_->RunAfter(delay, [weak_self, generation]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->DrainTimeShift(generation);
+        }
+    });
+}
+
+void LiveFrameSource::DrainTimeShift(uint32_t generation) {
+    if (generation != shift_generation_) {
+        return;
+    }
+
+    const TimeShiftBufferPtr &buffer = hub_->time_shift_buffer();
+    // 与发布者同一loop时直接引用缓冲中的数据
+    bool share = hub_->publisher_loop() == loop_;
+
+    while (true) {
+        AVPacket packet;
+        uint64_t next = 0;
+        auto result = buffer->Read(shift_position_, share, &packet, &next);
+
+        if (result == TimeShiftBuffer::ReadResult::kOverrun) {
+            // 落后超过缓冲长度，跳到最旧的关键帧
+            TimeShiftBuffer::KeyFrame key;
+            if (!buffer->FindKeyFrame(0, &key)) {
+                ScheduleTimeShift(generation, kTimeShiftPollInterval);
+                return;
+            }
+            LOG_WARN << "time shift viewer overrun at " << this;
+            shift_position_ = key.position;
+            shift_base_pts_ = -1;
+            need_parameter_sets_ = true;
+            continue;
+        }
+        if (result == TimeShiftBuffer::ReadResult::kEmpty) {
+            ScheduleTimeShift(generation, kTimeShiftPollInterval);
+            return;
+        }
+
+        if (shift_base_pts_ < 0 ||
+            std::abs(packet.pts - shift_last_pts_) > kMaxPtsGap) {
+            shift_base_pts_ = packet.pts;
+            shift_start_us_ = NowMicros();
+        }
+        int64_t due_us = shift_start_us_ +
+                         (packet.pts - shift_base_pts_) * 1000000 / 90000;
+        int64_t now_us = NowMicros();
+        if (due_us > now_us) {
+            ScheduleTimeShift(generation, (due_us - now_us) / 1e6);
+            return;
+        }
+
+        shift_position_ = next;
+        shift_last_pts_ = packet.pts;
+
+        if (need_parameter_sets_) {
+            need_parameter_sets_ = false;
+            AVPacket sps;
+            AVPacket pps;
+            buffer->GetParameterSets(&sps, &pps);
+            for (AVPacket *sets : {&sps, &pps}) {
+                if (sets->buffer) {
+                    sets->pts = packet.pts;
+                    cb_(*sets);
+                    if (generation != shift_generation_) {
+                        return;
+                    }
+                }
+            }
+        }
+
+        // cb_可能触发StopPush
+        cb_(packet);
+        if (generation != shift_generation_) {
+            return;
+        }
+    }
+}
+
+} // namespace muduo_media
@@ -0,0 +1,74 @@
+#ifndef A91D6E38_2F4C_47B5_8C03_D5E7B1F29A64
+#define A91D6E38_2F4C_47B5_8C03_D5E7B1F29A64
+
+#include "live_stream_hub.h"
+#include "multi_frame_source.h"
+
+#include <deque>
+
+namespace muduo_media {
+
+/// @brief 每个观看者一个，订阅推流的LiveStreamHub
+///
+/// 订阅时先拿到hub缓存的GOP，第一帧立即发送，其余按pts以略快于实时的
+/// 速度发送，期间到达的实时帧排在后面，追上后直接转发。
+///
+/// hub启用了TimeShiftBuffer时支持时移: 不再订阅hub，而是从缓冲中自己的
+/// 位置按pts实时读取，始终落后直播同样的时长。
+class LiveFrameSource : public MultiFrameSource,
+                        public std::enable_shared_from_this<LiveFrameSource> {
+public:
+    // 追赶缓存GOP时的倍速
+    static constexpr double kCatchUpSpeed = 1.5;
+
+    LiveFrameSource(const LiveStreamHubPtr &hub);
+    ~LiveFrameSource();
+
+    // 只支持推送
+    bool GetNextFrame(AVPacket *packet) override { return false; }
+
+    bool StartPush(muduo::event_loop::EventLoop *loop,
+                   const FramePushCallback &cb) override;
+    void StopPush() override;
+
+    bool TimeShift(double offset, double *start_offset) override;
+
+    // 时移读到缓冲末尾后的重试间隔(秒)
+    static constexpr double kTimeShiftPollInterval = 0.02;
+
+private:
+    void OnLivePacket(const AVPacket &packet);
+
+    // 发送已到期的缓存帧，没发完时定时继续
+    void DrainPending();
+
+    // 发送时移缓冲中已到期的帧。generation与shift_generation_不同时说明
+    // 已停止或重新定位，旧的定时器作废
+    void DrainTimeShift(uint32_t generation);
+    void ScheduleTimeShift(uint32_t generation, double delay);
+
+private:
+    LiveStreamHubPtr hub_;
+    uint64_t subscription_;
+
+    muduo::event_loop::EventLoop *loop_;
+    FramePushCallback cb_;
+
+    std::deque<AVPacket> pending_;
+    int64_t pending_base_pts_;
+    int64_t pending_start_us_;
+
+    // 时移
+    bool time_shifted_;
+    bool shifting_;
+    bool need_parameter_sets_; // 从关键帧开始时先发送参数集
+    uint32_t shift_generation_;
+    uint64_t shift_position_;
+    int64_t shift_base_pts_; // -1表示下一帧重新对齐时钟
+    int64_t shift_start_us_;
+    int64_t shift_last_pts_;
+};
+
+} // namespace muduo_media
+
+#endif /* A91D6E38_2F4C_47B5_8C03_D5E7B1F29A64 */
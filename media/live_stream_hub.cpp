@@ -0,0 +1,209 @@
+#include "live_stream_hub.h"
+#include "defs.h"
+#include "eventloop/event_loop.h"
+#include "media_log.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+LiveStreamHub::LiveStreamHub(size_t gop_cache_bytes)
+    : publisher_loop_(nullptr),
+      subscribers_(std::make_shared<SubscriberList>()),
+      next_id_(1),
+      gop_bytes_(0),
+      gop_cache_limit_(gop_cache_bytes) {}
+
+LiveStreamHub::~LiveStreamHub() {}
+
+uint64_t LiveStreamHub::Subscribe(muduo::event_loop::EventLoop *loop,
+                                  const FramePushCallback &cb,
+                                  std::vector<AVPacket> *burst) {
+    SubscriberPtr subscriber = std::make_shared<Subscriber>();
+    subscriber->loop = loop;
+    subscriber->cb = cb;
+    subscriber->synced = false;
+    subscriber->active = true;
+
+    // 取缓存快照和加入列表在同一临界区，Publish的每个NALU要么在快照里，
+    // 要么之后回调
+    std::vector<AVPacket> cached;
+    uint64_t id;
+    size_t total;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (burst && !gop_.empty()) {
+            int64_t pts = gop_.front().pts;
+            cached.reserve(gop_.size() + 2);
+            for (const AVPacket *param : {&sps_, &pps_}) {
+                if (param->buffer) {
+                    cached.push_back(*param);
+                    cached.back().pts = pts;
+                }
+            }
+            cached.insert(cached.end(), gop_.begin(), gop_.end());
+            subscriber->synced = true;
+        }
+
+        id = subscriber->id = next_id_++;
+        auto list = std::make_shared<SubscriberList>(*subscribers_);
+        list->push_back(subscriber);
+        subscribers_ = list;
+        total = list->size();
+    }
+
+    if (!cached.empty()) {
+        // 负载只读，其他loop只需在锁外拷贝出自己的前置空间
+        bool share = loop == publisher_loop_;
+        burst->reserve(cached.size());
+        for (auto &&packet : cached) {
+            burst->push_back(share ? packet : CopyPacket(packet));
+        }
+    }
+
+    LOG_DEBUG << "live subscriber " << id << ", burst " << cached.size()
+              << ", total " << total;
+    return id;
+}
+
+void LiveStreamHub::Unsubscribe(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto list = std::make_shared<SubscriberList>();
+    list->reserve(subscribers_->size());
+    for (auto &&subscriber : *subscribers_) {
+        if (subscriber->id == id) {
+            subscriber->active = false;
+        } else {
+            list->push_back(subscriber);
+        }
+    }
+    subscribers_ = list;
+}
+
+size_t LiveStreamHub::subscriber_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_->size();
+}
+
+size_t LiveStreamHub::gop_cache_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return gop_bytes_;
+}
+
+void LiveStreamHub::SetParameterSets(const std::string &sps,
+                                     const std::string &pps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!sps.empty()) {
+        sps_ = MakePacket(sps, 0);
+    }
+    if (!pps.empty()) {
+        pps_ = MakePacket(pps, 0);
+    }
+}
+
+void LiveStreamHub::Publish(const AVPacket &packet) {
+    if (time_shift_) {
+        time_shift_->Write(packet);
+    }
+
+    std::shared_ptr<const SubscriberList> list;
+    AVPacket sps;
+    AVPacket pps;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (packet.type == NALU_TYPE_SPS) {
+            sps_ = packet;
+        } else if (packet.type == NALU_TYPE_PPS) {
+            pps_ = packet;
+        } else {
+            CacheGop(packet);
+        }
+        list = subscribers_;
+        sps = sps_;
+        pps = pps_;
+    }
+
+    for (auto &&subscriber : *list) {
+        if (!subscriber->synced) {
+            if (packet.type != NALU_TYPE_IDR) {
+                continue;
+            }
+            // 从IDR开始，先补发参数集，时间戳与IDR相同
+            subscriber->synced = true;
+            if (sps.buffer) {
+                sps.pts = packet.pts;
+                Deliver(subscriber, sps);
+            }
+            if (pps.buffer) {
+                pps.pts = packet.pts;
+                Deliver(subscriber, pps);
+            }
+        }
+        Deliver(subscriber, packet);
+    }
+}
+
+void LiveStreamHub::CacheGop(const AVPacket &packet) {
+    if (0 == gop_cache_limit_) {
+        return;
+    }
+
+    if (packet.type == NALU_TYPE_IDR) {
+        // 同一帧的多个IDR slice属于同一个GOP
+        if (gop_.empty() || gop_.front().pts != packet.pts) {
+            gop_.clear();
+            gop_bytes_ = 0;
+        }
+    } else if (gop_.empty()) {
+        // 还没有IDR，或者本GOP已超出上限
+        return;
+    }
+
+    if (gop_bytes_ + packet.size > gop_cache_limit_) {
+        LOG_DEBUG << "GOP exceeds cache limit " << gop_cache_limit_
+                  << ", drop cache until next IDR";
+        gop_.clear();
+        gop_bytes_ = 0;
+        return;
+    }
+
+    gop_.push_back(packet);
+    gop_bytes_ += packet.size;
+}
+
+void LiveStreamHub::Deliver(const SubscriberPtr &subscriber,
+                            const AVPacket &packet) {
+    if (subscriber->loop->IsInLoopThread()) {
+        subscriber->cb(packet);
+        return;
+    }
+
+    AVPacket copy = CopyPacket(packet);
+    subscriber->loop->QueueInLoop([subscriber, copy]() {
+        if (subscriber->active) {
+            subscriber->cb(copy);
+        }
+    });
+}
+
+AVPacket LiveStreamHub::CopyPacket(const AVPacket &packet) {
+    AVPacket copy = packet;
+    copy.buffer.reset(new uint8_t[packet.prepend_size + packet.size]);
+    memcpy(copy.buffer.get() + packet.prepend_size,
+           packet.buffer.get() + packet.prepend_size, packet.size);
+    return copy;
+}
+
+AVPacket LiveStreamHub::MakePacket(const std::string &nalu, int64_t pts) {
+    AVPacket packet;
+    packet.prepend_size = defs::kBufPrependSize;
+    packet.size = nalu.size();
+    packet.buffer.reset(new uint8_t[packet.prepend_size + packet.size]);
+    memcpy(packet.buffer.get() + packet.prepend_size, nalu.data(),
+           nalu.size());
+    packet.type = nalu[0] & 0x1F;
+    packet.pts = pts;
+    return packet;
+}
+
+} // namespace muduo_media
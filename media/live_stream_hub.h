@@ -0,0 +1,104 @@
+#ifndef C8F35A17_6E2B_4D90_B1A4_3F7E05D9C216
+#define C8F35A17_6E2B_4D90_B1A4_3F7E05D9C216
+
+#include "av_packet.h"
+#include "multi_frame_source.h"
+#include "time_shift_buffer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace muduo_media {
+
+/// @brief 一路直播流的分发点
+///
+/// 发布者在自己的loop上解包一次，Publish把NALU分发给所有订阅者。订阅者
+/// 在同一个loop上时直接回调、共用缓冲；在其他loop上时投递一份拷贝，因为
+/// sink会在前置空间里写RTP头。订阅者列表写时复制，Publish不持锁回调。
+///
+/// hub缓存最近的SPS/PPS和从最后一个IDR开始的当前GOP(只持有引用，不拷贝)。
+/// 新订阅者先拿到这段缓存，不必等下一个IDR；没有缓存(超出上限或还没有
+/// IDR)时从下一个IDR开始接收。
+class LiveStreamHub {
+public:
+    static constexpr size_t kDefaultGopCacheBytes = 4 * 1024 * 1024;
+
+    explicit LiveStreamHub(size_t gop_cache_bytes = kDefaultGopCacheBytes);
+    ~LiveStreamHub();
+
+    /// 发布者所在loop，同一loop的订阅者与缓存共用缓冲
+    void set_publisher_loop(muduo::event_loop::EventLoop *loop) {
+        publisher_loop_ = loop;
+    }
+    muduo::event_loop::EventLoop *publisher_loop() const {
+        return publisher_loop_;
+    }
+
+    /// 启用时移，Publish的每个NALU同时写入buffer。须在发布之前设置
+    void set_time_shift_buffer(const TimeShiftBufferPtr &buffer) {
+        time_shift_ = buffer;
+    }
+    const TimeShiftBufferPtr &time_shift_buffer() const { return time_shift_; }
+
+    /// 返回订阅id，cb总是在loop线程中调用。burst非空时填入缓存的参数集和
+    /// 当前GOP，之后的cb从缓存末尾接续
+    uint64_t Subscribe(muduo::event_loop::EventLoop *loop,
+                       const FramePushCallback &cb,
+                       std::vector<AVPacket> *burst = nullptr);
+
+    /// 须在订阅时的loop线程中调用，返回后不会再回调
+    void Unsubscribe(uint64_t id);
+
+    /// 由发布者loop调用
+    void Publish(const AVPacket &packet);
+
+    /// 来自SDP sprop-parameter-sets的参数集，不含起始码
+    void SetParameterSets(const std::string &sps, const std::string &pps);
+
+    size_t subscriber_count() const;
+    size_t gop_cache_bytes() const;
+
+private:
+    struct Subscriber {
+        uint64_t id;
+        muduo::event_loop::EventLoop *loop;
+        FramePushCallback cb;
+        bool synced;              // 只由发布者loop访问
+        std::atomic<bool> active; // 退订后跨loop投递的帧直接丢弃
+    };
+
+    using SubscriberPtr = std::shared_ptr<Subscriber>;
+    using SubscriberList = std::vector<SubscriberPtr>;
+
+    void Deliver(const SubscriberPtr &subscriber, const AVPacket &packet);
+
+    // mutex_已加锁
+    void CacheGop(const AVPacket &packet);
+
+    static AVPacket CopyPacket(const AVPacket &packet);
+    static AVPacket MakePacket(const std::string &nalu, int64_t pts);
+
+private:
+    muduo::event_loop::EventLoop *publisher_loop_;
+    TimeShiftBufferPtr time_shift_;
+
+    // 保护订阅者列表和缓存；Publish只在更新缓存、取列表快照时持锁
+    mutable std::mutex mutex_;
+    std::shared_ptr<const SubscriberList> subscribers_;
+    uint64_t next_id_;
+
+    AVPacket sps_;
+    AVPacket pps_;
+
+    std::vector<AVPacket> gop_; // gop_[0]是IDR
+    size_t gop_bytes_;
+    const size_t gop_cache_limit_;
+};
+
+using LiveStreamHubPtr = std::shared_ptr<LiveStreamHub>;
+
+} // namespace muduo_media
+
+#endif /* C8F35A17_6E2B_4D90_B1A4_3F7E05D9C216 */
@@ -0,0 +1,39 @@
+#ifndef F1B6A3D9_52C7_4E08_A4D1_6E93B0C27F5A
+#define F1B6A3D9_52C7_4E08_A4D1_6E93B0C27F5A
+
+#include "logger/logger.h"
+
+/// media和rtsp库编译期的最低日志级别，低于它的LOG_xxx不生成任何代码，
+/// 参数也不会求值。取值与Logger::LogLevel一致：0 TRACE, 1 DEBUG, 2 INFO。
+/// 由CMake的MUDUO_MEDIA_MIN_LOG_LEVEL设置。
+#ifndef MUDUO_MEDIA_MIN_LOG_LEVEL
+#define MUDUO_MEDIA_MIN_LOG_LEVEL 0
+#endif
+
+namespace muduo_media {
+
+/// 吞掉所有<<的空日志流
+struct NullLogStream {
+    template <typename T> NullLogStream &operator<<(const T &) { return *this; }
+};
+
+} // namespace muduo_media
+
+#define MUDUO_MEDIA_LOG_NOTHING while (false) ::muduo_media::NullLogStream()
+
+#if MUDUO_MEDIA_MIN_LOG_LEVEL > 0
+#undef LOG_TRACE
+#define LOG_TRACE MUDUO_MEDIA_LOG_NOTHING
+#endif
+
+#if MUDUO_MEDIA_MIN_LOG_LEVEL > 1
+#undef LOG_DEBUG
+#define LOG_DEBUG MUDUO_MEDIA_LOG_NOTHING
+#endif
+
+#if MUDUO_MEDIA_MIN_LOG_LEVEL > 2
+#undef LOG_INFO
+#define LOG_INFO MUDUO_MEDIA_LOG_NOTHING
+#endif
+
+#endif /* F1B6A3D9_52C7_4E08_A4D1_6E93B0C27F5A */
@@ -4,7 +4,7 @@
 
 namespace muduo_media {
 MediaSubsession::MediaSubsession(unsigned int fps, unsigned int time_base)
-    : track_id_(0), fps_(fps), time_base_(time_base) {}
+    : track_id_(0), fps_(fps), time_base_(time_base), frame_duration_(0) {}
 
 MediaSubsession::~MediaSubsession() {}
 
@@ -13,6 +13,9 @@ std::string MediaSubsession::TrackId() {
 }
 
 unsigned int MediaSubsession::Duration() const {
+    if (frame_duration_ > 0) {
+        return frame_duration_;
+    }
     if (0 == fps_) {
         throw std::runtime_error("0 fps for duration calculation");
     }
@@ -20,4 +23,8 @@ unsigned int MediaSubsession::Duration() const {
     return time_base_ / fps_;
 }
 
+double MediaSubsession::FrameInterval() const {
+    return (double)Duration() / time_base_;
+}
+
 } // namespace muduo_media
\ No newline at end of file
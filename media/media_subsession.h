@@ -31,14 +31,31 @@ public:
     unsigned int time_base() const { return time_base_; }
     void set_time_base(unsigned int time_base) { time_base_ = time_base; }
 
-    // 时间戳步进
+    // 时间戳步进，设置了frame_duration时直接使用，否则按fps计算
     unsigned int Duration() const;
 
+    // 来自码流的精确步进(如29.97fps为3003)，0表示按fps计算
+    void set_frame_duration(unsigned int duration) {
+        frame_duration_ = duration;
+    }
+
+    // 帧间隔，秒
+    double FrameInterval() const;
+
     unsigned char payload_type() const { return payload_type_; }
     void set_payload_type(unsigned char type) { payload_type_ = type; }
 
     virtual std::string GetSdp() = 0;
 
+    // 点播时长(秒)，0表示直播或未知
+    virtual double PlayLength() { return 0; }
+
+    // 直播轨道在SDP中的范围为npt=now-
+    virtual bool IsLive() const { return true; }
+
+    // 索引等常驻数据的字节数，点播目录按此淘汰空闲会话；未加载时为0
+    virtual size_t MemoryBytes() { return 0; }
+
     virtual RtpSinkPtr
     NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
                int8_t rtp_channel) = 0;
@@ -52,6 +69,7 @@ protected:
     unsigned int track_id_;
     unsigned int fps_;
     unsigned int time_base_;
+    unsigned int frame_duration_;
     unsigned char payload_type_;
 };
 
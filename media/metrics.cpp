@@ -0,0 +1,311 @@
+#include "metrics.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+namespace {
+
+struct MetricDesc {
+    const char *name;
+    const char *help;
+    MetricCounter LoopMetrics::*counter;
+    MetricGauge LoopMetrics::*gauge;
+};
+
+const MetricDesc kMetricDescs[] = {
+    {"rtsp_connections", "Open RTSP TCP connections.", nullptr,
+     &LoopMetrics::rtsp_connections},
+    {"rtsp_sessions", "Live RTSP sessions.", nullptr,
+     &LoopMetrics::rtsp_sessions},
+    {"streams", "Set up streams.", nullptr, &LoopMetrics::streams},
+    {"streams_playing", "Streams currently playing.", nullptr,
+     &LoopMetrics::streams_playing},
+    {"play_requests_total", "PLAY requests handled.",
+     &LoopMetrics::play_requests, nullptr},
+    {"frames_sent_total", "Frames handed to RTP sinks.",
+     &LoopMetrics::frames_sent, nullptr},
+    {"frames_dropped_total", "Frames read but not sent.",
+     &LoopMetrics::frames_dropped, nullptr},
+    {"rtp_packets_total", "RTP packets sent.", &LoopMetrics::rtp_packets,
+     nullptr},
+    {"rtp_octets_total", "RTP bytes sent, including framing.",
+     &LoopMetrics::rtp_octets, nullptr},
+    {"rtcp_packets_total", "RTCP packets received.",
+     &LoopMetrics::rtcp_packets, nullptr},
+    {"rtcp_malformed_total", "Malformed RTCP compound packets.",
+     &LoopMetrics::rtcp_malformed, nullptr},
+    {"rtcp_packets_lost_total", "Packets lost as reported by receivers.",
+     &LoopMetrics::rtcp_packets_lost, nullptr},
+    {"rtcp_fraction_lost", "Sum over streams of the last RR fraction lost "
+                           "(1/256 units).",
+     nullptr, &LoopMetrics::rtcp_fraction_lost},
+    {"rtcp_jitter", "Sum over streams of the last RR interarrival jitter "
+                    "(RTP timestamp units).",
+     nullptr, &LoopMetrics::rtcp_jitter},
+    {"ingest_streams", "Streams being recorded from publishers.", nullptr,
+     &LoopMetrics::ingest_streams},
+    {"ingest_rtp_packets_total", "RTP packets received from publishers.",
+     &LoopMetrics::ingest_rtp_packets, nullptr},
+    {"ingest_rtp_lost_total", "Publisher RTP packets missing by sequence.",
+     &LoopMetrics::ingest_rtp_lost, nullptr},
+    {"ingest_nalus_total", "NAL units depacketized from publishers.",
+     &LoopMetrics::ingest_nalus, nullptr},
+    {"relay_upstreams", "Upstream RTSP sources being relayed.", nullptr,
+     &LoopMetrics::relay_upstreams},
+    {"relay_reconnects_total", "Reconnect attempts to upstream sources.",
+     &LoopMetrics::relay_reconnects, nullptr},
+    {"relay_rtp_packets_total", "RTP packets received from upstream sources.",
+     &LoopMetrics::relay_rtp_packets, nullptr},
+    {"relay_rtp_lost_total", "Upstream RTP packets missing by sequence.",
+     &LoopMetrics::relay_rtp_lost, nullptr},
+    {"vod_sessions", "On-demand sessions cached by the catalog.", nullptr,
+     &LoopMetrics::vod_sessions},
+    {"vod_memory_bytes", "Index memory held by cached on-demand sessions.",
+     nullptr, &LoopMetrics::vod_memory_bytes},
+    {"vod_session_loads_total", "On-demand sessions created on first request.",
+     &LoopMetrics::vod_session_loads, nullptr},
+    {"vod_evictions_total", "Idle on-demand sessions evicted by the catalog.",
+     &LoopMetrics::vod_evictions, nullptr},
+    {"output_queue_bytes", "Bytes waiting in TCP output buffers.", nullptr,
+     &LoopMetrics::output_queue_bytes},
+    {"bulk_octets_total", "RTP bytes sent by unpaced bulk streams.",
+     &LoopMetrics::bulk_octets, nullptr},
+};
+
+struct LatencyDesc {
+    const char *name;
+    const char *help;
+    LatencyHistogram LatencyMetrics::*histogram;
+};
+
+const LatencyDesc kLatencyDescs[] = {
+    {"play_timer_lateness_microseconds",
+     "Delay between the scheduled and actual PlayOnce run.",
+     &LatencyMetrics::play_timer_lateness},
+    {"source_read_microseconds", "Time spent in GetNextFrame.",
+     &LatencyMetrics::source_read},
+    {"packetize_microseconds", "Time spent packetizing and sending a NALU.",
+     &LatencyMetrics::packetize},
+    {"deadline_to_send_microseconds",
+     "Delay from frame deadline to its last packet written.",
+     &LatencyMetrics::deadline_to_send},
+    {"time_to_first_frame_microseconds",
+     "Delay from PLAY to the first picture NALU written.",
+     &LatencyMetrics::time_to_first_frame},
+    {"index_load_microseconds",
+     "One-time keyframe index load or build of a file on its first use.",
+     &LatencyMetrics::index_load},
+    {"relay_forward_microseconds",
+     "Delay added by the relay, from upstream RTP arrival to NALU written.",
+     &LatencyMetrics::relay_forward},
+};
+
+const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+void RenderSummary(const char *name, const char *label_name,
+                   const std::string &label_value,
+                   const LatencyHistogram &histogram, std::string *text) {
+    char line[256];
+    for (double q : kQuantiles) {
+        snprintf(line, sizeof(line),
+                 "muduo_media_%s{%s=\"%s\",quantile=\"%g\"} %llu\n", name,
+                 label_name, label_value.c_str(), q,
+                 (unsigned long long)histogram.Percentile(q));
+        text->append(line);
+    }
+    snprintf(line, sizeof(line), "muduo_media_%s_sum{%s=\"%s\"} %llu\n",
+             name, label_name, label_value.c_str(),
+             (unsigned long long)histogram.sum());
+    text->append(line);
+    snprintf(line, sizeof(line), "muduo_media_%s_count{%s=\"%s\"} %llu\n",
+             name, label_name, label_value.c_str(),
+             (unsigned long long)histogram.count());
+    text->append(line);
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() : sum_(0) {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < (uint64_t)kSubBuckets) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent >= kMaxExponent) {
+        return kBucketCount - 1;
+    }
+    int shift = exponent - kSubBucketBits;
+    int sub = (int)(value >> shift) & (kSubBuckets - 1);
+    return kSubBuckets + shift * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int shift = (index - kSubBuckets) / kSubBuckets;
+    uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t us) {
+    uint64_t value = us > 0 ? (uint64_t)us : 0;
+    buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (auto &bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(q * total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return BucketUpperBound(i);
+        }
+    }
+    return BucketUpperBound(kBucketCount - 1);
+}
+
+LoopMetrics *LoopMetrics::Local() {
+    static thread_local LoopMetrics *metrics = nullptr;
+    if (!metrics) {
+        char name[32];
+        snprintf(name, sizeof(name), "%ld", (long)::syscall(SYS_gettid));
+        metrics = MetricsRegistry::Instance().Register(name);
+    }
+    return metrics;
+}
+
+MetricsRegistry &MetricsRegistry::Instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+LoopMetrics *MetricsRegistry::Register(const std::string &loop_name) {
+    // C++11的operator new不保证alignas(64)，按缓存行对齐单独分配。
+    // 注册后不再释放
+    void *memory = nullptr;
+    if (::posix_memalign(&memory, alignof(LoopMetrics), sizeof(LoopMetrics)) !=
+        0) {
+        throw std::bad_alloc();
+    }
+    LoopMetrics *metrics = new (memory) LoopMetrics(loop_name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    loops_.push_back(metrics);
+    return metrics;
+}
+
+void MetricsRegistry::RegisterSession(const std::string &session_name,
+                                      const LatencyMetricsPtr &latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.emplace_back(session_name, latency);
+}
+
+void MetricsRegistry::UnregisterSession(const LatencyMetricsPtr &latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+        if (!it->second.owner_before(latency) &&
+            !latency.owner_before(it->second)) {
+            sessions_.erase(it);
+            return;
+        }
+    }
+}
+
+std::string MetricsRegistry::RenderPrometheus() {
+    std::vector<LoopMetrics *> loops;
+    std::vector<std::pair<std::string, LatencyMetricsPtr>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loops = loops_;
+
+        auto it = sessions_.begin();
+        while (it != sessions_.end()) {
+            LatencyMetricsPtr latency = it->second.lock();
+            if (latency) {
+                sessions.emplace_back(it->first, latency);
+                ++it;
+            } else {
+                it = sessions_.erase(it);
+            }
+        }
+    }
+
+    std::string text;
+    text.reserve(4096);
+
+    char line[256];
+    for (const MetricDesc &desc : kMetricDescs) {
+        snprintf(line, sizeof(line),
+                 "# HELP muduo_media_%s %s\n# TYPE muduo_media_%s %s\n",
+                 desc.name, desc.help, desc.name,
+                 desc.counter ? "counter" : "gauge");
+        text.append(line);
+
+        for (LoopMetrics *metrics : loops) {
+            if (desc.counter) {
+                snprintf(line, sizeof(line),
+                         "muduo_media_%s{loop=\"%s\"} %llu\n", desc.name,
+                         metrics->name.c_str(),
+                         (unsigned long long)(metrics->*desc.counter).value());
+            } else {
+                snprintf(line, sizeof(line),
+                         "muduo_media_%s{loop=\"%s\"} %lld\n", desc.name,
+                         metrics->name.c_str(),
+                         (long long)(metrics->*desc.gauge).value());
+            }
+            text.append(line);
+        }
+    }
+
+    for (const LatencyDesc &desc : kLatencyDescs) {
+        snprintf(line, sizeof(line),
+                 "# HELP muduo_media_%s %s\n# TYPE muduo_media_%s summary\n",
+                 desc.name, desc.help, desc.name);
+        text.append(line);
+
+        for (LoopMetrics *metrics : loops) {
+            RenderSummary(desc.name, "loop", metrics->name,
+                          metrics->latency.*desc.histogram, &text);
+        }
+        for (auto &session : sessions) {
+            RenderSummary(desc.name, "session", session.first,
+                          (*session.second).*desc.histogram, &text);
+        }
+    }
+    return text;
+}
+
+} // namespace muduo_media
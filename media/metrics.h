@@ -0,0 +1,167 @@
+#ifndef E4F0C2B7_1A9D_4E36_8C5B_92D7F31A6E08
+#define E4F0C2B7_1A9D_4E36_8C5B_92D7F31A6E08
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace muduo_media {
+
+/// 单调递增计数。基本只由所属loop线程更新，relaxed原子操作没有竞争
+class MetricCounter {
+public:
+    MetricCounter() : value_(0) {}
+
+    void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_;
+};
+
+/// 可增可减的瞬时值
+class MetricGauge {
+public:
+    MetricGauge() : value_(0) {}
+
+    void Add(int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    void Sub(int64_t n = 1) { value_.fetch_sub(n, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
+
+/// @brief 对数线性分桶的延迟直方图，单位us
+///
+/// 每个2的幂区间分成16个子桶，相对误差不超过1/16。记录只有几次relaxed
+/// fetch_add，可以常开；百分位在采集时计算。
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 32; // 超过2^32us的按最大值计
+    static constexpr int kBucketCount =
+        kSubBuckets + (kMaxExponent - kSubBucketBits) * kSubBuckets;
+
+    LatencyHistogram();
+
+    void Record(int64_t us);
+
+    uint64_t count() const;
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    /// q取值[0, 1]，返回所在桶的上界
+    uint64_t Percentile(double q) const;
+
+private:
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(int index);
+
+    std::atomic<uint64_t> buckets_[kBucketCount];
+    std::atomic<uint64_t> sum_;
+};
+
+/// @brief 帧发送路径上的几段延迟
+struct LatencyMetrics {
+    LatencyHistogram play_timer_lateness; // 定时器实际触发时间 - 预期时间
+    LatencyHistogram source_read;         // GetNextFrame耗时
+    LatencyHistogram packetize;           // RtpSink::Send耗时
+    LatencyHistogram deadline_to_send;    // 帧预期时间 -> 最后一个包写出
+    LatencyHistogram time_to_first_frame; // PLAY -> 第一个图像帧写出
+    LatencyHistogram index_load;          // 首次使用文件时建立索引
+    LatencyHistogram relay_forward;       // 上游RTP包到达 -> 转发写出
+};
+
+using LatencyMetricsPtr = std::shared_ptr<LatencyMetrics>;
+
+/// @brief 每个loop线程一份的指标，避免多个loop写同一缓存行
+///
+/// 采集线程只做relaxed读取，不加锁，不会阻塞媒体loop。
+struct alignas(64) LoopMetrics {
+    explicit LoopMetrics(const std::string &loop_name) : name(loop_name) {}
+
+    /// 当前线程的指标，首次调用时注册
+    static LoopMetrics *Local();
+
+    const std::string name;
+
+    MetricGauge rtsp_connections;
+    MetricGauge rtsp_sessions;
+    MetricGauge streams;
+    MetricGauge streams_playing;
+
+    MetricCounter play_requests;
+    MetricCounter frames_sent;
+    MetricCounter frames_dropped;
+    MetricCounter rtp_packets;
+    MetricCounter rtp_octets;
+
+    MetricCounter rtcp_packets;
+    MetricCounter rtcp_malformed;
+    MetricCounter rtcp_packets_lost;
+    // 各流最近一次RR的和，除以streams得到平均值
+    MetricGauge rtcp_fraction_lost;
+    MetricGauge rtcp_jitter;
+
+    // 推流(RECORD)接收
+    MetricGauge ingest_streams;
+    MetricCounter ingest_rtp_packets;
+    MetricCounter ingest_rtp_lost;
+    MetricCounter ingest_nalus;
+
+    // 从上游RTSP服务拉流转发
+    MetricGauge relay_upstreams;
+    MetricCounter relay_reconnects;
+    MetricCounter relay_rtp_packets;
+    MetricCounter relay_rtp_lost;
+
+    // 点播目录中缓存的会话
+    MetricGauge vod_sessions;
+    MetricGauge vod_memory_bytes;
+    MetricCounter vod_session_loads;
+    MetricCounter vod_evictions;
+
+    // 各流TCP发送缓冲中尚未写出的字节数之和
+    MetricGauge output_queue_bytes;
+
+    // 不限速(Speed)发送的字节数，rate()即导出速度
+    MetricCounter bulk_octets;
+
+    LatencyMetrics latency;
+};
+
+/// @brief 所有loop的指标
+///
+/// LoopMetrics注册后不再释放，采集时无需担心loop线程已退出。
+class MetricsRegistry {
+public:
+    static MetricsRegistry &Instance();
+
+    LoopMetrics *Register(const std::string &loop_name);
+
+    /// 按MediaSession聚合的延迟。只保存weak_ptr，会话析构时注销
+    void RegisterSession(const std::string &session_name,
+                         const LatencyMetricsPtr &latency);
+    void UnregisterSession(const LatencyMetricsPtr &latency);
+
+    /// Prometheus text format 0.0.4
+    std::string RenderPrometheus();
+
+private:
+    MetricsRegistry() = default;
+
+    // 只在注册和采集时加锁，媒体loop更新指标不经过这里
+    std::mutex mutex_;
+    std::vector<LoopMetrics *> loops_;
+    // 过期的weak_ptr仍占住make_shared的整块内存，须及时注销
+    std::vector<std::pair<std::string, std::weak_ptr<LatencyMetrics>>>
+        sessions_;
+};
+
+} // namespace muduo_media
+
+#endif /* E4F0C2B7_1A9D_4E36_8C5B_92D7F31A6E08 */
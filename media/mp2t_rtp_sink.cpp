@@ -0,0 +1,105 @@
+#include "mp2t_rtp_sink.h"
+#include "eventloop/endian.h"
+#include "media_log.h"
+
+#include <cassert>
+#include <cstring>
+#include <random>
+
+namespace muduo_media {
+
+Mp2tRtpSink::Mp2tRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
+                         int8_t rtp_channel)
+    : Mp2tRtpSink(RtpTransProto::kRtpOverTcp, rtp_channel) {
+    tcp_conn_ = tcp_conn;
+}
+
+Mp2tRtpSink::Mp2tRtpSink(const muduo::net::UdpVirtualConnectionPtr &udp_conn)
+    : Mp2tRtpSink(RtpTransProto::kRtpOverUdp, -1) {
+    udp_conn_ = udp_conn;
+}
+
+Mp2tRtpSink::Mp2tRtpSink(RtpTransProto transport, int8_t rtp_channel)
+    : transport_(transport),
+      tcp_conn_(nullptr),
+      rtp_channel_(rtp_channel),
+      udp_conn_(nullptr) {
+
+    std::random_device rd;
+    init_seq_ = rd() & 0xFF; // limited
+    LOG_DEBUG << "Mp2tRtpSink::ctor at " << this;
+}
+
+Mp2tRtpSink::~Mp2tRtpSink() { LOG_DEBUG << "Mp2tRtpSink::dtor at " << this; }
+
+void Mp2tRtpSink::Output(const uint8_t *data, size_t len) {
+    if (tcp_conn_) {
+        tcp_conn_->Send(data, len);
+    } else if (udp_conn_) {
+        udp_conn_->Send(data, len);
+    }
+}
+
+size_t Mp2tRtpSink::QueuedBytes() const {
+    return tcp_conn_ ? tcp_conn_->output_buffer()->ReadableBytes() : 0;
+}
+
+void Mp2tRtpSink::Send(const unsigned char *data, int len,
+                       const std::shared_ptr<void> &info) {
+    // 拷贝到带前置空间的缓冲，与AVPacket走同一条路径
+    AVPacket pkt;
+    pkt.prepend_size = defs::kBufPrependSize;
+    pkt.size = len;
+    pkt.buffer.reset(new uint8_t[pkt.prepend_size + len]);
+    memcpy(pkt.buffer.get() + pkt.prepend_size, data, len);
+
+    SendPacket(pkt, (RtpHeader *)info.get());
+}
+
+void Mp2tRtpSink::Send(const AVPacket &pkt, const AVPacketInfo &info) {
+    // 连接已断开，不再打包
+    if (tcp_conn_ && !tcp_conn_->Connected()) {
+        ++dropped_frames_;
+        return;
+    }
+    if (pkt.size == 0) {
+        return;
+    }
+
+    RtpHeader header;
+    ::bzero(&header, sizeof(header));
+    header.version = RTP_VESION;
+    header.payloadType = info.payload_type;
+    header.timestamp = muduo::HostToNetwork32(info.timestamp);
+    header.ssrc = muduo::HostToNetwork32(info.ssrc);
+
+    SendPacket(pkt, &header);
+}
+
+void Mp2tRtpSink::SendPacket(const AVPacket &pkt, RtpHeader *header) {
+    size_t prefix = transport_ == RtpTransProto::kRtpOverTcp
+                        ? INTERLEAVED_FRAME_SIZE
+                        : 0;
+    assert(pkt.prepend_size >= prefix + RTP_HEADER_SIZE);
+
+    uint8_t *pdata_start =
+        pkt.buffer.get() + (pkt.prepend_size - prefix - RTP_HEADER_SIZE);
+    uint32_t rtp_len = RTP_HEADER_SIZE + pkt.size;
+    if (prefix) {
+        pdata_start[0] = '$';
+        pdata_start[1] = (uint8_t)rtp_channel_;
+        pdata_start[2] = (uint8_t)((rtp_len & 0xFF00) >> 8);
+        pdata_start[3] = (uint8_t)(rtp_len & 0xFF);
+    }
+
+    LOG_TRACE << "send seq " << init_seq_;
+    header->seq = muduo::HostToNetwork16(init_seq_++); // 随机初值，自动增长
+    memcpy(pdata_start + prefix, header, RTP_HEADER_SIZE);
+
+    Output(pdata_start, prefix + rtp_len);
+
+    ++packets_;
+    octets_ += prefix + rtp_len;
+}
+
+} // namespace muduo_media
@@ -0,0 +1,56 @@
+#ifndef D573D4AC_6AD6_4C6E_AF51_80E1F84FD022
+#define D573D4AC_6AD6_4C6E_AF51_80E1F84FD022
+
+#include "defs.h"
+#include "multi_frame_rtp_sink.h"
+#include "net/tcp_connection.h"
+#include "net/udp_virtual_connection.h"
+#include "rtp.h"
+
+namespace muduo_media {
+
+/// @brief RFC 2250 MP2T打包
+///
+/// 载荷就是若干个完整的TS包，没有额外的载荷头。RTP头直接写在AVPacket
+/// 的前置空间中，不再拷贝载荷。
+class Mp2tRtpSink : public MultiFrameRtpSink {
+public:
+    Mp2tRtpSink(const muduo::net::TcpConnectionPtr &tcp_conn,
+                int8_t rtp_channel);
+
+    Mp2tRtpSink(const muduo::net::UdpVirtualConnectionPtr &udp_conn);
+
+    virtual ~Mp2tRtpSink();
+
+    // data为完整的RTP载荷，info为RtpHeader
+    void Send(const unsigned char *data, int len,
+              const std::shared_ptr<void> &info) override;
+
+    void Send(const AVPacket &pkt, const AVPacketInfo &info) override;
+
+    size_t QueuedBytes() const override;
+    bool HasOutputQueue() const override { return tcp_conn_ != nullptr; }
+
+protected:
+    // 不绑定连接，子类通过Output接管打包后的数据
+    Mp2tRtpSink(RtpTransProto transport, int8_t rtp_channel);
+
+    virtual void Output(const uint8_t *data, size_t len);
+
+private:
+    // RTP头写在pkt的前置空间，按传输方式加上interleaved头
+    void SendPacket(const AVPacket &pkt, RtpHeader *header);
+
+private:
+    RtpTransProto transport_;
+    muduo::net::TcpConnectionPtr tcp_conn_;
+    int8_t rtp_channel_;
+
+    muduo::net::UdpVirtualConnectionPtr udp_conn_;
+
+    uint16_t init_seq_;
+};
+
+} // namespace muduo_media
+
+#endif /* D573D4AC_6AD6_4C6E_AF51_80E1F84FD022 */
@@ -0,0 +1,452 @@
+#include "mp4_file.h"
+#include "media_log.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+namespace {
+
+constexpr uint32_t FourCC(const char *s) {
+    return ((uint32_t)(uint8_t)s[0] << 24) | ((uint32_t)(uint8_t)s[1] << 16) |
+           ((uint32_t)(uint8_t)s[2] << 8) | (uint32_t)(uint8_t)s[3];
+}
+
+uint16_t ReadU16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+uint32_t ReadU32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+uint64_t ReadU64(const uint8_t *p) {
+    return ((uint64_t)ReadU32(p) << 32) | ReadU32(p + 4);
+}
+
+// payload不含box头
+struct Box {
+    uint32_t type = 0;
+    const uint8_t *payload = nullptr;
+    size_t size = 0;
+};
+
+// 读取*pos处的box并前进，越界时返回false
+bool NextBox(const uint8_t **pos, const uint8_t *end, Box *box) {
+    const uint8_t *p = *pos;
+    if (end - p < 8) {
+        return false;
+    }
+
+    uint64_t box_size = ReadU32(p);
+    size_t header = 8;
+    box->type = ReadU32(p + 4);
+    if (box_size == 1) { // largesize
+        if (end - p < 16) {
+            return false;
+        }
+        box_size = ReadU64(p + 8);
+        header = 16;
+    } else if (box_size == 0) { // 到文件结尾
+        box_size = end - p;
+    }
+    if (box_size < header || box_size > (uint64_t)(end - p)) {
+        return false;
+    }
+
+    box->payload = p + header;
+    box->size = box_size - header;
+    *pos = p + box_size;
+    return true;
+}
+
+// 容器中第一个type类型的子box
+bool FindBox(const uint8_t *data, size_t size, uint32_t type, Box *box) {
+    const uint8_t *pos = data;
+    const uint8_t *end = data + size;
+    while (NextBox(&pos, end, box)) {
+        if (box->type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// full box: version(1) + flags(3) + entry_count(4)，之后每项entry_size字节
+bool TableEntries(const Box &box, size_t entry_size, uint32_t *count) {
+    if (box.size < 8) {
+        return false;
+    }
+    *count = ReadU32(box.payload + 4);
+    return (box.size - 8) / entry_size >= *count;
+}
+
+// VisualSampleEntry在子box之前的固定字段
+constexpr size_t kVisualSampleEntrySize = 78;
+
+} // namespace
+
+struct Mp4File::SampleTables {
+    Box stsz;
+    Box stsc;
+    Box stco;
+    bool co64 = false;
+    Box stts;
+    Box ctts;
+    bool has_ctts = false;
+    Box stss;
+    bool has_stss = false;
+};
+
+Mp4File::Mp4File()
+    : mapping_(nullptr),
+      mapping_size_(0),
+      all_keyframes_(false),
+      timescale_(0),
+      duration_(0),
+      sample_delta_(0),
+      nal_length_size_(4) {}
+
+Mp4File::~Mp4File() {
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+    }
+}
+
+std::shared_ptr<Mp4File> Mp4File::Open(const std::string &filename) {
+    int fd = ::open(filename.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR << "open " << filename << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < 8) {
+        ::close(fd);
+        LOG_WARN << filename << " too short";
+        return nullptr;
+    }
+
+    size_t length = st.st_size;
+    void *addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOG_ERROR << "mmap " << filename << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    // 之后由file负责munmap
+    std::shared_ptr<Mp4File> file(new Mp4File);
+    file->filename_ = filename;
+    file->mapping_ = addr;
+    file->mapping_size_ = length;
+
+    if (!file->Parse()) {
+        return nullptr;
+    }
+    return file;
+}
+
+bool Mp4File::Parse() {
+    Box moov;
+    if (!FindBox(data(), size(), FourCC("moov"), &moov)) {
+        LOG_WARN << filename_ << " no moov";
+        return false;
+    }
+
+    Box mvex;
+    if (FindBox(moov.payload, moov.size, FourCC("mvex"), &mvex)) {
+        LOG_WARN << filename_ << " fragmented MP4, samples in moof ignored";
+    }
+
+    const uint8_t *pos = moov.payload;
+    const uint8_t *end = moov.payload + moov.size;
+    Box trak;
+    while (NextBox(&pos, end, &trak)) {
+        if (trak.type == FourCC("trak") &&
+            ParseTrack(trak.payload, trak.size)) {
+            return true;
+        }
+    }
+
+    LOG_WARN << filename_ << " no H.264 video track";
+    return false;
+}
+
+bool Mp4File::ParseTrack(const uint8_t *trak, size_t size) {
+    Box mdia, hdlr, mdhd, minf, stbl;
+    if (!FindBox(trak, size, FourCC("mdia"), &mdia) ||
+        !FindBox(mdia.payload, mdia.size, FourCC("hdlr"), &hdlr) ||
+        !FindBox(mdia.payload, mdia.size, FourCC("mdhd"), &mdhd) ||
+        !FindBox(mdia.payload, mdia.size, FourCC("minf"), &minf) ||
+        !FindBox(minf.payload, minf.size, FourCC("stbl"), &stbl)) {
+        return false;
+    }
+
+    // hdlr: version/flags(4) + pre_defined(4) + handler_type(4)
+    if (hdlr.size < 12 || ReadU32(hdlr.payload + 8) != FourCC("vide")) {
+        return false;
+    }
+
+    // mdhd: version 1时创建/修改时间为64位
+    if (mdhd.size < 1) {
+        return false;
+    }
+    size_t timescale_pos = mdhd.payload[0] == 1 ? 20 : 12;
+    if (mdhd.size < timescale_pos + 4) {
+        return false;
+    }
+    timescale_ = ReadU32(mdhd.payload + timescale_pos);
+    if (0 == timescale_) {
+        return false;
+    }
+
+    Box stsd;
+    if (!FindBox(stbl.payload, stbl.size, FourCC("stsd"), &stsd) ||
+        !ParseAvcC(stsd.payload, stsd.size)) {
+        return false;
+    }
+
+    SampleTables tables;
+    if (!FindBox(stbl.payload, stbl.size, FourCC("stsz"), &tables.stsz) ||
+        !FindBox(stbl.payload, stbl.size, FourCC("stsc"), &tables.stsc) ||
+        !FindBox(stbl.payload, stbl.size, FourCC("stts"), &tables.stts)) {
+        LOG_WARN << filename_ << " incomplete sample table";
+        return false;
+    }
+    if (!FindBox(stbl.payload, stbl.size, FourCC("stco"), &tables.stco)) {
+        if (!FindBox(stbl.payload, stbl.size, FourCC("co64"), &tables.stco)) {
+            LOG_WARN << filename_ << " no chunk offsets";
+            return false;
+        }
+        tables.co64 = true;
+    }
+    tables.has_ctts =
+        FindBox(stbl.payload, stbl.size, FourCC("ctts"), &tables.ctts);
+    tables.has_stss =
+        FindBox(stbl.payload, stbl.size, FourCC("stss"), &tables.stss);
+
+    return BuildSamples(tables);
+}
+
+bool Mp4File::ParseAvcC(const uint8_t *stsd, size_t size) {
+    if (size < 8) {
+        return false;
+    }
+
+    // 只取第一个样本描述
+    Box entry, avcc;
+    const uint8_t *pos = stsd + 8;
+    if (!NextBox(&pos, stsd + size, &entry) ||
+        (entry.type != FourCC("avc1") && entry.type != FourCC("avc3")) ||
+        entry.size < kVisualSampleEntrySize ||
+        !FindBox(entry.payload + kVisualSampleEntrySize,
+                 entry.size - kVisualSampleEntrySize, FourCC("avcC"), &avcc) ||
+        avcc.size < 7) {
+        return false;
+    }
+
+    // configurationVersion, profile, compatibility, level,
+    // lengthSizeMinusOne, numOfSequenceParameterSets
+    const uint8_t *p = avcc.payload;
+    const uint8_t *end = avcc.payload + avcc.size;
+    nal_length_size_ = (p[4] & 0x03) + 1;
+    if (nal_length_size_ == 3) {
+        LOG_WARN << filename_ << " invalid NALU length size";
+        return false;
+    }
+
+    // avc3的参数集可能只在码流中
+    std::string *sets[2] = {&parameter_sets_.sps, &parameter_sets_.pps};
+    int count = p[5] & 0x1F;
+    p += 6;
+    for (int kind = 0; kind < 2; ++kind) {
+        for (int i = 0; i < count; ++i) {
+            if (end - p < 2 || end - p - 2 < ReadU16(p)) {
+                return false;
+            }
+            uint16_t len = ReadU16(p);
+            if (sets[kind]->empty()) {
+                sets[kind]->assign((const char *)p + 2, len);
+            }
+            p += 2 + len;
+        }
+        if (kind == 0) {
+            if (p == end) {
+                break;
+            }
+            count = *p++;
+        }
+    }
+    return true;
+}
+
+bool Mp4File::BuildSamples(const SampleTables &tables) {
+    // stsz: version/flags, sample_size, sample_count, [entry_size...]
+    if (tables.stsz.size < 12) {
+        return false;
+    }
+    const uint8_t *stsz = tables.stsz.payload;
+    uint32_t sample_size = ReadU32(stsz + 4);
+    uint32_t count = ReadU32(stsz + 8);
+    if (0 == sample_size && (tables.stsz.size - 12) / 4 < count) {
+        return false;
+    }
+
+    uint32_t chunk_count = 0;
+    uint32_t stsc_count = 0;
+    if (!TableEntries(tables.stco, tables.co64 ? 8 : 4, &chunk_count) ||
+        !TableEntries(tables.stsc, 12, &stsc_count) || 0 == stsc_count) {
+        return false;
+    }
+    const uint8_t *chunks = tables.stco.payload + 8;
+    const uint8_t *stsc = tables.stsc.payload + 8;
+
+    // count来自文件，分配前先用文件大小和chunk能容纳的样本数约束
+    if (count > mapping_size_ / std::max<uint32_t>(sample_size, 1)) {
+        LOG_WARN << filename_ << " sample count " << count
+                 << " exceeds file size";
+        return false;
+    }
+    uint64_t covered = 0;
+    uint32_t run = 0;
+    for (uint32_t chunk = 0; chunk < chunk_count && covered < count;
+         ++chunk) {
+        while (run + 1 < stsc_count &&
+               ReadU32(stsc + (run + 1) * 12) <= chunk + 1) {
+            ++run;
+        }
+        covered += ReadU32(stsc + run * 12 + 4);
+    }
+    if (covered < count) {
+        LOG_WARN << filename_ << " chunks cover " << covered << " of "
+                 << count << " samples";
+        count = (uint32_t)covered;
+    }
+
+    // 按chunk展开样本位置，stsc的first_chunk从1开始
+    samples_.resize(count);
+    size_t index = 0;
+    run = 0;
+    for (uint32_t chunk = 0; chunk < chunk_count && index < count; ++chunk) {
+        while (run + 1 < stsc_count &&
+               ReadU32(stsc + (run + 1) * 12) <= chunk + 1) {
+            ++run;
+        }
+        uint32_t per_chunk = ReadU32(stsc + run * 12 + 4);
+        uint64_t offset = tables.co64 ? ReadU64(chunks + chunk * 8)
+                                      : ReadU32(chunks + chunk * 4);
+
+        for (uint32_t i = 0; i < per_chunk && index < count; ++i, ++index) {
+            uint32_t size =
+                sample_size ? sample_size : ReadU32(stsz + 12 + index * 4);
+            if (offset > mapping_size_ || mapping_size_ - offset < size) {
+                LOG_WARN << filename_ << " sample " << index
+                         << " beyond end of file";
+                samples_.resize(index);
+                count = index;
+                break;
+            }
+            Mp4Sample &sample = samples_[index];
+            sample.offset = offset;
+            sample.size = size;
+            sample.dts = 0;
+            sample.composition_offset = 0;
+            offset += size;
+        }
+    }
+    if (samples_.empty()) {
+        return false;
+    }
+
+    // stts: (sample_count, sample_delta)，名义帧间隔取覆盖样本最多的一项
+    uint32_t stts_count = 0;
+    if (!TableEntries(tables.stts, 8, &stts_count)) {
+        return false;
+    }
+    const uint8_t *stts = tables.stts.payload + 8;
+    int64_t dts = 0;
+    uint32_t delta = 0;
+    uint32_t most = 0;
+    index = 0;
+    for (uint32_t e = 0; e < stts_count; ++e) {
+        uint32_t run_count = ReadU32(stts + e * 8);
+        delta = ReadU32(stts + e * 8 + 4);
+        if (run_count > most) {
+            most = run_count;
+            sample_delta_ = delta;
+        }
+        for (uint32_t i = 0; i < run_count && index < samples_.size(); ++i) {
+            samples_[index++].dts = dts;
+            dts += delta;
+        }
+    }
+    for (; index < samples_.size(); ++index) {
+        samples_[index].dts = dts;
+        dts += delta;
+    }
+    duration_ = dts;
+
+    // ctts: (sample_count, sample_offset)，version 1时为有符号数
+    uint32_t ctts_count = 0;
+    if (tables.has_ctts && TableEntries(tables.ctts, 8, &ctts_count)) {
+        const uint8_t *ctts = tables.ctts.payload + 8;
+        index = 0;
+        for (uint32_t e = 0; e < ctts_count && index < samples_.size(); ++e) {
+            uint32_t run_count = ReadU32(ctts + e * 8);
+            int32_t offset = (int32_t)ReadU32(ctts + e * 8 + 4);
+            for (uint32_t i = 0; i < run_count && index < samples_.size();
+                 ++i) {
+                samples_[index++].composition_offset = offset;
+            }
+        }
+    }
+
+    // stss: 样本序号从1开始
+    uint32_t stss_count = 0;
+    all_keyframes_ = !tables.has_stss;
+    if (tables.has_stss && TableEntries(tables.stss, 4, &stss_count)) {
+        const uint8_t *stss = tables.stss.payload + 8;
+        for (uint32_t e = 0; e < stss_count; ++e) {
+            uint32_t number = ReadU32(stss + e * 4);
+            if (number == 0 || number > samples_.size() ||
+                (!keyframes_.empty() && number - 1 <= keyframes_.back())) {
+                continue;
+            }
+            keyframes_.push_back(number - 1);
+        }
+    }
+
+    LOG_INFO << filename_ << " samples " << samples_.size() << ", keyframes "
+             << (all_keyframes_ ? samples_.size() : keyframes_.size())
+             << ", timescale " << timescale_ << ", delta " << sample_delta_;
+    return sample_delta_ > 0;
+}
+
+bool Mp4File::IsKeyFrame(size_t index) const {
+    return all_keyframes_ ||
+           std::binary_search(keyframes_.begin(), keyframes_.end(),
+                              (uint32_t)index);
+}
+
+size_t Mp4File::FindKeyFrame(int64_t dts) const {
+    auto sample = std::upper_bound(
+        samples_.begin(), samples_.end(), dts,
+        [](int64_t value, const Mp4Sample &s) { return value < s.dts; });
+    size_t index =
+        sample == samples_.begin() ? 0 : sample - samples_.begin() - 1;
+    if (all_keyframes_) {
+        return index;
+    }
+
+    auto key =
+        std::upper_bound(keyframes_.begin(), keyframes_.end(), (uint32_t)index);
+    return key == keyframes_.begin() ? 0 : *(key - 1);
+}
+
+} // namespace muduo_media
@@ -0,0 +1,94 @@
+#ifndef B13351C5_38D5_4B37_8EA2_831E6FB7BABB
+#define B13351C5_38D5_4B37_8EA2_831E6FB7BABB
+
+#include "h264_parameter_sets.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace muduo_media {
+
+struct Mp4Sample {
+    uint64_t offset;            // 在文件中的位置
+    int64_t dts;                // 解码时间，timescale单位
+    uint32_t size;
+    int32_t composition_offset; // ctts，展示时间 - 解码时间
+};
+
+/**
+ * @brief mmap的MP4(ISO BMFF)文件，moov中第一路H.264视频轨道的样本表
+ *
+ * 打开时解析一次stsz/stsc/stco(co64)/stts/ctts/stss/avcC，展开成按解码
+ * 顺序排列的样本数组，之后按下标直接取得样本在文件中的位置，不需要扫描
+ * 起始码。样本数据为avcC规定长度前缀的NALU序列。
+ *
+ * 只读，可以被多个源共享。不支持分片MP4(moof)和编辑列表(elst)。
+ */
+class Mp4File {
+public:
+    ~Mp4File();
+
+    /// 失败返回nullptr
+    static std::shared_ptr<Mp4File> Open(const std::string &filename);
+
+    const uint8_t *data() const { return (const uint8_t *)mapping_; }
+    size_t size() const { return mapping_size_; }
+
+    const Mp4Sample *samples() const { return samples_.data(); }
+    size_t sample_count() const { return samples_.size(); }
+
+    uint32_t timescale() const { return timescale_; }
+    /// 所有样本时长之和，timescale单位
+    int64_t duration() const { return duration_; }
+    /// stts中最常见的样本时长，即名义帧间隔
+    uint32_t sample_delta() const { return sample_delta_; }
+
+    /// NALU长度前缀的字节数(1, 2或4)
+    int nal_length_size() const { return nal_length_size_; }
+
+    /// avcC中的第一组SPS/PPS
+    const H264ParameterSets &parameter_sets() const { return parameter_sets_; }
+
+    /// 关键帧的样本下标，升序
+    const std::vector<uint32_t> &keyframes() const { return keyframes_; }
+
+    bool IsKeyFrame(size_t index) const;
+
+    /// dts不超过dts的最近关键帧的样本下标，二分查找
+    size_t FindKeyFrame(int64_t dts) const;
+
+private:
+    Mp4File();
+
+    bool Parse();
+    bool ParseTrack(const uint8_t *trak, size_t size);
+    bool ParseAvcC(const uint8_t *stsd, size_t size);
+
+    struct SampleTables;
+    bool BuildSamples(const SampleTables &tables);
+
+private:
+    std::string filename_;
+    void *mapping_;
+    size_t mapping_size_;
+
+    std::vector<Mp4Sample> samples_;
+    std::vector<uint32_t> keyframes_;
+    bool all_keyframes_; // 没有stss时每个样本都是关键帧
+
+    uint32_t timescale_;
+    int64_t duration_;
+    uint32_t sample_delta_;
+
+    int nal_length_size_;
+    H264ParameterSets parameter_sets_;
+};
+
+using Mp4FilePtr = std::shared_ptr<const Mp4File>;
+
+} // namespace muduo_media
+
+#endif /* B13351C5_38D5_4B37_8EA2_831E6FB7BABB */
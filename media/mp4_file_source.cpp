@@ -0,0 +1,109 @@
+#include "mp4_file_source.h"
+#include "defs.h"
+#include "media_log.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+Mp4FileSource::Mp4FileSource(const Mp4FilePtr &file, unsigned int time_base)
+    : file_(file),
+      time_base_(time_base),
+      sample_(0),
+      nal_pos_(0),
+      parameter_set_(0) {}
+
+Mp4FileSource::~Mp4FileSource() {}
+
+void Mp4FileSource::FillPacket(AVPacket *packet, const uint8_t *nalu,
+                               size_t size) {
+    // sink在前置空间中写RTP头，不能直接指向只读映射
+    std::shared_ptr<uint8_t[]> buffer(
+        new uint8_t[defs::kBufPrependSize + size]);
+    memcpy(buffer.get() + defs::kBufPrependSize, nalu, size);
+
+    packet->buffer = buffer;
+    packet->prepend_size = defs::kBufPrependSize;
+    packet->size = size;
+    packet->type = nalu[0] & 0x1F;
+    packet->frame_span = 0;
+    packet->composition_offset = 0;
+}
+
+void Mp4FileSource::NextSample() {
+    ++sample_;
+    nal_pos_ = 0;
+    parameter_set_ = 0;
+}
+
+bool Mp4FileSource::GetNextFrame(AVPacket *packet) {
+    if (!file_) {
+        return false;
+    }
+
+    const H264ParameterSets &sets = file_->parameter_sets();
+    const std::string *parameter_sets[2] = {&sets.sps, &sets.pps};
+    size_t length_size = file_->nal_length_size();
+
+    while (sample_ < file_->sample_count()) {
+        const Mp4Sample &sample = file_->samples()[sample_];
+
+        if (0 == nal_pos_ && parameter_set_ < 2 &&
+            file_->IsKeyFrame(sample_)) {
+            const std::string *ps = parameter_sets[parameter_set_++];
+            if (!ps->empty()) {
+                FillPacket(packet, (const uint8_t *)ps->data(), ps->size());
+                return true;
+            }
+            continue;
+        }
+
+        const uint8_t *data = file_->data() + sample.offset;
+        if (sample.size < nal_pos_ + length_size) {
+            NextSample();
+            continue;
+        }
+
+        uint32_t nal_size = 0;
+        for (size_t i = 0; i < length_size; ++i) {
+            nal_size = (nal_size << 8) | data[nal_pos_ + i];
+        }
+        size_t pos = nal_pos_ + length_size;
+        if (0 == nal_size || sample.size - pos < nal_size) {
+            LOG_WARN << "bad NALU length " << nal_size << " in sample "
+                     << sample_;
+            NextSample();
+            continue;
+        }
+        nal_pos_ = pos + nal_size;
+
+        FillPacket(packet, data + pos, nal_size);
+        packet->composition_offset =
+            (int32_t)((int64_t)sample.composition_offset * time_base_ /
+                      file_->timescale());
+
+        // 样本中剩余的字节放不下下一个NALU，这是最后一个
+        if (sample.size < nal_pos_ + length_size) {
+            packet->frame_span = 1;
+            NextSample();
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool Mp4FileSource::Seek(double npt, double *start_npt) {
+    if (!file_ || npt < 0) {
+        return false;
+    }
+
+    size_t key = file_->FindKeyFrame((int64_t)(npt * file_->timescale()));
+    sample_ = key;
+    nal_pos_ = 0;
+    parameter_set_ = 0;
+    *start_npt = (double)file_->samples()[key].dts / file_->timescale();
+    return true;
+}
+
+} // namespace muduo_media
@@ -0,0 +1,40 @@
+#ifndef F66CAC8C_F7A0_4144_BD73_940811020B71
+#define F66CAC8C_F7A0_4144_BD73_940811020B71
+
+#include "av_packet.h"
+#include "mp4_file.h"
+#include "multi_frame_source.h"
+
+namespace muduo_media {
+
+/// @brief 按样本表读取MP4中的H.264，每次取出一个NALU
+///
+/// 样本的最后一个NALU占一帧，其余NALU与它同时发送。关键帧之前先发送
+/// avcC中的SPS/PPS，客户端从任意关键帧开始都能解码。
+class Mp4FileSource : public MultiFrameSource {
+public:
+    /// time_base为RTP时间戳的频率，ctts按它换算
+    Mp4FileSource(const Mp4FilePtr &file, unsigned int time_base);
+    ~Mp4FileSource();
+
+    bool GetNextFrame(AVPacket *) override;
+
+    bool Seek(double npt, double *start_npt) override;
+
+private:
+    void FillPacket(AVPacket *packet, const uint8_t *nalu, size_t size);
+
+    void NextSample();
+
+private:
+    Mp4FilePtr file_;
+    unsigned int time_base_;
+
+    size_t sample_;          // 当前样本下标
+    size_t nal_pos_;         // 当前样本中下一个长度前缀的位置
+    int parameter_set_;      // 关键帧之前已发送的参数集个数
+};
+
+} // namespace muduo_media
+
+#endif /* F66CAC8C_F7A0_4144_BD73_940811020B71 */
@@ -0,0 +1,109 @@
+#include "mp4_file_subsession.h"
+#include "defs.h"
+#include "h264_video_rtp_sink.h"
+#include "media_log.h"
+#include "metrics.h"
+#include "mp4_file_source.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace muduo_media {
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+Mp4FileSubsession::Mp4FileSubsession(const std::string &filename,
+                                     unsigned int fps, unsigned int time_base)
+    : FileMediaSubsession(filename, fps, time_base) {
+    set_payload_type(defs::kMediaFormatH264);
+}
+
+Mp4FileSubsession::~Mp4FileSubsession() {}
+
+void Mp4FileSubsession::OpenFile() {
+    int64_t start_us = NowMicros();
+    file_ = Mp4File::Open(filename_);
+    int64_t cost_us = NowMicros() - start_us;
+
+    LoopMetrics::Local()->latency.index_load.Record(cost_us);
+    if (!file_) {
+        return;
+    }
+    LOG_INFO << filename_ << " moov parsed " << cost_us << "us";
+
+    if (!file_->parameter_sets().complete()) {
+        LOG_WARN << filename_ << " no SPS/PPS in avcC";
+    }
+
+    // 名义帧间隔换算到RTP时间戳，如timescale 30000、delta 1001时为3003
+    uint64_t duration =
+        (uint64_t)file_->sample_delta() * time_base_ / file_->timescale();
+    if (duration > 0) {
+        fps_ = (unsigned int)((double)time_base_ / duration + 0.5);
+        set_frame_duration((unsigned int)duration);
+    }
+}
+
+void Mp4FileSubsession::EnsureFile() {
+    std::call_once(file_once_, [this]() { OpenFile(); });
+}
+
+double Mp4FileSubsession::PlayLength() {
+    EnsureFile();
+    return file_ ? (double)file_->duration() / file_->timescale() : 0;
+}
+
+size_t Mp4FileSubsession::MemoryBytes() {
+    // 只计样本表，媒体数据的映射属于页缓存
+    if (!file_) {
+        return 0;
+    }
+    return file_->sample_count() * sizeof(Mp4Sample) +
+           file_->keyframes().size() * sizeof(uint32_t);
+}
+
+std::string Mp4FileSubsession::GetSdp() {
+    EnsureFile();
+
+    char media_sdp[200] = {0};
+    snprintf(media_sdp, sizeof(media_sdp),
+             "m=video 0 %s %hu\r\n"
+             "a=rtpmap:%hu %s/%u\r\n"
+             "a=framerate:%u\r\n"
+             "a=control:%s\r\n",
+             defs::kSdpMediaProtocol, payload_type_, payload_type_,
+             defs::kMimeTypeH264, time_base_, fps_, TrackId().data());
+
+    std::string sdp(media_sdp);
+    if (file_) {
+        sdp.append("a=fmtp:")
+            .append(std::to_string(payload_type_))
+            .append(" ")
+            .append(file_->parameter_sets().FmtpParameters())
+            .append("\r\n");
+    }
+    return sdp;
+}
+
+RtpSinkPtr Mp4FileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+    int8_t rtp_channel) {
+    return std::make_shared<H264VideoRtpSink>(tcp_conn, rtp_channel);
+}
+
+RtpSinkPtr Mp4FileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn) {
+    return std::make_shared<H264VideoRtpSink>(udp_conn);
+}
+
+MultiFrameSourcePtr Mp4FileSubsession::NewMultiFrameSouce() {
+    // 没有DESCRIBE直接SETUP时，在开始播放前确定帧率
+    EnsureFile();
+    return std::make_shared<Mp4FileSource>(file_, time_base_);
+}
+
+} // namespace muduo_media
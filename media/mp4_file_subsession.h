@@ -0,0 +1,47 @@
+#ifndef E2168948_7C18_4BA6_ABC3_3E05B02F37A6
+#define E2168948_7C18_4BA6_ABC3_3E05B02F37A6
+
+#include "file_media_subsession.h"
+#include "mp4_file.h"
+
+#include <mutex>
+
+namespace muduo_media {
+
+/// @brief MP4文件中的H.264视频轨道，不需要预先转成Annex B
+class Mp4FileSubsession : public FileMediaSubsession {
+
+public:
+    Mp4FileSubsession(const std::string &filename, unsigned int fps = 25,
+                      unsigned int time_base = 90000);
+    ~Mp4FileSubsession();
+
+    std::string GetSdp() override;
+
+    double PlayLength() override;
+
+    size_t MemoryBytes() override;
+
+    RtpSinkPtr
+    NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+               int8_t rtp_channel) override;
+
+    RtpSinkPtr NewRtpSink(
+        const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn)
+        override;
+
+    MultiFrameSourcePtr NewMultiFrameSouce() override;
+
+private:
+    // 首次使用时mmap并解析moov，按stts设置帧率，之后各源共享
+    void OpenFile();
+    void EnsureFile();
+
+private:
+    std::once_flag file_once_;
+    Mp4FilePtr file_;
+};
+
+} // namespace muduo_media
+
+#endif /* E2168948_7C18_4BA6_ABC3_3E05B02F37A6 */
@@ -3,12 +3,21 @@
 
 #include "media_source.h"
 
+#include <functional>
 #include <memory>
 
+namespace muduo {
+namespace event_loop {
+class EventLoop;
+} // namespace event_loop
+} // namespace muduo
+
 namespace muduo_media {
 
 class AVPacket;
 
+using FramePushCallback = std::function<void(const AVPacket &)>;
+
 class MultiFrameSource : public MediaSource {
 public:
     MultiFrameSource();
@@ -16,6 +25,41 @@ public:
 
     virtual bool GetNextFrame(AVPacket *) = 0;
 
+    /// 实时源在有新数据时令该fd可读，由发送方注册到loop上，不再按帧率定时
+    /// 拉取。-1表示按帧率拉取的普通源
+    virtual int wakeup_fd() const { return -1; }
+
+    /// GetNextFrame取空后调用。返回false表示期间已有新数据，应继续读取
+    virtual bool ArmWakeup() { return true; }
+
+    /// wakeup_fd可读后调用，清除通知
+    virtual void ClearWakeup() {}
+
+    /// 定位到npt(秒)之前最近的关键帧，start_npt返回实际位置。
+    /// 不支持定位时返回false
+    virtual bool Seek(double npt, double *start_npt) { return false; }
+
+    /// 直播时移: 从当前直播位置之前-offset秒(offset <= 0)最近的关键帧开始，
+    /// start_offset返回实际位置(同样为负数)，offset为0时回到直播位置。
+    /// 不支持时返回false
+    virtual bool TimeShift(double offset, double *start_offset) {
+        return false;
+    }
+
+    /// 设置播放速率(RTSP Scale)，负数为倒放。改变速率后GetNextFrame通过
+    /// AVPacket::frame_span说明每帧跨过的原始帧数。不支持时返回false
+    virtual bool SetScale(double scale) { return scale == 1.0; }
+
+    /// 由上游推送帧的源，有帧时在loop上回调cb，不再调用GetNextFrame。
+    /// 返回false表示不是推送源
+    virtual bool StartPush(muduo::event_loop::EventLoop *loop,
+                           const FramePushCallback &cb) {
+        return false;
+    }
+
+    /// 停止后不会再回调
+    virtual void StopPush() {}
+
     uint32_t ssrc() const { return ssrc_; }
     void set_ssrc(uint32_t ssrc) { ssrc_ = ssrc; }
 
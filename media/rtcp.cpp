@@ -1,7 +1,7 @@
 #include "rtcp.h"
 
 #include "eventloop/endian.h"
-#include "logger/logger.h"
+#include "media_log.h"
 
 #include <cstring>
 
@@ -136,4 +136,186 @@ std::string RtcpAPPMessage::Serialize() { return std::string(); }
 
 bool RtcpAPPMessage::Deserialize(const char *buf, size_t size) { return true; }
 
+/*============================ view ===================================*/
+static inline uint16_t ReadBE16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ReadBE32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// report block中24位有符号的累计丢包数。先按无符号左移，避免有符号溢出
+static constexpr int32_t SignExtend24(uint32_t value) {
+    return (int32_t)((value & 0xFFFFFF) << 8) >> 8;
+}
+
+static_assert(SignExtend24(0) == 0, "cumulative lost 0");
+static_assert(SignExtend24(5) == 5, "cumulative lost 5");
+static_assert(SignExtend24(0x7FFFFF) == 8388607, "largest positive");
+static_assert(SignExtend24(0x800000) == -8388608, "most negative");
+static_assert(SignExtend24(0xFFFFFF) == -1, "duplicates exceed losses");
+
+static constexpr size_t kRtcpHeaderSize = 8;       // 含发送者ssrc
+static constexpr size_t kRtcpSenderInfoSize = 20;  // NTP(8) + RTP ts + 计数
+static constexpr size_t kRtcpReportBlockSize = 24; // 固定24字节
+
+size_t RtcpPacketView::ReportBlockCount() const {
+    size_t offset = kRtcpHeaderSize;
+    if (header.pt == (uint8_t)RtcpPacketType::RTCP_SR) {
+        offset += kRtcpSenderInfoSize;
+    } else if (header.pt != (uint8_t)RtcpPacketType::RTCP_RR) {
+        return 0;
+    }
+
+    if (size < offset) {
+        return 0;
+    }
+
+    size_t fit = (size - offset) / kRtcpReportBlockSize;
+    return header.rc < fit ? header.rc : fit;
+}
+
+bool RtcpPacketView::GetReportBlock(size_t idx, RtcpReportBlock *block) const {
+    if (idx >= ReportBlockCount()) {
+        return false;
+    }
+
+    size_t offset = kRtcpHeaderSize + idx * kRtcpReportBlockSize;
+    if (header.pt == (uint8_t)RtcpPacketType::RTCP_SR) {
+        offset += kRtcpSenderInfoSize;
+    }
+
+    const uint8_t *p = data + offset;
+    block->ssrc = ReadBE32(p);
+    block->fraction = p[4];
+    block->lost_packets = ReadBE32(p + 4) & 0xFFFFFF;
+    block->sequence = ReadBE32(p + 8);
+    block->jitter = ReadBE32(p + 12);
+    block->lsr = ReadBE32(p + 16);
+    block->dlsr = ReadBE32(p + 20);
+    return true;
+}
+
+bool RtcpPacketView::GetSenderInfo(RtcpSenderInfo *info) const {
+    if (header.pt != (uint8_t)RtcpPacketType::RTCP_SR ||
+        size < kRtcpHeaderSize + kRtcpSenderInfoSize) {
+        return false;
+    }
+
+    const uint8_t *p = data + kRtcpHeaderSize;
+    info->ts_msw = ReadBE32(p);
+    info->ts_lsw = ReadBE32(p + 4);
+    info->rtp_ts = ReadBE32(p + 8);
+    info->packets = ReadBE32(p + 12);
+    info->octets = ReadBE32(p + 16);
+    return true;
+}
+
+RtcpCompoundReader::RtcpCompoundReader(const char *buf, size_t size)
+    : pos_((const uint8_t *)buf),
+      end_((const uint8_t *)buf + size),
+      malformed_(false) {}
+
+bool RtcpCompoundReader::Next(RtcpPacketView *view) {
+    // 至少要有V/P/RC、PT、length
+    if (end_ - pos_ < 4) {
+        if (pos_ != end_) {
+            malformed_ = true;
+        }
+        return false;
+    }
+
+    uint8_t first = pos_[0];
+    view->header.v = first >> 6;
+    view->header.p = (first >> 5) & 0x01;
+    view->header.rc = first & 0x1F;
+    view->header.pt = pos_[1];
+    view->header.length = ReadBE16(pos_ + 2);
+
+    size_t packet_size = ((size_t)view->header.length + 1) * RTCP_LENGTH_DWORD;
+    if (view->header.v != RTCP_VERSION ||
+        packet_size > (size_t)(end_ - pos_)) {
+        malformed_ = true;
+        pos_ = end_;
+        return false;
+    }
+
+    view->header.ssrc = packet_size >= kRtcpHeaderSize ? ReadBE32(pos_ + 4) : 0;
+    view->data = pos_;
+    view->size = packet_size;
+
+    pos_ += packet_size;
+    return true;
+}
+
+void RtcpReceiverStats::Accumulate(const char *buf, size_t size) {
+    ++datagrams;
+    octets += size;
+
+    RtcpCompoundReader reader(buf, size);
+    RtcpPacketView view;
+    while (reader.Next(&view)) {
+        switch ((RtcpPacketType)view.header.pt) {
+        case RtcpPacketType::RTCP_SR:
+            ++sr_packets;
+            break;
+        case RtcpPacketType::RTCP_RR:
+            ++rr_packets;
+            break;
+        case RtcpPacketType::RTCP_SDES:
+            ++sdes_packets;
+            break;
+        case RtcpPacketType::RTCP_BYE:
+            ++bye_packets;
+            break;
+        default:
+            ++other_packets;
+            break;
+        }
+
+        size_t count = view.ReportBlockCount();
+        if (count > 0) {
+            report_blocks += count;
+
+            RtcpReportBlock block;
+            view.GetReportBlock(count - 1, &block);
+            report_ssrc = block.ssrc;
+            fraction_lost = block.fraction;
+            cumulative_lost = SignExtend24(block.lost_packets);
+            highest_sequence = block.sequence;
+            jitter = block.jitter;
+            lsr = block.lsr;
+            dlsr = block.dlsr;
+        }
+    }
+
+    if (reader.malformed()) {
+        ++malformed;
+    }
+}
+
+void RtcpReceiverStats::Merge(const RtcpReceiverStats &delta) {
+    datagrams += delta.datagrams;
+    octets += delta.octets;
+    sr_packets += delta.sr_packets;
+    rr_packets += delta.rr_packets;
+    sdes_packets += delta.sdes_packets;
+    bye_packets += delta.bye_packets;
+    other_packets += delta.other_packets;
+    malformed += delta.malformed;
+    report_blocks += delta.report_blocks;
+
+    if (delta.report_blocks > 0) {
+        report_ssrc = delta.report_ssrc;
+        fraction_lost = delta.fraction_lost;
+        cumulative_lost = delta.cumulative_lost;
+        highest_sequence = delta.highest_sequence;
+        jitter = delta.jitter;
+        lsr = delta.lsr;
+        dlsr = delta.dlsr;
+    }
+}
+
 } // namespace muduo_media
\ No newline at end of file
@@ -152,6 +152,56 @@ struct RtcpAPPMessage : public RtcpMessage {
 using RtcpMessagePtr = std::shared_ptr<RtcpMessage>;
 using RtcpMessageVector = std::vector<RtcpMessagePtr>;
 
+/// @brief 复合RTCP包中单个RTCP包的只读视图，直接引用接收缓冲区，不做拷贝
+struct RtcpPacketView {
+    RtcpHeader header;   // 主机字节序
+    const uint8_t *data; // 包起始位置，包含头部
+    size_t size;         // (length + 1) * 4
+
+    size_t ReportBlockCount() const;
+    bool GetReportBlock(size_t idx, RtcpReportBlock *block) const;
+    bool GetSenderInfo(RtcpSenderInfo *info) const;
+};
+
+/// @brief 逐个遍历复合RTCP包，零内存分配
+class RtcpCompoundReader {
+public:
+    RtcpCompoundReader(const char *buf, size_t size);
+
+    bool Next(RtcpPacketView *view);
+    bool malformed() const { return malformed_; }
+
+private:
+    const uint8_t *pos_;
+    const uint8_t *end_;
+    bool malformed_;
+};
+
+/// @brief 接收到的RTCP统计，按批次累加后一次性合并到流状态
+struct RtcpReceiverStats {
+    uint64_t datagrams = 0;
+    uint64_t octets = 0;
+    uint32_t sr_packets = 0;
+    uint32_t rr_packets = 0;
+    uint32_t sdes_packets = 0;
+    uint32_t bye_packets = 0;
+    uint32_t other_packets = 0;
+    uint32_t malformed = 0;
+    uint32_t report_blocks = 0;
+
+    // 最近一个report block
+    uint32_t report_ssrc = 0;
+    uint8_t fraction_lost = 0;
+    int32_t cumulative_lost = 0;
+    uint32_t highest_sequence = 0;
+    uint32_t jitter = 0;
+    uint32_t lsr = 0;
+    uint32_t dlsr = 0;
+
+    void Accumulate(const char *buf, size_t size);
+    void Merge(const RtcpReceiverStats &delta);
+};
+
 } // namespace muduo_media
 
 #endif /* C6A67180_CD35_42B2_8219_E6D2F1932DF6 */
@@ -10,6 +10,8 @@
 
 #define RTP_PAYLOAD_TYPE_H264 96
 #define RTP_PAYLOAD_TYPE_AAC 97
+#define RTP_PAYLOAD_TYPE_H265 98
+#define RTP_PAYLOAD_TYPE_MP2T 33
 
 #define RTP_HEADER_SIZE 12
 #define RTP_MAX_PAYLOAD_SIZE 1400 // 最大1460，  1500(MTU)-20(IP)-8(UDP)-12(RTP)
@@ -19,6 +21,19 @@
 #define RTP_FU_A_TYPE 28
 #define RTP_FU_A_HEAD_LEN 2 //  FU Indicator +  FU Header
 
+// RFC 7798
+#define RTP_H265_AP_TYPE 48
+#define RTP_H265_FU_TYPE 49
+#define RTP_H265_NALU_HEAD_LEN 2
+#define RTP_H265_FU_HEAD_LEN 3 // PayloadHdr + FU header
+
+// RFC 3640 AAC-hbr: sizelength=13, indexlength=3, indexdeltalength=3
+#define RTP_AAC_AU_HEADERS_LENGTH_SIZE 2
+#define RTP_AAC_AU_HEADER_SIZE 2
+
+// RFC 2250: 每个RTP包7个188字节的TS包，不超过MTU
+#define RTP_MP2T_TS_PACKETS 7
+
 static_assert(RTP_PACKET_PREPEND_SIZE > RTP_HEADER_SIZE);
 
 namespace muduo_media {
@@ -10,7 +10,7 @@ namespace muduo_media {
 
 class RtpSink : public MediaSink {
 public:
-    RtpSink() : packets_(0), octets_(0) {}
+    RtpSink() : packets_(0), octets_(0), dropped_frames_(0) {}
     virtual ~RtpSink() = default;
 
     virtual void Send(const unsigned char *data, int len,
@@ -20,10 +20,21 @@ public:
 
     uint32_t packets() const { return packets_; }
     uint32_t octets() const { return octets_; }
+    uint32_t dropped_frames() const { return dropped_frames_; }
+
+    // 已交给连接但还没写入socket的字节数
+    virtual size_t QueuedBytes() const { return 0; }
+
+    // 是否有可观察的发送队列(TCP)，不限速发送依赖它做流控
+    virtual bool HasOutputQueue() const { return false; }
+
+    // 发出暂存(聚合中)的数据，流结束或停止时调用
+    virtual void Flush() {}
 
 protected:
     uint32_t packets_;
     uint32_t octets_;
+    uint32_t dropped_frames_;
 };
 
 using RtpSinkPtr = std::shared_ptr<RtpSink>;
@@ -0,0 +1,390 @@
+#include "shm_ring.h"
+#include "defs.h"
+#include "media_log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+static constexpr uint32_t kShmRingMagic = 0x4D4D5352; // "MMSR"
+static constexpr uint32_t kShmRingVersion = 1;
+static constexpr size_t kShmRingHeaderSize =
+    (sizeof(ShmRingHeader) + 63) / 64 * 64;
+// 生产者由attach线程立即应答，超时只防止生产者卡死时拖住媒体loop
+static constexpr int kAttachTimeoutMs = 100;
+
+static socklen_t MakeSocketAddr(const std::string &name,
+                                struct sockaddr_un *addr) {
+    std::string path = ShmRing::SocketName(name);
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    // abstract socket，首字节为0，不占用文件系统
+    size_t len = std::min(path.size(), sizeof(addr->sun_path) - 1);
+    memcpy(addr->sun_path + 1, path.data(), len);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + len;
+}
+
+ShmRing::ShmRing(const std::string &name, void *addr, size_t length)
+    : name_(name), header_((ShmRingHeader *)addr), length_(length) {}
+
+ShmRing::~ShmRing() { ::munmap(header_, length_); }
+
+ShmSlotHeader *ShmRing::slot(uint64_t index) const {
+    uint64_t pos = index & (header_->slot_count - 1);
+    return (ShmSlotHeader *)((uint8_t *)header_ + kShmRingHeaderSize +
+                             pos * header_->slot_size);
+}
+
+uint8_t *ShmRing::slot_data(uint64_t index) const {
+    return (uint8_t *)slot(index) + sizeof(ShmSlotHeader);
+}
+
+size_t ShmRing::max_payload() const {
+    return header_->slot_size - sizeof(ShmSlotHeader) - defs::kBufPrependSize;
+}
+
+std::string ShmRing::SocketName(const std::string &name) {
+    return "muduo_media" + name;
+}
+
+std::unique_ptr<ShmRingProducer>
+ShmRingProducer::Create(const std::string &name, uint32_t slot_count,
+                        uint32_t slot_size) {
+    uint32_t count = 1;
+    while (count < slot_count) {
+        count <<= 1;
+    }
+    slot_size = (slot_size + 63) / 64 * 64;
+    if (slot_size <= sizeof(ShmSlotHeader) + defs::kBufPrependSize) {
+        LOG_ERROR << "shm ring slot size too small " << slot_size;
+        return nullptr;
+    }
+    size_t length = kShmRingHeaderSize + (size_t)count * slot_size;
+
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOG_ERROR << "shm_open " << name << " fail, errno " << errno;
+        return nullptr;
+    }
+    if (::ftruncate(fd, length) != 0) {
+        LOG_ERROR << "ftruncate " << name << " fail, errno " << errno;
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void *addr =
+        ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOG_ERROR << "mmap " << name << " fail, errno " << errno;
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    int event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int stop_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int listen_fd =
+        ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un un;
+    socklen_t un_len = MakeSocketAddr(name, &un);
+    if (event_fd < 0 || stop_fd < 0 || listen_fd < 0 ||
+        ::bind(listen_fd, (struct sockaddr *)&un, un_len) != 0 ||
+        ::listen(listen_fd, 4) != 0) {
+        LOG_ERROR << "shm ring " << name << " doorbell fail, errno " << errno;
+        if (event_fd >= 0) {
+            ::close(event_fd);
+        }
+        if (stop_fd >= 0) {
+            ::close(stop_fd);
+        }
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+        }
+        ::munmap(addr, length);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    ShmRingHeader *header = new (addr) ShmRingHeader;
+    header->slot_count = count;
+    header->slot_size = slot_size;
+    header->producer_pid = ::getpid();
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->consumer_waiting.store(0, std::memory_order_relaxed);
+    header->consumer_pid.store(0, std::memory_order_relaxed);
+    header->attach_pending.store(0, std::memory_order_relaxed);
+    header->version = kShmRingVersion;
+    // magic最后写，消费者看到magic时其他字段已经就绪
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = kShmRingMagic;
+
+    return std::unique_ptr<ShmRingProducer>(
+        new ShmRingProducer(name, addr, length, event_fd, listen_fd, stop_fd));
+}
+
+ShmRingProducer::ShmRingProducer(const std::string &name, void *addr,
+                                 size_t length, int event_fd, int listen_fd,
+                                 int stop_fd)
+    : ShmRing(name, addr, length),
+      event_fd_(event_fd),
+      listen_fd_(listen_fd),
+      stop_fd_(stop_fd),
+      attach_thread_(&ShmRingProducer::AttachThreadFunc, this),
+      dropped_(0) {}
+
+ShmRingProducer::~ShmRingProducer() {
+    header_->magic = 0;
+    uint64_t one = 1;
+    ssize_t n = ::write(stop_fd_, &one, sizeof(one));
+    (void)n;
+    attach_thread_.join();
+    ::close(stop_fd_);
+    ::close(listen_fd_);
+    ::close(event_fd_);
+    ::shm_unlink(name_.c_str());
+}
+
+uint8_t *ShmRingProducer::Reserve(size_t size) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    if (head - tail >= header_->slot_count || size > max_payload()) {
+        ++dropped_;
+        return nullptr;
+    }
+    return slot_data(head) + defs::kBufPrependSize;
+}
+
+void ShmRingProducer::Commit(size_t size, uint8_t type, int64_t pts,
+                             bool frame_end) {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    ShmSlotHeader *slot_header = slot(head);
+    slot_header->size = (uint32_t)size;
+    slot_header->type = type;
+    slot_header->flags = frame_end ? kShmSlotFrameEnd : 0;
+    slot_header->pts = pts;
+
+    header_->head.store(head + 1, std::memory_order_release);
+
+    // 与消费者ArmWakeup中的fence配对，保证不会错过唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->consumer_waiting.load(std::memory_order_relaxed) &&
+        header_->consumer_waiting.exchange(0)) {
+        uint64_t one = 1;
+        ssize_t n = ::write(event_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void ShmRingProducer::AttachThreadFunc() {
+    struct pollfd fds[2];
+    fds[0].fd = listen_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_fd_;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR << "shm ring " << name_ << " attach poll fail, errno "
+                      << errno;
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        if (fds[0].revents) {
+            ServeAttach();
+        }
+    }
+}
+
+void ShmRingProducer::ServeAttach() {
+    int conn = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn < 0) {
+        return;
+    }
+
+    char data = 'E';
+    struct iovec iov = {&data, 1};
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &event_fd_, sizeof(int));
+
+    if (::sendmsg(conn, &msg, MSG_NOSIGNAL) == 1) {
+        header_->attach_pending.store(0, std::memory_order_relaxed);
+    }
+    ::close(conn);
+}
+
+std::unique_ptr<ShmRingConsumer>
+ShmRingConsumer::Open(const std::string &name) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        LOG_ERROR << "shm_open " << name << " fail, errno " << errno;
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (size_t)st.st_size < kShmRingHeaderSize) {
+        LOG_ERROR << "shm ring " << name << " not ready";
+        ::close(fd);
+        return nullptr;
+    }
+    size_t length = st.st_size;
+    void *addr =
+        ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOG_ERROR << "mmap " << name << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    ShmRingHeader *header = (ShmRingHeader *)addr;
+    if (header->magic != kShmRingMagic ||
+        header->version != kShmRingVersion ||
+        length < kShmRingHeaderSize +
+                     (size_t)header->slot_count * header->slot_size) {
+        LOG_ERROR << "shm ring " << name << " bad header";
+        ::munmap(addr, length);
+        return nullptr;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // 单消费者。原消费者进程已经不存在时接管
+    int32_t self = ::getpid();
+    int32_t owner = 0;
+    if (!header->consumer_pid.compare_exchange_strong(owner, self)) {
+        if (owner == self ||
+            (::kill(owner, 0) == 0 || errno != ESRCH) ||
+            !header->consumer_pid.compare_exchange_strong(owner, self)) {
+            LOG_WARN << "shm ring " << name << " already has consumer "
+                     << owner;
+            ::munmap(addr, length);
+            return nullptr;
+        }
+    }
+
+    // 通过unix socket取得生产者的eventfd
+    header->attach_pending.store(1);
+    int event_fd = -1;
+    int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un un;
+    socklen_t un_len = MakeSocketAddr(name, &un);
+    struct timeval tv = {kAttachTimeoutMs / 1000,
+                         (kAttachTimeoutMs % 1000) * 1000};
+    ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (sock >= 0 && ::connect(sock, (struct sockaddr *)&un, un_len) == 0) {
+        char data;
+        struct iovec iov = {&data, 1};
+        char control[CMSG_SPACE(sizeof(int))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) == 1) {
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            if (cmsg && cmsg->cmsg_type == SCM_RIGHTS) {
+                memcpy(&event_fd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+    }
+    if (sock >= 0) {
+        ::close(sock);
+    }
+
+    if (event_fd < 0) {
+        LOG_ERROR << "shm ring " << name << " get eventfd fail, errno "
+                  << errno;
+        header->attach_pending.store(0);
+        header->consumer_pid.store(0);
+        ::munmap(addr, length);
+        return nullptr;
+    }
+
+    return std::unique_ptr<ShmRingConsumer>(
+        new ShmRingConsumer(name, addr, length, event_fd));
+}
+
+ShmRingConsumer::ShmRingConsumer(const std::string &name, void *addr,
+                                 size_t length, int event_fd)
+    : ShmRing(name, addr, length), event_fd_(event_fd) {
+    // 直播从最新的数据开始，丢弃attach之前积压的NALU
+    tail_ = header_->head.load(std::memory_order_acquire);
+    header_->tail.store(tail_, std::memory_order_release);
+}
+
+ShmRingConsumer::~ShmRingConsumer() {
+    header_->consumer_waiting.store(0);
+    header_->consumer_pid.store(0);
+    ::close(event_fd_);
+}
+
+ShmSlotHeader *ShmRingConsumer::Peek() {
+    if (tail_ == header_->head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return slot(tail_);
+}
+
+void ShmRingConsumer::Release() {
+    ++tail_;
+    header_->tail.store(tail_, std::memory_order_release);
+}
+
+bool ShmRingConsumer::ArmWakeup() {
+    header_->consumer_waiting.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tail_ != header_->head.load(std::memory_order_acquire)) {
+        header_->consumer_waiting.store(0);
+        return false;
+    }
+    return true;
+}
+
+void ShmRingConsumer::ClearWakeup() {
+    uint64_t count;
+    ssize_t n = ::read(event_fd_, &count, sizeof(count));
+    (void)n;
+}
+
+bool ShmRingConsumer::closed() const {
+    // 正常退出时析构清除magic，被杀掉时只能看进程是否还在
+    if (header_->magic != kShmRingMagic) {
+        return true;
+    }
+    return ::kill(header_->producer_pid, 0) != 0 && errno == ESRCH;
+}
+
+} // namespace muduo_media
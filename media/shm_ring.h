@@ -0,0 +1,142 @@
+#ifndef C4D8E1F6_7A25_4B93_9E0C_38F5B2A61D47
+#define C4D8E1F6_7A25_4B93_9E0C_38F5B2A61D47
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace muduo_media {
+
+/**
+ * 共享内存单生产者单消费者环形队列，用于本机编码器推送NALU
+ *
+ * +--------------+---------+---------+-----+---------+
+ * | ShmRingHeader| slot[0] | slot[1] | ... | slot[n] |
+ * +--------------+---------+---------+-----+---------+
+ *
+ * slot = ShmSlotHeader(64字节) + 预留前置空间 + NALU(不含起始码)
+ *
+ * head只由生产者写，tail只由消费者写，二者各占一条缓存行。满时生产者丢帧，
+ * 不会阻塞编码。消费者取空后置waiting，生产者发布新帧时看到waiting就写
+ * eventfd唤醒消费者。eventfd由生产者创建，消费者attach时通过unix socket
+ * 的SCM_RIGHTS取得；生产者在自己的线程中应答，与编码节奏无关，消费者在
+ * ShmStreamReader的线程中等待，不占用媒体loop。
+ */
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count; // 2的幂
+    uint32_t slot_size;  // 每个slot的总字节数
+    int32_t producer_pid;
+
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> consumer_waiting;
+    std::atomic<int32_t> consumer_pid;   // 0表示没有消费者
+    std::atomic<uint32_t> attach_pending; // 消费者等待取eventfd
+};
+
+struct alignas(64) ShmSlotHeader {
+    uint32_t size;  // NALU字节数
+    uint8_t type;   // NALU类型
+    uint8_t flags;  // kShmSlotFrameEnd
+    int64_t pts;    // 90kHz
+};
+
+constexpr uint8_t kShmSlotFrameEnd = 0x01; // access unit的最后一个NALU
+
+/// @brief 共享内存映射，生产者和消费者共用
+class ShmRing {
+public:
+    ~ShmRing();
+
+    ShmRingHeader *header() const { return header_; }
+
+    /// 第index个slot的头部
+    ShmSlotHeader *slot(uint64_t index) const;
+
+    /// slot中预留前置空间的起始地址，NALU紧随其后
+    uint8_t *slot_data(uint64_t index) const;
+
+    /// 单个NALU的最大长度
+    size_t max_payload() const;
+
+    static std::string SocketName(const std::string &name);
+
+protected:
+    ShmRing(const std::string &name, void *addr, size_t length);
+
+    std::string name_;
+    ShmRingHeader *header_;
+    size_t length_;
+};
+
+/// @brief 编码器一侧
+class ShmRingProducer : public ShmRing {
+public:
+    /// name形如"/camera0"，slot_count会向上取整到2的幂
+    static std::unique_ptr<ShmRingProducer>
+    Create(const std::string &name, uint32_t slot_count, uint32_t slot_size);
+
+    ~ShmRingProducer();
+
+    /// 返回下一个slot中NALU的写入地址，队列满或size过大时返回nullptr
+    uint8_t *Reserve(size_t size);
+
+    /// 发布Reserve得到的slot
+    void Commit(size_t size, uint8_t type, int64_t pts, bool frame_end);
+
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    ShmRingProducer(const std::string &name, void *addr, size_t length,
+                    int event_fd, int listen_fd, int stop_fd);
+
+    // attach线程，应答消费者直到stop_fd_可读
+    void AttachThreadFunc();
+    void ServeAttach();
+
+    int event_fd_;
+    int listen_fd_;
+    int stop_fd_;
+    std::thread attach_thread_;
+    uint64_t dropped_;
+};
+
+/// @brief 媒体服务一侧
+class ShmRingConsumer : public ShmRing {
+public:
+    /// 已有消费者或者生产者不存在时返回nullptr
+    static std::unique_ptr<ShmRingConsumer> Open(const std::string &name);
+
+    ~ShmRingConsumer();
+
+    /// 队头slot，空时返回nullptr。数据在Release之前有效
+    ShmSlotHeader *Peek();
+    void Release();
+
+    /// 准备等待eventfd。返回false表示期间已有新数据，应继续读取
+    bool ArmWakeup();
+
+    /// 取走eventfd上的计数
+    void ClearWakeup();
+
+    int event_fd() const { return event_fd_; }
+
+    /// 生产者已经退出，需要重新attach
+    bool closed() const;
+
+private:
+    ShmRingConsumer(const std::string &name, void *addr, size_t length,
+                    int event_fd);
+
+    int event_fd_;
+    uint64_t tail_;
+};
+
+} // namespace muduo_media
+
+#endif /* C4D8E1F6_7A25_4B93_9E0C_38F5B2A61D47 */
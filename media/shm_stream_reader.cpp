@@ -0,0 +1,109 @@
+#include "shm_stream_reader.h"
+#include "av_packet.h"
+#include "defs.h"
+#include "media_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+constexpr int ShmStreamReader::kMinBackoffMs;
+constexpr int ShmStreamReader::kMaxBackoffMs;
+
+ShmStreamReader::ShmStreamReader(const std::string &shm_name,
+                                 const LiveStreamHubPtr &hub)
+    : shm_name_(shm_name),
+      hub_(hub),
+      stop_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      thread_(&ShmStreamReader::ThreadFunc, this) {}
+
+ShmStreamReader::~ShmStreamReader() {
+    uint64_t one = 1;
+    ssize_t n = ::write(stop_fd_, &one, sizeof(one));
+    (void)n;
+    thread_.join();
+    ::close(stop_fd_);
+}
+
+void ShmStreamReader::ThreadFunc() {
+    int backoff_ms = kMinBackoffMs;
+    while (true) {
+        std::unique_ptr<ShmRingConsumer> consumer =
+            ShmRingConsumer::Open(shm_name_);
+        if (!consumer) {
+            LOG_WARN << "shm ring " << shm_name_ << " attach fail, retry in "
+                     << backoff_ms << "ms";
+            if (!Wait(-1, backoff_ms)) {
+                return;
+            }
+            backoff_ms = std::min(backoff_ms * 2, kMaxBackoffMs);
+            continue;
+        }
+        LOG_INFO << "attached shm ring " << shm_name_;
+        backoff_ms = kMinBackoffMs;
+
+        // 超时时检查生产者是否还在
+        while (!consumer->closed()) {
+            Drain(consumer.get());
+            if (!consumer->ArmWakeup()) {
+                continue;
+            }
+            if (!Wait(consumer->event_fd(), kMinBackoffMs)) {
+                return;
+            }
+            consumer->ClearWakeup();
+        }
+        LOG_WARN << "shm ring " << shm_name_ << " producer exited";
+    }
+}
+
+void ShmStreamReader::Drain(ShmRingConsumer *consumer) {
+    ShmSlotHeader *slot;
+    while ((slot = consumer->Peek()) != nullptr) {
+        const uint8_t *data =
+            (const uint8_t *)slot + sizeof(ShmSlotHeader) +
+            defs::kBufPrependSize;
+
+        AVPacket packet;
+        packet.prepend_size = defs::kBufPrependSize;
+        packet.size = slot->size;
+        packet.type = slot->type;
+        packet.pts = slot->pts;
+        packet.buffer.reset(new uint8_t[packet.prepend_size + packet.size]);
+        memcpy(packet.buffer.get() + packet.prepend_size, data, packet.size);
+        consumer->Release();
+
+        hub_->Publish(packet);
+    }
+}
+
+bool ShmStreamReader::Wait(int fd, int timeout_ms) {
+    struct pollfd fds[2];
+    fds[0].fd = stop_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = fd;
+    fds[1].events = POLLIN;
+
+    while (true) {
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        int n = ::poll(fds, fd >= 0 ? 2 : 1, timeout_ms);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            LOG_ERROR << "shm ring " << shm_name_ << " poll fail, errno "
+                      << errno;
+            return false;
+        }
+        return 0 == fds[0].revents;
+    }
+}
+
+} // namespace muduo_media
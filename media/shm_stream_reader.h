@@ -0,0 +1,46 @@
+#ifndef A5E92B7D_0C43_4F18_B6D2_E1874C3F9A05
+#define A5E92B7D_0C43_4F18_B6D2_E1874C3F9A05
+
+#include "live_stream_hub.h"
+#include "shm_ring.h"
+
+#include <string>
+#include <thread>
+
+namespace muduo_media {
+
+/// @brief 读取本机编码器推送到共享内存环形队列的NALU，发布到LiveStreamHub
+///
+/// 环形队列是单消费者的，每个H264ShmSubsession只有一个reader，所有观看者
+/// 订阅同一个hub。attach时要等生产者回传eventfd，之后也要等eventfd，都在
+/// reader自己的线程中，不占用媒体loop。
+///
+/// hub缓存GOP时只持有引用，而slot归还后会被生产者覆盖，所以NALU先拷贝出来
+/// 再发布。生产者还没启动或者退出后按退避间隔重新attach。
+class ShmStreamReader {
+public:
+    static constexpr int kMinBackoffMs = 1000;
+    static constexpr int kMaxBackoffMs = 30000;
+
+    ShmStreamReader(const std::string &shm_name, const LiveStreamHubPtr &hub);
+    ~ShmStreamReader();
+
+private:
+    void ThreadFunc();
+
+    // 读出所有已发布的slot
+    void Drain(ShmRingConsumer *consumer);
+
+    // 等待fd可读或超时，fd为-1时只等超时。返回false表示要停止
+    bool Wait(int fd, int timeout_ms);
+
+private:
+    std::string shm_name_;
+    LiveStreamHubPtr hub_;
+    int stop_fd_;
+    std::thread thread_;
+};
+
+} // namespace muduo_media
+
+#endif /* A5E92B7D_0C43_4F18_B6D2_E1874C3F9A05 */
@@ -0,0 +1,76 @@
+#ifndef F13D1D5C_60CB_4864_9B34_1CB9D984BD2D
+#define F13D1D5C_60CB_4864_9B34_1CB9D984BD2D
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace muduo_media {
+
+/// @brief 单生产者单消费者的无锁环形队列
+///
+/// 容量向上取整为2的幂。生产者和消费者各自只写自己的下标，两个下标分在
+/// 不同缓存行；满时TryPush直接返回false，调用方决定丢弃还是重试，生产者
+/// 永远不会阻塞。
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : mask_(RoundUp(capacity) - 1),
+          slots_(new T[mask_ + 1]),
+          head_(0),
+          tail_(0) {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /// 只由生产者调用
+    bool TryPush(T &&item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// 只由消费者调用。取出后槽位重置，不再持有对象
+    bool TryPop(T *item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// 近似值，只用于统计
+    size_t size() const {
+        return tail_.load(std::memory_order_relaxed) -
+               head_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static size_t RoundUp(size_t n) {
+        size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(64) std::atomic<size_t> head_; // 消费者写
+    alignas(64) std::atomic<size_t> tail_; // 生产者写
+};
+
+} // namespace muduo_media
+
+#endif /* F13D1D5C_60CB_4864_9B34_1CB9D984BD2D */
@@ -0,0 +1,400 @@
+#include "stream_recorder.h"
+#include "media_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+static const uint8_t kStartCode[4] = {0, 0, 0, 1};
+
+// 单次pwritev的iovec上限
+static constexpr size_t kMaxIov = IOV_MAX;
+// 攒批的最长时间，直播码率低时也不会在内存里积压太久
+static constexpr int64_t kMaxBatchDelayUs = 200 * 1000;
+// 队列空时I/O线程的等待时间
+static constexpr auto kIdleWait = std::chrono::milliseconds(5);
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint8_t NalType(const AVPacket &packet) {
+    return packet.buffer[packet.prepend_size] & 0x1F;
+}
+
+// first_mb_in_slice为0，即一幅图像的第一个slice
+static bool IsFirstSlice(const AVPacket &packet, uint8_t type) {
+    return (type == NALU_TYPE_IDR || type == NALU_TYPE_SLICE) &&
+           packet.size > 1 && (packet.buffer[packet.prepend_size + 1] & 0x80);
+}
+
+StreamRecorder::StreamRecorder(const LiveStreamHubPtr &hub,
+                               const StreamRecorderOptions &options)
+    : hub_(hub),
+      options_(options),
+      loop_(nullptr),
+      subscription_(0),
+      waiting_keyframe_(true),
+      queue_(options.queue_capacity),
+      running_(false),
+      batch_size_(0),
+      last_type_(0),
+      fd_(-1),
+      offset_(0),
+      append_pos_(0),
+      segment_start_us_(0),
+      segment_seq_(0),
+      segments_(0),
+      nalus_(0),
+      dropped_nalus_(0),
+      payload_bytes_(0),
+      media_bytes_(0),
+      index_bytes_(0),
+      write_calls_(0),
+      write_errors_(0) {}
+
+StreamRecorder::~StreamRecorder() { Stop(); }
+
+void *StreamRecorder::operator new(size_t size) {
+    void *memory = nullptr;
+    if (::posix_memalign(&memory, alignof(StreamRecorder), size) != 0) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void StreamRecorder::operator delete(void *ptr) { ::free(ptr); }
+
+bool StreamRecorder::Start(muduo::event_loop::EventLoop *loop) {
+    if (thread_.joinable()) {
+        return false;
+    }
+
+    loop_ = loop;
+    waiting_keyframe_ = true;
+    running_ = true;
+    thread_ = std::thread(&StreamRecorder::ThreadFunc, this);
+
+    // 先写缓存的参数集和当前GOP，之后的回调从缓存末尾接续
+    std::vector<AVPacket> burst;
+    subscription_ = hub_->Subscribe(
+        loop, [this](const AVPacket &packet) { OnPacket(packet); }, &burst);
+    for (auto &&packet : burst) {
+        OnPacket(packet);
+    }
+    return true;
+}
+
+void StreamRecorder::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    if (subscription_ != 0) {
+        hub_->Unsubscribe(subscription_);
+        subscription_ = 0;
+    }
+    running_ = false;
+    thread_.join();
+
+    LOG_INFO << "recorder " << options_.prefix << " stopped, " << Report();
+}
+
+void StreamRecorder::OnPacket(const AVPacket &packet) {
+    if (packet.size == 0) {
+        return;
+    }
+
+    // 丢过数据之后从下一个SPS或IDR重新开始
+    if (waiting_keyframe_) {
+        uint8_t type = NalType(packet);
+        if (type != NALU_TYPE_SPS &&
+            !(type == NALU_TYPE_IDR && IsFirstSlice(packet, type))) {
+            return;
+        }
+        waiting_keyframe_ = false;
+    }
+    Enqueue(packet);
+}
+
+void StreamRecorder::Enqueue(const AVPacket &packet) {
+    Item item;
+    item.packet = packet;
+    item.enqueue_us = NowMicros();
+    if (!queue_.TryPush(std::move(item))) {
+        ++dropped_nalus_;
+        waiting_keyframe_ = true;
+    }
+}
+
+void StreamRecorder::ThreadFunc() {
+    int64_t batch_start_us = 0;
+
+    while (true) {
+        // 先读标志再取队列，Stop之前入队的数据一定能取到
+        bool running = running_.load(std::memory_order_acquire);
+
+        Item item;
+        bool popped = false;
+        while (batch_size_ < options_.batch_bytes &&
+               batch_.size() < kMaxIov / 2 && queue_.TryPop(&item)) {
+            if (batch_.empty()) {
+                batch_start_us = item.enqueue_us;
+            }
+            batch_size_ += item.packet.size;
+            batch_.push_back(std::move(item));
+            popped = true;
+        }
+
+        bool full = batch_size_ >= options_.batch_bytes ||
+                    batch_.size() >= kMaxIov / 2;
+        bool due = !batch_.empty() &&
+                   NowMicros() - batch_start_us >= kMaxBatchDelayUs;
+        if (full || due || (!running && !batch_.empty())) {
+            WriteBatch();
+            continue;
+        }
+        if (!running) {
+            break;
+        }
+        if (!popped) {
+            std::this_thread::sleep_for(kIdleWait);
+        }
+    }
+
+    CloseSegment();
+}
+
+void StreamRecorder::WriteBatch() {
+    for (auto &&item : batch_) {
+        WriteNal(item.packet, item.enqueue_us);
+    }
+    Flush();
+
+    int64_t now_us = NowMicros();
+    for (auto &&item : batch_) {
+        queue_to_disk_.Record(now_us - item.enqueue_us);
+    }
+    batch_.clear();
+    pinned_.clear();
+    batch_size_ = 0;
+}
+
+void StreamRecorder::WriteNal(const AVPacket &packet, int64_t enqueue_us) {
+    uint8_t type = NalType(packet);
+    bool first_slice = IsFirstSlice(packet, type);
+    bool keyframe = type == NALU_TYPE_IDR && first_slice;
+
+    if (type == NALU_TYPE_SPS) {
+        sps_ = packet;
+    } else if (type == NALU_TYPE_PPS) {
+        pps_ = packet;
+    }
+
+    if (fd_ < 0 || ShouldRotate(type, keyframe, enqueue_us)) {
+        // 每段从SPS或IDR开始
+        if (type != NALU_TYPE_SPS && !keyframe) {
+            return;
+        }
+        CloseSegment();
+        if (!OpenSegment(enqueue_us)) {
+            return;
+        }
+        // 段从IDR开始时补上最近的参数集，iov_引用期间不能释放
+        if (keyframe) {
+            for (const AVPacket *sets : {&sps_, &pps_}) {
+                if (sets->size > 0) {
+                    pinned_.push_back(*sets);
+                    AppendNal(*sets, NalType(*sets), false);
+                }
+            }
+        }
+    }
+
+    AppendNal(packet, type, first_slice);
+}
+
+bool StreamRecorder::ShouldRotate(uint8_t type, bool keyframe,
+                                  int64_t now_us) const {
+    if (type != NALU_TYPE_SPS && !keyframe) {
+        return false;
+    }
+    // IDR紧跟在本段的参数集之后时，参数集已经写在本段，不在这里切开
+    if (keyframe &&
+        (last_type_ == NALU_TYPE_SPS || last_type_ == NALU_TYPE_PPS)) {
+        return false;
+    }
+    return append_pos_ >= options_.segment_bytes ||
+           now_us - segment_start_us_ >=
+               (int64_t)(options_.segment_duration * 1000000);
+}
+
+bool StreamRecorder::OpenSegment(int64_t start_us) {
+    char name[64];
+    time_t now = time(nullptr);
+    struct tm tm_time;
+    localtime_r(&now, &tm_time);
+    snprintf(name, sizeof(name), "-%04d%02d%02d-%02d%02d%02d-%llu.h264",
+             tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+             tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
+             (unsigned long long)segment_seq_++);
+    path_ = options_.directory + "/" + options_.prefix + name;
+
+    fd_ = ::open(path_.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0644);
+    if (fd_ < 0) {
+        LOG_ERROR << "open " << path_ << " fail, errno " << errno;
+        return false;
+    }
+
+    offset_ = 0;
+    append_pos_ = 0;
+    last_type_ = 0;
+    nals_.clear();
+    segment_start_us_ = start_us;
+    ++segments_;
+    LOG_INFO << "recording " << path_;
+    return true;
+}
+
+void StreamRecorder::CloseSegment() {
+    if (fd_ < 0) {
+        return;
+    }
+    Flush();
+    if (fd_ < 0) {
+        // 写入失败，段已经放弃
+        return;
+    }
+    ::close(fd_);
+    fd_ = -1;
+
+    size_t nal_count = nals_.size();
+    auto index = H264FileIndex::FromNals(path_, std::move(nals_));
+    nals_.clear();
+    if (!index || !index->Save(path_)) {
+        LOG_ERROR << "index " << path_ << " fail";
+        return;
+    }
+
+    struct stat st;
+    if (::stat(H264FileIndex::IndexPath(path_).data(), &st) == 0) {
+        index_bytes_ += st.st_size;
+    }
+    LOG_INFO << "recorded " << path_ << ", bytes " << offset_ << ", NALUs "
+             << nal_count << ", keyframes " << index->keyframe_count();
+}
+
+void StreamRecorder::AppendNal(const AVPacket &packet, uint8_t type,
+                               bool first_slice) {
+    H264NalEntry entry;
+    entry.offset = append_pos_;
+    entry.size = packet.size + sizeof(kStartCode);
+    entry.type = type;
+    entry.flags = first_slice ? kH264NalFirstSlice : 0;
+    entry.reserved = 0;
+    nals_.push_back(entry);
+
+    Append(kStartCode, sizeof(kStartCode));
+    Append(packet.buffer.get() + packet.prepend_size, packet.size);
+
+    last_type_ = type;
+    ++nalus_;
+    payload_bytes_ += packet.size;
+}
+
+void StreamRecorder::Append(const uint8_t *data, size_t size) {
+    if (iov_.size() >= kMaxIov) {
+        Flush();
+    }
+    struct iovec iov;
+    iov.iov_base = const_cast<uint8_t *>(data);
+    iov.iov_len = size;
+    iov_.push_back(iov);
+    append_pos_ += size;
+}
+
+void StreamRecorder::Flush() {
+    size_t index = 0;
+    while (fd_ >= 0 && index < iov_.size()) {
+        int count = (int)std::min(iov_.size() - index, kMaxIov);
+        int64_t start_us = NowMicros();
+        ssize_t n = ::pwritev(fd_, &iov_[index], count, offset_);
+        write_call_.Record(NowMicros() - start_us);
+        ++write_calls_;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 段已经不完整，放弃它，下一个关键帧开新段
+            LOG_ERROR << "write " << path_ << " fail, errno " << errno;
+            ++write_errors_;
+            ::close(fd_);
+            fd_ = -1;
+            nals_.clear();
+            break;
+        }
+        offset_ += n;
+        media_bytes_ += n;
+
+        // 跳过已写完的iovec，部分写入的调整起点
+        while (n > 0) {
+            struct iovec &iov = iov_[index];
+            if ((size_t)n >= iov.iov_len) {
+                n -= iov.iov_len;
+                ++index;
+            } else {
+                iov.iov_base = (uint8_t *)iov.iov_base + n;
+                iov.iov_len -= n;
+                n = 0;
+            }
+        }
+    }
+    iov_.clear();
+}
+
+std::string StreamRecorder::Report() const {
+    uint64_t payload = payload_bytes_.load();
+    uint64_t media = media_bytes_.load();
+    uint64_t index = index_bytes_.load();
+    uint64_t calls = write_calls_.load();
+
+    char text[640];
+    snprintf(text, sizeof(text),
+             "segments %llu, NALUs %llu, dropped %llu, payload %llu bytes, "
+             "written %llu bytes (media %llu + index %llu), "
+             "write amplification %.4f, pwritev %llu calls avg %llu bytes, "
+             "errors %llu, queue->disk p50 %llu us p99 %llu us, "
+             "pwritev p50 %llu us p99 %llu us",
+             (unsigned long long)segments_.load(),
+             (unsigned long long)nalus_.load(),
+             (unsigned long long)dropped_nalus_.load(),
+             (unsigned long long)payload,
+             (unsigned long long)(media + index), (unsigned long long)media,
+             (unsigned long long)index,
+             payload ? (double)(media + index) / payload : 0.0,
+             (unsigned long long)calls,
+             (unsigned long long)(calls ? media / calls : 0),
+             (unsigned long long)write_errors_.load(),
+             (unsigned long long)queue_to_disk_.Percentile(0.5),
+             (unsigned long long)queue_to_disk_.Percentile(0.99),
+             (unsigned long long)write_call_.Percentile(0.5),
+             (unsigned long long)write_call_.Percentile(0.99));
+    return text;
+}
+
+} // namespace muduo_media
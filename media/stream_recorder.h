@@ -0,0 +1,126 @@
+#ifndef BD9195C2_C382_4DCB_AABA_2ADF7D36735B
+#define BD9195C2_C382_4DCB_AABA_2ADF7D36735B
+
+#include "av_packet.h"
+#include "h264_file_index.h"
+#include "live_stream_hub.h"
+#include "metrics.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+namespace muduo_media {
+
+struct StreamRecorderOptions {
+    std::string directory = ".";
+    std::string prefix = "record";      // 段文件名前缀
+    double segment_duration = 60.0;     // 秒，到达后在下一个关键帧切段
+    uint64_t segment_bytes = 256 << 20; // 到达后在下一个关键帧切段
+    size_t queue_capacity = 8192;       // 队列中的NALU数
+    size_t batch_bytes = 1 << 20;       // 攒够后一次pwritev
+};
+
+/**
+ * @brief 把一路直播(LiveStreamHub)录制成分段的H.264裸流文件
+ *
+ * 订阅回调只把AVPacket(共享缓冲，不拷贝)放入无锁SPSC队列，媒体loop不碰
+ * 磁盘；队列满时丢弃并等下一个关键帧重新开始，不写入残缺的GOP。独立的
+ * I/O线程批量取出，以起始码+NALU的iovec聚合成大块pwritev写入。
+ *
+ * 每段以SPS/PPS和IDR开头，超过时长或大小后在下一个关键帧切段。段关闭时
+ * 按写入时记录的NALU位置生成同名.idx(H264FileIndex格式)，录好的文件可以
+ * 直接由H264FileSubsession点播和定位，不需要重新扫描。
+ */
+class StreamRecorder {
+public:
+    StreamRecorder(const LiveStreamHubPtr &hub,
+                   const StreamRecorderOptions &options);
+    ~StreamRecorder();
+
+    // queue_含64字节对齐的成员，C++11的new不保证，按类型对齐分配
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr);
+
+    /// 在loop上订阅hub。loop为发布者loop时与观看者共用缓冲
+    bool Start(muduo::event_loop::EventLoop *loop);
+
+    /// 须在Start的loop线程中调用。写完队列中剩余数据、关闭当前段后返回
+    void Stop();
+
+    /// 写放大和延迟的汇总，可以在任意线程调用
+    std::string Report() const;
+
+    uint64_t segments() const { return segments_.load(); }
+    uint64_t dropped_nalus() const { return dropped_nalus_.load(); }
+
+private:
+    struct Item {
+        AVPacket packet;
+        int64_t enqueue_us = 0;
+    };
+
+    // loop线程
+    void OnPacket(const AVPacket &packet);
+    void Enqueue(const AVPacket &packet);
+
+    // I/O线程
+    void ThreadFunc();
+    void WriteBatch();
+    void WriteNal(const AVPacket &packet, int64_t enqueue_us);
+    bool ShouldRotate(uint8_t type, bool keyframe, int64_t now_us) const;
+    bool OpenSegment(int64_t start_us);
+    void CloseSegment();
+    void AppendNal(const AVPacket &packet, uint8_t type, bool first_slice);
+    void Append(const uint8_t *data, size_t size);
+    void Flush();
+
+private:
+    LiveStreamHubPtr hub_;
+    const StreamRecorderOptions options_;
+
+    muduo::event_loop::EventLoop *loop_;
+    uint64_t subscription_;
+    bool waiting_keyframe_; // 丢弃之后等下一个关键帧，只由loop线程访问
+
+    SpscQueue<Item> queue_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+
+    // 以下只由I/O线程访问
+    std::vector<Item> batch_;
+    size_t batch_size_;
+    std::vector<struct iovec> iov_;
+    std::vector<AVPacket> pinned_; // iov_引用但不在batch_中的参数集
+    AVPacket sps_;
+    AVPacket pps_;
+    uint8_t last_type_; // 当前段最后写入的NALU类型
+
+    int fd_;
+    std::string path_;
+    uint64_t offset_;      // 当前段已提交给pwritev的长度
+    uint64_t append_pos_;  // 加上iov_中待写的长度
+    int64_t segment_start_us_;
+    uint64_t segment_seq_;
+    std::vector<H264NalEntry> nals_;
+
+    // 统计
+    std::atomic<uint64_t> segments_;
+    std::atomic<uint64_t> nalus_;
+    std::atomic<uint64_t> dropped_nalus_;
+    std::atomic<uint64_t> payload_bytes_; // NALU本身，不含起始码
+    std::atomic<uint64_t> media_bytes_;   // 段文件实际写入
+    std::atomic<uint64_t> index_bytes_;
+    std::atomic<uint64_t> write_calls_;
+    std::atomic<uint64_t> write_errors_;
+    LatencyHistogram queue_to_disk_; // 入队 -> pwritev返回
+    LatencyHistogram write_call_;    // 单次pwritev耗时
+};
+
+} // namespace muduo_media
+
+#endif /* BD9195C2_C382_4DCB_AABA_2ADF7D36735B */
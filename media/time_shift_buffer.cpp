@@ -0,0 +1,248 @@
+#include "time_shift_buffer.h"
+#include "defs.h"
+#include "media_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+static constexpr size_t kAlignment = 8;
+
+TimeShiftBuffer::TimeShiftBuffer(uint8_t *base, size_t capacity)
+    : base_(base), capacity_(capacity), head_(0), tail_(0) {}
+
+TimeShiftBuffer::~TimeShiftBuffer() { ::munmap(base_, capacity_); }
+
+std::shared_ptr<TimeShiftBuffer>
+TimeShiftBuffer::Create(size_t capacity, const std::string &directory) {
+    capacity = (capacity + kAlignment - 1) & ~(kAlignment - 1);
+
+    std::string pattern = directory + "/muduo_media_dvr_XXXXXX";
+    std::vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
+        LOG_ERROR << "create time shift file in " << directory
+                  << " fail, errno " << errno;
+        return nullptr;
+    }
+    // 只通过映射访问，进程退出后自动回收
+    ::unlink(path.data());
+
+    // 预先分配磁盘空间，避免写映射时因空间不足收到SIGBUS
+    int err = ::posix_fallocate(fd, 0, capacity);
+    if (err != 0) {
+        LOG_ERROR << "allocate time shift file " << capacity
+                  << " bytes fail, errno " << err;
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *base = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        LOG_ERROR << "mmap time shift file fail, errno " << errno;
+        return nullptr;
+    }
+
+    LOG_INFO << "time shift buffer " << capacity << " bytes";
+    return std::shared_ptr<TimeShiftBuffer>(
+        new TimeShiftBuffer((uint8_t *)base, capacity));
+}
+
+int64_t TimeShiftBuffer::WallMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+size_t TimeShiftBuffer::RecordSize(uint32_t size) {
+    return (sizeof(Record) + defs::kBufPrependSize + size + kAlignment - 1) &
+           ~(kAlignment - 1);
+}
+
+uint64_t TimeShiftBuffer::NextRecord(uint64_t position) const {
+    size_t remain = capacity_ - position % capacity_;
+    if (remain < sizeof(Record)) {
+        return position + remain;
+    }
+    Record record;
+    memcpy(&record, base_ + position % capacity_, sizeof(record));
+    if (record.size == kPadding) {
+        return position + remain;
+    }
+    return position + RecordSize(record.size);
+}
+
+void TimeShiftBuffer::Reclaim(uint64_t end) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (end - tail <= capacity_) {
+        return;
+    }
+    while (end - tail > capacity_) {
+        tail = NextRecord(tail);
+    }
+
+    // 先公布新的tail再覆盖数据，读者拷贝之后重新检查tail即可发现覆盖
+    tail_.store(tail, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!keyframes_.empty() && keyframes_.front().position < tail) {
+        keyframes_.pop_front();
+    }
+}
+
+void TimeShiftBuffer::Write(const AVPacket &packet) {
+    size_t need = RecordSize(packet.size);
+    if (need > capacity_ / 4) {
+        LOG_WARN << "NALU " << packet.size << " bytes too large for time "
+                 << "shift buffer " << capacity_;
+        return;
+    }
+
+    if (packet.type == NALU_TYPE_SPS || packet.type == NALU_TYPE_PPS) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        (packet.type == NALU_TYPE_SPS ? sps_ : pps_) = packet;
+    }
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    size_t offset = head % capacity_;
+    size_t pad = capacity_ - offset < need ? capacity_ - offset : 0;
+    Reclaim(head + pad + need);
+
+    // 环尾放不下，跳到环首
+    if (pad > 0) {
+        if (pad >= sizeof(Record)) {
+            Record padding = {kPadding, 0, 0, 0};
+            memcpy(base_ + offset, &padding, sizeof(padding));
+        }
+        head += pad;
+        offset = 0;
+    }
+
+    Record record = {packet.size, 0, packet.pts, WallMicros()};
+    uint8_t *dst = base_ + offset;
+    memcpy(dst, &record, sizeof(record));
+    memcpy(dst + sizeof(Record) + defs::kBufPrependSize,
+           packet.buffer.get() + packet.prepend_size, packet.size);
+
+    // 同一帧的多个IDR slice只建一个关键帧
+    if (packet.type == NALU_TYPE_IDR) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (keyframes_.empty() || keyframes_.back().pts != packet.pts) {
+            keyframes_.push_back({head, packet.pts, record.wall_us});
+        }
+    }
+
+    head_.store(head + need, std::memory_order_release);
+}
+
+TimeShiftBuffer::ReadResult TimeShiftBuffer::Read(uint64_t position,
+                                                  bool share, AVPacket *packet,
+                                                  uint64_t *next) const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (true) {
+        if (position >= head) {
+            return ReadResult::kEmpty;
+        }
+        if (position < tail_.load(std::memory_order_acquire)) {
+            return ReadResult::kOverrun;
+        }
+
+        size_t offset = position % capacity_;
+        size_t remain = capacity_ - offset;
+        Record record;
+        if (remain >= sizeof(Record)) {
+            memcpy(&record, base_ + offset, sizeof(record));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (position < tail_.load(std::memory_order_relaxed)) {
+            return ReadResult::kOverrun;
+        }
+        if (remain < sizeof(Record) || record.size == kPadding) {
+            position += remain;
+            continue;
+        }
+
+        size_t total = RecordSize(record.size);
+        if (total > remain) {
+            // 头部已被覆盖成了其他数据
+            return ReadResult::kOverrun;
+        }
+
+        uint8_t *data = base_ + offset + sizeof(Record);
+        AVPacket result;
+        result.prepend_size = defs::kBufPrependSize;
+        result.size = record.size;
+        result.pts = record.pts;
+        if (share) {
+            // 与缓冲共用生命周期，直接指向映射区
+            result.buffer = std::shared_ptr<uint8_t[]>(shared_from_this(),
+                                                       data);
+        } else {
+            result.buffer.reset(new uint8_t[defs::kBufPrependSize +
+                                            record.size]);
+            memcpy(result.buffer.get() + defs::kBufPrependSize,
+                   data + defs::kBufPrependSize, record.size);
+        }
+        result.type = result.buffer[defs::kBufPrependSize] & 0x1F;
+
+        // 拷贝期间被覆盖则作废
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (position < tail_.load(std::memory_order_relaxed)) {
+            return ReadResult::kOverrun;
+        }
+
+        *packet = result;
+        *next = position + total;
+        return ReadResult::kOk;
+    }
+}
+
+bool TimeShiftBuffer::FindKeyFrame(int64_t wall_us, KeyFrame *key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keyframes_.empty()) {
+        return false;
+    }
+    auto it = std::upper_bound(
+        keyframes_.begin(), keyframes_.end(), wall_us,
+        [](int64_t t, const KeyFrame &k) { return t < k.wall_us; });
+    *key = it == keyframes_.begin() ? *it : *(it - 1);
+    return true;
+}
+
+AVPacket TimeShiftBuffer::CopyParameterSet(const AVPacket &packet) {
+    AVPacket copy = packet;
+    if (packet.buffer) {
+        copy.buffer.reset(new uint8_t[packet.prepend_size + packet.size]);
+        memcpy(copy.buffer.get() + packet.prepend_size,
+               packet.buffer.get() + packet.prepend_size, packet.size);
+    }
+    return copy;
+}
+
+void TimeShiftBuffer::GetParameterSets(AVPacket *sps, AVPacket *pps) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *sps = CopyParameterSet(sps_);
+    *pps = CopyParameterSet(pps_);
+}
+
+double TimeShiftBuffer::Duration() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keyframes_.empty()) {
+        return 0;
+    }
+    return (WallMicros() - keyframes_.front().wall_us) / 1000000.0;
+}
+
+} // namespace muduo_media
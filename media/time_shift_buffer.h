@@ -0,0 +1,109 @@
+#ifndef AA4D6A1B_F711_48C0_8408_BFF5693733FA
+#define AA4D6A1B_F711_48C0_8408_BFF5693733FA
+
+#include "av_packet.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace muduo_media {
+
+/**
+ * @brief 直播时移(DVR)用的环形缓冲，一路直播一个，所有观看者共享
+ *
+ * 发布者loop把每个NALU追加到mmap的文件(已unlink)上，内存占用只取决于
+ * 环的大小，与时移观看者的数量无关。写满后覆盖最旧的记录，关键帧索引
+ * 同步淘汰。
+ *
+ * 观看者各自只保存一个位置(单调递增的绝对偏移)。在发布者loop上读取时
+ * AVPacket直接指向映射区，不拷贝；其他loop上读取时拷贝一份，因为sink会
+ * 在前置空间里写RTP头，与LiveStreamHub的规则相同。读取后检查该位置是否
+ * 已被覆盖，落后太多的观看者得到kOverrun，由调用方跳到最旧的关键帧。
+ *
+ * 记录布局: Record头 + defs::kBufPrependSize前置空间 + NALU，8字节对齐，
+ * 不跨越环尾，环尾放不下时跳到环首。
+ */
+class TimeShiftBuffer : public std::enable_shared_from_this<TimeShiftBuffer> {
+public:
+    enum class ReadResult { kOk, kEmpty, kOverrun };
+
+    struct KeyFrame {
+        uint64_t position;
+        int64_t pts;
+        int64_t wall_us; // 写入时的系统时间(us)
+    };
+
+    ~TimeShiftBuffer();
+
+    /// 在directory下建立capacity字节的环，失败返回nullptr
+    static std::shared_ptr<TimeShiftBuffer>
+    Create(size_t capacity, const std::string &directory = "/tmp");
+
+    /// 由发布者loop调用
+    void Write(const AVPacket &packet);
+
+    /// 读取position处的NALU，next返回下一条记录的位置。share为true时
+    /// 必须在发布者loop中调用
+    ReadResult Read(uint64_t position, bool share, AVPacket *packet,
+                    uint64_t *next) const;
+
+    /// 系统时间wall_us之前(含)最近的关键帧，比缓冲中所有关键帧都早时返回
+    /// 最旧的一个。没有关键帧时返回false
+    bool FindKeyFrame(int64_t wall_us, KeyFrame *key) const;
+
+    /// 最近的SPS/PPS，从关键帧开始读取时先发送。总是返回拷贝
+    void GetParameterSets(AVPacket *sps, AVPacket *pps) const;
+
+    size_t capacity() const { return capacity_; }
+    /// 缓冲中最旧的关键帧之后的时长(秒)
+    double Duration() const;
+
+    /// 当前系统时间(us)，与KeyFrame::wall_us同一时钟
+    static int64_t WallMicros();
+
+private:
+    struct Record {
+        uint32_t size; // NALU长度，kPadding表示跳到环首
+        uint32_t reserved;
+        int64_t pts;
+        int64_t wall_us;
+    };
+
+    static constexpr uint32_t kPadding = 0xFFFFFFFF;
+
+    TimeShiftBuffer(uint8_t *base, size_t capacity);
+
+    static size_t RecordSize(uint32_t size);
+
+    // 写入方使用，position处必须是有效记录
+    uint64_t NextRecord(uint64_t position) const;
+
+    // 淘汰记录，直到[tail_, end)不超过capacity_
+    void Reclaim(uint64_t end);
+
+    static AVPacket CopyParameterSet(const AVPacket &packet);
+
+private:
+    uint8_t *const base_;
+    const size_t capacity_;
+
+    std::atomic<uint64_t> head_; // 下一条记录的位置
+    std::atomic<uint64_t> tail_; // 最旧的有效记录
+
+    // 保护关键帧索引和参数集，只在写入关键帧和定位时加锁
+    mutable std::mutex mutex_;
+    std::deque<KeyFrame> keyframes_;
+    AVPacket sps_;
+    AVPacket pps_;
+};
+
+using TimeShiftBufferPtr = std::shared_ptr<TimeShiftBuffer>;
+
+} // namespace muduo_media
+
+#endif /* AA4D6A1B_F711_48C0_8408_BFF5693733FA */
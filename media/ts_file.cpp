@@ -0,0 +1,141 @@
+#include "ts_file.h"
+#include "media_log.h"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muduo_media {
+
+TsFile::TsFile()
+    : mapping_(nullptr),
+      mapping_size_(0),
+      sync_offset_(0),
+      packet_count_(0),
+      pcr_pid_(0),
+      first_pcr_index_(0),
+      first_pcr_(0),
+      duration_(0) {}
+
+TsFile::~TsFile() {
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+    }
+}
+
+std::shared_ptr<TsFile> TsFile::Open(const std::string &filename) {
+    int fd = ::open(filename.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR << "open " << filename << " fail, errno " << errno;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (size_t)st.st_size < kTsPacketSize) {
+        ::close(fd);
+        LOG_WARN << filename << " too short";
+        return nullptr;
+    }
+
+    size_t length = st.st_size;
+    void *addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOG_ERROR << "mmap " << filename << " fail, errno " << errno;
+        return nullptr;
+    }
+    // 发送时顺序读取
+    ::madvise(addr, length, MADV_SEQUENTIAL);
+
+    // 之后由file负责munmap
+    std::shared_ptr<TsFile> file(new TsFile);
+    file->filename_ = filename;
+    file->mapping_ = addr;
+    file->mapping_size_ = length;
+
+    if (!file->Parse()) {
+        return nullptr;
+    }
+    return file;
+}
+
+bool TsFile::Parse() {
+    // 开头可能有残缺的包，连续三个同步字节才算对齐
+    const uint8_t *data = (const uint8_t *)mapping_;
+    size_t offset = 0;
+    for (; offset < kTsPacketSize; ++offset) {
+        size_t n = 0;
+        while (n < 3 && offset + n * kTsPacketSize < mapping_size_ &&
+               data[offset + n * kTsPacketSize] == kTsSyncByte) {
+            ++n;
+        }
+        if (n == 3 || (n > 0 && offset + n * kTsPacketSize >= mapping_size_)) {
+            break;
+        }
+    }
+    if (offset == kTsPacketSize) {
+        LOG_WARN << filename_ << " no TS sync byte";
+        return false;
+    }
+    sync_offset_ = offset;
+    packet_count_ = (mapping_size_ - offset) / kTsPacketSize;
+
+    uint16_t pid = 0;
+    size_t index = 0;
+    for (; index < packet_count_; ++index) {
+        if (ReadPcr(index, &pid, &first_pcr_)) {
+            break;
+        }
+    }
+    if (index == packet_count_) {
+        LOG_WARN << filename_ << " no PCR";
+        return false;
+    }
+    pcr_pid_ = pid;
+    first_pcr_index_ = index;
+
+    // 从结尾向前找最后一个PCR
+    int64_t last_pcr = first_pcr_;
+    for (size_t i = packet_count_; i-- > first_pcr_index_;) {
+        int64_t pcr = 0;
+        if (ReadPcr(i, &pid, &pcr) && pid == pcr_pid_) {
+            last_pcr = pcr;
+            break;
+        }
+    }
+    duration_ = ((last_pcr - first_pcr_) & kPcrMask) / 90000.0;
+
+    LOG_INFO << filename_ << " TS packets " << packet_count_ << ", PCR PID "
+             << pcr_pid_ << ", duration " << duration_ << "s";
+    return true;
+}
+
+bool TsFile::ReadPcr(size_t index, uint16_t *pid, int64_t *pcr) const {
+    // sync | TEI PUSI prio PID(13) | scrambling afc(2) cc | af_length | flags
+    const uint8_t *p = packet(index);
+    if (p[0] != kTsSyncByte || !(p[3] & 0x20) || p[4] < 7 ||
+        !(p[5] & 0x10)) {
+        return false;
+    }
+
+    *pid = ((p[1] & 0x1F) << 8) | p[2];
+    *pcr = ((int64_t)p[6] << 25) | ((int64_t)p[7] << 17) |
+           ((int64_t)p[8] << 9) | ((int64_t)p[9] << 1) | (p[10] >> 7);
+    return true;
+}
+
+bool TsFile::FindPcr(size_t index, size_t *pcr_index, int64_t *pcr) const {
+    uint16_t pid = 0;
+    for (; index < packet_count_; ++index) {
+        if (ReadPcr(index, &pid, pcr) && pid == pcr_pid_) {
+            *pcr_index = index;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace muduo_media
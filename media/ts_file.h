@@ -0,0 +1,73 @@
+#ifndef E6813DF0_FB0F_4871_A7DA_47F4AE5A5EC5
+#define E6813DF0_FB0F_4871_A7DA_47F4AE5A5EC5
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace muduo_media {
+
+constexpr size_t kTsPacketSize = 188;
+constexpr uint8_t kTsSyncByte = 0x47;
+constexpr int64_t kPcrMask = (1LL << 33) - 1; // PCR base为33位，90kHz
+
+/**
+ * @brief mmap的MPEG-TS文件
+ *
+ * 不解复用，只认出TS包边界和PCR。打开时只读取首尾的PCR得到时长，发送
+ * 时由源顺序向后查找下一个PCR，整个文件不做预扫描。
+ */
+class TsFile {
+public:
+    ~TsFile();
+
+    /// 找不到同步字节或者没有PCR时返回nullptr
+    static std::shared_ptr<TsFile> Open(const std::string &filename);
+
+    size_t packet_count() const { return packet_count_; }
+
+    const uint8_t *packet(size_t index) const {
+        return (const uint8_t *)mapping_ + sync_offset_ +
+               index * kTsPacketSize;
+    }
+
+    /// 携带PCR的PID，取文件中第一个PCR所在的PID
+    uint16_t pcr_pid() const { return pcr_pid_; }
+
+    size_t first_pcr_index() const { return first_pcr_index_; }
+    int64_t first_pcr() const { return first_pcr_; }
+
+    /// 首尾PCR之差，秒
+    double duration() const { return duration_; }
+
+    /// index(含)之后第一个带PCR的包
+    bool FindPcr(size_t index, size_t *pcr_index, int64_t *pcr) const;
+
+private:
+    TsFile();
+
+    bool Parse();
+
+    // 包中的PCR base及其PID，不带PCR时返回false
+    bool ReadPcr(size_t index, uint16_t *pid, int64_t *pcr) const;
+
+private:
+    std::string filename_;
+    void *mapping_;
+    size_t mapping_size_;
+
+    size_t sync_offset_; // 第一个同步字节的位置
+    size_t packet_count_;
+
+    uint16_t pcr_pid_;
+    size_t first_pcr_index_;
+    int64_t first_pcr_;
+    double duration_;
+};
+
+using TsFilePtr = std::shared_ptr<const TsFile>;
+
+} // namespace muduo_media
+
+#endif /* E6813DF0_FB0F_4871_A7DA_47F4AE5A5EC5 */
@@ -0,0 +1,141 @@
+#include "ts_file_source.h"
+#include "defs.h"
+#include "media_log.h"
+#include "rtp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace muduo_media {
+
+TsFileSource::TsFileSource(const TsFilePtr &file)
+    : file_(file),
+      packet_(0),
+      sent_ticks_(0),
+      begin_index_(0),
+      begin_time_(0),
+      end_index_(0),
+      end_time_(0),
+      end_pcr_(0),
+      rate_(0),
+      pcr_end_(false) {
+    if (file_) {
+        ResetWindow(file_->first_pcr_index(), 0, file_->first_pcr());
+    }
+}
+
+TsFileSource::~TsFileSource() {}
+
+void TsFileSource::ResetWindow(size_t index, double time, int64_t pcr) {
+    begin_index_ = end_index_ = index;
+    begin_time_ = end_time_ = time;
+    end_pcr_ = pcr;
+    pcr_end_ = false;
+}
+
+bool TsFileSource::AdvanceWindow() {
+    size_t index = 0;
+    int64_t pcr = 0;
+    if (!file_->FindPcr(end_index_ + 1, &index, &pcr)) {
+        pcr_end_ = true;
+        return false;
+    }
+
+    // 33位回绕后仍然为正
+    int64_t delta = (pcr - end_pcr_) & kPcrMask;
+    double elapsed = (double)delta;
+    if (delta > kMaxPcrGap) {
+        LOG_WARN << "PCR discontinuity at packet " << index << ", delta "
+                 << delta;
+        elapsed = rate_ * (index - end_index_);
+    }
+
+    begin_index_ = end_index_;
+    begin_time_ = end_time_;
+    end_index_ = index;
+    end_time_ += elapsed;
+    end_pcr_ = pcr;
+    rate_ = (end_time_ - begin_time_) / (end_index_ - begin_index_);
+    return true;
+}
+
+double TsFileSource::PacketTime(size_t index) {
+    while (index > end_index_ && !pcr_end_) {
+        AdvanceWindow();
+    }
+
+    // 第一个PCR之前的包立即发送
+    if (index <= begin_index_) {
+        return begin_time_;
+    }
+    if (index <= end_index_) {
+        return begin_time_ + rate_ * (index - begin_index_);
+    }
+    return end_time_ + rate_ * (index - end_index_);
+}
+
+bool TsFileSource::GetNextFrame(AVPacket *packet) {
+    if (!file_ || packet_ >= file_->packet_count()) {
+        return false;
+    }
+
+    size_t count = std::min<size_t>(RTP_MP2T_TS_PACKETS,
+                                    file_->packet_count() - packet_);
+    size_t size = count * kTsPacketSize;
+
+    // 不解析内容，只在前面留出RTP头的空间
+    std::shared_ptr<uint8_t[]> buffer(
+        new uint8_t[defs::kBufPrependSize + size]);
+    memcpy(buffer.get() + defs::kBufPrependSize, file_->packet(packet_), size);
+    packet_ += count;
+
+    // 按整数时钟累计，插值的小数部分不会积累成漂移。至少一个时钟周期，
+    // 没有PCR的一段也不会一次发完
+    int64_t next = std::llround(PacketTime(packet_));
+    uint32_t span = next > sent_ticks_ ? (uint32_t)(next - sent_ticks_) : 1;
+    sent_ticks_ += span;
+
+    packet->buffer = buffer;
+    packet->prepend_size = defs::kBufPrependSize;
+    packet->size = size;
+    packet->type = 0;
+    packet->frame_span = span;
+    packet->composition_offset = 0;
+    return true;
+}
+
+bool TsFileSource::Seek(double npt, double *start_npt) {
+    if (!file_ || npt < 0) {
+        return false;
+    }
+
+    // 包序号越大PCR越大，找最后一个不超过target的PCR。每次探测只向后
+    // 扫描到下一个PCR
+    int64_t target = (int64_t)(npt * 90000);
+    size_t index = 0;
+    int64_t pcr = 0;
+    size_t lo = file_->first_pcr_index();
+    size_t hi = file_->packet_count();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (file_->FindPcr(mid, &index, &pcr) &&
+            ((pcr - file_->first_pcr()) & kPcrMask) <= target) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    if (!file_->FindPcr(lo, &index, &pcr)) {
+        return false;
+    }
+
+    int64_t time = (pcr - file_->first_pcr()) & kPcrMask;
+    ResetWindow(index, (double)time, pcr);
+    packet_ = index;
+    sent_ticks_ = time;
+    *start_npt = time / 90000.0;
+    return true;
+}
+
+} // namespace muduo_media
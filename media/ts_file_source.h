@@ -0,0 +1,56 @@
+#ifndef A3C92814_18C0_4718_8D0E_AC239CF1C403
+#define A3C92814_18C0_4718_8D0E_AC239CF1C403
+
+#include "av_packet.h"
+#include "multi_frame_source.h"
+#include "ts_file.h"
+
+namespace muduo_media {
+
+/**
+ * @brief 原样读取TS包，每次取出一个RTP包的载荷(7个TS包)
+ *
+ * 按PCR而不是帧率控制节奏: 相邻两个PCR之间的包按位置线性插值得到发送
+ * 时间。帧间隔为一个90kHz时钟周期，frame_span即到下一组包的时钟数，
+ * RTP时间戳随之推进。PCR跳变(不连续或超过kMaxPcrGap)时沿用上一段的码率。
+ */
+class TsFileSource : public MultiFrameSource {
+public:
+    explicit TsFileSource(const TsFilePtr &file);
+    ~TsFileSource();
+
+    bool GetNextFrame(AVPacket *) override;
+
+    /// 二分查找不超过npt的最近PCR，从该包开始发送
+    bool Seek(double npt, double *start_npt) override;
+
+    static constexpr int64_t kMaxPcrGap = 90000; // 1s
+
+private:
+    // index处的包相对第一个PCR的发送时间，90kHz
+    double PacketTime(size_t index);
+
+    // 找下一个PCR，插值区间向后移动一段
+    bool AdvanceWindow();
+
+    void ResetWindow(size_t index, double time, int64_t pcr);
+
+private:
+    TsFilePtr file_;
+
+    size_t packet_;      // 下一个要发送的包
+    int64_t sent_ticks_; // 已发出的包的总时长
+
+    // 插值区间两端PCR的包序号和时间
+    size_t begin_index_;
+    double begin_time_;
+    size_t end_index_;
+    double end_time_;
+    int64_t end_pcr_; // 区间末端的原始PCR
+    double rate_;     // 每个包的时长
+    bool pcr_end_;    // 后面没有PCR了，按rate_外推
+};
+
+} // namespace muduo_media
+
+#endif /* A3C92814_18C0_4718_8D0E_AC239CF1C403 */
@@ -0,0 +1,58 @@
+#include "ts_file_subsession.h"
+#include "defs.h"
+#include "media_log.h"
+#include "mp2t_rtp_sink.h"
+#include "ts_file_source.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+TsFileSubsession::TsFileSubsession(const std::string &filename)
+    : FileMediaSubsession(filename, 25, 90000) {
+    set_payload_type(defs::kMediaFormatMp2t);
+    set_frame_duration(1);
+}
+
+TsFileSubsession::~TsFileSubsession() {}
+
+void TsFileSubsession::EnsureFile() {
+    std::call_once(file_once_, [this]() { file_ = TsFile::Open(filename_); });
+}
+
+double TsFileSubsession::PlayLength() {
+    EnsureFile();
+    return file_ ? file_->duration() : 0;
+}
+
+std::string TsFileSubsession::GetSdp() {
+    EnsureFile();
+
+    char media_sdp[200] = {0};
+    snprintf(media_sdp, sizeof(media_sdp),
+             "m=video 0 %s %hu\r\n"
+             "a=rtpmap:%hu %s/%u\r\n"
+             "a=control:%s\r\n",
+             defs::kSdpMediaProtocol, payload_type_, payload_type_,
+             defs::kMimeTypeMp2t, time_base_, TrackId().data());
+
+    return std::string(media_sdp);
+}
+
+RtpSinkPtr TsFileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+    int8_t rtp_channel) {
+    return std::make_shared<Mp2tRtpSink>(tcp_conn, rtp_channel);
+}
+
+RtpSinkPtr TsFileSubsession::NewRtpSink(
+    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn) {
+    return std::make_shared<Mp2tRtpSink>(udp_conn);
+}
+
+MultiFrameSourcePtr TsFileSubsession::NewMultiFrameSouce() {
+    EnsureFile();
+    return std::make_shared<TsFileSource>(file_);
+}
+
+} // namespace muduo_media
@@ -0,0 +1,45 @@
+#ifndef DA3D7E15_BED3_42C2_B273_FE141A60C977
+#define DA3D7E15_BED3_42C2_B273_FE141A60C977
+
+#include "file_media_subsession.h"
+#include "ts_file.h"
+
+#include <mutex>
+
+namespace muduo_media {
+
+/// @brief TS文件原样以RFC 2250 MP2T发送，不解复用
+///
+/// 一帧为一个90kHz时钟周期，发送节奏和时间戳由TsFileSource按PCR给出。
+class TsFileSubsession : public FileMediaSubsession {
+
+public:
+    TsFileSubsession(const std::string &filename);
+    ~TsFileSubsession();
+
+    std::string GetSdp() override;
+
+    double PlayLength() override;
+
+    RtpSinkPtr
+    NewRtpSink(const std::shared_ptr<muduo::net::TcpConnection> &tcp_conn,
+               int8_t rtp_channel) override;
+
+    RtpSinkPtr NewRtpSink(
+        const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn)
+        override;
+
+    MultiFrameSourcePtr NewMultiFrameSouce() override;
+
+private:
+    // 首次使用时mmap并读取首尾PCR，之后各源共享
+    void EnsureFile();
+
+private:
+    std::once_flag file_once_;
+    TsFilePtr file_;
+};
+
+} // namespace muduo_media
+
+#endif /* DA3D7E15_BED3_42C2_B273_FE141A60C977 */
@@ -3,14 +3,20 @@
 #include "media/av_packet.h"
 #include "media/defs.h"
 
+#include <algorithm>
 #include <cstring>
 #include <ctime>
 
 namespace muduo_media {
 
-MediaSession::MediaSession(const std::string &path) : name_(path) {}
+MediaSession::MediaSession(const std::string &path)
+    : name_(path), latency_(std::make_shared<LatencyMetrics>()) {
+    MetricsRegistry::Instance().RegisterSession(name_, latency_);
+}
 
-MediaSession::~MediaSession() {}
+MediaSession::~MediaSession() {
+    MetricsRegistry::Instance().UnregisterSession(latency_);
+}
 
 void MediaSession::AddSubsession(const MediaSubsessionPtr &subsession) {
     std::size_t index = subsessions_.size();
@@ -31,6 +37,23 @@ bool MediaSession::SubsessionExists(const std::string &track) {
     return subsessions_.find(track) != subsessions_.end();
 }
 
+size_t MediaSession::MemoryBytes() {
+    size_t bytes = 0;
+    for (auto &&i : subsessions_) {
+        bytes += i.second->MemoryBytes();
+    }
+    return bytes;
+}
+
+bool MediaSession::HasStreams() const {
+    for (auto &&i : subsessions_) {
+        if (i.second.use_count() > 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
 std::string MediaSession::GetMethodsAsString() {
     std::string methods("OPTIONS, DESCRIBE, SETUP, TRARDOWN, PLAY");
     return methods;
@@ -41,15 +64,41 @@ std::string MediaSession::BuildSdp() {
     // TODO:
     std::string ip = "0.0.0.0";
 
-    char session_sdp[100] = {0};
+    // 有直播轨道时为now-。点播取最长的时长，有轨道时长还未知(如索引在
+    // 后台建立)时不写结束位置
+    bool live = false;
+    double length = 0;
+    for (auto &&i : subsessions_) {
+        if (i.second->IsLive()) {
+            live = true;
+            break;
+        }
+        double track_length = i.second->PlayLength();
+        if (track_length <= 0 || length < 0) {
+            length = -1;
+        } else {
+            length = std::max(length, track_length);
+        }
+    }
+
+    char range[40] = {0};
+    if (live) {
+        snprintf(range, sizeof(range), "npt=now-");
+    } else if (length > 0) {
+        snprintf(range, sizeof(range), "npt=0-%.3f", length);
+    } else {
+        snprintf(range, sizeof(range), "npt=0-");
+    }
+
+    char session_sdp[160] = {0};
     snprintf(session_sdp, sizeof(session_sdp),
              "v=0\r\n"
              "o=- 9%ld 1 IN IP4 %s\r\n"
              "s=%s\r\n"
              "t=0 0\r\n"
              "a=control:*\r\n"
-             "a=range:npt=now-\r\n",
-             (long)std::time(NULL), ip.data(), defs::kAppName);
+             "a=range:%s\r\n",
+             (long)std::time(NULL), ip.data(), defs::kAppName, range);
 
     std::string data(session_sdp);
 
@@ -3,6 +3,7 @@
 
 #include "eventloop/event_loop.h"
 #include "media/media_subsession.h"
+#include "media/metrics.h"
 
 #include <map>
 #include <memory>
@@ -27,8 +28,18 @@ public:
 
     std::string BuildSdp();
 
+    // 各轨道索引等常驻数据之和
+    size_t MemoryBytes();
+
+    // 是否有流正在使用某个轨道(流持有MediaSubsession)
+    bool HasStreams() const;
+
+    // 所有loop上属于本会话的流共用
+    const LatencyMetricsPtr &latency() const { return latency_; }
+
 private:
     std::string name_;
+    LatencyMetricsPtr latency_;
     std::map<std::string, std::shared_ptr<MediaSubsession>> subsessions_;
 };
 
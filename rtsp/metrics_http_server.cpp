@@ -0,0 +1,94 @@
+#include "metrics_http_server.h"
+#include "media/media_log.h"
+#include "media/metrics.h"
+#include "net/buffer.h"
+#include "net/tcp_server.h"
+
+#include <cstring>
+
+namespace muduo_media {
+
+static constexpr size_t kMaxRequestSize = 8192;
+
+MetricsHttpServer::MetricsHttpServer(
+    const muduo::net::InetAddress &listen_addr)
+    : listen_addr_(listen_addr), loop_(nullptr) {}
+
+MetricsHttpServer::~MetricsHttpServer() { Stop(); }
+
+void MetricsHttpServer::Start() {
+    thread_ = std::thread(&MetricsHttpServer::ThreadFunc, this);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return loop_ != nullptr; });
+}
+
+void MetricsHttpServer::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (loop_) {
+            loop_->Quit();
+        }
+    }
+    thread_.join();
+}
+
+void MetricsHttpServer::ThreadFunc() {
+    muduo::event_loop::EventLoop loop;
+    muduo::net::TcpServer server(&loop, listen_addr_, "MetricsHttpServer");
+    server.set_message_callback(
+        std::bind(&MetricsHttpServer::OnMessage, this, std::placeholders::_1,
+                  std::placeholders::_2, std::placeholders::_3));
+    server.Start();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loop_ = &loop;
+    }
+    cond_.notify_one();
+
+    LOG_INFO << "metrics listening on " << listen_addr_.IpPort();
+    loop.Loop();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    loop_ = nullptr;
+}
+
+void MetricsHttpServer::OnMessage(const muduo::net::TcpConnectionPtr &conn,
+                                  muduo::net::Buffer *buf,
+                                  muduo::event_loop::Timestamp timestamp) {
+    // 只需要请求行，等请求头收齐后一次应答并关闭
+    const char *begin = buf->Peek();
+    size_t size = buf->ReadableBytes();
+    const char *end = (const char *)memmem(begin, size, "\r\n\r\n", 4);
+    if (!end) {
+        if (size > kMaxRequestSize) {
+            conn->Shutdown();
+        }
+        return;
+    }
+
+    std::string response;
+    if (size >= 13 && (strncmp(begin, "GET /metrics ", 13) == 0 ||
+                       strncmp(begin, "GET /metrics?", 13) == 0)) {
+        std::string body = MetricsRegistry::Instance().RenderPrometheus();
+        response = "HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/plain; version=0.0.4\r\n"
+                   "Connection: close\r\n"
+                   "Content-Length: " +
+                   std::to_string(body.size()) + "\r\n\r\n" + body;
+    } else {
+        response = "HTTP/1.1 404 Not Found\r\n"
+                   "Connection: close\r\n"
+                   "Content-Length: 0\r\n\r\n";
+    }
+    buf->RetrieveAll();
+
+    conn->Send(response);
+    conn->Shutdown();
+}
+
+} // namespace muduo_media
@@ -0,0 +1,43 @@
+#ifndef A83D5E2C_47B1_4F9A_B60E_1C9F2D74E5A3
+#define A83D5E2C_47B1_4F9A_B60E_1C9F2D74E5A3
+
+#include "eventloop/event_loop.h"
+#include "net/inet_address.h"
+#include "net/tcp_connection.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace muduo_media {
+
+/// @brief 在独立线程和loop上提供 GET /metrics
+///
+/// 采集只读取各loop的原子计数，不向媒体loop投递任务。
+class MetricsHttpServer {
+public:
+    explicit MetricsHttpServer(const muduo::net::InetAddress &listen_addr);
+    ~MetricsHttpServer();
+
+    void Start();
+    void Stop();
+
+private:
+    void ThreadFunc();
+
+    void OnMessage(const muduo::net::TcpConnectionPtr &conn,
+                   muduo::net::Buffer *buf,
+                   muduo::event_loop::Timestamp timestamp);
+
+private:
+    muduo::net::InetAddress listen_addr_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    muduo::event_loop::EventLoop *loop_;
+};
+
+} // namespace muduo_media
+
+#endif /* A83D5E2C_47B1_4F9A_B60E_1C9F2D74E5A3 */
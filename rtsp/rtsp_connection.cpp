@@ -1,14 +1,22 @@
 #include "rtsp_connection.h"
 #include "eventloop/endian.h"
 #include "logger/log_stream.h"
-#include "logger/logger.h"
+#include "media/h264_live_subsession.h"
+#include "media/media_log.h"
 #include "media/rtcp.h"
+#include "media/time_shift_buffer.h"
 #include "media_session.h"
 #include "net/tcp_connection.h"
 #include "rtsp_session.h"
+#include "sdp_parser.h"
 
 #include "utils.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <strings.h>
+
 namespace muduo_media {
 
 static const char kRtspUrlPrefix[] = "rtsp://";
@@ -25,6 +33,13 @@ static_assert(strlen(kRtspCSeq) == kRtspCSeqLen);
 
 static constexpr int kRtspPort = 554;
 
+// 请求头加SDP消息体的上限，超过仍不完整则断开
+static constexpr size_t kMaxRtspMessageSize = 64 * 1024;
+
+// 没有对应MediaSession时OPTIONS返回的方法，推流客户端会先发OPTIONS
+static const char kRtspPublicMethods[] =
+    "OPTIONS, DESCRIBE, SETUP, TEARDOWN, PLAY, ANNOUNCE, RECORD";
+
 /************************ logger helper ***************************/
 inline muduo::log::LogStream &operator<<(muduo::log::LogStream &s,
                                          RtspStatusCode code) {
@@ -47,12 +62,16 @@ RtspConnection::RtspConnection(const muduo::net::TcpConnectionPtr &conn,
       get_media_session_callback_(cb),
       next_type_(kMessageNone),
       next_ilframe_({0, 0}),
+      gop_cache_bytes_(LiveStreamHub::kDefaultGopCacheBytes),
+      time_shift_bytes_(0),
       rtp_transport_(RtpTransProto::kRtpTransportNone) {
 
     // 消息回调最迟要在tcp connection before_reading_callback 中来设置
     tcp_conn_->set_message_callback(
         std::bind(&RtspConnection::OnMessage, this, std::placeholders::_1,
                   std::placeholders::_2, std::placeholders::_3));
+    tcp_conn_->set_write_complete_callback(std::bind(
+        &RtspConnection::OnWriteComplete, this, std::placeholders::_1));
 
     LOG_DEBUG << "RtspConnection::ctor[" << tcp_conn_->name() << "] at "
               << this;
@@ -62,6 +81,7 @@ RtspConnection::~RtspConnection() {
     LOG_DEBUG << "RtspConnection::dtor[" << tcp_conn_->name() << "] at "
               << this;
 
+    Unpublish();
     tcp_conn_.reset();
     rtsp_session_.reset();
 }
@@ -72,61 +92,89 @@ void RtspConnection::OnMessage(const muduo::net::TcpConnectionPtr conn,
 
     LOG_TRACE << "available bytes " << buf->ReadableBytes();
 
-    std::string data = buf->TryRetrieveAllAsString();
-    LOG_TRACE << "try receive data [" << data << "]";
+    // 一次读取可能包含多个交织帧或请求，全部处理完再返回
+    while (buf->ReadableBytes() > 0) {
+        auto data_ptr = buf->Peek();
 
-    auto data_ptr = buf->Peek();
-    if (*data_ptr == defs::kRtspInterleavedFrameMagic) {
-        if (buf->ReadableBytes() < sizeof(RtspInterleavedFrame)) {
-            LOG_WARN << "RTSP Interleaved Frame packet size must be >="
-                     << sizeof(RtspInterleavedFrame);
-            // 继续接收数据
-            return;
-        } else {
-            LOG_TRACE << "parse RTSP Interleaved Frame";
+        if (kMessageILFrame == next_type_) {
+            if (buf->ReadableBytes() < next_ilframe_.length)
+                return;
+
+            LOG_TRACE << "parse RTSP Interleaved Frame body size "
+                      << next_ilframe_.length;
+            if (rtsp_session_) {
+                rtsp_session_->ParseTcpInterleavedFrameBody(
+                    next_ilframe_.channel, data_ptr, next_ilframe_.length);
+            }
+            buf->Retrieve(next_ilframe_.length);
+            next_ilframe_.Reset();
+            next_type_ = kMessageNone;
+            continue;
+        }
+
+        if (*data_ptr == defs::kRtspInterleavedFrameMagic) {
+            if (buf->ReadableBytes() < sizeof(RtspInterleavedFrame)) {
+                // 继续接收数据
+                return;
+            }
             ParseInterleavedFrameHead(data_ptr, sizeof(RtspInterleavedFrame));
             buf->Retrieve(sizeof(RtspInterleavedFrame));
-            return;
+            continue;
         }
-    } else if (kMessageILFrame == next_type_) {
-        if (buf->ReadableBytes() < next_ilframe_.length)
+
+        size_t header_size = 0;
+        size_t message_size =
+            RtspMessageSize(data_ptr, buf->ReadableBytes(), &header_size);
+        if (0 == message_size) {
+            if (buf->ReadableBytes() > kMaxRtspMessageSize) {
+                LOG_ERROR << "rtsp request too large from "
+                          << conn->peer_addr().IpPort();
+                buf->RetrieveAll();
+                conn->Shutdown();
+            }
+            // 等待完整的请求
             return;
+        }
 
-        LOG_TRACE << "parse RTSP Interleaved Frame body size "
-                  << next_ilframe_.length;
-        rtsp_session_->ParseTcpInterleavedFrameBody(
-            next_ilframe_.channel, data_ptr, next_ilframe_.length);
-        buf->Retrieve(next_ilframe_.length);
-        LOG_TRACE << "retrieve " << next_ilframe_.length;
-        next_ilframe_.Reset();
-        next_type_ = kMessageNone;
-        return;
+        // 请求头单独拷出，处理函数按行读取时不会越过本条请求
+        muduo::net::Buffer request;
+        request.Append(data_ptr, header_size);
+        std::string body(data_ptr + header_size, message_size - header_size);
+        buf->Retrieve(message_size);
+
+        HandleRequest(conn, &request, body);
     }
+}
 
+void RtspConnection::HandleRequest(const muduo::net::TcpConnectionPtr &conn,
+                                   muduo::net::Buffer *buf,
+                                   const std::string &body) {
     // Request line 与 CSeq之间可能存在数据——ffmpeg请求会有这个问题。
     std::vector<std::string> gap_lines;
 
-    std::shared_ptr<RtspRequestHead> request_head =
-        ParseRequestHead(buf, gap_lines);
-
-    if (!request_head) {
+    RtspRequestHead request_head;
+    if (!ParseRequestHead(buf, gap_lines, &request_head)) {
         LOG_ERROR << "parse rtsp request header fail";
         conn->Shutdown();
         return;
     }
 
-    if (request_head->method == RtspMethod::OPTIONS) {
+    if (request_head.method == RtspMethod::OPTIONS) {
         HandleMethodOptions(buf, request_head);
-    } else if (request_head->method == RtspMethod::DESCRIBE) {
+    } else if (request_head.method == RtspMethod::DESCRIBE) {
         HandleMethodDescribe(buf, request_head, gap_lines);
-    } else if (request_head->method == RtspMethod::SETUP) {
+    } else if (request_head.method == RtspMethod::SETUP) {
         HandleMethodSetup(buf, request_head, gap_lines);
-    } else if (request_head->method == RtspMethod::PLAY) {
+    } else if (request_head.method == RtspMethod::PLAY) {
         HandleMethodPlay(buf, request_head);
-    } else if (request_head->method == RtspMethod::TEARDOWN) {
+    } else if (request_head.method == RtspMethod::TEARDOWN) {
         HandleMethodTeardown(buf, request_head);
+    } else if (request_head.method == RtspMethod::ANNOUNCE) {
+        HandleMethodAnnounce(buf, request_head, gap_lines, body);
+    } else if (request_head.method == RtspMethod::RECORD) {
+        HandleMethodRecord(buf, request_head);
     } else {
-        LOG_ERROR << "unhandled method " << request_head->method;
+        LOG_ERROR << "unhandled method " << request_head.method;
     }
 
     if (buf->ReadableBytes() > 0) {
@@ -136,58 +184,100 @@ void RtspConnection::OnMessage(const muduo::net::TcpConnectionPtr conn,
     }
 }
 
-std::shared_ptr<RtspRequestHead>
-RtspConnection::ParseRequestHead(muduo::net::Buffer *buf,
-                                 std::vector<std::string> &gap_lines) {
+void RtspConnection::OnWriteComplete(
+    const muduo::net::TcpConnectionPtr &conn) {
+    if (rtsp_session_) {
+        rtsp_session_->OnWriteComplete();
+    }
+}
+
+size_t RtspConnection::RtspMessageSize(const char *data, size_t size,
+                                       size_t *header_size) {
+    static const char kHeaderEnd[] = "\r\n\r\n";
+    static const char kContentLength[] = "Content-Length:";
+
+    const char *end = data + size;
+    const char *header_end =
+        std::search(data, end, kHeaderEnd, kHeaderEnd + 4);
+    if (header_end == end) {
+        return 0;
+    }
+    *header_size = header_end + 4 - data;
+
+    // 逐行查找Content-Length，不区分大小写
+    size_t content_length = 0;
+    const char *line = data;
+    while (line < header_end) {
+        const char *line_end = std::search(line, header_end + 2,
+                                           kHeaderEnd, kHeaderEnd + 2);
+        size_t len = sizeof(kContentLength) - 1;
+        if ((size_t)(line_end - line) > len &&
+            strncasecmp(line, kContentLength, len) == 0) {
+            content_length = strtoul(line + len, nullptr, 10);
+            break;
+        }
+        line = line_end + 2;
+    }
+
+    if (*header_size + content_length > size) {
+        return 0;
+    }
+    return *header_size + content_length;
+}
+
+bool RtspConnection::ParseRequestHead(muduo::net::Buffer *buf,
+                                      std::vector<std::string> &gap_lines,
+                                      RtspRequestHead *req_head) {
     const char *first_crlf = buf->FindCRLF();
     if (first_crlf) {
         char method[32] = {0};
-        char url[256] = {0};
+        char url[640] = {0};
         char version[16] = {0};
 
-        if (sscanf(buf->Peek(), "%s %s %s", method, url, version) != 3) {
+        if (sscanf(buf->Peek(), "%31s %639s %15s", method, url, version) !=
+            3) {
             LOG_ERROR << "Invalid RTSP reques line data";
-            return nullptr;
+            return false;
         }
 
         if (strncmp(url, kRtspUrlPrefix, kRtspUrlPrefixLen) != 0) {
             LOG_ERROR << "rtsp url " << url << " does not start with rtsp://";
-            return nullptr;
+            return false;
         }
 
         if (strncmp(version, kRtspVersion, kRtspVersionLen) != 0) {
             LOG_ERROR << "unsupported rtsp version " << version;
-            return nullptr;
+            return false;
         }
 
         auto rtsp_method = StringToRtspMethod(method);
         if (rtsp_method == RtspMethod::NONE) {
             LOG_ERROR << "unknown method " << method;
-            return nullptr;
+            return false;
         }
 
-        std::shared_ptr<RtspRequestHead> req_head(new RtspRequestHead());
         req_head->method = rtsp_method;
         req_head->version.assign(version);
         req_head->url.entire = url;
 
         uint16_t port = 0;
         char host[64] = {0};
-        char suffix[128] = {0};
+        // 点播目录的路径可能较深
+        char suffix[512] = {0};
 
         char *s_point = url + strlen(kRtspUrlPrefix);
-        if (sscanf(s_point, "%[^:]:%hu/%s", host, &port, suffix) == 3) {
+        if (sscanf(s_point, "%63[^:/]:%hu/%511s", host, &port, suffix) == 3) {
             req_head->url.host = host;
             req_head->url.port = port;
             req_head->url.session = suffix;
-        } else if (sscanf(s_point, "%[^/]/%s", host, suffix) == 2) {
+        } else if (sscanf(s_point, "%63[^/]/%511s", host, suffix) == 2) {
             req_head->url.host = host;
             req_head->url.port = kRtspPort;
             req_head->url.session = suffix;
             port = 554;
         } else {
             LOG_ERROR << "analyze rtsp " << url << " fail ";
-            return nullptr;
+            return false;
         }
 
         // 第一行处理完毕
@@ -212,13 +302,13 @@ RtspConnection::ParseRequestHead(muduo::net::Buffer *buf,
 
         if (req_head->cseq == 0) {
             LOG_ERROR << "parse CSeq fail";
-            return nullptr;
+            return false;
         } else {
             LOG_INFO << "CSeq: " << req_head->cseq;
-            return req_head;
+            return true;
         }
     } else {
-        return nullptr;
+        return false;
     }
 }
 
@@ -227,18 +317,25 @@ void RtspConnection::DiscardAllData(muduo::net::Buffer *buf) {
     LOG_DEBUG << "discard left data: " << left_data;
 }
 
-void RtspConnection::HandleMethodOptions(
-    muduo::net::Buffer *buf, const std::shared_ptr<RtspRequestHead> &head) {
+void RtspConnection::HandleMethodOptions(muduo::net::Buffer *buf,
+                                         const RtspRequestHead &head) {
 
     RtspResponseHead resp_head;
-    resp_head.version = head->version;
-    resp_head.cseq = head->cseq;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
 
-    auto session = get_media_session_callback_(head->url.session);
+    std::string methods;
+    auto session = get_media_session_callback_(head.url.session);
     if (session) {
         active_media_session_ = session;
         media_session_name_ = session->name();
+        methods = session->GetMethodsAsString();
+    } else if (publish_media_session_callback_) {
+        // 推流客户端在ANNOUNCE之前询问
+        methods = kRtspPublicMethods;
+    }
 
+    if (!methods.empty()) {
         resp_head.code = RtspStatusCode::OK;
 
         char send_buf[200] = {0};
@@ -250,7 +347,7 @@ void RtspConnection::HandleMethodOptions(
                      "\r\n",
                      resp_head.version.data(), (int)resp_head.code,
                      RtspStatusCodeToString(resp_head.code), resp_head.cseq,
-                     session->GetMethodsAsString().data());
+                     methods.data());
 
         SendResponse(send_buf, data_size);
     } else {
@@ -260,12 +357,12 @@ void RtspConnection::HandleMethodOptions(
 }
 
 void RtspConnection::HandleMethodDescribe(
-    muduo::net::Buffer *buf, const std::shared_ptr<RtspRequestHead> &head,
+    muduo::net::Buffer *buf, const RtspRequestHead &head,
     const std::vector<std::string> &gap_lines) {
 
     // 如果没有执行OPTIONS
     if (active_media_session_.expired()) {
-        auto session = get_media_session_callback_(head->url.session);
+        auto session = get_media_session_callback_(head.url.session);
         if (session) {
             active_media_session_ = session;
             media_session_name_ = session->name();
@@ -293,8 +390,8 @@ void RtspConnection::HandleMethodDescribe(
     }
 
     RtspResponseHead resp_head;
-    resp_head.version = head->version;
-    resp_head.cseq = head->cseq;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
 
     if (accept_application_type != defs::kRtspApplicationSdp) {
         resp_head.code = RtspStatusCode::UnsupportedMediaType;
@@ -328,20 +425,20 @@ void RtspConnection::HandleMethodDescribe(
 }
 
 void RtspConnection::HandleMethodSetup(
-    muduo::net::Buffer *buf, const std::shared_ptr<RtspRequestHead> &head,
+    muduo::net::Buffer *buf, const RtspRequestHead &head,
     const std::vector<std::string> &gap_lines) {
 
     RtspResponseHead resp_head;
-    resp_head.version = head->version;
-    resp_head.cseq = head->cseq;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
     resp_head.code = RtspStatusCode::OK;
 
     // TODO: 如果没有OPTIONS、DESCRIBE，直接SETUP
     assert(!media_session_name_.empty());
     std::string session_head = media_session_name_ + "/";
-    assert(utils::StartsWith(head->url.session, session_head));
+    assert(utils::StartsWith(head.url.session, session_head));
 
-    std::string track = head->url.session.substr(session_head.size());
+    std::string track = head.url.session.substr(session_head.size());
     LOG_DEBUG << "session track " << track;
 
     auto media_session = active_media_session_.lock();
@@ -352,7 +449,17 @@ void RtspConnection::HandleMethodSetup(
         return;
     }
 
-    if (!media_session->SubsessionExists(track)) {
+    // 推流时track是发布者SDP中的a=control
+    LiveStreamHubPtr record_hub;
+    if (published_session_) {
+        record_hub = FindAnnouncedTrack(track);
+        if (!record_hub) {
+            LOG_ERROR << "can not find announced track " << track;
+            resp_head.code = RtspStatusCode::NotFound;
+            SendShortResponse(resp_head);
+            return;
+        }
+    } else if (!media_session->SubsessionExists(track)) {
         LOG_ERROR << "can not find subsession " << track;
         resp_head.code = RtspStatusCode::NotFound;
         SendShortResponse(resp_head);
@@ -380,6 +487,14 @@ void RtspConnection::HandleMethodSetup(
         line_handler(line);
     }
 
+    // 不支持更换已建立轨道的传输方式
+    if (rtsp_session_ && rtsp_session_->HasTrack(track)) {
+        LOG_WARN << "track " << track << " already set up";
+        resp_head.code = RtspStatusCode::MethodNotValidInThisState;
+        SendShortResponse(resp_head);
+        return;
+    }
+
     if (transport.empty()) {
         LOG_ERROR << "no transport";
         resp_head.code = RtspStatusCode::UnsupportedTransport;
@@ -417,7 +532,12 @@ void RtspConnection::HandleMethodSetup(
                 new RtspSession(tcp_conn_->loop(), active_media_session_));
         }
 
-        rtsp_session_->Setup(track, tcp_conn_, rtp_channel, rtcp_channel);
+        if (record_hub) {
+            rtsp_session_->SetupRecord(track, record_hub, tcp_conn_,
+                                       rtp_channel, rtcp_channel);
+        } else {
+            rtsp_session_->Setup(track, tcp_conn_, rtp_channel, rtcp_channel);
+        }
 
         auto session_id = rtsp_session_->id();
         LOG_DEBUG << "session id " << session_id;
@@ -470,8 +590,14 @@ void RtspConnection::HandleMethodSetup(
                 new RtspSession(tcp_conn_->loop(), active_media_session_));
         }
 
-        rtsp_session_->Setup(track, peer_rtp_addr, peer_rtcp_addr,
-                             local_rtp_port, local_rtcp_port);
+        if (record_hub) {
+            rtsp_session_->SetupRecord(track, record_hub, peer_rtp_addr,
+                                       peer_rtcp_addr, local_rtp_port,
+                                       local_rtcp_port);
+        } else {
+            rtsp_session_->Setup(track, peer_rtp_addr, peer_rtcp_addr,
+                                 local_rtp_port, local_rtcp_port);
+        }
 
         auto session_id = rtsp_session_->id();
         LOG_DEBUG << "local rtp port " << local_rtp_port << ", rtcp port "
@@ -497,50 +623,323 @@ void RtspConnection::HandleMethodSetup(
     }
 }
 
-void RtspConnection::HandleMethodPlay(
-    muduo::net::Buffer *buf, const std::shared_ptr<RtspRequestHead> &head) {
+/// RFC 2326 3.7 绝对时间，如19961108T142300.25Z，转为系统时间(us)
+static bool ParseClockTime(const char *str, int64_t *wall_us) {
+    struct tm tm_time = {};
+    int consumed = 0;
+    if (sscanf(str, "%4d%2d%2dT%2d%2d%2d%n", &tm_time.tm_year,
+               &tm_time.tm_mon, &tm_time.tm_mday, &tm_time.tm_hour,
+               &tm_time.tm_min, &tm_time.tm_sec, &consumed) != 6) {
+        return false;
+    }
+    tm_time.tm_year -= 1900;
+    tm_time.tm_mon -= 1;
+
+    double fraction = 0;
+    if (str[consumed] == '.') {
+        fraction = strtod(str + consumed, nullptr);
+    }
+    *wall_us = (int64_t)timegm(&tm_time) * 1000000 +
+               (int64_t)(fraction * 1000000);
+    return true;
+}
 
+void RtspConnection::HandleMethodPlay(muduo::net::Buffer *buf,
+                                      const RtspRequestHead &head) {
+
+    // Range: npt=10.5-，没有或者为now时从当前位置继续
+    double range_start = -1;
+    // 直播时移: npt=-300-为直播位置之前300秒，或clock=20261019T090000Z-
+    double time_shift = 0;
+    bool has_time_shift = false;
+    // Scale: -4，每次PLAY重新设置，没有时恢复正常速度
+    double scale = 1.0;
+    bool has_scale = false;
+    // Speed: 32，只改变发送速度，不小于RtspStreamState::kBulkSpeed时不限速
+    double speed = 1.0;
+    bool has_speed = false;
     std::string line;
     while (buf->RetrieveCRLFLine(false, line)) {
         if (utils::StartsWith(line, "User-Agent: ")) {
             LOG_DEBUG << "agent " << line.substr(strlen("User-Agent: "));
         } else if (utils::StartsWith(line, "Session: ")) {
             LOG_DEBUG << "session " << line.substr(strlen("Session: "));
+        } else if (utils::StartsWith(line, "Range: npt=")) {
+            const char *npt = line.data() + strlen("Range: npt=");
+            if (strncmp(npt, "now", 3) != 0) {
+                double value = strtod(npt, nullptr);
+                if (value < 0) {
+                    time_shift = value;
+                    has_time_shift = true;
+                } else {
+                    range_start = value;
+                }
+            }
+        } else if (utils::StartsWith(line, "Range: clock=")) {
+            int64_t wall_us = 0;
+            if (ParseClockTime(line.data() + strlen("Range: clock="),
+                               &wall_us)) {
+                time_shift = std::min(
+                    0.0, (wall_us - TimeShiftBuffer::WallMicros()) / 1e6);
+                has_time_shift = true;
+            }
+        } else if (utils::StartsWith(line, "Scale: ")) {
+            scale = strtod(line.data() + strlen("Scale: "), nullptr);
+            has_scale = true;
+        } else if (utils::StartsWith(line, "Speed: ")) {
+            speed = strtod(line.data() + strlen("Speed: "), nullptr);
+            has_speed = true;
         }
     }
-    rtsp_session_->Play();
 
     RtspResponseHead resp_head;
-    resp_head.version = head->version;
-    resp_head.cseq = head->cseq;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
     resp_head.code = RtspStatusCode::OK;
 
+    // 请求的位置无法定位时回复457，播放状态不变
+    double start_offset = 0;
+    bool time_shifted = false;
+    if (has_time_shift) {
+        time_shifted = rtsp_session_->TimeShift(time_shift, &start_offset);
+        if (!time_shifted) {
+            LOG_WARN << "session " << rtsp_session_->id()
+                     << " cannot time shift " << time_shift;
+            resp_head.code = RtspStatusCode::InvalidRange;
+            SendShortResponse(resp_head);
+            return;
+        }
+    } else if (range_start >= 0) {
+        // 还没播放过或者是实时流时，npt=0就是当前位置
+        double npt = 0;
+        bool at_start = range_start == 0 && (!rtsp_session_->played() ||
+                                             !rtsp_session_->Position(&npt));
+        if (!at_start && !rtsp_session_->Seek(range_start, &npt)) {
+            LOG_WARN << "session " << rtsp_session_->id()
+                     << " cannot seek to " << range_start;
+            resp_head.code = RtspStatusCode::InvalidRange;
+            SendShortResponse(resp_head);
+            return;
+        }
+    }
+
+    if (!rtsp_session_->SetScale(scale)) {
+        LOG_WARN << "session " << rtsp_session_->id()
+                 << " unsupported scale " << scale;
+        scale = 1.0;
+    }
+    if (!rtsp_session_->SetSpeed(speed)) {
+        LOG_WARN << "session " << rtsp_session_->id()
+                 << " unsupported speed " << speed;
+        speed = 1.0;
+    }
+    rtsp_session_->Play();
+
+    // 请求带Scale/Speed时回复实际采用的值
+    char scale_line[80] = {0};
+    int scale_len = 0;
+    if (has_scale) {
+        scale_len = snprintf(scale_line, sizeof(scale_line),
+                             "Scale: %.3f\r\n", scale);
+    }
+    if (has_speed) {
+        snprintf(scale_line + scale_len, sizeof(scale_line) - scale_len,
+                 "Speed: %.3f\r\n", speed);
+    }
+
+    // 时移时以绝对时间回复实际开始位置，否则为源的当前位置
+    char range_line[64] = {0};
+    double start_npt = 0;
+    if (time_shifted) {
+        int64_t wall_us = TimeShiftBuffer::WallMicros() +
+                          (int64_t)(start_offset * 1000000);
+        time_t seconds = wall_us / 1000000;
+        struct tm tm_time;
+        gmtime_r(&seconds, &tm_time);
+        snprintf(range_line, sizeof(range_line),
+                 "Range: clock=%04d%02d%02dT%02d%02d%02d.%03dZ-\r\n",
+                 tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                 tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
+                 (int)(wall_us % 1000000 / 1000));
+    } else if (rtsp_session_->Position(&start_npt)) {
+        snprintf(range_line, sizeof(range_line), "Range: npt=%.3f-\r\n",
+                 start_npt);
+    } else {
+        snprintf(range_line, sizeof(range_line), "Range: npt=now-\r\n");
+    }
+
     char send_buf[300] = {0};
     auto data_len = snprintf(send_buf, sizeof(send_buf),
                              "%s %d %s\r\n"
                              "CSeq: %d\r\n"
-                             "Range: npt=0.000-\r\n"
+                             "%s"
+                             "%s"
                              "Session: %d; timeout=60\r\n"
                              "\r\n",
                              resp_head.version.data(), (int)resp_head.code,
                              RtspStatusCodeToString(resp_head.code),
-                             resp_head.cseq, rtsp_session_->id());
+                             resp_head.cseq, range_line, scale_line,
+                             rtsp_session_->id());
 
     SendResponse(send_buf, data_len);
 }
 
-void RtspConnection::HandleMethodTeardown(
-    muduo::net::Buffer *buf, const std::shared_ptr<RtspRequestHead> &head) {
-    rtsp_session_->Teardown();
-    rtsp_session_.reset();
+void RtspConnection::HandleMethodTeardown(muduo::net::Buffer *buf,
+                                          const RtspRequestHead &head) {
+    if (rtsp_session_) {
+        rtsp_session_->Teardown();
+        rtsp_session_.reset();
+    }
+    Unpublish();
+
+    RtspResponseHead resp_head;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
+    resp_head.code = RtspStatusCode::OK;
+    SendShortResponse(resp_head);
+}
+
+void RtspConnection::HandleMethodAnnounce(
+    muduo::net::Buffer *buf, const RtspRequestHead &head,
+    const std::vector<std::string> &gap_lines, const std::string &body) {
+
+    std::string content_type;
+
+    auto line_handler([&](const std::string &line) {
+        if (utils::StartsWith(line, "Content-Type: ")) {
+            content_type = line.substr(strlen("Content-Type: "));
+        } else if (utils::StartsWith(line, "User-Agent: ")) {
+            LOG_DEBUG << "agent " << line.substr(strlen("User-Agent: "));
+        }
+    });
+
+    for (auto &&line : gap_lines) {
+        line_handler(line);
+    }
+
+    std::string line;
+    while (buf->RetrieveCRLFLine(false, line)) {
+        line_handler(line);
+    }
 
     RtspResponseHead resp_head;
-    resp_head.version = head->version;
-    resp_head.cseq = head->cseq;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
+
+    if (!publish_media_session_callback_ || published_session_) {
+        resp_head.code = RtspStatusCode::MethodNotAllowed;
+        SendShortResponse(resp_head);
+        return;
+    }
+
+    std::vector<H264SdpMedia> medias;
+    if (content_type != defs::kRtspApplicationSdp ||
+        !ParseH264Sdp(body, &medias)) {
+        LOG_ERROR << "unsupported announce sdp [" << body << "]";
+        resp_head.code = RtspStatusCode::UnsupportedMediaType;
+        SendShortResponse(resp_head);
+        return;
+    }
+
+    // 每路视频一个hub，发布者只解包一次，所有观看者共享
+    MediaSessionPtr session = std::make_shared<MediaSession>(head.url.session);
+    std::vector<AnnouncedTrack> tracks;
+    for (auto &&media : medias) {
+        LiveStreamHubPtr hub = std::make_shared<LiveStreamHub>(gop_cache_bytes_);
+        hub->SetParameterSets(media.sps, media.pps);
+        if (time_shift_bytes_ > 0) {
+            hub->set_time_shift_buffer(
+                TimeShiftBuffer::Create(time_shift_bytes_));
+        }
+
+        auto subsession = std::make_shared<H264LiveSubsession>(hub, media.fps);
+        subsession->set_fmtp(media.fmtp);
+        session->AddSubsession(subsession);
+
+        tracks.push_back({media.control, hub});
+    }
+
+    if (!publish_media_session_callback_(session)) {
+        LOG_ERROR << "media session " << session->name() << " already exists";
+        resp_head.code = RtspStatusCode::Forbidden;
+        SendShortResponse(resp_head);
+        return;
+    }
+
+    LOG_INFO << "publish " << session->name() << " from "
+             << tcp_conn_->peer_addr().IpPort() << ", tracks "
+             << tracks.size();
+
+    published_session_ = session;
+    announced_tracks_.swap(tracks);
+    active_media_session_ = session;
+    media_session_name_ = session->name();
+
     resp_head.code = RtspStatusCode::OK;
     SendShortResponse(resp_head);
 }
 
+void RtspConnection::HandleMethodRecord(muduo::net::Buffer *buf,
+                                        const RtspRequestHead &head) {
+    std::string line;
+    while (buf->RetrieveCRLFLine(false, line)) {
+        if (utils::StartsWith(line, "Session: ")) {
+            LOG_DEBUG << "session " << line.substr(strlen("Session: "));
+        }
+    }
+
+    RtspResponseHead resp_head;
+    resp_head.version = head.version;
+    resp_head.cseq = head.cseq;
+
+    if (!published_session_ || !rtsp_session_) {
+        resp_head.code = RtspStatusCode::SessionNotFound;
+        SendShortResponse(resp_head);
+        return;
+    }
+
+    // 推流状态的Play即开始接收
+    rtsp_session_->Play();
+
+    resp_head.code = RtspStatusCode::OK;
+
+    char send_buf[200] = {0};
+    int data_len = snprintf(send_buf, sizeof(send_buf),
+                            "%s %d %s\r\n"
+                            "CSeq: %d\r\n"
+                            "Session: %d; timeout=60\r\n"
+                            "\r\n",
+                            resp_head.version.data(), (int)resp_head.code,
+                            RtspStatusCodeToString(resp_head.code),
+                            resp_head.cseq, rtsp_session_->id());
+    SendResponse(send_buf, data_len);
+}
+
+LiveStreamHubPtr
+RtspConnection::FindAnnouncedTrack(const std::string &track) const {
+    for (auto &&announced : announced_tracks_) {
+        // control可能是绝对url
+        if (announced.control == track ||
+            utils::EndsWith(announced.control, "/" + track)) {
+            return announced.hub;
+        }
+    }
+    return nullptr;
+}
+
+void RtspConnection::Unpublish() {
+    if (!published_session_) {
+        return;
+    }
+
+    LOG_INFO << "unpublish " << published_session_->name();
+    if (unpublish_media_session_callback_) {
+        unpublish_media_session_callback_(published_session_->name());
+    }
+    published_session_.reset();
+    announced_tracks_.clear();
+}
+
 std::string RtspConnection::ShortResponseMessage(const std::string &version,
                                                  RtspStatusCode code,
                                                  int cseq) {
@@ -572,7 +971,8 @@ void RtspConnection::SendShortResponse(const RtspResponseHead &resp_head) {
 }
 
 void RtspConnection::SendResponse(const char *buf, int size) {
-    LOG_DEBUG << "size " << size << ", [\r\n"
+    // 完整应答只在TRACE输出
+    LOG_TRACE << "size " << size << ", [\r\n"
               << muduo::StringPiece(buf, size) << "]";
     tcp_conn_->Send(buf, size);
 }
@@ -581,7 +981,7 @@ void RtspConnection::ParseInterleavedFrameHead(const char *buf, size_t size) {
     RtspInterleavedFrame rif{0};
     memcpy(&rif, buf, sizeof(RtspInterleavedFrame));
     rif.length = muduo::NetworkToHost16(rif.length);
-    LOG_DEBUG << "RTSP Interleaved Frame, magic " << (char)rif.magic
+    LOG_TRACE << "RTSP Interleaved Frame, magic " << (char)rif.magic
               << ", channel " << rif.channel << ", length " << rif.length;
 
     next_ilframe_.channel = rif.channel;
@@ -3,6 +3,7 @@
 
 #include "eventloop/event_loop.h"
 #include "media/defs.h"
+#include "media/live_stream_hub.h"
 #include "net/callback.h"
 #include "rtsp_message.h"
 
@@ -14,16 +15,39 @@ class RtspSession;
 using GetMediaSessionCallback =
     std::function<std::shared_ptr<MediaSession>(const std::string &)>;
 
+// 推流时注册直播会话，名字已存在时返回false
+using PublishMediaSessionCallback =
+    std::function<bool(const std::shared_ptr<MediaSession> &)>;
+using UnpublishMediaSessionCallback = std::function<void(const std::string &)>;
+
 class RtspConnection {
 public:
     RtspConnection(const muduo::net::TcpConnectionPtr &conn,
                    const GetMediaSessionCallback &cb);
     ~RtspConnection();
 
+    void set_publish_media_session_callback(
+        const PublishMediaSessionCallback &cb) {
+        publish_media_session_callback_ = cb;
+    }
+
+    // 推流会话每路视频缓存GOP的上限，0表示不缓存
+    void set_gop_cache_bytes(size_t bytes) { gop_cache_bytes_ = bytes; }
+
+    // 推流会话每路视频时移缓冲的大小，0表示不支持时移
+    void set_time_shift_bytes(size_t bytes) { time_shift_bytes_ = bytes; }
+
+    void set_unpublish_media_session_callback(
+        const UnpublishMediaSessionCallback &cb) {
+        unpublish_media_session_callback_ = cb;
+    }
+
     void OnMessage(const muduo::net::TcpConnectionPtr conn,
                    muduo::net::Buffer *buf,
                    muduo::event_loop::Timestamp timestamp);
 
+    void OnWriteComplete(const muduo::net::TcpConnectionPtr &conn);
+
     // 下一条消息解析类型
     enum NextMessageType { kMessageNone, kMessageILFrame };
 
@@ -37,29 +61,50 @@ public:
         }
     };
 
+    // 解析请求行和CSeq，不依赖连接状态
+    static bool ParseRequestHead(muduo::net::Buffer *buf,
+                                 std::vector<std::string> &gap_lines,
+                                 RtspRequestHead *req_head);
+
+    // 完整请求(含Content-Length指定的消息体)的长度，数据不完整时返回0。
+    // header_size为请求头(含空行)的长度
+    static size_t RtspMessageSize(const char *data, size_t size,
+                                  size_t *header_size);
+
 private:
-    std::shared_ptr<RtspRequestHead>
-    ParseRequestHead(muduo::net::Buffer *buf,
-                     std::vector<std::string> &gap_lines);
+    void HandleRequest(const muduo::net::TcpConnectionPtr &conn,
+                       muduo::net::Buffer *buf, const std::string &body);
 
     void DiscardAllData(muduo::net::Buffer *buf);
 
     void HandleMethodOptions(muduo::net::Buffer *buf,
-                             const std::shared_ptr<RtspRequestHead> &head);
+                             const RtspRequestHead &head);
 
     void HandleMethodDescribe(muduo::net::Buffer *buf,
-                              const std::shared_ptr<RtspRequestHead> &head,
+                              const RtspRequestHead &head,
                               const std::vector<std::string> &gap_lines);
 
     void HandleMethodSetup(muduo::net::Buffer *buf,
-                           const std::shared_ptr<RtspRequestHead> &head,
+                           const RtspRequestHead &head,
                            const std::vector<std::string> &gap_lines);
 
-    void HandleMethodPlay(muduo::net::Buffer *buf,
-                          const std::shared_ptr<RtspRequestHead> &head);
+    void HandleMethodPlay(muduo::net::Buffer *buf, const RtspRequestHead &head);
 
     void HandleMethodTeardown(muduo::net::Buffer *buf,
-                              const std::shared_ptr<RtspRequestHead> &head);
+                              const RtspRequestHead &head);
+
+    void HandleMethodAnnounce(muduo::net::Buffer *buf,
+                              const RtspRequestHead &head,
+                              const std::vector<std::string> &gap_lines,
+                              const std::string &body);
+
+    void HandleMethodRecord(muduo::net::Buffer *buf,
+                            const RtspRequestHead &head);
+
+    // 推流SETUP的track对应的hub，没有时返回nullptr
+    LiveStreamHubPtr FindAnnouncedTrack(const std::string &track) const;
+
+    void Unpublish();
 
     std::string ShortResponseMessage(const std::string &version,
                                      RtspStatusCode code, int cseq);
@@ -77,6 +122,8 @@ private:
 private:
     muduo::net::TcpConnectionPtr tcp_conn_;
     GetMediaSessionCallback get_media_session_callback_;
+    PublishMediaSessionCallback publish_media_session_callback_;
+    UnpublishMediaSessionCallback unpublish_media_session_callback_;
     NextMessageType next_type_;
     InterleavedFrameInfo next_ilframe_;
 
@@ -85,6 +132,16 @@ private:
 
     std::shared_ptr<RtspSession> rtsp_session_;
 
+    // ANNOUNCE创建的直播会话，连接断开时注销
+    struct AnnouncedTrack {
+        std::string control;
+        LiveStreamHubPtr hub;
+    };
+    std::shared_ptr<MediaSession> published_session_;
+    std::vector<AnnouncedTrack> announced_tracks_;
+    size_t gop_cache_bytes_;
+    size_t time_shift_bytes_;
+
     RtpTransProto rtp_transport_;
 };
 
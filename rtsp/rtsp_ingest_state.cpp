@@ -0,0 +1,91 @@
+#include "rtsp_ingest_state.h"
+#include "media/media_log.h"
+
+namespace muduo_media {
+
+RtspIngestState::RtspIngestState(muduo::event_loop::EventLoop *loop,
+                                 const LiveStreamHubPtr &hub)
+    : StreamState(loop),
+      hub_(hub),
+      depacketizer_([this](const AVPacket &packet) { OnNalu(packet); }),
+      packets_(0),
+      lost_packets_(0) {
+    hub_->set_publisher_loop(loop);
+    LOG_DEBUG << "RtspIngestState::ctor at " << this;
+}
+
+RtspIngestState::~RtspIngestState() {
+    LOG_DEBUG << "RtspIngestState::dtor at " << this;
+    if (playing_) {
+        metrics_->ingest_streams.Sub();
+    }
+}
+
+void RtspIngestState::Play() {
+    ++play_times_;
+    if (!playing_) {
+        metrics_->ingest_streams.Add();
+    }
+    playing_ = true;
+}
+
+void RtspIngestState::Teardown() {
+    if (playing_) {
+        metrics_->ingest_streams.Sub();
+    }
+    playing_ = false;
+}
+
+void RtspIngestState::ParseRTP(const char *buf, size_t size) {
+    if (!playing_) {
+        return;
+    }
+
+    depacketizer_.Input((const uint8_t *)buf, size);
+
+    uint64_t packets = depacketizer_.packets();
+    uint64_t lost = depacketizer_.lost_packets();
+    metrics_->ingest_rtp_packets.Add(packets - packets_);
+    metrics_->ingest_rtp_lost.Add(lost - lost_packets_);
+    packets_ = packets;
+    lost_packets_ = lost;
+}
+
+void RtspIngestState::ParseRTCP(const char *buf, size_t size) {
+    // 发布者的SR只做统计
+    RtcpReceiverStats delta;
+    delta.Accumulate(buf, size);
+    metrics_->rtcp_packets.Add(delta.sr_packets + delta.rr_packets +
+                               delta.sdes_packets + delta.bye_packets +
+                               delta.other_packets);
+    metrics_->rtcp_malformed.Add(delta.malformed);
+    rtcp_stats_.Merge(delta);
+}
+
+void RtspIngestState::OnUdpRtpMessage(const muduo::net::UdpServerPtr &,
+                                      muduo::net::Buffer *buf,
+                                      struct sockaddr_in6 *,
+                                      muduo::event_loop::Timestamp) {
+    ParseRTP(buf->Peek(), buf->ReadableBytes());
+    buf->RetrieveAll();
+}
+
+void RtspIngestState::OnUdpRtcpMessage(const muduo::net::UdpServerPtr &,
+                                       muduo::net::Buffer *buf,
+                                       struct sockaddr_in6 *,
+                                       muduo::event_loop::Timestamp) {
+    ParseRTCP(buf->Peek(), buf->ReadableBytes());
+    buf->RetrieveAll();
+}
+
+void RtspIngestState::OnNalu(const AVPacket &packet) {
+    ++play_frames_;
+    metrics_->ingest_nalus.Add();
+
+    LOG_TRACE << "ingest NALU " << (int)packet.type << ", length " << packet.size
+              << ", pts " << packet.pts;
+
+    hub_->Publish(packet);
+}
+
+} // namespace muduo_media
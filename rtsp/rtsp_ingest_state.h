@@ -0,0 +1,50 @@
+#ifndef E6C14B92_7D3A_4F85_A0E9_28B5D7F36C1E
+#define E6C14B92_7D3A_4F85_A0E9_28B5D7F36C1E
+
+#include "media/h264_rtp_depacketizer.h"
+#include "media/live_stream_hub.h"
+#include "net/udp_virtual_connection.h"
+#include "stream_state.h"
+
+namespace muduo_media {
+
+/// @brief RtspSession中表示一路推流(RECORD)的状态
+///
+/// 收到的RTP在发布者的loop上解包一次，NALU写入LiveStreamHub。RECORD之前
+/// 收到的数据直接丢弃。
+class RtspIngestState : public StreamState {
+public:
+    RtspIngestState(muduo::event_loop::EventLoop *loop,
+                    const LiveStreamHubPtr &hub);
+    ~RtspIngestState();
+
+    // RECORD
+    virtual void Play() override;
+    virtual void Teardown() override;
+
+    virtual void ParseRTP(const char *buf, size_t size) override;
+    virtual void ParseRTCP(const char *buf, size_t size) override;
+
+    void OnUdpRtpMessage(const muduo::net::UdpServerPtr &,
+                         muduo::net::Buffer *buf, struct sockaddr_in6 *,
+                         muduo::event_loop::Timestamp);
+
+    void OnUdpRtcpMessage(const muduo::net::UdpServerPtr &,
+                          muduo::net::Buffer *buf, struct sockaddr_in6 *,
+                          muduo::event_loop::Timestamp);
+
+private:
+    void OnNalu(const AVPacket &packet);
+
+private:
+    LiveStreamHubPtr hub_;
+    H264RtpDepacketizer depacketizer_;
+
+    // 上次计入LoopMetrics的采样值
+    uint64_t packets_;
+    uint64_t lost_packets_;
+};
+
+} // namespace muduo_media
+
+#endif /* E6C14B92_7D3A_4F85_A0E9_28B5D7F36C1E */
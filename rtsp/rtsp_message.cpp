@@ -108,6 +108,9 @@ static RtspLabel s_status_code_names[] = {
     {(int)RtspStatusCode::NotAcceptable, "Not Acceptable"},
     {(int)RtspStatusCode::UnsupportedMediaType, "Unsupported Media Type"},
     {(int)RtspStatusCode::SessionNotFound, "Session Not Found"},
+    {(int)RtspStatusCode::MethodNotValidInThisState,
+     "Method Not Valid in This State"},
+    {(int)RtspStatusCode::InvalidRange, "Invalid Range"},
     {(int)RtspStatusCode::UnsupportedTransport, "Unsupported transport"},
     {(int)RtspStatusCode::None, nullptr}};
 
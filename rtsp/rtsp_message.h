@@ -58,6 +58,8 @@ enum class RtspStatusCode {
     NotAcceptable = 406,
     UnsupportedMediaType = 415,
     SessionNotFound = 454,
+    MethodNotValidInThisState = 455,
+    InvalidRange = 457,
     UnsupportedTransport = 461
 }; // https://www.websitepulse.com/kb/rtsp_status_codes
 
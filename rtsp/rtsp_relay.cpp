@@ -0,0 +1,574 @@
+#include "rtsp_relay.h"
+#include "media/defs.h"
+#include "media/media_log.h"
+#include "net/inet_address.h"
+#include "net/tcp_connection.h"
+#include "rtsp_connection.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace muduo_media {
+
+static const char kRtspUrlPrefix[] = "rtsp://";
+
+// C++11中ODR使用(如std::min按引用传参)时需要定义
+constexpr double RtspRelay::kMinBackoff;
+constexpr double RtspRelay::kMaxBackoff;
+constexpr double RtspRelay::kDataTimeout;
+constexpr double RtspRelay::kCheckInterval;
+
+static constexpr uint16_t kRtspPort = 554;
+
+// 应答头加SDP的上限，超过仍不完整则重连
+static constexpr size_t kMaxRtspMessageSize = 64 * 1024;
+
+// 上游没有给出Session超时时按RFC 2326的默认值60秒
+static constexpr double kDefaultSessionTimeout = 60.0;
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// rtsp://host[:port]/path，不支持user:password@
+static bool ParseRtspUrl(const std::string &url, RtspUrl *result) {
+    if (!utils::StartsWith(url, kRtspUrlPrefix)) {
+        return false;
+    }
+    size_t host_start = strlen(kRtspUrlPrefix);
+    size_t slash = url.find('/', host_start);
+    std::string authority = url.substr(
+        host_start, slash == std::string::npos ? std::string::npos
+                                               : slash - host_start);
+    if (authority.empty() || authority.find('@') != std::string::npos) {
+        return false;
+    }
+
+    result->entire = url;
+    result->prefix = kRtspUrlPrefix;
+    result->port = kRtspPort;
+    size_t colon = authority.find(':');
+    if (colon != std::string::npos) {
+        result->port = atoi(authority.c_str() + colon + 1);
+        authority.resize(colon);
+    }
+    result->host = authority;
+    result->session =
+        slash == std::string::npos ? std::string() : url.substr(slash + 1);
+    return result->port > 0 && result->port <= 0xFFFF;
+}
+
+/// SDP中的a=control可能是绝对url、"*"或相对于Content-Base的路径
+static std::string ResolveControl(const std::string &base,
+                                  const std::string &control) {
+    if (control == "*") {
+        return base;
+    }
+    if (utils::StartsWith(control, kRtspUrlPrefix)) {
+        return control;
+    }
+    if (utils::EndsWith(base, "/")) {
+        return base + control;
+    }
+    return base + "/" + control;
+}
+
+/// 取"Name: value"中的value，不区分大小写
+static bool HeaderValue(const std::string &line, const char *name,
+                        std::string *value) {
+    size_t len = strlen(name);
+    if (line.size() <= len || line[len] != ':' ||
+        strncasecmp(line.data(), name, len) != 0) {
+        return false;
+    }
+    size_t start = line.find_first_not_of(' ', len + 1);
+    *value = start == std::string::npos ? std::string() : line.substr(start);
+    return true;
+}
+
+RtspRelay::RtspRelay(muduo::event_loop::EventLoop *loop,
+                     const std::string &url, const std::string &session_name,
+                     size_t gop_cache_bytes)
+    : loop_(loop),
+      url_(url),
+      session_name_(session_name),
+      attempt_(0),
+      started_(false),
+      state_(State::kIdle),
+      backoff_(kMinBackoff),
+      cseq_(0),
+      pending_cseq_(0),
+      rtp_channel_(0),
+      keepalive_interval_(kDefaultSessionTimeout / 2),
+      last_receive_us_(0),
+      last_keepalive_us_(0),
+      hub_(std::make_shared<LiveStreamHub>(gop_cache_bytes)),
+      fps_(25),
+      packets_(0),
+      lost_packets_(0),
+      pts_offset_(0),
+      last_pts_(-1),
+      arrival_us_(0),
+      metrics_(nullptr) {
+    hub_->set_publisher_loop(loop);
+    LOG_DEBUG << "RtspRelay::ctor at " << this;
+}
+
+RtspRelay::~RtspRelay() {
+    LOG_DEBUG << "RtspRelay::dtor at " << this;
+    if (state_ == State::kStreaming) {
+        metrics_->relay_upstreams.Sub();
+    }
+}
+
+void RtspRelay::Start() {
+    if (started_) {
+        return;
+    }
+    if (!ParseRtspUrl(url_, &upstream_)) {
+        LOG_ERROR << "invalid relay url " << url_;
+        return;
+    }
+    metrics_ = LoopMetrics::Local();
+    started_ = true;
+    backoff_ = kMinBackoff;
+    Connect();
+}
+
+void RtspRelay::Stop() {
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+
+    if (state_ == State::kStreaming && !session_id_.empty()) {
+        SendRequest(RtspMethod::TEARDOWN, url_,
+                    "Session: " + session_id_ + "\r\n");
+    }
+    Disconnect();
+
+    if (session_) {
+        if (unpublish_media_session_callback_) {
+            unpublish_media_session_callback_(session_->name());
+        }
+        LOG_INFO << "relay " << session_->name() << " stopped";
+        session_.reset();
+        subsession_.reset();
+    }
+}
+
+void RtspRelay::Connect() {
+    uint32_t attempt = ++attempt_;
+    SetState(State::kConnecting);
+    last_receive_us_ = NowMicros();
+
+    client_ = std::make_shared<muduo::net::TcpClient>(
+        loop_, muduo::net::InetAddress(upstream_.host, upstream_.port),
+        "RtspRelay-" + session_name_);
+
+    std::weak_ptr<RtspRelay> weak_self(shared_from_this());
+    client_->set_connection_callback(
+        [weak_self, attempt](const muduo::net::TcpConnectionPtr &conn) {
+            auto self = weak_self.lock();
+            if (self) {
+                self->OnConnection(attempt, conn);
+            }
+        });
+    client_->set_message_callback(
+        [weak_self, attempt](const muduo::net::TcpConnectionPtr &,
+                             muduo::net::Buffer *buf,
+                             muduo::event_loop::Timestamp) {
+            auto self = weak_self.lock();
+            if (self) {
+                self->OnMessage(attempt, buf);
+            } else {
+                buf->RetrieveAll();
+            }
+        });
+
+    LOG_INFO << "relay " << session_name_ << " connecting to " << url_;
+    client_->Connect();
+
+    loop_->RunAfter(kCheckInterval, [weak_self, attempt]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->Check(attempt);
+        }
+    });
+}
+
+void RtspRelay::Disconnect() {
+    ++attempt_;
+    SetState(State::kIdle);
+    conn_.reset();
+    depacketizer_.reset();
+    session_id_.clear();
+
+    if (client_) {
+        // 可能正处在client_的回调中，延后到下一轮再释放
+        std::shared_ptr<muduo::net::TcpClient> client;
+        client.swap(client_);
+        client->Disconnect();
+        loop_->QueueInLoop([client]() {});
+    }
+}
+
+void RtspRelay::Fail(const char *reason) {
+    LOG_WARN << "relay " << session_name_ << " from " << url_ << ": "
+             << reason << ", reconnect in " << backoff_ << "s";
+    Disconnect();
+
+    double delay = backoff_;
+    backoff_ = std::min(backoff_ * 2, kMaxBackoff);
+
+    uint32_t attempt = attempt_;
+    std::weak_ptr<RtspRelay> weak_self(shared_from_this());
+    loop_->RunAfter(delay, [weak_self, attempt]() {
+        auto self = weak_self.lock();
+        if (self && self->started_ && self->attempt_ == attempt) {
+            self->metrics_->relay_reconnects.Add();
+            self->Connect();
+        }
+    });
+}
+
+void RtspRelay::OnConnection(uint32_t attempt,
+                             const muduo::net::TcpConnectionPtr &conn) {
+    if (attempt != attempt_) {
+        return;
+    }
+
+    if (!conn->Connected()) {
+        Fail("upstream closed");
+        return;
+    }
+
+    LOG_INFO << "relay " << session_name_ << " connected to "
+             << conn->peer_addr().IpPort();
+    conn_ = conn;
+    last_receive_us_ = NowMicros();
+    SetState(State::kDescribe);
+    SendRequest(RtspMethod::DESCRIBE, url_,
+                std::string("Accept: ") + defs::kRtspApplicationSdp + "\r\n");
+}
+
+void RtspRelay::OnMessage(uint32_t attempt, muduo::net::Buffer *buf) {
+    if (attempt != attempt_) {
+        buf->RetrieveAll();
+        return;
+    }
+
+    arrival_us_ = NowMicros();
+    last_receive_us_ = arrival_us_;
+
+    while (buf->ReadableBytes() > 0) {
+        const char *data = buf->Peek();
+        size_t size = buf->ReadableBytes();
+
+        // RTP over TCP: '$' channel length(2字节)
+        if (data[0] == defs::kRtspInterleavedFrameMagic) {
+            if (size < sizeof(RtspInterleavedFrame)) {
+                return;
+            }
+            size_t length = (uint8_t)data[2] << 8 | (uint8_t)data[3];
+            if (size < sizeof(RtspInterleavedFrame) + length) {
+                return;
+            }
+            if ((uint8_t)data[1] == rtp_channel_) {
+                OnRtp(data + sizeof(RtspInterleavedFrame), length);
+            }
+            // 上游的RTCP忽略
+            buf->Retrieve(sizeof(RtspInterleavedFrame) + length);
+            continue;
+        }
+
+        size_t header_size = 0;
+        size_t message_size =
+            RtspConnection::RtspMessageSize(data, size, &header_size);
+        if (0 == message_size) {
+            if (size > kMaxRtspMessageSize) {
+                Fail("response too large");
+            }
+            return;
+        }
+
+        std::string header(data, header_size);
+        std::string body(data + header_size, message_size - header_size);
+        buf->Retrieve(message_size);
+        if (!HandleResponse(header, body)) {
+            // 连接已放弃，buf属于旧连接
+            return;
+        }
+    }
+}
+
+void RtspRelay::Check(uint32_t attempt) {
+    if (attempt != attempt_) {
+        return;
+    }
+
+    int64_t now_us = NowMicros();
+    if (now_us - last_receive_us_ > (int64_t)(kDataTimeout * 1000000)) {
+        Fail(state_ == State::kConnecting ? "connect timeout"
+                                          : "upstream timeout");
+        return;
+    }
+
+    // 上游按Session超时回收会话，TCP上的RTCP不一定被当作活动
+    if (state_ == State::kStreaming &&
+        now_us - last_keepalive_us_ >
+            (int64_t)(keepalive_interval_ * 1000000)) {
+        last_keepalive_us_ = now_us;
+        SendRequest(RtspMethod::OPTIONS, url_,
+                    "Session: " + session_id_ + "\r\n");
+    }
+
+    std::weak_ptr<RtspRelay> weak_self(shared_from_this());
+    loop_->RunAfter(kCheckInterval, [weak_self, attempt]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->Check(attempt);
+        }
+    });
+}
+
+void RtspRelay::SendRequest(RtspMethod method, const std::string &url,
+                            const std::string &headers) {
+    if (!conn_) {
+        return;
+    }
+
+    ++cseq_;
+    if (method != RtspMethod::OPTIONS) {
+        pending_cseq_ = cseq_;
+    }
+
+    char line[512];
+    snprintf(line, sizeof(line),
+             "%s %s RTSP/1.0\r\n"
+             "CSeq: %d\r\n"
+             "User-Agent: %s\r\n",
+             RtspMethodToString(method), url.c_str(), cseq_, defs::kAppName);
+    std::string request(line);
+    request.append(headers);
+    request.append("\r\n");
+
+    LOG_DEBUG << "relay request [" << request << "]";
+    conn_->Send(request);
+}
+
+bool RtspRelay::HandleResponse(const std::string &header,
+                               const std::string &body) {
+    LOG_DEBUG << "relay response [" << header << "]";
+
+    int code = 0;
+    if (sscanf(header.c_str(), "RTSP/%*s %d", &code) != 1) {
+        Fail("malformed response");
+        return false;
+    }
+
+    int cseq = -1;
+    std::string content_base;
+    std::string session;
+    std::string transport;
+
+    size_t start = 0;
+    while (start < header.size()) {
+        size_t end = header.find("\r\n", start);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+        std::string line = header.substr(start, end - start);
+        start = end + 2;
+
+        std::string value;
+        if (HeaderValue(line, "CSeq", &value)) {
+            cseq = atoi(value.c_str());
+        } else if (HeaderValue(line, "Content-Base", &value)) {
+            content_base = value;
+        } else if (HeaderValue(line, "Session", &value)) {
+            session = value;
+        } else if (HeaderValue(line, "Transport", &value)) {
+            transport = value;
+        }
+    }
+
+    // keepalive的应答
+    if (cseq != pending_cseq_) {
+        return true;
+    }
+
+    if (code != (int)RtspStatusCode::OK) {
+        LOG_ERROR << "relay " << session_name_ << " upstream returned "
+                  << code;
+        Fail("request refused");
+        return false;
+    }
+
+    switch (state_) {
+    case State::kDescribe:
+        return HandleDescribe(content_base, body);
+    case State::kSetup:
+        return HandleSetup(session, transport);
+    case State::kPlay:
+        HandlePlay();
+        return true;
+    default:
+        return true;
+    }
+}
+
+bool RtspRelay::HandleDescribe(const std::string &content_base,
+                               const std::string &body) {
+    std::vector<H264SdpMedia> medias;
+    if (!ParseH264Sdp(body, &medias)) {
+        LOG_ERROR << "relay " << session_name_ << " no H.264 in sdp [" << body
+                  << "]";
+        Fail("unsupported sdp");
+        return false;
+    }
+    if (medias.size() > 1) {
+        LOG_WARN << "relay " << session_name_ << " only relays the first of "
+                 << medias.size() << " H.264 tracks";
+    }
+
+    const H264SdpMedia &media = medias.front();
+    if (!PublishSession(media)) {
+        // 会话名冲突，重连也不会成功
+        Stop();
+        return false;
+    }
+
+    track_url_ = ResolveControl(content_base.empty() ? url_ : content_base,
+                                media.control);
+    SetState(State::kSetup);
+    SendRequest(RtspMethod::SETUP, track_url_,
+                "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n");
+    return true;
+}
+
+bool RtspRelay::HandleSetup(const std::string &session,
+                            const std::string &transport) {
+    if (session.empty()) {
+        Fail("no session in SETUP response");
+        return false;
+    }
+
+    // Session: <id>[;timeout=<秒>]
+    size_t semicolon = session.find(';');
+    session_id_ = session.substr(0, semicolon);
+    double timeout = kDefaultSessionTimeout;
+    if (semicolon != std::string::npos) {
+        size_t pos = session.find("timeout=", semicolon);
+        if (pos != std::string::npos) {
+            double value = atof(session.c_str() + pos + strlen("timeout="));
+            if (value > 0) {
+                timeout = value;
+            }
+        }
+    }
+    keepalive_interval_ = timeout / 2;
+
+    rtp_channel_ = 0;
+    size_t pos = transport.find("interleaved=");
+    if (pos != std::string::npos) {
+        rtp_channel_ = atoi(transport.c_str() + pos + strlen("interleaved="));
+    }
+
+    SetState(State::kPlay);
+    SendRequest(RtspMethod::PLAY, url_,
+                "Session: " + session_id_ + "\r\nRange: npt=0.000-\r\n");
+    return true;
+}
+
+void RtspRelay::HandlePlay() {
+    // 新连接的pts从0开始，接在上一个连接最后一帧之后
+    if (last_pts_ >= 0) {
+        pts_offset_ = last_pts_ + 90000 / fps_;
+    }
+    depacketizer_.reset(new H264RtpDepacketizer(
+        [this](const AVPacket &packet) { OnNalu(packet); }));
+    packets_ = 0;
+    lost_packets_ = 0;
+
+    last_keepalive_us_ = NowMicros();
+    backoff_ = kMinBackoff;
+    SetState(State::kStreaming);
+    LOG_INFO << "relay " << session_name_ << " streaming from " << url_;
+}
+
+void RtspRelay::OnRtp(const char *data, size_t size) {
+    if (!depacketizer_) {
+        return;
+    }
+
+    depacketizer_->Input((const uint8_t *)data, size);
+
+    uint64_t packets = depacketizer_->packets();
+    uint64_t lost = depacketizer_->lost_packets();
+    metrics_->relay_rtp_packets.Add(packets - packets_);
+    metrics_->relay_rtp_lost.Add(lost - lost_packets_);
+    packets_ = packets;
+    lost_packets_ = lost;
+}
+
+void RtspRelay::OnNalu(const AVPacket &packet) {
+    AVPacket relayed = packet;
+    if (relayed.pts >= 0) {
+        relayed.pts += pts_offset_;
+        last_pts_ = relayed.pts;
+    }
+    relayed.arrival_us = arrival_us_;
+    hub_->Publish(relayed);
+}
+
+bool RtspRelay::PublishSession(const H264SdpMedia &media) {
+    if (session_) {
+        // 重连，上游可能换了参数集
+        hub_->SetParameterSets(media.sps, media.pps);
+        subsession_->set_fmtp(media.fmtp);
+        return true;
+    }
+
+    fps_ = media.fps;
+    hub_->SetParameterSets(media.sps, media.pps);
+
+    subsession_ = std::make_shared<H264LiveSubsession>(hub_, media.fps);
+    subsession_->set_fmtp(media.fmtp);
+
+    MediaSessionPtr session = std::make_shared<MediaSession>(session_name_);
+    session->AddSubsession(subsession_);
+
+    if (publish_media_session_callback_ &&
+        !publish_media_session_callback_(session)) {
+        LOG_ERROR << "media session " << session_name_ << " already exists";
+        subsession_.reset();
+        return false;
+    }
+
+    LOG_INFO << "relay " << url_ << " published as " << session_name_;
+    session_ = session;
+    return true;
+}
+
+void RtspRelay::SetState(State state) {
+    if (state == state_) {
+        return;
+    }
+    if (state_ == State::kStreaming) {
+        metrics_->relay_upstreams.Sub();
+    } else if (state == State::kStreaming) {
+        metrics_->relay_upstreams.Add();
+    }
+    state_ = state;
+}
+
+} // namespace muduo_media
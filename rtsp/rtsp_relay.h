@@ -0,0 +1,158 @@
+#ifndef C6EF3072_ECB2_4066_BF17_BF12788B385A
+#define C6EF3072_ECB2_4066_BF17_BF12788B385A
+
+#include "eventloop/event_loop.h"
+#include "media/h264_live_subsession.h"
+#include "media/h264_rtp_depacketizer.h"
+#include "media/live_stream_hub.h"
+#include "media/metrics.h"
+#include "media_session.h"
+#include "net/tcp_client.h"
+#include "rtsp_message.h"
+#include "sdp_parser.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace muduo_media {
+
+/**
+ * @brief 从上游RTSP服务(摄像机)拉流，作为本地直播会话转发
+ *
+ * 对上游依次发送DESCRIBE、SETUP(RTP over TCP)、PLAY，只转发SDP中第一路
+ * H.264视频。收到的RTP在loop上解包一次写入LiveStreamHub，观看者与推流
+ * (ANNOUNCE/RECORD)的会话一样订阅同一个hub。
+ *
+ * 连接断开、应答失败或超过kDataTimeout没有数据时，按指数退避重连；
+ * MediaSession在第一次DESCRIBE成功时发布，重连期间保留，观看者不会断开，
+ * 重连后pts接续。只支持不需要认证的url。
+ *
+ * 所有方法都须在loop线程中调用。
+ */
+class RtspRelay : public std::enable_shared_from_this<RtspRelay> {
+public:
+    using PublishMediaSessionCallback =
+        std::function<bool(const MediaSessionPtr &)>;
+    using UnpublishMediaSessionCallback =
+        std::function<void(const std::string &)>;
+
+    /// url为上游地址，session_name为本地发布的会话名
+    RtspRelay(muduo::event_loop::EventLoop *loop, const std::string &url,
+              const std::string &session_name,
+              size_t gop_cache_bytes = LiveStreamHub::kDefaultGopCacheBytes);
+    ~RtspRelay();
+
+    void set_publish_media_session_callback(
+        const PublishMediaSessionCallback &cb) {
+        publish_media_session_callback_ = cb;
+    }
+    void set_unpublish_media_session_callback(
+        const UnpublishMediaSessionCallback &cb) {
+        unpublish_media_session_callback_ = cb;
+    }
+
+    void Start();
+    /// 停止拉流并注销已发布的会话
+    void Stop();
+
+    /// 正在从上游接收媒体数据
+    bool streaming() const { return state_ == State::kStreaming; }
+
+    /// 转发的直播流，构造时创建，可以在Start之前订阅(如录制)
+    const LiveStreamHubPtr &hub() const { return hub_; }
+
+    // 重连退避的初值和上限(秒)
+    static constexpr double kMinBackoff = 1.0;
+    static constexpr double kMaxBackoff = 30.0;
+    // 超过该时间(秒)没有收到任何数据则重连
+    static constexpr double kDataTimeout = 10.0;
+    static constexpr double kCheckInterval = 1.0;
+
+private:
+    enum class State {
+        kIdle,
+        kConnecting,
+        kDescribe,
+        kSetup,
+        kPlay,
+        kStreaming
+    };
+
+    void Connect();
+    // 断开当前连接，按退避时间重连
+    void Fail(const char *reason);
+    // 断开当前连接，不重连
+    void Disconnect();
+
+    // attempt与attempt_不同时说明回调属于已经放弃的连接
+    void OnConnection(uint32_t attempt,
+                      const muduo::net::TcpConnectionPtr &conn);
+    void OnMessage(uint32_t attempt, muduo::net::Buffer *buf);
+    void Check(uint32_t attempt);
+
+    void SendRequest(RtspMethod method, const std::string &url,
+                     const std::string &headers = std::string());
+
+    // 返回false时连接已经放弃
+    bool HandleResponse(const std::string &header, const std::string &body);
+    bool HandleDescribe(const std::string &content_base,
+                        const std::string &body);
+    bool HandleSetup(const std::string &session, const std::string &transport);
+    void HandlePlay();
+
+    void OnRtp(const char *data, size_t size);
+    void OnNalu(const AVPacket &packet);
+
+    // 第一次调用时发布会话，重连时更新参数集
+    bool PublishSession(const H264SdpMedia &media);
+
+    void SetState(State state);
+
+private:
+    muduo::event_loop::EventLoop *loop_;
+    const std::string url_;
+    const std::string session_name_;
+
+    PublishMediaSessionCallback publish_media_session_callback_;
+    UnpublishMediaSessionCallback unpublish_media_session_callback_;
+
+    RtspUrl upstream_;
+    std::shared_ptr<muduo::net::TcpClient> client_;
+    muduo::net::TcpConnectionPtr conn_;
+    uint32_t attempt_;
+    bool started_;
+    State state_;
+    double backoff_;
+
+    int cseq_;
+    int pending_cseq_; // 等待应答的请求，keepalive的应答不在此列
+    std::string track_url_;
+    std::string session_id_;
+    int rtp_channel_;
+    double keepalive_interval_;
+    int64_t last_receive_us_;
+    int64_t last_keepalive_us_;
+
+    MediaSessionPtr session_;
+    LiveStreamHubPtr hub_;
+    std::shared_ptr<H264LiveSubsession> subsession_;
+    unsigned int fps_;
+
+    // 每次连接重新创建，pts从0开始
+    std::unique_ptr<H264RtpDepacketizer> depacketizer_;
+    uint64_t packets_;
+    uint64_t lost_packets_;
+    // 重连后加到新连接的pts上，使hub中的pts连续
+    int64_t pts_offset_;
+    int64_t last_pts_;
+    int64_t arrival_us_; // 当前RTP包到达的时刻
+
+    LoopMetrics *metrics_;
+};
+
+using RtspRelayPtr = std::shared_ptr<RtspRelay>;
+
+} // namespace muduo_media
+
+#endif /* C6EF3072_ECB2_4066_BF17_BF12788B385A */
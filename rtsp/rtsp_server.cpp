@@ -1,6 +1,7 @@
 
 #include "rtsp_server.h"
-#include "logger/logger.h"
+#include "media/media_log.h"
+#include "media/metrics.h"
 #include "net/inet_address.h"
 #include "net/tcp_connection.h"
 
@@ -9,7 +10,9 @@ namespace muduo_media {
 RtspServer::RtspServer(muduo::event_loop::EventLoop *loop,
                        const muduo::net::InetAddress &listen_addr,
                        const std::string &name, bool reuse_port)
-    : tcp_server_(loop, listen_addr, name, reuse_port) {
+    : tcp_server_(loop, listen_addr, name, reuse_port),
+      gop_cache_bytes_(LiveStreamHub::kDefaultGopCacheBytes),
+      time_shift_bytes_(0) {
 
     // 连接已经建立，但是还没开始读取数据
     tcp_server_.set_before_reading_callback(
@@ -24,21 +27,56 @@ RtspServer::RtspServer(muduo::event_loop::EventLoop *loop,
 
 RtspServer::~RtspServer() {}
 
-void RtspServer::Start() { tcp_server_.Start(); }
+void RtspServer::Start() {
+    if (catalog_) {
+        catalog_->Start();
+    }
+    tcp_server_.Start();
+}
 
 void RtspServer::AddMediaSession(const MediaSessionPtr &session) {
     sessions_.insert(std::make_pair(session->name(), session));
     LOG_INFO << "added session " << session->name();
 }
 
+bool RtspServer::PublishMediaSession(const MediaSessionPtr &session) {
+    // 查找时会话优先于点播目录，推流不能顶替已有的文件
+    if (catalog_ && catalog_->Get(session->name())) {
+        LOG_WARN << "publish " << session->name()
+                 << " refused, path is a vod file";
+        return false;
+    }
+    if (!sessions_.insert(std::make_pair(session->name(), session)).second) {
+        return false;
+    }
+    LOG_INFO << "published session " << session->name();
+    return true;
+}
+
+void RtspServer::RemoveMediaSession(const std::string &name) {
+    if (sessions_.erase(name) > 0) {
+        LOG_INFO << "removed session " << name;
+    }
+}
+
 void RtspServer::OnBeforeReading(const muduo::net::TcpConnectionPtr &conn) {
     assert(conn->Connected());
 
     LOG_INFO << "connected " << conn->peer_addr().IpPort();
-    RtspConnectionPtr rtsp_conn(
-        new RtspConnection(conn, std::bind(&RtspServer::OnGetMediaSession, this,
-                                           std::placeholders::_1)));
-    connections_[conn->name()] = rtsp_conn;
+    std::unique_ptr<RtspConnection> rtsp_conn(
+        new RtspConnection(conn, [this](const std::string &name) {
+            return OnGetMediaSession(name);
+        }));
+    rtsp_conn->set_gop_cache_bytes(gop_cache_bytes_);
+    rtsp_conn->set_time_shift_bytes(time_shift_bytes_);
+    rtsp_conn->set_publish_media_session_callback(
+        [this](const MediaSessionPtr &session) {
+            return PublishMediaSession(session);
+        });
+    rtsp_conn->set_unpublish_media_session_callback(
+        [this](const std::string &name) { RemoveMediaSession(name); });
+    connections_[conn.get()] = std::move(rtsp_conn);
+    LoopMetrics::Local()->rtsp_connections.Add();
 }
 
 void RtspServer::OnConnection(const muduo::net::TcpConnectionPtr &conn) {
@@ -46,16 +84,20 @@ void RtspServer::OnConnection(const muduo::net::TcpConnectionPtr &conn) {
         LOG_INFO << "start reading data from " << conn->peer_addr().IpPort();
     } else {
         LOG_INFO << "disconnected " << conn->peer_addr().IpPort();
-        connections_.erase(conn->name());
+        if (connections_.erase(conn.get()) > 0) {
+            LoopMetrics::Local()->rtsp_connections.Sub();
+        }
     }
 }
 
 MediaSessionPtr RtspServer::OnGetMediaSession(const std::string &name) {
     auto it = sessions_.find(name);
-    if (it == sessions_.end()) {
-        return nullptr;
-    } else {
+    if (it != sessions_.end()) {
         return it->second;
+    } else if (catalog_) {
+        return catalog_->Get(name);
+    } else {
+        return nullptr;
     }
 }
 
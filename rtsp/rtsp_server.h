@@ -5,6 +5,9 @@
 #include "media_session.h"
 #include "net/tcp_server.h"
 #include "rtsp_connection.h"
+#include "vod_catalog.h"
+
+#include <unordered_map>
 
 namespace muduo_media {
 
@@ -19,6 +22,19 @@ public:
 
     void AddMediaSession(const MediaSessionPtr &session);
 
+    // 推流创建的直播会话，名字已存在或与点播目录中的文件重名时返回false
+    bool PublishMediaSession(const MediaSessionPtr &session);
+    void RemoveMediaSession(const std::string &name);
+
+    // 推流会话每路视频的GOP缓存上限，新观看者无需等待IDR；0表示不缓存
+    void set_gop_cache_bytes(size_t bytes) { gop_cache_bytes_ = bytes; }
+
+    // 推流会话每路视频时移(DVR)缓冲的大小，0表示不支持时移
+    void set_time_shift_bytes(size_t bytes) { time_shift_bytes_ = bytes; }
+
+    // 点播目录，已添加和推流的会话中找不到时按路径查找。须在Start之前设置
+    void set_vod_catalog(const VodCatalogPtr &catalog) { catalog_ = catalog; }
+
 private:
     void OnBeforeReading(const muduo::net::TcpConnectionPtr &conn);
     void OnConnection(const muduo::net::TcpConnectionPtr &conn);
@@ -28,8 +44,17 @@ private:
 private:
     muduo::net::TcpServer tcp_server_;
 
-    std::map<std::string, RtspConnectionPtr> connections_;
+    // 先于connections_构造，连接析构时还可以注销推流会话
     std::map<std::string, MediaSessionPtr> sessions_;
+
+    // 以TcpConnection地址为键，避免为每个连接保存名字字符串
+    std::unordered_map<const muduo::net::TcpConnection *,
+                       std::unique_ptr<RtspConnection>>
+        connections_;
+
+    size_t gop_cache_bytes_;
+    size_t time_shift_bytes_;
+    VodCatalogPtr catalog_;
 };
 
 } // namespace rtsp
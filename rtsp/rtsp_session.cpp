@@ -1,23 +1,34 @@
 #include "rtsp_session.h"
 #include "eventloop/endian.h"
-#include "logger/logger.h"
+#include "media/media_log.h"
+#include "media/metrics.h"
 #include "media/rtcp.h"
 #include "net/tcp_connection.h"
+#include "rtsp_ingest_state.h"
 #include "rtsp_stream_state.h"
+#include "session_scheduler.h"
 
+#include <algorithm>
 #include <random>
 
 namespace muduo_media {
 RtspSession::RtspSession(muduo::event_loop::EventLoop *loop,
                          const std::weak_ptr<MediaSession> &media_session)
-    : loop_(loop), media_session_(media_session), id_(-1) {
+    : loop_(loop), media_session_(media_session), id_(-1),
+      scheduler_(std::make_shared<SessionScheduler>(loop)) {
 
     LOG_DEBUG << "RtspSession::ctor at " << this;
+    LoopMetrics::Local()->rtsp_sessions.Add();
 }
 
 RtspSession::~RtspSession() {
     LOG_DEBUG << "RtspSession::dtor at " << this;
+    LoopMetrics::Local()->rtsp_sessions.Sub();
 
+    scheduler_.reset();
+    rtcp_conns_.clear();
+    rtp_conns_.clear();
+    bindings_.clear();
     states_.clear();
     media_session_.reset();
     tcp_conn_.reset();
@@ -29,155 +40,230 @@ void RtspSession::Setup(const std::string &track,
                         unsigned short &local_rtp_port,
                         unsigned short &local_rtcp_port) {
 
-    std::shared_ptr<muduo::net::UdpVirtualConnection> rtp_conn;
-    std::shared_ptr<muduo::net::UdpVirtualConnection> rtcp_conn;
-    std::random_device rd;
-
-    for (;;) {
-        local_rtp_port = rd() & 0xfffe;
+    muduo::net::UdpVirtualConnectionPtr rtp_conn;
+    muduo::net::UdpVirtualConnectionPtr rtcp_conn;
+    int rtcp_sockfd = -1;
+    BindUdpPorts(peer_rtp_addr, peer_rtcp_addr, local_rtp_port,
+                 local_rtcp_port, &rtp_conn, &rtcp_conn, &rtcp_sockfd);
 
-        // rtp
-        {
-            LOG_DEBUG << "try to bind rtp port " << local_rtp_port;
+    auto valid_media_session = media_session_.lock();
 
-            int rtp_sockfd = muduo::net::sockets::CreateNonblockingUdp(AF_INET);
-            muduo::net::InetAddress local_rtp_addr(local_rtp_port);
-            rtp_conn.reset(new muduo::net::UdpVirtualConnection(
-                loop_, "rtp_conn", rtp_sockfd, local_rtp_addr, peer_rtp_addr));
+    MediaSubsessionPtr subsession = valid_media_session->GetSubsession(track);
 
-            if (!rtp_conn->Bind()) {
-                LOG_ERROR << "failed to bind rtp " << local_rtp_addr.IpPort();
-                continue;
-            }
-        }
+    RtpSinkPtr rtp_sink = subsession->NewRtpSink(rtp_conn);
+    MultiFrameSourcePtr frame_source = subsession->NewMultiFrameSouce();
 
-        // rtcp
-        {
-            local_rtcp_port = local_rtp_port + 1;
-            LOG_DEBUG << "try to bind rtcp port " << local_rtcp_port;
-            int rtcp_sockfd =
-                muduo::net::sockets::CreateNonblockingUdp(AF_INET);
+    RtspStreamStatePtr state = std::make_shared<RtspStreamState>(
+        loop_, subsession, rtp_sink, frame_source);
+    state->set_rtcp_sockfd(rtcp_sockfd);
+    state->set_session_latency(valid_media_session->latency());
+
+    RtspStreamState *state_ptr = state.get();
+    rtcp_conn->set_message_callback(
+        [state_ptr](const muduo::net::UdpServerPtr &server,
+                    muduo::net::Buffer *buf, struct sockaddr_in6 *addr,
+                    muduo::event_loop::Timestamp timestamp) {
+            state_ptr->OnUdpRtcpMessage(server, buf, addr, timestamp);
+        });
+
+    // 只捕获裸指针，保持在std::function的内联存储中; rtcp_conn由会话持有
+    muduo::net::UdpVirtualConnection *rtcp_conn_ptr = rtcp_conn.get();
+    state->set_send_rtcp_message_callback(
+        [this, rtcp_conn_ptr](const RtcpMessageVector &msg) {
+            SendUdpRtcpMessages(rtcp_conn_ptr, msg);
+        });
 
-            muduo::net::InetAddress local_rtcp_addr(local_rtcp_port);
+    rtcp_conns_.push_back(rtcp_conn);
+    states_.push_back(state);
+    tracks_.push_back(track);
+    scheduler_->Add(state.get());
 
-            rtcp_conn.reset(new muduo::net::UdpVirtualConnection(
-                loop_, "rtcp_conn", rtcp_sockfd, local_rtcp_addr,
-                peer_rtcp_addr));
+    AddBinding(kPortRtp, local_rtp_port, state.get());
+    AddBinding(kPortRtcp, local_rtcp_port, state.get());
+}
 
-            if (!rtcp_conn->Bind()) {
-                LOG_ERROR << "failed to bind rtcp " << local_rtcp_addr.IpPort();
-                continue;
-            }
-        }
+void RtspSession::Setup(const std::string &track,
+                        const muduo::net::TcpConnectionPtr &tcp_conn,
+                        int8_t rtp_channel, int8_t rtcp_channel) {
 
-        rtp_conn->BindingFinished();
-        rtcp_conn->BindingFinished();
+    tcp_conn_ = tcp_conn;
 
+    if (id_ < 0) {
+        std::random_device rd;
         id_ = rd() & 0xffffff;
-        break;
     }
-
     auto valid_media_session = media_session_.lock();
 
     MediaSubsessionPtr subsession = valid_media_session->GetSubsession(track);
 
-    RtpSinkPtr rtp_sink = subsession->NewRtpSink(rtp_conn);
+    RtpSinkPtr rtp_sink = subsession->NewRtpSink(tcp_conn, rtp_channel);
     MultiFrameSourcePtr frame_source = subsession->NewMultiFrameSouce();
 
     RtspStreamStatePtr state = std::make_shared<RtspStreamState>(
         loop_, subsession, rtp_sink, frame_source);
+    state->set_session_latency(valid_media_session->latency());
+    uint8_t channel = (uint8_t)rtcp_channel;
+    state->set_send_rtcp_message_callback(
+        [this, channel](const RtcpMessageVector &msg) {
+            SendTcpRtcpMessages(channel, msg);
+        });
 
-    rtcp_conn->set_message_callback(std::bind(
-        &RtspStreamState::OnUdpRtcpMessage, state.get(), std::placeholders::_1,
-        std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    states_.push_back(state);
+    tracks_.push_back(track);
+    scheduler_->Add(state.get());
 
-    // state holds the rtcp_conn by function object
-    state->set_send_rtcp_message_callback(
-        std::bind(&RtspSession::SendUdpRtcpMessages, this, rtcp_conn,
-                  std::placeholders::_1));
+    AddBinding(kChannelRtp, (uint8_t)rtp_channel, state.get());
+    AddBinding(kChannelRtcp, (uint8_t)rtcp_channel, state.get());
+}
+
+void RtspSession::SetupRecord(const std::string &track,
+                              const LiveStreamHubPtr &hub,
+                              const muduo::net::InetAddress &peer_rtp_addr,
+                              const muduo::net::InetAddress &peer_rtcp_addr,
+                              unsigned short &local_rtp_port,
+                              unsigned short &local_rtcp_port) {
+
+    muduo::net::UdpVirtualConnectionPtr rtp_conn;
+    muduo::net::UdpVirtualConnectionPtr rtcp_conn;
+    int rtcp_sockfd = -1;
+    BindUdpPorts(peer_rtp_addr, peer_rtcp_addr, local_rtp_port,
+                 local_rtcp_port, &rtp_conn, &rtcp_conn, &rtcp_sockfd);
+
+    std::shared_ptr<RtspIngestState> state =
+        std::make_shared<RtspIngestState>(loop_, hub);
+
+    RtspIngestState *state_ptr = state.get();
+    rtp_conn->set_message_callback(
+        [state_ptr](const muduo::net::UdpServerPtr &server,
+                    muduo::net::Buffer *buf, struct sockaddr_in6 *addr,
+                    muduo::event_loop::Timestamp timestamp) {
+            state_ptr->OnUdpRtpMessage(server, buf, addr, timestamp);
+        });
+    rtcp_conn->set_message_callback(
+        [state_ptr](const muduo::net::UdpServerPtr &server,
+                    muduo::net::Buffer *buf, struct sockaddr_in6 *addr,
+                    muduo::event_loop::Timestamp timestamp) {
+            state_ptr->OnUdpRtcpMessage(server, buf, addr, timestamp);
+        });
+
+    rtp_conns_.push_back(rtp_conn);
+    rtcp_conns_.push_back(rtcp_conn);
+    states_.push_back(state);
+    tracks_.push_back(track);
+
+    AddBinding(kPortRtp, local_rtp_port, state.get());
+    AddBinding(kPortRtcp, local_rtcp_port, state.get());
+}
 
-    states_.insert(std::make_pair(track, state));
+void RtspSession::SetupRecord(const std::string &track,
+                              const LiveStreamHubPtr &hub,
+                              const muduo::net::TcpConnectionPtr &tcp_conn,
+                              int8_t rtp_channel, int8_t rtcp_channel) {
 
-    {
-        std::shared_ptr<ChannelOrPortStreamBinding> rtp_binding =
-            std::make_shared<ChannelOrPortStreamBinding>();
-        rtp_binding->cop_type = kPortRtp;
-        rtp_binding->cop_rtp = local_rtp_port;
-        rtp_binding->cop_rtcp = local_rtcp_port;
-        rtp_binding->media_subsession = track;
-        rtp_binding->state = state;
+    tcp_conn_ = tcp_conn;
 
-        binding_states_.insert(std::make_pair(local_rtp_port, rtp_binding));
+    if (id_ < 0) {
+        std::random_device rd;
+        id_ = rd() & 0xffffff;
     }
 
-    {
-        std::shared_ptr<ChannelOrPortStreamBinding> rtcp_binding =
-            std::make_shared<ChannelOrPortStreamBinding>();
-        rtcp_binding->cop_type = kPortRtcp;
-        rtcp_binding->cop_rtp = local_rtp_port;
-        rtcp_binding->cop_rtcp = local_rtcp_port;
-        rtcp_binding->media_subsession = track;
-        rtcp_binding->state = state;
-        binding_states_.insert(std::make_pair(local_rtcp_port, rtcp_binding));
-    }
+    StreamStatePtr state = std::make_shared<RtspIngestState>(loop_, hub);
+    states_.push_back(state);
+    tracks_.push_back(track);
+
+    AddBinding(kChannelRtp, (uint8_t)rtp_channel, state.get());
+    AddBinding(kChannelRtcp, (uint8_t)rtcp_channel, state.get());
 }
 
-void RtspSession::Setup(const std::string &track,
-                        const muduo::net::TcpConnectionPtr &tcp_conn,
-                        int8_t rtp_channel, int8_t rtcp_channel) {
+bool RtspSession::HasTrack(const std::string &track) const {
+    return std::find(tracks_.begin(), tracks_.end(), track) != tracks_.end();
+}
 
-    tcp_conn_ = tcp_conn;
+void RtspSession::Play() {
+    for (auto &&state : states_) {
+        state->Play();
+    }
+    // 按帧率发送的各路流共用一个时钟和定时器
+    scheduler_->Start();
+}
 
-    std::random_device rd;
-    id_ = rd() & 0xffffff;
-    auto valid_media_session = media_session_.lock();
+bool RtspSession::Seek(double npt, double *start_npt) {
+    if (states_.empty()) {
+        return false;
+    }
 
-    MediaSubsessionPtr subsession = valid_media_session->GetSubsession(track);
+    // 各轨道关键帧位置不同，其余轨道从第一个流的位置开始以保持同步
+    if (!states_[0]->Seek(npt, start_npt)) {
+        return false;
+    }
+    double actual = 0;
+    for (size_t i = 1; i < states_.size(); ++i) {
+        if (!states_[i]->Seek(*start_npt, &actual)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    RtpSinkPtr rtp_sink = subsession->NewRtpSink(tcp_conn, rtp_channel);
-    MultiFrameSourcePtr frame_source = subsession->NewMultiFrameSouce();
+bool RtspSession::Position(double *npt) const {
+    return !states_.empty() && states_[0]->Position(npt);
+}
 
-    RtspStreamStatePtr state = std::make_shared<RtspStreamState>(
-        loop_, subsession, rtp_sink, frame_source);
-    state->set_send_rtcp_message_callback(
-        std::bind(&RtspSession::SendTcpRtcpMessages, this, rtcp_channel,
-                  std::placeholders::_1));
+bool RtspSession::played() const {
+    return !states_.empty() && states_[0]->play_times() > 0;
+}
 
-    states_.insert(std::make_pair(track, state));
+bool RtspSession::TimeShift(double offset, double *start_offset) {
+    if (states_.empty()) {
+        return false;
+    }
 
-    {
-        std::shared_ptr<ChannelOrPortStreamBinding> rtp_binding =
-            std::make_shared<ChannelOrPortStreamBinding>();
-        rtp_binding->cop_type = kChannelRtp;
-        rtp_binding->cop_rtp = rtp_channel;
-        rtp_binding->cop_rtcp = rtcp_channel;
-        rtp_binding->media_subsession = track;
-        rtp_binding->state = state;
+    if (!states_[0]->TimeShift(offset, start_offset)) {
+        return false;
+    }
+    double actual = 0;
+    for (size_t i = 1; i < states_.size(); ++i) {
+        if (!states_[i]->TimeShift(*start_offset, &actual)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        binding_states_.insert(std::make_pair(rtp_channel, rtp_binding));
+bool RtspSession::SetScale(double scale) {
+    for (auto &&state : states_) {
+        if (!state->SetScale(scale)) {
+            for (auto &&s : states_) {
+                s->SetScale(1.0);
+            }
+            return false;
+        }
     }
+    return true;
+}
 
-    {
-        std::shared_ptr<ChannelOrPortStreamBinding> rtcp_binding =
-            std::make_shared<ChannelOrPortStreamBinding>();
-        rtcp_binding->cop_type = kChannelRtcp;
-        rtcp_binding->cop_rtp = rtp_channel;
-        rtcp_binding->cop_rtcp = rtcp_channel;
-        rtcp_binding->media_subsession = track;
-        rtcp_binding->state = state;
-        binding_states_.insert(std::make_pair(rtcp_channel, rtcp_binding));
+bool RtspSession::SetSpeed(double speed) {
+    for (auto &&state : states_) {
+        if (!state->SetSpeed(speed)) {
+            for (auto &&s : states_) {
+                s->SetSpeed(1.0);
+            }
+            return false;
+        }
     }
+    return true;
 }
 
-void RtspSession::Play() {
-    for (auto &&i : states_) {
-        i.second->Play();
+void RtspSession::OnWriteComplete() {
+    for (auto &&state : states_) {
+        state->OnWriteComplete();
     }
 }
 
 void RtspSession::Teardown() {
-    for (auto &&i : states_) {
-        i.second->Teardown();
+    scheduler_->Stop();
+    for (auto &&state : states_) {
+        state->Teardown();
     }
     // TODO: release session
 }
@@ -185,20 +271,88 @@ void RtspSession::Teardown() {
 void RtspSession::ParseTcpInterleavedFrameBody(uint8_t channel, const char *buf,
                                                size_t size) {
 
-    auto it = binding_states_.find(channel);
-    if (it == binding_states_.end()) {
-        LOG_ERROR << "can't find channel " << channel << " binding";
+    for (auto &&binding : bindings_) {
+        if (binding.cop != channel || (binding.cop_type != kChannelRtp &&
+                                       binding.cop_type != kChannelRtcp)) {
+            continue;
+        }
+
+        if (binding.cop_type == kChannelRtcp) {
+            binding.state->ParseRTCP(buf, size);
+        } else {
+            binding.state->ParseRTP(buf, size);
+        }
         return;
     }
 
-    if (it->second->cop_type == kChannelRtcp ||
-        it->second->cop_type == kPortRtcp) {
-        it->second->state->ParseRTCP(buf, size);
-    } else {
-        it->second->state->ParseRTP(buf, size);
+    LOG_ERROR << "can't find channel " << channel << " binding";
+}
+
+void RtspSession::BindUdpPorts(const muduo::net::InetAddress &peer_rtp_addr,
+                               const muduo::net::InetAddress &peer_rtcp_addr,
+                               unsigned short &local_rtp_port,
+                               unsigned short &local_rtcp_port,
+                               muduo::net::UdpVirtualConnectionPtr *rtp_conn,
+                               muduo::net::UdpVirtualConnectionPtr *rtcp_conn,
+                               int *rtcp_sockfd) {
+    std::random_device rd;
+
+    for (;;) {
+        local_rtp_port = rd() & 0xfffe;
+
+        // rtp
+        {
+            LOG_DEBUG << "try to bind rtp port " << local_rtp_port;
+
+            int rtp_sockfd = muduo::net::sockets::CreateNonblockingUdp(AF_INET);
+            muduo::net::InetAddress local_rtp_addr(local_rtp_port);
+            rtp_conn->reset(new muduo::net::UdpVirtualConnection(
+                loop_, "rtp_conn", rtp_sockfd, local_rtp_addr, peer_rtp_addr));
+
+            if (!(*rtp_conn)->Bind()) {
+                LOG_ERROR << "failed to bind rtp " << local_rtp_addr.IpPort();
+                continue;
+            }
+        }
+
+        // rtcp
+        {
+            local_rtcp_port = local_rtp_port + 1;
+            LOG_DEBUG << "try to bind rtcp port " << local_rtcp_port;
+            *rtcp_sockfd = muduo::net::sockets::CreateNonblockingUdp(AF_INET);
+
+            muduo::net::InetAddress local_rtcp_addr(local_rtcp_port);
+
+            rtcp_conn->reset(new muduo::net::UdpVirtualConnection(
+                loop_, "rtcp_conn", *rtcp_sockfd, local_rtcp_addr,
+                peer_rtcp_addr));
+
+            if (!(*rtcp_conn)->Bind()) {
+                LOG_ERROR << "failed to bind rtcp " << local_rtcp_addr.IpPort();
+                continue;
+            }
+        }
+
+        (*rtp_conn)->BindingFinished();
+        (*rtcp_conn)->BindingFinished();
+
+        // 同一会话的多路流共用一个id
+        if (id_ < 0) {
+            id_ = rd() & 0xffffff;
+        }
+        break;
     }
 }
 
+void RtspSession::AddBinding(ChannelOrPortType type, uint16_t cop,
+                             StreamState *state) {
+    ChannelOrPortStreamBinding binding;
+    binding.cop_type = type;
+    binding.cop = cop;
+    binding.state = state;
+    bindings_.push_back(binding);
+}
+
 void RtspSession::SendTcpRtcpMessages(
     uint8_t channel, const std::vector<std::shared_ptr<RtcpMessage>> &msg) {
     LOG_DEBUG << "send RTCP on channel " << channel;
@@ -220,8 +374,7 @@ void RtspSession::SendTcpRtcpMessages(
 }
 
 void RtspSession::SendUdpRtcpMessages(
-    const std::shared_ptr<muduo::net::UdpVirtualConnection> &udp_conn,
-    const RtcpMessageVector &msg) {
+    muduo::net::UdpVirtualConnection *udp_conn, const RtcpMessageVector &msg) {
     LOG_DEBUG << "send RTCP on udp " << udp_conn->name();
 
     std::string binary;
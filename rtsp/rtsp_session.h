@@ -1,16 +1,20 @@
 #ifndef ED091CCA_7ECE_478F_86D7_589C367B2D77
 #define ED091CCA_7ECE_478F_86D7_589C367B2D77
 
+#include "media/live_stream_hub.h"
 #include "media/rtcp.h"
 #include "media_session.h"
 #include "net/udp_virtual_connection.h"
 #include "stream_state.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace muduo_media {
 
 class RtpConnection;
+class SessionScheduler;
 
 class RtspSession {
 public:
@@ -29,30 +33,83 @@ public:
                const muduo::net::TcpConnectionPtr &tcp_conn, int8_t rtp_channel,
                int8_t rtcp_channel);
 
+    // 推流(RECORD)，over udp
+    void SetupRecord(const std::string &track, const LiveStreamHubPtr &hub,
+                     const muduo::net::InetAddress &peer_rtp_addr,
+                     const muduo::net::InetAddress &peer_rtcp_addr,
+                     unsigned short &local_rtp_port,
+                     unsigned short &local_rtcp_port);
+
+    // 推流(RECORD)，over tcp
+    void SetupRecord(const std::string &track, const LiveStreamHubPtr &hub,
+                     const muduo::net::TcpConnectionPtr &tcp_conn,
+                     int8_t rtp_channel, int8_t rtcp_channel);
+
     int id() const { return id_; }
 
+    /// track是否已经SETUP过，重复SETUP同一轨道会发送两份数据
+    bool HasTrack(const std::string &track) const;
+
     void Play();
+
+    /// 所有流定位到npt之前最近的关键帧，start_npt取第一个流的实际位置。
+    /// 任一流不支持定位时返回false
+    bool Seek(double npt, double *start_npt);
+
+    /// 第一个流下一帧的npt，实时流或者没有流时返回false
+    bool Position(double *npt) const;
+
+    /// 是否已经PLAY过
+    bool played() const;
+
+    /// 直播时移，offset为相对直播位置的秒数(<= 0)，其余同Seek
+    bool TimeShift(double offset, double *start_offset);
+
+    /// 所有流设置播放速率，任一流不支持时全部恢复为1并返回false
+    bool SetScale(double scale);
+
+    /// 所有流设置发送速度，任一流不支持时全部恢复为1并返回false
+    bool SetSpeed(double speed);
+
+    /// TCP连接发送缓冲写空，驱动不限速发送的流
+    void OnWriteComplete();
+
     void Teardown();
 
     void ParseTcpInterleavedFrameBody(uint8_t channel, const char *buf,
                                       size_t size);
 
 private:
-    enum ChannelOrPortType { kChannelRtp, kChannelRtcp, kPortRtp, kPortRtcp };
+    enum ChannelOrPortType : uint8_t {
+        kChannelRtp,
+        kChannelRtcp,
+        kPortRtp,
+        kPortRtcp
+    };
+
+    // 一个会话只有几路流，平铺存储并线性查找，不为每个通道分配堆对象
     struct ChannelOrPortStreamBinding {
         ChannelOrPortType cop_type;
-        uint16_t cop_rtp;
-        uint16_t cop_rtcp;
-        std::string media_subsession;
-        StreamStatePtr state;
+        uint16_t cop; // channel or port
+        StreamState *state; // owned by states_
     };
 
 private:
+    void AddBinding(ChannelOrPortType type, uint16_t cop, StreamState *state);
+
+    // 绑定一对相邻的本地端口，同时生成会话id
+    void BindUdpPorts(const muduo::net::InetAddress &peer_rtp_addr,
+                      const muduo::net::InetAddress &peer_rtcp_addr,
+                      unsigned short &local_rtp_port,
+                      unsigned short &local_rtcp_port,
+                      muduo::net::UdpVirtualConnectionPtr *rtp_conn,
+                      muduo::net::UdpVirtualConnectionPtr *rtcp_conn,
+                      int *rtcp_sockfd);
+
     void SendTcpRtcpMessages(uint8_t channel, const RtcpMessageVector &msg);
 
-    void SendUdpRtcpMessages(
-        const std::shared_ptr<muduo::net::UdpVirtualConnection> &,
-        const RtcpMessageVector &msg);
+    void SendUdpRtcpMessages(muduo::net::UdpVirtualConnection *udp_conn,
+                             const RtcpMessageVector &msg);
 
 private:
     muduo::event_loop::EventLoop *loop_;
@@ -61,10 +118,17 @@ private:
 
     muduo::net::TcpConnectionPtr tcp_conn_;
 
-    std::map<uint8_t, std::shared_ptr<ChannelOrPortStreamBinding>>
-        binding_states_;
+    std::vector<ChannelOrPortStreamBinding> bindings_;
+    std::vector<StreamStatePtr> states_;
+    std::vector<std::string> tracks_; // 已SETUP的轨道
+
+    // 持有states_中RtspStreamState的裸指针，先于states_释放
+    std::shared_ptr<SessionScheduler> scheduler_;
 
-    std::map<std::string, StreamStatePtr> states_;
+    // over udp, rtcp连接由会话持有
+    std::vector<muduo::net::UdpVirtualConnectionPtr> rtcp_conns_;
+    // 推流时rtp连接也由会话持有，播放时由sink持有
+    std::vector<muduo::net::UdpVirtualConnectionPtr> rtp_conns_;
 };
 
 using RtspSessionPtr = std::shared_ptr<RtspSession>;
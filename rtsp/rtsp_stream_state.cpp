@@ -1,15 +1,31 @@
 #include "rtsp_stream_state.h"
+#include "eventloop/channel.h"
 #include "eventloop/endian.h"
-#include "logger/logger.h"
+#include "media/media_log.h"
 #include "media/av_packet.h"
 #include "media/defs.h"
 #include "media/rtcp.h"
 #include "media/rtp.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
 #include <random>
 
+#include <sys/socket.h>
+
 namespace muduo_media {
 
+static constexpr int kRtcpBatchSize = 16;
+static constexpr size_t kRtcpDatagramSize = 1500;
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 RtspStreamState::RtspStreamState(muduo::event_loop::EventLoop *loop,
                                  const MediaSubsessionPtr &media_subsession,
                                  const RtpSinkPtr &rtp_sink,
@@ -18,14 +34,51 @@ RtspStreamState::RtspStreamState(muduo::event_loop::EventLoop *loop,
       media_subsession_(media_subsession),
       rtp_sink_(rtp_sink),
       frame_source_(frame_source),
+      rtcp_sockfd_(-1),
       last_rtp_ts_(0),
-      play_interval_(0.0) {
+      clock_rate_(90000),
+      play_interval_(0.0),
+      play_generation_(0),
+      npt_(0),
+      live_(false),
+      scale_(1.0),
+      next_ts_step_(0),
+      speed_(1.0),
+      bulk_(false),
+      bulk_update_ts_(true),
+      bulk_start_us_(0),
+      bulk_octets_(0),
+      scheduled_(false),
+      rtp_base_(0),
+      play_start_us_(0),
+      first_frame_sent_(false),
+      sink_packets_(0),
+      sink_octets_(0),
+      sink_dropped_(0),
+      queued_bytes_(0) {
 
     LOG_DEBUG << "RtspStreamState::ctor at " << this;
 }
 
 RtspStreamState::~RtspStreamState() {
     LOG_DEBUG << "RtspStreamState::dtor at " << this;
+    if (playing_) {
+        metrics_->streams_playing.Sub();
+    }
+    metrics_->output_queue_bytes.Sub(queued_bytes_);
+    metrics_->rtcp_fraction_lost.Sub(rtcp_stats_.fraction_lost);
+    metrics_->rtcp_jitter.Sub(rtcp_stats_.jitter);
+
+    if (wakeup_channel_) {
+        wakeup_channel_->DisableAll();
+        wakeup_channel_->Remove();
+        wakeup_channel_.reset();
+    }
+
+    if (frame_source_) {
+        frame_source_->StopPush();
+    }
+
     // reset members, they could be used in timer function object
     frame_source_.reset();
     media_subsession_.reset();
@@ -34,62 +87,139 @@ RtspStreamState::~RtspStreamState() {
 }
 
 void RtspStreamState::Play() {
+    ++play_times_;
+    metrics_->play_requests.Add();
+    if (!playing_) {
+        metrics_->streams_playing.Add();
+    }
     playing_ = true;
+    play_start_us_ = NowMicros();
+    first_frame_sent_ = false;
     try {
         ts_duration_ = media_subsession_->Duration();
-        play_interval_ = 1 / media_subsession_->fps();
+        play_interval_ = media_subsession_->FrameInterval();
+        clock_rate_ = media_subsession_->time_base();
     } catch (...) {
         ts_duration_ = defs::kMediaTsDuration;
         play_interval_ = 0.04;
+        clock_rate_ = 90000;
+    }
+    next_ts_step_ = ts_duration_;
+    scheduled_ = false;
+
+    if (frame_source_->StartPush(loop_, [this](const AVPacket &packet) {
+            OnPushedFrame(packet);
+        })) {
+        live_ = true;
+        return;
+    }
+
+    if (frame_source_->wakeup_fd() >= 0) {
+        live_ = true;
+        StartLive();
+        return;
+    }
+    live_ = false;
+
+    if (bulk_) {
+        bulk_update_ts_ = true;
+        bulk_start_us_ = NowMicros();
+        bulk_octets_ = 0;
+        QueuePumpBulk(++play_generation_);
+        return;
+    }
+
+    // 按帧率发送的流由RtspSession的SessionScheduler统一驱动。重新PLAY时
+    // 接着上一帧的时间戳
+    if (0 == last_rtp_ts_) {
+        std::random_device rd;
+        last_rtp_ts_ = rd() & 0xffffff;
+    }
+    rtp_base_ = last_rtp_ts_ + ts_duration_;
+    ++play_generation_;
+    scheduled_ = true;
+}
+
+bool RtspStreamState::SetScale(double scale) {
+    if (!frame_source_ || !frame_source_->SetScale(scale)) {
+        return false;
+    }
+    scale_ = scale;
+    return true;
+}
+
+bool RtspStreamState::SetSpeed(double speed) {
+    if (speed <= 0) {
+        return false;
+    }
+    // 没有发送队列(UDP)时无法感知拥塞，不能不限速
+    bool bulk = speed >= kBulkSpeed;
+    if (bulk && !rtp_sink_->HasOutputQueue()) {
+        return false;
+    }
+    speed_ = speed;
+    bulk_ = bulk;
+    return true;
+}
+
+void RtspStreamState::OnWriteComplete() {
+    if (bulk_ && playing_) {
+        PumpBulk(play_generation_);
     }
+}
+
+bool RtspStreamState::Seek(double npt, double *start_npt) {
+    if (!frame_source_ || !frame_source_->Seek(npt, start_npt)) {
+        return false;
+    }
+    LOG_DEBUG << "seek " << npt << " -> " << *start_npt << " at " << this;
+    npt_ = *start_npt;
+    return true;
+}
+
+bool RtspStreamState::Position(double *npt) const {
+    if (live_) {
+        return false;
+    }
+    *npt = std::max(npt_, 0.0);
+    return true;
+}
+
+void RtspStreamState::AdvancePosition(const AVPacket &packet) {
+    double step = packet.frame_span * play_interval_;
+    npt_ += scale_ < 0 ? -step : step;
+}
 
-    loop_->QueueInLoop(std::bind(&RtspStreamState::PlayOnce, this, true));
+bool RtspStreamState::TimeShift(double offset, double *start_offset) {
+    if (!frame_source_ || !frame_source_->TimeShift(offset, start_offset)) {
+        return false;
+    }
+    LOG_DEBUG << "time shift " << offset << " -> " << *start_offset << " at "
+              << this;
+    return true;
 }
 
-void RtspStreamState::Teardown() { playing_ = false; }
+void RtspStreamState::Teardown() {
+    if (playing_) {
+        metrics_->streams_playing.Sub();
+    }
+    playing_ = false;
+    scheduled_ = false;
+    StopLive();
+    frame_source_->StopPush();
+    rtp_sink_->Flush();
+}
 
 void RtspStreamState::ParseRTP(const char *buf, size_t size) {}
 
 void RtspStreamState::ParseRTCP(const char *buf, size_t size) {
-    size_t parse_size = 0;
-    size_t left_size = size;
-    while (left_size > sizeof(RtcpHeader)) {
-        RtcpHeader rtcp_header = {0};
-        memcpy(&rtcp_header, buf + parse_size, sizeof(RtcpHeader));
-        rtcp_header.length = muduo::NetworkToHost16(rtcp_header.length);
-        rtcp_header.ssrc = muduo::NetworkToHost32(rtcp_header.ssrc);
-
-        size_t packet_size = (rtcp_header.length + 1) * RTCP_LENGTH_DWORD;
-
-        LOG_DEBUG << "RTCP V " << rtcp_header.v << ", P " << rtcp_header.p
-                  << ", RC " << rtcp_header.rc << ", PT " << rtcp_header.pt
-                  << ", length " << rtcp_header.length << ", ssrc "
-                  << rtcp_header.ssrc << ", RTCP packet size " << packet_size;
-
-        if (rtcp_header.pt == (uint8_t)RtcpPacketType::RTCP_RR) {
-            std::unique_ptr<RtcpRRMessage> rtcp_rr(new RtcpRRMessage);
-            rtcp_rr->header = rtcp_header;
-            rtcp_rr->Deserialize(buf + parse_size + sizeof(RtcpHeader),
-                                 (rtcp_header.length - 1) * RTCP_LENGTH_DWORD);
-
-        } else if (rtcp_header.pt == (uint8_t)RtcpPacketType::RTCP_SDES) {
-            std::unique_ptr<RtcpSDESMessage> rtcp_sdes(new RtcpSDESMessage);
-            rtcp_sdes->header = rtcp_header;
-            rtcp_sdes->Deserialize(buf + parse_size + sizeof(RtcpHeader) -
-                                       sizeof(rtcp_header.ssrc),
-                                   rtcp_header.length * RTCP_LENGTH_DWORD);
-        } else if (rtcp_header.pt == (uint8_t)RtcpPacketType::RTCP_BYE) {
-            std::unique_ptr<RtcpBYEMessage> rtcp_sdes(new RtcpBYEMessage);
-            rtcp_sdes->header = rtcp_header;
-            rtcp_sdes->Deserialize(buf + parse_size + sizeof(RtcpHeader),
-                                   (rtcp_header.length - 1) *
-                                       RTCP_LENGTH_DWORD);
-        }
+    RtcpReceiverStats delta;
+    delta.Accumulate(buf, size);
+    MergeRtcpStats(delta);
 
-        parse_size += packet_size;
-        left_size -= packet_size;
-        LOG_TRACE << "left size " << left_size;
-    }
+    LOG_TRACE << "RTCP size " << size << ", report blocks "
+              << delta.report_blocks << ", jitter " << rtcp_stats_.jitter
+              << ", packets lost " << rtcp_stats_.cumulative_lost;
 }
 
 void RtspStreamState::OnUdpRtcpMessage(const muduo::net::UdpServerPtr &,
@@ -97,33 +227,138 @@ void RtspStreamState::OnUdpRtcpMessage(const muduo::net::UdpServerPtr &,
                                        struct sockaddr_in6 *addr,
                                        muduo::event_loop::Timestamp timestamp) {
 
-    ParseRTCP(buf->Peek(), buf->ReadableBytes());
-
+    RtcpReceiverStats delta;
+    delta.Accumulate(buf->Peek(), buf->ReadableBytes());
     buf->RetrieveAll();
+
+    // 一次唤醒把socket中排队的RTCP全部取走
+    if (rtcp_sockfd_ >= 0) {
+        DrainUdpRtcp(&delta);
+    }
+
+    MergeRtcpStats(delta);
+
+    LOG_TRACE << "RTCP datagrams " << delta.datagrams << ", report blocks "
+              << delta.report_blocks << ", jitter " << rtcp_stats_.jitter
+              << ", packets lost " << rtcp_stats_.cumulative_lost;
 }
 
-void RtspStreamState::SendRtcpBye() {
-    if (rtcp_cb_) {
-        std::vector<std::shared_ptr<RtcpMessage>> msgs;
+void RtspStreamState::DrainUdpRtcp(RtcpReceiverStats *delta) {
+    // 同一个loop线程中的所有流共用接收缓冲
+    static thread_local char bufs[kRtcpBatchSize][kRtcpDatagramSize];
 
-        std::shared_ptr<RtcpSRMessage> sr = std::make_shared<RtcpSRMessage>();
-        sr->header.ssrc = frame_source_->ssrc();
-        auto &sender_info = sr->sender_info;
+    struct mmsghdr msgs[kRtcpBatchSize];
+    struct iovec iovs[kRtcpBatchSize];
 
-        auto ts = muduo::event_loop::Timestamp::TimespecNow();
-        sender_info.ts_msw =
-            ts.tv_sec + 0x83AA7E80; // NTP timestamp most-significant word (1970
-                                    // epoch -> 1900 epoch)
-        // 1 second = 1,000,000,000,000 picoseconds
-        /* Convert nanoseconds to 32-bits fraction (232 picosecond units) */
-        sender_info.ts_lsw =
-            (uint32_t)((uint64_t)ts.tv_nsec * ((uint64_t)1 << 32) / 1000000000);
+    for (;;) {
+        ::bzero(msgs, sizeof(msgs));
+        for (int i = 0; i < kRtcpBatchSize; ++i) {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = kRtcpDatagramSize;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
 
-        sender_info.rtp_ts = last_rtp_ts_;
-        sender_info.octets = rtp_sink_->octets();
-        sender_info.packets = rtp_sink_->packets();
+        int n = ::recvmmsg(rtcp_sockfd_, msgs, kRtcpBatchSize, MSG_DONTWAIT,
+                           nullptr);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_ERROR << "recvmmsg RTCP fail, errno " << errno;
+            }
+            break;
+        }
 
-        msgs.push_back(sr);
+        for (int i = 0; i < n; ++i) {
+            delta->Accumulate(bufs[i], msgs[i].msg_len);
+        }
+
+        if (n < kRtcpBatchSize) {
+            break;
+        }
+    }
+}
+
+void RtspStreamState::MergeRtcpStats(const RtcpReceiverStats &delta) {
+    metrics_->rtcp_packets.Add(delta.sr_packets + delta.rr_packets +
+                               delta.sdes_packets + delta.bye_packets +
+                               delta.other_packets);
+    metrics_->rtcp_malformed.Add(delta.malformed);
+
+    if (delta.report_blocks > 0) {
+        if (delta.cumulative_lost > rtcp_stats_.cumulative_lost) {
+            metrics_->rtcp_packets_lost.Add(delta.cumulative_lost -
+                                            rtcp_stats_.cumulative_lost);
+        }
+        metrics_->rtcp_fraction_lost.Add((int64_t)delta.fraction_lost -
+                                         rtcp_stats_.fraction_lost);
+        metrics_->rtcp_jitter.Add((int64_t)delta.jitter - rtcp_stats_.jitter);
+    }
+
+    rtcp_stats_.Merge(delta);
+}
+
+void RtspStreamState::RecordLatency(
+    LatencyHistogram LatencyMetrics::*histogram, int64_t us) {
+    (metrics_->latency.*histogram).Record(us);
+    if (session_latency_) {
+        ((*session_latency_).*histogram).Record(us);
+    }
+}
+
+void RtspStreamState::UpdateSinkMetrics() {
+    uint32_t packets = rtp_sink_->packets();
+    uint32_t octets = rtp_sink_->octets();
+    uint32_t dropped = rtp_sink_->dropped_frames();
+    size_t queued = rtp_sink_->QueuedBytes();
+
+    // 无符号相减，计数回绕也能得到正确增量
+    metrics_->rtp_packets.Add((uint32_t)(packets - sink_packets_));
+    metrics_->rtp_octets.Add((uint32_t)(octets - sink_octets_));
+    metrics_->frames_dropped.Add((uint32_t)(dropped - sink_dropped_));
+    metrics_->output_queue_bytes.Add((int64_t)queued - (int64_t)queued_bytes_);
+    if (bulk_) {
+        metrics_->bulk_octets.Add((uint32_t)(octets - sink_octets_));
+        bulk_octets_ += (uint32_t)(octets - sink_octets_);
+    }
+
+    sink_packets_ = packets;
+    sink_octets_ = octets;
+    sink_dropped_ = dropped;
+    queued_bytes_ = queued;
+}
+
+RtcpMessagePtr RtspStreamState::MakeSenderReport(uint32_t rtp_ts) {
+    std::shared_ptr<RtcpSRMessage> sr = std::make_shared<RtcpSRMessage>();
+    sr->header.ssrc = frame_source_->ssrc();
+    auto &sender_info = sr->sender_info;
+
+    auto ts = muduo::event_loop::Timestamp::TimespecNow();
+    sender_info.ts_msw =
+        ts.tv_sec + 0x83AA7E80; // NTP timestamp most-significant word (1970
+                                // epoch -> 1900 epoch)
+    // 1 second = 1,000,000,000,000 picoseconds
+    /* Convert nanoseconds to 32-bits fraction (232 picosecond units) */
+    sender_info.ts_lsw =
+        (uint32_t)((uint64_t)ts.tv_nsec * ((uint64_t)1 << 32) / 1000000000);
+
+    sender_info.rtp_ts = rtp_ts;
+    sender_info.octets = rtp_sink_->octets();
+    sender_info.packets = rtp_sink_->packets();
+    return sr;
+}
+
+void RtspStreamState::SendSenderReport(double t) {
+    if (rtcp_cb_ && scheduled_ && frame_source_) {
+        RtcpMessageVector msgs;
+        msgs.push_back(MakeSenderReport(RtpTimestamp(t)));
+        rtcp_cb_(msgs);
+    }
+}
+
+void RtspStreamState::SendRtcpBye() {
+    if (rtcp_cb_) {
+        std::vector<std::shared_ptr<RtcpMessage>> msgs;
+        msgs.push_back(MakeSenderReport(last_rtp_ts_));
 
         std::shared_ptr<RtcpBYEMessage> bye =
             std::make_shared<RtcpBYEMessage>();
@@ -134,15 +369,117 @@ void RtspStreamState::SendRtcpBye() {
     }
 }
 
-void RtspStreamState::PlayOnce(bool update_ts) {
+int64_t RtspStreamState::SendPacket(const AVPacket &packet, uint32_t timestamp,
+                                    int64_t read_us) {
+    ++play_frames_;
+    ++play_packets_;
+
+    //  打包成RTP并发送
+    AVPacketInfo info;
+    info.payload_type = media_subsession_->payload_type();
+    info.timestamp = timestamp;
+    info.ssrc = frame_source_->ssrc();
+
+    rtp_sink_->Send(packet, info);
+
+    int64_t sent_us = NowMicros();
+    RecordLatency(&LatencyMetrics::packetize, sent_us - read_us);
+    if (!first_frame_sent_ && (packet.type == NALU_TYPE_IDR ||
+                               packet.type == NALU_TYPE_SLICE)) {
+        first_frame_sent_ = true;
+        RecordLatency(&LatencyMetrics::time_to_first_frame,
+                      sent_us - play_start_us_);
+    }
+    metrics_->frames_sent.Add();
+    UpdateSinkMetrics();
+    return sent_us;
+}
+
+void RtspStreamState::StartLive() {
+    if (!wakeup_channel_) {
+        wakeup_channel_.reset(new muduo::event_loop::Channel(
+            loop_, frame_source_->wakeup_fd()));
+        wakeup_channel_->set_read_callback(
+            [this](muduo::event_loop::Timestamp) { OnLiveReadable(); });
+    }
+    wakeup_channel_->EnableReading();
+
+    // 注册之前可能已经有数据
+    OnLiveReadable();
+}
+
+void RtspStreamState::StopLive() {
+    if (wakeup_channel_) {
+        wakeup_channel_->DisableAll();
+    }
+}
+
+void RtspStreamState::OnLiveReadable() {
+    frame_source_->ClearWakeup();
+
+    if (0 == last_rtp_ts_) {
+        std::random_device rd;
+        last_rtp_ts_ = rd() & 0xffffff;
+    }
+
+    while (playing_) {
+        int64_t start_us = NowMicros();
+        AVPacket frame_packet;
+        if (!frame_source_->GetNextFrame(&frame_packet)) {
+            if (frame_source_->ArmWakeup()) {
+                break;
+            }
+            continue;
+        }
+        int64_t read_us = NowMicros();
+        RecordLatency(&LatencyMetrics::source_read, read_us - start_us);
+
+        // 编码器的pts直接映射到RTP时间戳，同一帧的NALU时间戳相同
+        uint32_t timestamp = frame_packet.pts >= 0
+                                 ? last_rtp_ts_ + (uint32_t)frame_packet.pts
+                                 : last_rtp_ts_;
+
+        LOG_TRACE << "live NALU " << (int)frame_packet.type << ", length "
+                  << frame_packet.size << ", ts " << timestamp;
+
+        SendPacket(frame_packet, timestamp, read_us);
+    }
+}
+
+void RtspStreamState::OnPushedFrame(const AVPacket &packet) {
     if (!playing_) {
-        LOG_DEBUG << "not playing at " << this;
         return;
     }
 
-    // IMPORTANT!!! In timer, this object might be released.
-    if (!frame_source_) {
-        LOG_WARN << "PlayOnce cancel at " << this;
+    if (0 == last_rtp_ts_) {
+        std::random_device rd;
+        last_rtp_ts_ = rd() & 0xffffff;
+    }
+
+    // 与wakeup_fd驱动的实时源一样，pts直接映射到RTP时间戳
+    uint32_t timestamp = packet.pts >= 0
+                             ? last_rtp_ts_ + (uint32_t)packet.pts
+                             : last_rtp_ts_;
+    SendPacket(packet, timestamp, NowMicros());
+
+    if (packet.arrival_us > 0) {
+        RecordLatency(&LatencyMetrics::relay_forward,
+                      NowMicros() - packet.arrival_us);
+    }
+}
+
+void RtspStreamState::QueuePumpBulk(uint32_t generation) {
+    std::weak_ptr<RtspStreamState> weak_self(shared_from_this());
+    loop_->QueueInLoop([weak_self, generation]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->PumpBulk(generation);
+        }
+    });
+}
+
+void RtspStreamState::PumpBulk(uint32_t generation) {
+    if (!playing_ || generation != play_generation_ || !frame_source_) {
         return;
     }
 
@@ -151,43 +488,106 @@ void RtspStreamState::PlayOnce(bool update_ts) {
         last_rtp_ts_ = rd() & 0xffffff;
     }
 
-    AVPacket frame_packet;
-    // 读取一帧, 获取NALU
-    // 同一帧可能有多个NALU，如果是同一个帧的多个NALU则需要立即发送
-    if (!frame_source_->GetNextFrame(&frame_packet)) {
-        LOG_ERROR << "frame source get next frame fail";
-        SendRtcpBye();
-    } else {
+    // 数据追加到连接的发送缓冲，由连接在可写时成批写出。每批有上限，
+    // 避免读文件长时间占用loop
+    uint32_t dropped = rtp_sink_->dropped_frames();
+    int frames = 0;
+    while (rtp_sink_->QueuedBytes() < kBulkHighWaterBytes) {
+        if (frames++ == kBulkBatchFrames) {
+            QueuePumpBulk(generation);
+            return;
+        }
 
-        ++play_frames_;
+        int64_t start_us = NowMicros();
+        AVPacket frame_packet;
+        if (!frame_source_->GetNextFrame(&frame_packet)) {
+            rtp_sink_->Flush();
+            FinishBulk();
+            SendRtcpBye();
+            return;
+        }
+        int64_t read_us = NowMicros();
+        RecordLatency(&LatencyMetrics::source_read, read_us - start_us);
+        AdvancePosition(frame_packet);
 
-        ++play_packets_;
-        //  打包成RTP并发送
+        if (bulk_update_ts_) {
+            last_rtp_ts_ += next_ts_step_;
+        }
+        SendPacket(frame_packet,
+                   last_rtp_ts_ + frame_packet.composition_offset, read_us);
+
+        // 时间戳与按帧率发送时相同
+        bulk_update_ts_ = frame_packet.frame_span != 0;
+        if (bulk_update_ts_) {
+            double step = frame_packet.frame_span / std::fabs(scale_);
+            next_ts_step_ = (uint32_t)(ts_duration_ * step + 0.5);
+        }
+
+        // 连接已断开，sink开始丢帧
+        if (rtp_sink_->dropped_frames() != dropped) {
+            LOG_WARN << "bulk stream stopped, connection lost at " << this;
+            FinishBulk();
+            return;
+        }
+    }
+}
+
+void RtspStreamState::FinishBulk() {
+    double seconds = (NowMicros() - bulk_start_us_) / 1000000.0;
+    double mbytes = bulk_octets_ / (1024.0 * 1024.0);
+    LOG_INFO << "bulk stream sent " << mbytes << " MB in " << seconds
+             << "s, " << (seconds > 0 ? mbytes / seconds : 0) << " MB/s at "
+             << this;
+    bulk_ = false;
+}
+
+uint32_t RtspStreamState::RtpTimestamp(double t) const {
+    // Speed只改变发送快慢，时间戳仍按正常速度推进
+    return rtp_base_ + (uint32_t)std::llround(t * speed_ * clock_rate_);
+}
+
+double RtspStreamState::SendScheduledFrame(double t, int64_t deadline_us) {
+    if (!playing_ || !scheduled_ || !frame_source_) {
+        LOG_DEBUG << "not playing at " << this;
+        return -1;
+    }
 
-        if (update_ts) {
-            last_rtp_ts_ += ts_duration_;
+    int64_t start_us = NowMicros();
+    RecordLatency(&LatencyMetrics::play_timer_lateness, start_us - deadline_us);
+
+    uint32_t timestamp = RtpTimestamp(t);
+    for (;;) {
+        AVPacket frame_packet;
+        bool got_frame = frame_source_->GetNextFrame(&frame_packet);
+        int64_t read_us = NowMicros();
+        RecordLatency(&LatencyMetrics::source_read, read_us - start_us);
+
+        if (!got_frame) {
+            LOG_ERROR << "frame source get next frame fail";
+            scheduled_ = false;
+            rtp_sink_->Flush();
+            SendRtcpBye();
+            return -1;
         }
+        AdvancePosition(frame_packet);
 
+        last_rtp_ts_ = timestamp;
         LOG_TRACE << "NALU " << frame_packet.type << ", length "
-                  << frame_packet.size << ", ts " << last_rtp_ts_;
-
-        AVPacketInfo info;
-        info.payload_type = media_subsession_->payload_type();
-        info.timestamp = last_rtp_ts_;
-        info.ssrc = frame_source_->ssrc();
-
-        rtp_sink_->Send(frame_packet, info);
-
-        if (frame_packet.type == NALU_TYPE_PPS ||
-            frame_packet.type == NALU_TYPE_SEI ||
-            frame_packet.type == NALU_TYPE_SPS) {
-            loop_->QueueInLoop(
-                std::bind(&RtspStreamState::PlayOnce, this, false));
-        } else if (frame_packet.size > 0) { // 计划下一次发送
-            loop_->RunAfter(0.04,
-                            std::bind(&RtspStreamState::PlayOnce, this, true));
+                  << frame_packet.size << ", ts " << timestamp;
+
+        // B帧等的时间戳为展示时间
+        int64_t sent_us = SendPacket(
+            frame_packet, timestamp + frame_packet.composition_offset, read_us);
+
+        // 参数集、SEI等与后面的帧同时发送
+        if (frame_packet.frame_span != 0) {
+            RecordLatency(&LatencyMetrics::deadline_to_send,
+                          sent_us - deadline_us);
+            double step = frame_packet.frame_span / std::fabs(scale_);
+            return play_interval_ * step / speed_;
         }
+        start_us = sent_us;
     }
 }
 
-} // namespace muduo_media
\ No newline at end of file
+} // namespace muduo_media
@@ -7,13 +7,20 @@
 #include "net/udp_virtual_connection.h"
 #include "stream_state.h"
 
+namespace muduo {
+namespace event_loop {
+class Channel;
+} // namespace event_loop
+} // namespace muduo
+
 namespace muduo_media {
 
 using SendRtcpMessageCallback =
     std::function<void(const std::vector<std::shared_ptr<RtcpMessage>> &)>;
 
 /// @brief RtspSession中表示当前流的状态
-class RtspStreamState : public StreamState {
+class RtspStreamState : public StreamState,
+                        public std::enable_shared_from_this<RtspStreamState> {
 public:
     RtspStreamState(muduo::event_loop::EventLoop *loop,
                     const MediaSubsessionPtr &media_subsession,
@@ -23,6 +30,17 @@ public:
 
     virtual void Play() override;
     virtual void Teardown() override;
+    virtual bool Seek(double npt, double *start_npt) override;
+    virtual bool Position(double *npt) const override;
+    virtual bool TimeShift(double offset, double *start_offset) override;
+    virtual bool SetScale(double scale) override;
+    virtual bool SetSpeed(double speed) override;
+    virtual void OnWriteComplete() override;
+
+    // Speed不小于该值时不再按帧率定时，只要TCP发送缓冲未满就继续发送
+    static constexpr double kBulkSpeed = 16.0;
+    static constexpr size_t kBulkHighWaterBytes = 4 * 1024 * 1024;
+    static constexpr int kBulkBatchFrames = 64;
 
     virtual void ParseRTP(const char *buf, size_t size) override;
     virtual void ParseRTCP(const char *buf, size_t size) override;
@@ -31,13 +49,63 @@ public:
         rtcp_cb_ = cb;
     }
 
+    // 用于recvmmsg批量收取同一socket上已到达的RTCP
+    void set_rtcp_sockfd(int sockfd) { rtcp_sockfd_ = sockfd; }
+
+    void set_session_latency(const LatencyMetricsPtr &latency) {
+        session_latency_ = latency;
+    }
+
     void OnUdpRtcpMessage(const muduo::net::UdpServerPtr &,
                           muduo::net::Buffer *, struct sockaddr_in6 *,
                           muduo::event_loop::Timestamp);
 
+    /// Play后由SessionScheduler按帧率驱动
+    bool scheduled() const { return scheduled_; }
+
+    /// 发送媒体时间t(秒)处的一帧及其前面的参数集等，deadline_us为预期发送
+    /// 时刻。返回距下一帧的时间(秒)，结束时返回负数
+    double SendScheduledFrame(double t, int64_t deadline_us);
+
+    /// 发送SR，t为当前的媒体时间
+    void SendSenderReport(double t);
+
 private:
-    void PlayOnce(bool update_ts);
+    // 媒体时间t对应的RTP时间戳
+    uint32_t RtpTimestamp(double t) const;
+
+    // 按读出的帧推进npt_，倒放时后退
+    void AdvancePosition(const AVPacket &packet);
+
+    // 不限速发送，发送缓冲到达高水位后等待OnWriteComplete
+    void PumpBulk(uint32_t generation);
+    // 下一批放到loop队列中，只捕获weak_ptr，流可能在此之前被TEARDOWN
+    void QueuePumpBulk(uint32_t generation);
+    void FinishBulk();
 
+    // 返回发送完成的时间(us)
+    int64_t SendPacket(const AVPacket &packet, uint32_t timestamp,
+                       int64_t read_us);
+
+    // 实时源由wakeup_fd驱动，有数据就发送
+    void StartLive();
+    void StopLive();
+    void OnLiveReadable();
+
+    // 推送源(LiveFrameSource)的帧
+    void OnPushedFrame(const AVPacket &packet);
+
+    void DrainUdpRtcp(RtcpReceiverStats *delta);
+
+    void MergeRtcpStats(const RtcpReceiverStats &delta);
+
+    void UpdateSinkMetrics();
+
+    // 同时计入loop和MediaSession的直方图
+    void RecordLatency(LatencyHistogram LatencyMetrics::*histogram,
+                       int64_t us);
+
+    RtcpMessagePtr MakeSenderReport(uint32_t rtp_ts);
     void SendRtcpBye();
 
 private:
@@ -45,11 +113,47 @@ private:
     RtpSinkPtr rtp_sink_;
     MultiFrameSourcePtr frame_source_;
 
+    std::unique_ptr<muduo::event_loop::Channel> wakeup_channel_;
+
     SendRtcpMessageCallback rtcp_cb_;
+    int rtcp_sockfd_;
 
     uint32_t last_rtp_ts_;
     uint32_t ts_duration_;
+    unsigned int clock_rate_;
     double play_interval_;
+    uint32_t play_generation_;
+
+    // 从源读出的下一帧的npt，Seek时重置。live_为实时源，没有位置
+    double npt_;
+    bool live_;
+
+    // 快进/倒放时帧间隔和时间戳增量都按frame_span/|scale|缩放，
+    // 客户端按正常速度解码。next_ts_step_为下一帧的时间戳增量
+    double scale_;
+    uint32_t next_ts_step_;
+
+    // Speed只缩短发送间隔；bulk_时由发送缓冲的可写驱动
+    double speed_;
+    bool bulk_;
+    bool bulk_update_ts_;
+    int64_t bulk_start_us_;
+    uint64_t bulk_octets_;
+
+    // 媒体时间0对应的RTP时间戳，会话内各轨道的媒体时间同一起点
+    bool scheduled_;
+    uint32_t rtp_base_;
+
+    // PLAY的时间，第一个图像帧发出后记录到time_to_first_frame
+    int64_t play_start_us_;
+    bool first_frame_sent_;
+    LatencyMetricsPtr session_latency_;
+
+    // 上次计入LoopMetrics的采样值，用于增量更新
+    uint32_t sink_packets_;
+    uint32_t sink_octets_;
+    uint32_t sink_dropped_;
+    size_t queued_bytes_;
 };
 
 using RtspStreamStatePtr = std::shared_ptr<RtspStreamState>;
@@ -0,0 +1,106 @@
+#include "sdp_parser.h"
+#include "media/av_packet.h"
+#include "media/base64.h"
+#include "media/defs.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+namespace muduo_media {
+
+static void ParseSpropParameterSets(const std::string &fmtp,
+                                    H264SdpMedia *media) {
+    static const char kSprop[] = "sprop-parameter-sets=";
+
+    size_t pos = fmtp.find(kSprop);
+    if (pos == std::string::npos) {
+        return;
+    }
+    pos += strlen(kSprop);
+    size_t end = fmtp.find(';', pos);
+    std::string sets = fmtp.substr(pos, end == std::string::npos
+                                            ? std::string::npos
+                                            : end - pos);
+
+    size_t start = 0;
+    while (start < sets.size()) {
+        size_t comma = sets.find(',', start);
+        if (comma == std::string::npos) {
+            comma = sets.size();
+        }
+        std::string nalu;
+        if (base64::Decode(sets.substr(start, comma - start), &nalu) &&
+            !nalu.empty()) {
+            uint8_t type = nalu[0] & 0x1F;
+            if (type == NALU_TYPE_SPS) {
+                media->sps = nalu;
+            } else if (type == NALU_TYPE_PPS) {
+                media->pps = nalu;
+            }
+        }
+        start = comma + 1;
+    }
+}
+
+bool ParseH264Sdp(const std::string &sdp, std::vector<H264SdpMedia> *medias) {
+    H264SdpMedia *media = nullptr;
+
+    size_t start = 0;
+    while (start < sdp.size()) {
+        size_t end = sdp.find('\n', start);
+        if (end == std::string::npos) {
+            end = sdp.size();
+        }
+        std::string line = sdp.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        start = end + 1;
+
+        int pt = -1;
+        char encoding[32] = {0};
+        float framerate = 0;
+
+        if (utils::StartsWith(line, "m=")) {
+            media = nullptr;
+            if (sscanf(line.data(), "m=video %*d %*s %d", &pt) == 1) {
+                medias->emplace_back();
+                media = &medias->back();
+                media->payload_type = pt;
+            }
+        } else if (!media) {
+            continue;
+        } else if (sscanf(line.data(), "a=rtpmap:%d %31[^/]", &pt,
+                          encoding) == 2) {
+            if (pt == media->payload_type &&
+                strcasecmp(encoding, defs::kMimeTypeH264) == 0) {
+                media->h264 = true;
+            }
+        } else if (utils::StartsWith(line, "a=control:")) {
+            media->control = line.substr(strlen("a=control:"));
+        } else if (sscanf(line.data(), "a=fmtp:%d", &pt) == 1) {
+            size_t space = line.find(' ');
+            if (pt == media->payload_type && space != std::string::npos) {
+                media->fmtp = line.substr(space + 1);
+                ParseSpropParameterSets(media->fmtp, media);
+            }
+        } else if (sscanf(line.data(), "a=framerate:%f", &framerate) == 1) {
+            if (framerate >= 1) {
+                media->fps = (unsigned int)(framerate + 0.5f);
+            }
+        }
+    }
+
+    medias->erase(std::remove_if(medias->begin(), medias->end(),
+                                 [](const H264SdpMedia &m) {
+                                     return !m.h264 || m.control.empty();
+                                 }),
+                  medias->end());
+    return !medias->empty();
+}
+
+} // namespace muduo_media
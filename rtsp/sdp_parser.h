@@ -0,0 +1,26 @@
+#ifndef E27CBA24_2E65_4BB4_960E_797BC4B651B5
+#define E27CBA24_2E65_4BB4_960E_797BC4B651B5
+
+#include <string>
+#include <vector>
+
+namespace muduo_media {
+
+/// SDP中的一路H.264视频
+struct H264SdpMedia {
+    int payload_type = -1;
+    bool h264 = false;
+    unsigned int fps = 25;
+    std::string control;
+    std::string fmtp; // a=fmtp:<pt> 之后的参数部分
+    std::string sps;  // sprop-parameter-sets，不含起始码
+    std::string pps;
+};
+
+/// 只取有a=control的H.264视频，其他媒体忽略。推流的ANNOUNCE和拉流的
+/// DESCRIBE应答共用
+bool ParseH264Sdp(const std::string &sdp, std::vector<H264SdpMedia> *medias);
+
+} // namespace muduo_media
+
+#endif /* E27CBA24_2E65_4BB4_960E_797BC4B651B5 */
@@ -0,0 +1,131 @@
+#include "session_scheduler.h"
+#include "media/media_log.h"
+#include "rtsp_stream_state.h"
+
+#include <chrono>
+
+namespace muduo_media {
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+SessionScheduler::SessionScheduler(muduo::event_loop::EventLoop *loop)
+    : loop_(loop), generation_(0), origin_us_(0), next_report_(0) {}
+
+SessionScheduler::~SessionScheduler() {}
+
+void SessionScheduler::Add(RtspStreamState *state) {
+    Track track;
+    track.state = state;
+    track.next = 0;
+    track.active = false;
+    tracks_.push_back(track);
+}
+
+void SessionScheduler::Start() {
+    bool any = false;
+    for (auto &&track : tracks_) {
+        track.next = 0;
+        track.active = track.state->scheduled();
+        any = any || track.active;
+    }
+
+    uint32_t generation = ++generation_;
+    if (!any) {
+        return;
+    }
+    origin_us_ = NowMicros();
+    next_report_ = 0;
+
+    std::weak_ptr<SessionScheduler> weak_self(shared_from_this());
+    loop_->QueueInLoop([weak_self, generation]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->Run(generation);
+        }
+    });
+}
+
+void SessionScheduler::Stop() {
+    ++generation_;
+    for (auto &&track : tracks_) {
+        track.active = false;
+    }
+}
+
+SessionScheduler::Track *SessionScheduler::Earliest() {
+    Track *earliest = nullptr;
+    for (auto &&track : tracks_) {
+        if (track.active && (!earliest || track.next < earliest->next)) {
+            earliest = &track;
+        }
+    }
+    return earliest;
+}
+
+double SessionScheduler::MediaTime(int64_t now_us) const {
+    return (now_us - origin_us_) / 1000000.0;
+}
+
+void SessionScheduler::Run(uint32_t generation) {
+    if (generation != generation_) {
+        return;
+    }
+
+    Track *earliest = Earliest();
+    if (!earliest) {
+        LOG_DEBUG << "all tracks finished at " << this;
+        return;
+    }
+
+    // loop被长时间阻塞后不成批补发，所有轨道一起顺延，彼此仍然同步
+    double now = MediaTime(NowMicros());
+    double lag = now - earliest->next;
+    if (lag > kMaxLag) {
+        LOG_WARN << "scheduler lag " << lag << "s at " << this;
+        origin_us_ += (int64_t)(lag * 1000000);
+        now = earliest->next;
+    }
+
+    // 按展示时间顺序发送所有已到期的帧
+    while (earliest && earliest->next <= now) {
+        int64_t deadline_us =
+            origin_us_ + (int64_t)(earliest->next * 1000000);
+        double duration =
+            earliest->state->SendScheduledFrame(earliest->next, deadline_us);
+        if (duration < 0) {
+            earliest->active = false;
+        } else {
+            earliest->next += duration;
+        }
+        earliest = Earliest();
+    }
+
+    now = MediaTime(NowMicros());
+    if (now >= next_report_) {
+        for (auto &&track : tracks_) {
+            if (track.active) {
+                track.state->SendSenderReport(now);
+            }
+        }
+        next_report_ = now + kSenderReportInterval;
+    }
+
+    if (!earliest) {
+        return;
+    }
+
+    double wait = earliest->next - now;
+    std::weak_ptr<SessionScheduler> weak_self(shared_from_this());
+    loop_->RunAfter(wait > 0 ? wait : 0, [weak_self, generation]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->Run(generation);
+        }
+    });
+}
+
+} // namespace muduo_media
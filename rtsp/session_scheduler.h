@@ -0,0 +1,64 @@
+#ifndef C0DCEE81_DBCD_4616_82AC_1634B93A436B
+#define C0DCEE81_DBCD_4616_82AC_1634B93A436B
+
+#include "eventloop/event_loop.h"
+
+#include <memory>
+#include <vector>
+
+namespace muduo_media {
+
+class RtspStreamState;
+
+/**
+ * @brief 一个RtspSession中按帧率发送的所有流共用的调度器
+ *
+ * 各轨道的下一帧按展示时间排序，由同一个定时器依次发送，音视频以同一时钟
+ * 为准，不会各自漂移。PLAY时刻为媒体时间0，各轨道的RTP时间戳都由此推出，
+ * SR中的NTP/RTP对应关系也以它为准。
+ */
+class SessionScheduler
+    : public std::enable_shared_from_this<SessionScheduler> {
+public:
+    explicit SessionScheduler(muduo::event_loop::EventLoop *loop);
+    ~SessionScheduler();
+
+    /// state由RtspSession持有，生命周期不短于调度器
+    void Add(RtspStreamState *state);
+
+    /// 各流Play之后调用，只调度选择按帧率发送的流
+    void Start();
+    void Stop();
+
+    // 落后超过该值(秒)时时钟整体顺延，不成批补发
+    static constexpr double kMaxLag = 1.0;
+    // SR发送间隔(秒)
+    static constexpr double kSenderReportInterval = 5.0;
+
+private:
+    struct Track {
+        RtspStreamState *state;
+        double next; // 下一帧的媒体时间(秒)
+        bool active;
+    };
+
+    // generation与generation_不同时说明已重新PLAY或停止，旧的定时器作废
+    void Run(uint32_t generation);
+
+    Track *Earliest();
+
+    // now_us对应的媒体时间(秒)
+    double MediaTime(int64_t now_us) const;
+
+    muduo::event_loop::EventLoop *loop_;
+    std::vector<Track> tracks_;
+    uint32_t generation_;
+    int64_t origin_us_; // 媒体时间0对应的时刻
+    double next_report_;
+};
+
+using SessionSchedulerPtr = std::shared_ptr<SessionScheduler>;
+
+} // namespace muduo_media
+
+#endif /* C0DCEE81_DBCD_4616_82AC_1634B93A436B */
@@ -4,11 +4,14 @@ namespace muduo_media {
 
 StreamState::StreamState(muduo::event_loop::EventLoop *loop)
     : loop_(loop),
+      metrics_(LoopMetrics::Local()),
       playing_(false),
       play_times_(0),
       play_frames_(0),
-      play_packets_(0) {}
+      play_packets_(0) {
+    metrics_->streams.Add();
+}
 
-StreamState::~StreamState() {}
+StreamState::~StreamState() { metrics_->streams.Sub(); }
 
 } // namespace muduo_media
\ No newline at end of file
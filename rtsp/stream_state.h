@@ -2,6 +2,8 @@
 #define D8B36F66_7BE7_4D69_9FBA_3B8A2347C66B
 
 #include "eventloop/event_loop.h"
+#include "media/metrics.h"
+#include "media/rtcp.h"
 
 namespace muduo_media {
 
@@ -15,19 +17,42 @@ public:
     size_t play_times() const { return play_times_; }
     size_t play_frames() const { return play_frames_; }
     size_t play_packets() const { return play_packets_; }
+    const RtcpReceiverStats &rtcp_stats() const { return rtcp_stats_; }
 
     virtual void Play() = 0;
     virtual void Teardown() = 0;
 
+    /// PLAY之前定位到npt(秒)，start_npt返回实际开始位置。不支持时返回false
+    virtual bool Seek(double npt, double *start_npt) { return false; }
+
+    /// 下一帧的npt(秒)。实时流没有确定的位置，返回false
+    virtual bool Position(double *npt) const { return false; }
+
+    /// PLAY之前时移到直播位置之前-offset秒，不支持时返回false
+    virtual bool TimeShift(double offset, double *start_offset) {
+        return false;
+    }
+
+    /// PLAY之前设置播放速率(RTSP Scale)，不支持时返回false
+    virtual bool SetScale(double scale) { return scale == 1.0; }
+
+    /// PLAY之前设置发送速度(RTSP Speed)，时间戳不变。不支持时返回false
+    virtual bool SetSpeed(double speed) { return speed == 1.0; }
+
+    /// 所在TCP连接的发送缓冲已写空
+    virtual void OnWriteComplete() {}
+
     virtual void ParseRTP(const char *buf, size_t size) = 0;
     virtual void ParseRTCP(const char *buf, size_t size) = 0;
 
 protected:
     muduo::event_loop::EventLoop *loop_;
+    LoopMetrics *metrics_;
     bool playing_;
     size_t play_times_;
     size_t play_frames_;
     size_t play_packets_;
+    RtcpReceiverStats rtcp_stats_;
 };
 
 using StreamStatePtr = std::shared_ptr<StreamState>;
@@ -0,0 +1,210 @@
+#include "vod_catalog.h"
+#include "media/aac_file_subsession.h"
+#include "media/h264_file_subsession.h"
+#include "media/h265_file_subsession.h"
+#include "media/media_log.h"
+#include "media/metrics.h"
+#include "media/mp4_file_subsession.h"
+#include "media/ts_file_subsession.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+#include <sys/stat.h>
+
+namespace muduo_media {
+
+// 每个缓存会话除索引外的估计开销: MediaSession、轨道等，再加上延迟指标。
+// 淘汰时会话析构，从MetricsRegistry注销后延迟指标随之释放
+static constexpr size_t kSessionOverhead = 4096 + sizeof(LatencyMetrics);
+static constexpr double kTrimInterval = 5.0;
+
+static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+VodCatalog::VodCatalog(muduo::event_loop::EventLoop *loop,
+                       const std::string &root,
+                       const VodCatalogOptions &options)
+    : loop_(loop), root_(root), options_(options), memory_bytes_(0),
+      started_(false) {}
+
+VodCatalog::~VodCatalog() {
+    LoopMetrics *metrics = LoopMetrics::Local();
+    metrics->vod_sessions.Sub(entries_.size());
+    metrics->vod_memory_bytes.Sub(memory_bytes_);
+}
+
+void VodCatalog::Start() {
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    LOG_INFO << "vod catalog " << root_ << ", memory budget "
+             << options_.memory_budget;
+    ScheduleTrim();
+}
+
+MediaSubsessionPtr VodCatalog::NewFileSubsession(const std::string &filename) {
+    size_t dot = filename.rfind('.');
+    if (dot == std::string::npos ||
+        filename.find('/', dot) != std::string::npos) {
+        return nullptr;
+    }
+    std::string ext = filename.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    if (ext == "h264" || ext == "264") {
+        return std::make_shared<H264FileSubsession>(filename);
+    } else if (ext == "h265" || ext == "265" || ext == "hevc") {
+        return std::make_shared<H265FileSubsession>(filename);
+    } else if (ext == "mp4" || ext == "m4v") {
+        return std::make_shared<Mp4FileSubsession>(filename);
+    } else if (ext == "ts") {
+        return std::make_shared<TsFileSubsession>(filename);
+    } else if (ext == "aac") {
+        return std::make_shared<AacFileSubsession>(filename);
+    }
+    return nullptr;
+}
+
+bool VodCatalog::ValidPath(const std::string &path) {
+    if (path.empty() || path[0] == '/') {
+        return false;
+    }
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string segment = path.substr(start, end - start);
+        if (segment.empty() || segment == "." || segment == "..") {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+MediaSessionPtr VodCatalog::Get(const std::string &path) {
+    if (!ValidPath(path)) {
+        return nullptr;
+    }
+
+    // 每次查找都stat一次，文件删除或替换后不再使用旧的索引
+    std::string filename = root_ + "/" + path;
+    struct stat st;
+    bool exists = ::stat(filename.data(), &st) == 0 && S_ISREG(st.st_mode);
+    uint64_t file_size = exists ? st.st_size : 0;
+    int64_t mtime_ns =
+        exists ? (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec
+               : 0;
+
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        Entry &entry = *it->second;
+        if (exists && entry.file_size == file_size &&
+            entry.file_mtime_ns == mtime_ns) {
+            entry.last_access_us = NowMicros();
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return entry.session;
+        }
+        LOG_INFO << "vod " << path << " changed, drop cached session";
+        Erase(it->second);
+    }
+    if (!exists) {
+        return nullptr;
+    }
+
+    MediaSubsessionPtr subsession = NewFileSubsession(filename);
+    if (!subsession) {
+        LOG_DEBUG << "vod " << path << " unsupported type";
+        return nullptr;
+    }
+
+    // 这里只建立会话，索引到第一次DESCRIBE时才加载
+    MediaSessionPtr session = std::make_shared<MediaSession>(path);
+    session->AddSubsession(subsession);
+    entries_.push_front(Entry{path, session, file_size, mtime_ns, NowMicros(),
+                              kSessionOverhead});
+    index_[path] = entries_.begin();
+    memory_bytes_ += kSessionOverhead;
+
+    LoopMetrics *metrics = LoopMetrics::Local();
+    metrics->vod_session_loads.Add();
+    metrics->vod_sessions.Add();
+    metrics->vod_memory_bytes.Add(kSessionOverhead);
+    LOG_INFO << "vod " << path << " session created, " << entries_.size()
+             << " cached";
+    return session;
+}
+
+void VodCatalog::Erase(EntryList::iterator it) {
+    LoopMetrics *metrics = LoopMetrics::Local();
+    metrics->vod_sessions.Sub();
+    metrics->vod_memory_bytes.Sub(it->bytes);
+    memory_bytes_ -= it->bytes;
+    index_.erase(it->path);
+    entries_.erase(it);
+}
+
+void VodCatalog::Trim() {
+    // 索引在查找之后才加载，每次重新统计
+    size_t total = 0;
+    for (Entry &entry : entries_) {
+        entry.bytes = kSessionOverhead + entry.session->MemoryBytes();
+        total += entry.bytes;
+    }
+    LoopMetrics::Local()->vod_memory_bytes.Add((int64_t)total -
+                                               (int64_t)memory_bytes_);
+    memory_bytes_ = total;
+
+    int64_t now_us = NowMicros();
+    int64_t grace_us = (int64_t)(options_.idle_grace * 1000000);
+    size_t evicted = 0;
+    auto it = entries_.end();
+    while (memory_bytes_ > options_.memory_budget && it != entries_.begin()) {
+        --it;
+        // 越靠前访问越近，之后的都在宽限期内
+        if (now_us - it->last_access_us < grace_us) {
+            break;
+        }
+        if (it->session.use_count() > 1 || it->session->HasStreams()) {
+            continue;
+        }
+        LOG_DEBUG << "vod evict " << it->path << ", " << it->bytes
+                  << " bytes";
+        auto victim = it++;
+        Erase(victim);
+        ++evicted;
+    }
+
+    if (evicted > 0) {
+        LoopMetrics::Local()->vod_evictions.Add(evicted);
+        LOG_INFO << "vod evicted " << evicted << " sessions, "
+                 << entries_.size() << " cached, " << memory_bytes_
+                 << " bytes";
+    }
+    if (memory_bytes_ > options_.memory_budget) {
+        LOG_DEBUG << "vod catalog " << memory_bytes_
+                  << " bytes over budget, sessions in use";
+    }
+}
+
+void VodCatalog::ScheduleTrim() {
+    std::weak_ptr<VodCatalog> weak_self(shared_from_this());
+    loop_->RunAfter(kTrimInterval, [weak_self]() {
+        auto self = weak_self.lock();
+        if (self) {
+            self->Trim();
+            self->ScheduleTrim();
+        }
+    });
+}
+
+} // namespace muduo_media
@@ -0,0 +1,89 @@
+#ifndef E0C888E1_3034_492E_9BFA_073F9261B938
+#define E0C888E1_3034_492E_9BFA_073F9261B938
+
+#include "eventloop/event_loop.h"
+#include "media/media_subsession.h"
+#include "media_session.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace muduo_media {
+
+struct VodCatalogOptions {
+    size_t memory_budget = 256 << 20; // 缓存会话的索引内存上限
+    double idle_grace = 30.0;         // 秒，最近被查找过的会话不淘汰
+};
+
+/**
+ * @brief 把url路径映射为root目录下文件的点播目录
+ *
+ * 启动时不扫描目录，启动时间与库的大小无关。第一次OPTIONS/DESCRIBE某个
+ * 路径时按扩展名建立MediaSession，索引在第一次GetSdp时才加载；之后并发
+ * 的观看者共用同一个会话和索引。文件的大小或mtime变化后重新建立。
+ *
+ * 缓存的会话按最近查找的顺序排成LRU。索引内存加上每个会话的固定开销超过
+ * memory_budget时，从最久未用的一端淘汰空闲会话: 没有流持有它的轨道，且
+ * idle_grace秒内没有被查找过(RtspConnection在OPTIONS到SETUP之间只持有
+ * weak_ptr)。已建立的流持有轨道和索引，不受淘汰影响。
+ *
+ * 所有方法都须在loop线程中调用。
+ */
+class VodCatalog : public std::enable_shared_from_this<VodCatalog> {
+public:
+    VodCatalog(muduo::event_loop::EventLoop *loop, const std::string &root,
+               const VodCatalogOptions &options = VodCatalogOptions());
+    ~VodCatalog();
+
+    /// 开始定期统计内存和淘汰
+    void Start();
+
+    /// path为url中的会话部分，如"movies/a.mp4"。文件不存在、类型不支持
+    /// 或路径越出root时返回nullptr
+    MediaSessionPtr Get(const std::string &path);
+
+    size_t size() const { return entries_.size(); }
+    size_t memory_bytes() const { return memory_bytes_; }
+
+    /// 按扩展名建立文件的轨道，不支持的类型返回nullptr
+    static MediaSubsessionPtr NewFileSubsession(const std::string &filename);
+
+private:
+    struct Entry {
+        std::string path;
+        MediaSessionPtr session;
+        uint64_t file_size;
+        int64_t file_mtime_ns;
+        int64_t last_access_us;
+        size_t bytes; // 上次统计的内存，含固定开销
+    };
+    using EntryList = std::list<Entry>;
+
+    // 非空，不以/开头，不含空段、"."和".."
+    static bool ValidPath(const std::string &path);
+
+    void Erase(EntryList::iterator it);
+
+    // 重新统计内存，超出预算时淘汰空闲会话
+    void Trim();
+    void ScheduleTrim();
+
+private:
+    muduo::event_loop::EventLoop *loop_;
+    const std::string root_;
+    const VodCatalogOptions options_;
+
+    EntryList entries_; // 最近查找的在前
+    std::unordered_map<std::string, EntryList::iterator> index_;
+    size_t memory_bytes_;
+    bool started_;
+};
+
+using VodCatalogPtr = std::shared_ptr<VodCatalog>;
+
+} // namespace muduo_media
+
+#endif /* E0C888E1_3034_492E_9BFA_073F9261B938 */
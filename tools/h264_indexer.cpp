@@ -0,0 +1,60 @@
+/// 离线为H.264文件生成.idx索引
+///
+/// 索引与媒体文件大小/mtime一致时跳过，--force时总是重建。服务启动后
+/// 直接mmap加载，无需扫描整个文件。
+///
+/// usage: h264_indexer [--force] <file.h264>...
+
+#include "logger/logger.h"
+#include "media/h264_file_index.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using muduo_media::H264FileIndex;
+
+int main(int argc, char *argv[]) {
+    bool force = false;
+    std::vector<const char *> filenames;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else {
+            filenames.push_back(argv[i]);
+        }
+    }
+    if (filenames.empty()) {
+        fprintf(stderr, "usage: %s [--force] <file.h264>...\n", argv[0]);
+        return 1;
+    }
+
+    muduo::log::Logger::set_log_level(muduo::log::Logger::WARN);
+
+    int failed = 0;
+    for (const char *filename : filenames) {
+        if (!force && H264FileIndex::Load(filename)) {
+            printf("%s: up to date\n", filename);
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto index = H264FileIndex::Build(filename);
+        if (!index || !index->Save(filename)) {
+            fprintf(stderr, "%s: index fail\n", filename);
+            ++failed;
+            continue;
+        }
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+        printf("%s: NALUs %zu, frames %llu, keyframes %zu, %.3fs\n", filename,
+               index->nal_count(), (unsigned long long)index->frame_count(),
+               index->keyframe_count(), seconds);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+/// 测量空闲RTSP会话的内存占用
+///
+/// 在同一进程内启动RtspServer（独立线程、独立loop），然后从主线程建立N个
+/// 环回TCP连接，每个连接完成一次OPTIONS（可选再SETUP一路TCP交织流但不PLAY），
+/// 在1k/10k/100k等检查点输出进程RSS以及每会话平均字节数。
+///
+/// usage: rtsp_idle_rss [--setup] [--port 8654] [checkpoint ...]
+
+#include "logger/logger.h"
+#include "media/h264_file_subsession.h"
+#include "rtsp/media_session.h"
+#include "rtsp/rtsp_server.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr int kClientsPerSourceIp = 20000;
+
+static long ReadRssBytes() {
+    long pages = 0;
+    long resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+        resident = -1;
+    }
+    fclose(fp);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static bool RaiseFdLimit(rlim_t wanted) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+        return false;
+    }
+    if (rl.rlim_cur >= wanted) {
+        return true;
+    }
+    rl.rlim_cur = wanted;
+    if (rl.rlim_max < wanted) {
+        rl.rlim_max = wanted;
+    }
+    return setrlimit(RLIMIT_NOFILE, &rl) == 0;
+}
+
+// 读到一个完整的响应头即可
+static bool ReadResponse(int fd) {
+    char buf[1024];
+    size_t total = 0;
+    while (total < sizeof(buf) - 1) {
+        ssize_t n = ::recv(fd, buf + total, sizeof(buf) - 1 - total, 0);
+        if (n <= 0) {
+            return false;
+        }
+        total += n;
+        buf[total] = '\0';
+        if (strstr(buf, "\r\n\r\n")) {
+            return strncmp(buf, "RTSP/1.0 200", 12) == 0;
+        }
+    }
+    return false;
+}
+
+static int OpenIdleSession(int index, unsigned short port, bool setup) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // 环回地址按块轮换源IP，避免单个源IP的临时端口耗尽
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr =
+        htonl(INADDR_LOOPBACK + 1 + index / kClientsPerSourceIp);
+    ::bind(fd, (struct sockaddr *)&local, sizeof(local));
+
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, (struct sockaddr *)&server, sizeof(server)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    char req[512];
+    int len = snprintf(req, sizeof(req),
+                       "OPTIONS rtsp://127.0.0.1:%hu/live RTSP/1.0\r\n"
+                       "CSeq: 1\r\n"
+                       "\r\n",
+                       port);
+    if (::send(fd, req, len, 0) != len || !ReadResponse(fd)) {
+        ::close(fd);
+        return -1;
+    }
+
+    if (setup) {
+        len = snprintf(req, sizeof(req),
+                       "SETUP rtsp://127.0.0.1:%hu/live/track0 RTSP/1.0\r\n"
+                       "CSeq: 2\r\n"
+                       "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n"
+                       "\r\n",
+                       port);
+        if (::send(fd, req, len, 0) != len || !ReadResponse(fd)) {
+            ::close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    bool setup = false;
+    unsigned short port = 8654;
+    std::vector<int> checkpoints;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--setup") == 0) {
+            setup = true;
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = (unsigned short)atoi(argv[++i]);
+        } else {
+            checkpoints.push_back(atoi(argv[i]));
+        }
+    }
+    if (checkpoints.empty()) {
+        checkpoints = {1000, 10000, 100000};
+    }
+
+    muduo::log::Logger::set_log_level(muduo::log::Logger::WARN);
+
+    int max_sessions = checkpoints.back();
+    if (!RaiseFdLimit(2 * max_sessions + 64)) {
+        fprintf(stderr, "can not raise RLIMIT_NOFILE to %d, results above the "
+                        "current limit will be missing\n",
+                2 * max_sessions + 64);
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    muduo::event_loop::EventLoop *server_loop = nullptr;
+
+    std::thread server_thread([&] {
+        muduo::event_loop::EventLoop loop;
+        muduo::net::InetAddress listen_addr(port);
+        muduo_media::RtspServer rtsp_server(&loop, listen_addr, "RtspServer");
+
+        // 文件不会被读取，除非PLAY
+        muduo_media::MediaSessionPtr session(
+            new muduo_media::MediaSession("live"));
+        session->AddSubsession(
+            std::make_shared<muduo_media::H264FileSubsession>("idle.h264"));
+        rtsp_server.AddMediaSession(session);
+        rtsp_server.Start();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            server_loop = &loop;
+        }
+        cond.notify_one();
+
+        loop.Loop();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return server_loop != nullptr; });
+    }
+
+    long base_rss = ReadRssBytes();
+    printf("%-10s %14s %14s %16s\n", "sessions", "rss(KB)", "delta(KB)",
+           setup ? "bytes/stream" : "bytes/session");
+    printf("%-10d %14ld %14d %16s\n", 0, base_rss / 1024, 0, "-");
+
+    std::vector<int> fds;
+    fds.reserve(max_sessions);
+
+    for (int checkpoint : checkpoints) {
+        while ((int)fds.size() < checkpoint) {
+            int fd = OpenIdleSession(fds.size(), port, setup);
+            if (fd < 0) {
+                fprintf(stderr, "open session %zu fail: %s\n", fds.size(),
+                        strerror(errno));
+                break;
+            }
+            fds.push_back(fd);
+        }
+
+        if ((int)fds.size() < checkpoint) {
+            break;
+        }
+
+        long rss = ReadRssBytes();
+        // 客户端一侧只有fd，不占用用户态内存
+        printf("%-10d %14ld %14ld %16ld\n", checkpoint, rss / 1024,
+               (rss - base_rss) / 1024, (rss - base_rss) / checkpoint);
+        fflush(stdout);
+    }
+
+    for (int fd : fds) {
+        ::close(fd);
+    }
+
+    server_loop->Quit();
+    server_thread.join();
+
+    return 0;
+}
@@ -0,0 +1,901 @@
+/// RTSP/RTP 环回压测客户端
+///
+/// 单线程epoll驱动N个RTSP客户端，依次完成OPTIONS/DESCRIBE/SETUP/PLAY，
+/// SDP中的每一路媒体按a=control各SETUP一次，支持TCP交织和UDP两种传输。收到的RTP会检查序号连续性和marker位(帧的
+/// 最后一个包带marker，之后时间戳才变化)，并按RFC3550计算到达抖动、按RTP
+/// 时间戳计算帧的迟到时间。
+///
+/// 每秒输出一行汇总（在线客户端、包率、Gbit/s、丢包、服务端CPU），结束时
+/// 输出每路流抖动/迟到的分布。--clock只用于SDP中没有rtpmap的媒体。
+///
+/// usage: rtsp_load_gen [--host 127.0.0.1] [--port 8554] [--path live]
+///                      [--transport tcp|udp] [--clients 100]
+///                      [--ramp-up 0] [--duration 30] [--ramp-down 0]
+///                      [--clock 90000] [--server-pid PID]
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kRtpHeaderSize = 12;
+constexpr size_t kRecvBufSize = 64 * 1024;
+constexpr int kMaxEvents = 256;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    unsigned short port = 8554;
+    std::string path = "live";
+    bool udp = false;
+    int clients = 100;
+    double ramp_up = 0;   // clients/s, 0表示一次性全部建立
+    double duration = 30; // 全部建立后的保持时间
+    double ramp_down = 0; // clients/s, 0表示一次性全部断开
+    unsigned int clock = 90000;
+    int server_pid = 0;
+};
+
+double NowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint16_t ReadBE16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+uint32_t ReadBE32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/// 单路RTP流的接收统计
+struct RtpStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t frames = 0; // marker == 1
+    uint64_t lost = 0;
+    uint64_t reordered = 0;
+    uint64_t malformed = 0;
+    // 时间戳变化前没有marker，或marker之后时间戳没变
+    uint64_t marker_errors = 0;
+
+    bool started = false;
+    uint16_t expected_seq = 0;
+    bool last_marker = false;
+
+    // RFC3550 A.8
+    double jitter = 0; // RTP时钟单位
+    double last_transit = 0;
+
+    // 帧迟到：相对首个包，按RTP时间戳推算的应到时间
+    double first_arrival = 0;
+    uint32_t last_ts = 0;
+    int64_t unwrapped_ts = 0;
+    double max_lateness = 0;
+    double sum_lateness = 0;
+    uint64_t lateness_samples = 0;
+
+    void OnPacket(const uint8_t *data, size_t size, double arrival,
+                  unsigned int clock);
+};
+
+void RtpStats::OnPacket(const uint8_t *data, size_t size, double arrival,
+                        unsigned int clock) {
+    if (size < kRtpHeaderSize || (data[0] >> 6) != 2) {
+        ++malformed;
+        return;
+    }
+
+    ++packets;
+    bytes += size;
+
+    bool marker = data[1] & 0x80;
+    uint16_t seq = ReadBE16(data + 2);
+    uint32_t ts = ReadBE32(data + 4);
+
+    if (!started) {
+        started = true;
+        first_arrival = arrival;
+        last_ts = ts;
+        unwrapped_ts = 0;
+        last_transit = arrival * clock - ts;
+        expected_seq = seq + 1;
+    } else {
+        uint16_t diff = seq - expected_seq;
+        if (diff < 0x8000) {
+            // 丢包时帧边界无从判断，只检查连续的包
+            if (diff == 0) {
+                bool ts_changed = ts != last_ts;
+                if (ts_changed != last_marker) {
+                    ++marker_errors;
+                }
+            }
+            lost += diff;
+            expected_seq = seq + 1;
+        } else {
+            ++reordered;
+        }
+
+        unwrapped_ts += (int32_t)(ts - last_ts);
+        last_ts = ts;
+
+        double transit = arrival * clock - ts;
+        double d = transit - last_transit;
+        last_transit = transit;
+        if (d < 0) {
+            d = -d;
+        }
+        jitter += (d - jitter) / 16.0;
+    }
+
+    last_marker = marker;
+
+    if (marker) {
+        ++frames;
+        double due = first_arrival + (double)unwrapped_ts / clock;
+        double lateness = arrival - due;
+        if (lateness > max_lateness) {
+            max_lateness = lateness;
+        }
+        sum_lateness += lateness;
+        ++lateness_samples;
+    }
+}
+
+enum class ClientState {
+    kConnecting,
+    kOptions,
+    kDescribe,
+    kSetup,
+    kPlay,
+    kPlaying,
+    kClosed
+};
+
+struct Client;
+
+/// epoll事件的归属
+struct Endpoint {
+    Client *client;
+    enum Kind { kTcp, kRtp, kRtcp } kind;
+    size_t track; // kRtp/kRtcp所属的轨道
+};
+
+/// SDP中的一路媒体
+struct Track {
+    std::string control; // a=control，可能是相对url
+    unsigned int clock = 0;
+    int rtp_fd = -1;
+    int rtcp_fd = -1;
+    unsigned short rtp_port = 0;
+    RtpStats stats;
+
+    Endpoint rtp_ep;
+    Endpoint rtcp_ep;
+};
+
+/// 每个m=段取a=control和a=rtpmap中的时钟频率，会话级的a=control忽略
+std::vector<Track> ParseSdpTracks(const std::string &sdp,
+                                  unsigned int default_clock) {
+    std::vector<Track> tracks;
+    size_t pos = 0;
+    while (pos < sdp.size()) {
+        size_t end = sdp.find('\n', pos);
+        if (end == std::string::npos) {
+            end = sdp.size();
+        }
+        std::string line = sdp.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        pos = end + 1;
+
+        if (line.compare(0, 2, "m=") == 0) {
+            tracks.push_back(Track());
+            tracks.back().clock = default_clock;
+        } else if (tracks.empty()) {
+            continue;
+        } else if (line.compare(0, 10, "a=control:") == 0) {
+            tracks.back().control = line.substr(10);
+        } else if (line.compare(0, 9, "a=rtpmap:") == 0) {
+            // a=rtpmap:96 H264/90000
+            size_t slash = line.find('/');
+            unsigned int clock = slash == std::string::npos
+                                     ? 0
+                                     : strtoul(line.c_str() + slash + 1,
+                                               nullptr, 10);
+            if (clock > 0) {
+                tracks.back().clock = clock;
+            }
+        }
+    }
+    return tracks;
+}
+
+struct Client {
+    int index = 0;
+    ClientState state = ClientState::kConnecting;
+    int tcp_fd = -1;
+    int cseq = 0;
+    std::string session;
+    std::string base_url; // DESCRIBE响应的Content-Base
+    std::string in;
+    std::vector<Track> tracks; // DESCRIBE之后不再变化，Endpoint指向其中
+    size_t setup_index = 0;
+
+    Endpoint tcp_ep;
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const Options &options);
+    ~LoadGenerator();
+
+    int Run();
+
+private:
+    bool StartClient(Client *client);
+    void CloseClient(Client *client);
+
+    bool BindUdpPair(Track *track);
+    bool SetupTracks(Client *client, const std::string &sdp);
+
+    std::string SessionUrl() const;
+    // url为空时请求会话url
+    void SendRequest(Client *client, const char *method, const std::string &url,
+                     const std::string &extra);
+    void SendSetup(Client *client);
+    void NextRequest(Client *client);
+
+    void OnTcpReadable(Client *client, double now);
+    void OnUdpReadable(Endpoint *ep, double now);
+    bool ParseTcpInput(Client *client, double now);
+    bool HandleResponse(Client *client, const std::string &head,
+                        const std::string &body);
+
+    void Report(double now, bool final_report);
+    double ServerCpuSeconds() const;
+
+private:
+    Options options_;
+    int epfd_;
+    std::vector<std::unique_ptr<Client>> clients_;
+    std::unique_ptr<uint8_t[]> recv_buf_;
+
+    int online_;
+    int playing_;
+    int failed_;
+
+    double last_report_time_;
+    uint64_t last_report_packets_;
+    uint64_t last_report_bytes_;
+    double last_report_cpu_;
+};
+
+LoadGenerator::LoadGenerator(const Options &options)
+    : options_(options),
+      epfd_(epoll_create1(EPOLL_CLOEXEC)),
+      recv_buf_(new uint8_t[kRecvBufSize]),
+      online_(0),
+      playing_(0),
+      failed_(0),
+      last_report_time_(0),
+      last_report_packets_(0),
+      last_report_bytes_(0),
+      last_report_cpu_(0) {}
+
+LoadGenerator::~LoadGenerator() {
+    for (auto &client : clients_) {
+        CloseClient(client.get());
+    }
+    ::close(epfd_);
+}
+
+bool LoadGenerator::BindUdpPair(Track *track) {
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        int rtp_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (::bind(rtp_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            ::getsockname(rtp_fd, (struct sockaddr *)&addr, &len) != 0) {
+            ::close(rtp_fd);
+            return false;
+        }
+
+        unsigned short port = ntohs(addr.sin_port);
+        if (port & 1) {
+            ::close(rtp_fd);
+            continue;
+        }
+
+        int rtcp_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        addr.sin_port = htons(port + 1);
+        if (::bind(rtcp_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            ::close(rtp_fd);
+            ::close(rtcp_fd);
+            continue;
+        }
+
+        // 能抗住突发
+        int rcvbuf = 4 * 1024 * 1024;
+        ::setsockopt(rtp_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        track->rtp_fd = rtp_fd;
+        track->rtcp_fd = rtcp_fd;
+        track->rtp_port = port;
+        return true;
+    }
+    return false;
+}
+
+bool LoadGenerator::StartClient(Client *client) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(options_.port);
+    if (inet_pton(AF_INET, options_.host.c_str(), &server.sin_addr) != 1) {
+        ::close(fd);
+        return false;
+    }
+
+    int ret = ::connect(fd, (struct sockaddr *)&server, sizeof(server));
+    if (ret != 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return false;
+    }
+
+    client->tcp_fd = fd;
+    client->state = ClientState::kConnecting;
+    client->tcp_ep = {client, Endpoint::kTcp, 0};
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = &client->tcp_ep;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+    ++online_;
+
+    return true;
+}
+
+bool LoadGenerator::SetupTracks(Client *client, const std::string &sdp) {
+    client->tracks = ParseSdpTracks(sdp, options_.clock);
+    if (client->tracks.empty()) {
+        fprintf(stderr, "client %d: no media in SDP\n", client->index);
+        return false;
+    }
+
+    // UDP端口在知道轨道数之后绑定
+    if (!options_.udp) {
+        return true;
+    }
+    for (size_t i = 0; i < client->tracks.size(); ++i) {
+        Track &track = client->tracks[i];
+        if (!BindUdpPair(&track)) {
+            return false;
+        }
+        track.rtp_ep = {client, Endpoint::kRtp, i};
+        track.rtcp_ep = {client, Endpoint::kRtcp, i};
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &track.rtp_ep;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, track.rtp_fd, &ev);
+        ev.data.ptr = &track.rtcp_ep;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, track.rtcp_fd, &ev);
+    }
+    return true;
+}
+
+void LoadGenerator::CloseClient(Client *client) {
+    if (client->state == ClientState::kClosed) {
+        return;
+    }
+    if (client->state == ClientState::kPlaying) {
+        --playing_;
+    }
+    if (client->tcp_fd >= 0) {
+        // TEARDOWN不等待响应
+        if (client->state == ClientState::kPlaying) {
+            SendRequest(client, "TEARDOWN", "", "");
+        }
+        ::close(client->tcp_fd);
+        --online_;
+    }
+    for (auto &track : client->tracks) {
+        if (track.rtp_fd >= 0) {
+            ::close(track.rtp_fd);
+        }
+        if (track.rtcp_fd >= 0) {
+            ::close(track.rtcp_fd);
+        }
+        track.rtp_fd = track.rtcp_fd = -1;
+    }
+    client->tcp_fd = -1;
+    client->state = ClientState::kClosed;
+}
+
+std::string LoadGenerator::SessionUrl() const {
+    char url[256];
+    snprintf(url, sizeof(url), "rtsp://%s:%hu/%s", options_.host.c_str(),
+             options_.port, options_.path.c_str());
+    return url;
+}
+
+void LoadGenerator::SendRequest(Client *client, const char *method,
+                                const std::string &url,
+                                const std::string &extra) {
+    std::string req;
+    req.append(method).append(" ").append(url.empty() ? SessionUrl() : url);
+    req.append(" RTSP/1.0\r\nCSeq: ").append(std::to_string(++client->cseq));
+    req.append("\r\n");
+    if (!client->session.empty()) {
+        req.append("Session: ").append(client->session).append("\r\n");
+    }
+    req.append(extra).append("\r\n");
+
+    // 请求很小，非阻塞socket上可一次写完
+    ::send(client->tcp_fd, req.data(), req.size(), MSG_NOSIGNAL);
+}
+
+void LoadGenerator::NextRequest(Client *client) {
+    switch (client->state) {
+    case ClientState::kConnecting:
+        client->state = ClientState::kOptions;
+        SendRequest(client, "OPTIONS", "", "");
+        break;
+    case ClientState::kOptions:
+        client->state = ClientState::kDescribe;
+        SendRequest(client, "DESCRIBE", "", "Accept: application/sdp\r\n");
+        break;
+    case ClientState::kDescribe:
+        client->state = ClientState::kSetup;
+        client->setup_index = 0;
+        SendSetup(client);
+        break;
+    case ClientState::kSetup:
+        if (++client->setup_index < client->tracks.size()) {
+            SendSetup(client);
+            break;
+        }
+        client->state = ClientState::kPlay;
+        SendRequest(client, "PLAY", "", "Range: npt=0.000-\r\n");
+        break;
+    case ClientState::kPlay:
+        client->state = ClientState::kPlaying;
+        ++playing_;
+        break;
+    default:
+        break;
+    }
+}
+
+void LoadGenerator::SendSetup(Client *client) {
+    size_t index = client->setup_index;
+    const Track &track = client->tracks[index];
+
+    char transport[128];
+    if (options_.udp) {
+        snprintf(transport, sizeof(transport),
+                 "Transport: RTP/AVP;unicast;client_port=%hu-%hu\r\n",
+                 track.rtp_port, (unsigned short)(track.rtp_port + 1));
+    } else {
+        snprintf(transport, sizeof(transport),
+                 "Transport: RTP/AVP/TCP;unicast;interleaved=%zu-%zu\r\n",
+                 index * 2, index * 2 + 1);
+    }
+
+    // 没有a=control或为*时使用会话url，相对url接在Content-Base之后
+    std::string base = client->base_url.empty() ? SessionUrl()
+                                                : client->base_url;
+    std::string url;
+    if (track.control.empty() || track.control == "*") {
+        url = base;
+    } else if (track.control.compare(0, 7, "rtsp://") == 0) {
+        url = track.control;
+    } else {
+        if (base.back() != '/') {
+            base.push_back('/');
+        }
+        url = base + track.control;
+    }
+    SendRequest(client, "SETUP", url, transport);
+}
+
+bool LoadGenerator::HandleResponse(Client *client, const std::string &head,
+                                   const std::string &body) {
+    if (head.compare(0, 12, "RTSP/1.0 200") != 0) {
+        fprintf(stderr, "client %d: unexpected response [%s]\n", client->index,
+                head.substr(0, head.find("\r\n")).c_str());
+        return false;
+    }
+
+    size_t pos = head.find("Session: ");
+    if (pos != std::string::npos && client->session.empty()) {
+        size_t end = head.find_first_of(";\r", pos);
+        client->session = head.substr(pos + 9, end - pos - 9);
+    }
+
+    if (client->state == ClientState::kDescribe) {
+        pos = head.find("Content-Base: ");
+        if (pos != std::string::npos) {
+            size_t end = head.find("\r\n", pos);
+            client->base_url = head.substr(pos + 14, end - pos - 14);
+        }
+        if (!SetupTracks(client, body)) {
+            return false;
+        }
+    }
+
+    NextRequest(client);
+    return true;
+}
+
+bool LoadGenerator::ParseTcpInput(Client *client, double now) {
+    std::string &in = client->in;
+    size_t offset = 0;
+
+    while (offset < in.size()) {
+        if (in[offset] == '$') {
+            if (in.size() - offset < 4) {
+                break;
+            }
+            const uint8_t *p = (const uint8_t *)in.data() + offset;
+            uint8_t channel = p[1];
+            size_t len = ReadBE16(p + 2);
+            if (in.size() - offset < 4 + len) {
+                break;
+            }
+            // 第i路轨道的RTP在通道2i
+            size_t index = channel / 2;
+            if (channel % 2 == 0 && index < client->tracks.size()) {
+                Track &track = client->tracks[index];
+                track.stats.OnPacket(p + 4, len, now, track.clock);
+            }
+            offset += 4 + len;
+        } else {
+            size_t end = in.find("\r\n\r\n", offset);
+            if (end == std::string::npos) {
+                break;
+            }
+            std::string head = in.substr(offset, end + 4 - offset);
+            size_t body = 0;
+            size_t pos = head.find("Content-Length: ");
+            if (pos != std::string::npos) {
+                body = strtoul(head.c_str() + pos + 16, nullptr, 10);
+            }
+            if (in.size() - end - 4 < body) {
+                break;
+            }
+            std::string content = in.substr(end + 4, body);
+            offset = end + 4 + body;
+            if (!HandleResponse(client, head, content)) {
+                return false;
+            }
+        }
+    }
+
+    in.erase(0, offset);
+    return true;
+}
+
+void LoadGenerator::OnTcpReadable(Client *client, double now) {
+    for (;;) {
+        ssize_t n = ::recv(client->tcp_fd, recv_buf_.get(), kRecvBufSize, 0);
+        if (n > 0) {
+            client->in.append((const char *)recv_buf_.get(), n);
+            if (n < (ssize_t)kRecvBufSize) {
+                break;
+            }
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            ++failed_;
+            CloseClient(client);
+            return;
+        }
+    }
+
+    if (!ParseTcpInput(client, now)) {
+        ++failed_;
+        CloseClient(client);
+    }
+}
+
+void LoadGenerator::OnUdpReadable(Endpoint *ep, double now) {
+    Track &track = ep->client->tracks[ep->track];
+    bool rtp = ep->kind == Endpoint::kRtp;
+    int fd = rtp ? track.rtp_fd : track.rtcp_fd;
+    for (;;) {
+        ssize_t n = ::recv(fd, recv_buf_.get(), kRecvBufSize, 0);
+        if (n < 0) {
+            break;
+        }
+        if (rtp) {
+            track.stats.OnPacket(recv_buf_.get(), n, now, track.clock);
+        }
+    }
+}
+
+double LoadGenerator::ServerCpuSeconds() const {
+    if (options_.server_pid <= 0) {
+        return 0;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", options_.server_pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return 0;
+    }
+
+    char line[1024] = {0};
+    size_t n = fread(line, 1, sizeof(line) - 1, fp);
+    fclose(fp);
+    line[n] = '\0';
+
+    // comm字段可能含空格，从最后一个')'之后开始解析
+    const char *p = strrchr(line, ')');
+    if (!p) {
+        return 0;
+    }
+    unsigned long utime = 0, stime = 0;
+    if (sscanf(p + 2,
+               "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime,
+               &stime) != 2) {
+        return 0;
+    }
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+void LoadGenerator::Report(double now, bool final_report) {
+    uint64_t packets = 0, bytes = 0, lost = 0, reordered = 0, frames = 0;
+    uint64_t marker_errors = 0;
+    for (auto &client : clients_) {
+        for (auto &track : client->tracks) {
+            packets += track.stats.packets;
+            bytes += track.stats.bytes;
+            lost += track.stats.lost;
+            reordered += track.stats.reordered;
+            frames += track.stats.frames;
+            marker_errors += track.stats.marker_errors;
+        }
+    }
+
+    double interval = now - last_report_time_;
+    double cpu = ServerCpuSeconds();
+    if (interval > 0 && last_report_time_ > 0) {
+        double pps = (packets - last_report_packets_) / interval;
+        double gbps = (bytes - last_report_bytes_) * 8 / interval / 1e9;
+        printf("online %6d playing %6d failed %4d | %10.0f pkt/s %7.3f "
+               "Gbit/s | frames %10lu lost %8lu reordered %6lu",
+               online_, playing_, failed_, pps, gbps, (unsigned long)frames,
+               (unsigned long)lost, (unsigned long)reordered);
+        if (options_.server_pid > 0) {
+            printf(" | server cpu %6.1f%%",
+                   (cpu - last_report_cpu_) / interval * 100);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    last_report_time_ = now;
+    last_report_packets_ = packets;
+    last_report_bytes_ = bytes;
+    last_report_cpu_ = cpu;
+
+    if (!final_report) {
+        return;
+    }
+
+    std::vector<double> jitters;
+    std::vector<double> latenesses;
+    for (auto &client : clients_) {
+        for (auto &track : client->tracks) {
+            if (track.stats.packets == 0) {
+                continue;
+            }
+            jitters.push_back(track.stats.jitter * 1000 / track.clock);
+            latenesses.push_back(track.stats.max_lateness * 1000);
+        }
+    }
+    if (jitters.empty()) {
+        printf("no client received RTP\n");
+        return;
+    }
+
+    auto percentile = [](std::vector<double> &v, double q) {
+        size_t idx = (size_t)(q * (v.size() - 1));
+        std::nth_element(v.begin(), v.begin() + idx, v.end());
+        return v[idx];
+    };
+
+    printf("streams with RTP %zu, total packets %lu, bytes %lu, lost %lu, "
+           "reordered %lu, marker errors %lu\n",
+           jitters.size(), (unsigned long)packets, (unsigned long)bytes,
+           (unsigned long)lost, (unsigned long)reordered,
+           (unsigned long)marker_errors);
+    printf("per-stream jitter(ms)       p50 %8.3f p99 %8.3f max %8.3f\n",
+           percentile(jitters, 0.5), percentile(jitters, 0.99),
+           percentile(jitters, 1.0));
+    printf("per-stream max lateness(ms) p50 %8.3f p99 %8.3f max %8.3f\n",
+           percentile(latenesses, 0.5), percentile(latenesses, 0.99),
+           percentile(latenesses, 1.0));
+}
+
+int LoadGenerator::Run() {
+    if (epfd_ < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    for (int i = 0; i < options_.clients; ++i) {
+        clients_.emplace_back(new Client);
+        clients_.back()->index = i;
+    }
+
+    struct epoll_event events[kMaxEvents];
+    double start = NowSeconds();
+    double ramp_up_end = options_.ramp_up > 0
+                             ? start + options_.clients / options_.ramp_up
+                             : start;
+    double hold_end = ramp_up_end + options_.duration;
+    double ramp_down_end =
+        options_.ramp_down > 0 ? hold_end + options_.clients / options_.ramp_down
+                               : hold_end;
+
+    int started = 0;
+    int stopped = 0;
+    last_report_time_ = start;
+    last_report_cpu_ = ServerCpuSeconds();
+
+    for (;;) {
+        double now = NowSeconds();
+
+        // 按速率建立连接
+        int should_start =
+            options_.ramp_up > 0
+                ? std::min(options_.clients,
+                           (int)((now - start) * options_.ramp_up) + 1)
+                : options_.clients;
+        while (started < should_start) {
+            Client *client = clients_[started++].get();
+            if (!StartClient(client)) {
+                ++failed_;
+            }
+        }
+
+        // 按速率断开连接
+        if (now >= hold_end) {
+            int should_stop =
+                options_.ramp_down > 0
+                    ? std::min(options_.clients,
+                               (int)((now - hold_end) * options_.ramp_down) + 1)
+                    : options_.clients;
+            while (stopped < should_stop) {
+                CloseClient(clients_[stopped++].get());
+            }
+        }
+
+        if (now - last_report_time_ >= 1.0) {
+            Report(now, false);
+        }
+
+        if (now >= ramp_down_end && stopped >= options_.clients) {
+            break;
+        }
+
+        int n = epoll_wait(epfd_, events, kMaxEvents, 10);
+        now = NowSeconds();
+        for (int i = 0; i < n; ++i) {
+            Endpoint *ep = (Endpoint *)events[i].data.ptr;
+            Client *client = ep->client;
+            if (client->state == ClientState::kClosed) {
+                continue;
+            }
+
+            if (ep->kind == Endpoint::kTcp) {
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    ++failed_;
+                    CloseClient(client);
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) &&
+                    client->state == ClientState::kConnecting) {
+                    struct epoll_event ev;
+                    ev.events = EPOLLIN;
+                    ev.data.ptr = ep;
+                    epoll_ctl(epfd_, EPOLL_CTL_MOD, client->tcp_fd, &ev);
+                    NextRequest(client);
+                }
+                if (events[i].events & EPOLLIN) {
+                    OnTcpReadable(client, now);
+                }
+            } else {
+                OnUdpReadable(ep, now);
+            }
+        }
+    }
+
+    Report(NowSeconds(), true);
+    return 0;
+}
+
+void Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--host 127.0.0.1] [--port 8554] [--path live]\n"
+            "          [--transport tcp|udp] [--clients 100] [--ramp-up 0]\n"
+            "          [--duration 30] [--ramp-down 0] [--clock 90000]\n"
+            "          [--server-pid PID]\n",
+            prog);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = (unsigned short)atoi(value);
+        } else if (arg == "--path") {
+            options.path = value;
+        } else if (arg == "--transport") {
+            options.udp = strcmp(value, "udp") == 0;
+        } else if (arg == "--clients") {
+            options.clients = atoi(value);
+        } else if (arg == "--ramp-up") {
+            options.ramp_up = atof(value);
+        } else if (arg == "--duration") {
+            options.duration = atof(value);
+        } else if (arg == "--ramp-down") {
+            options.ramp_down = atof(value);
+        } else if (arg == "--clock") {
+            options.clock = (unsigned int)atoi(value);
+        } else if (arg == "--server-pid") {
+            options.server_pid = atoi(value);
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    LoadGenerator generator(options);
+    return generator.Run();
+}
@@ -0,0 +1,122 @@
+/// 从上游RTSP服务拉流，在本地RtspServer上以新的会话名转发
+///
+/// --loopback时同一进程内的RtspServer先以"upstream"提供该H.264文件，relay
+/// 再从rtsp://127.0.0.1:<port>/upstream拉流，不需要外部摄像机即可验证
+/// 拉流、重连和relay_forward_microseconds指标。--record时同时把转发的
+/// 流分段录制到目录中，退出时输出写放大和延迟。--dvr时保留最近若干MB
+/// 供观看者以Range: npt=-300-时移播放。
+///
+/// usage: rtsp_relay [--port 8554] [--name relay] [--metrics-port 9554]
+///                   [--record dir] [--segment seconds] [--dvr MB]
+///                   (--loopback file.h264 | rtsp://upstream/url)
+
+#include "logger/logger.h"
+#include "media/h264_file_subsession.h"
+#include "media/stream_recorder.h"
+#include "rtsp/media_session.h"
+#include "rtsp/metrics_http_server.h"
+#include "rtsp/rtsp_relay.h"
+#include "rtsp/rtsp_server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+static void Usage() {
+    fprintf(stderr, "usage: rtsp_relay [--port 8554] [--name relay] "
+                    "[--metrics-port 9554] [--record dir] "
+                    "[--segment seconds] [--dvr MB] "
+                    "(--loopback file.h264 | rtsp://upstream/url)\n");
+}
+
+int main(int argc, char *argv[]) {
+    unsigned short port = 8554;
+    unsigned short metrics_port = 9554;
+    std::string name = "relay";
+    std::string loopback_file;
+    std::string url;
+    std::string record_dir;
+    double segment_duration = 60;
+    size_t dvr_bytes = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = (unsigned short)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            metrics_port = (unsigned short)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_dir = argv[++i];
+        } else if (strcmp(argv[i], "--segment") == 0 && i + 1 < argc) {
+            segment_duration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--dvr") == 0 && i + 1 < argc) {
+            dvr_bytes = (size_t)atoi(argv[++i]) << 20;
+        } else if (strcmp(argv[i], "--loopback") == 0 && i + 1 < argc) {
+            loopback_file = argv[++i];
+        } else if (argv[i][0] != '-') {
+            url = argv[i];
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (url.empty() == loopback_file.empty()) {
+        Usage();
+        return 1;
+    }
+
+    muduo::log::Logger::set_log_level(muduo::log::Logger::INFO);
+
+    muduo::event_loop::EventLoop loop;
+    muduo_media::RtspServer rtsp_server(&loop, muduo::net::InetAddress(port),
+                                        "RtspRelayServer", true);
+
+    if (!loopback_file.empty()) {
+        auto session = std::make_shared<muduo_media::MediaSession>("upstream");
+        session->AddSubsession(
+            std::make_shared<muduo_media::H264FileSubsession>(loopback_file));
+        rtsp_server.AddMediaSession(session);
+        url = "rtsp://127.0.0.1:" + std::to_string(port) + "/upstream";
+    }
+
+    // relay与RtspServer在同一个loop上，直接登记会话
+    auto relay = std::make_shared<muduo_media::RtspRelay>(&loop, url, name);
+    if (dvr_bytes > 0) {
+        relay->hub()->set_time_shift_buffer(
+            muduo_media::TimeShiftBuffer::Create(dvr_bytes));
+    }
+    relay->set_publish_media_session_callback(
+        [&rtsp_server](const muduo_media::MediaSessionPtr &session) {
+            return rtsp_server.PublishMediaSession(session);
+        });
+    relay->set_unpublish_media_session_callback(
+        [&rtsp_server](const std::string &session_name) {
+            rtsp_server.RemoveMediaSession(session_name);
+        });
+
+    rtsp_server.Start();
+    relay->Start();
+
+    // 与relay在同一loop上订阅，录制与观看者共用缓冲
+    std::unique_ptr<muduo_media::StreamRecorder> recorder;
+    if (!record_dir.empty()) {
+        muduo_media::StreamRecorderOptions options;
+        options.directory = record_dir;
+        options.prefix = name;
+        options.segment_duration = segment_duration;
+        recorder.reset(new muduo_media::StreamRecorder(relay->hub(), options));
+        recorder->Start(&loop);
+    }
+
+    muduo::net::InetAddress metrics_addr(metrics_port);
+    muduo_media::MetricsHttpServer metrics_server(metrics_addr);
+    metrics_server.Start();
+
+    printf("relaying %s as rtsp://127.0.0.1:%u/%s\n", url.c_str(), port,
+           name.c_str());
+    loop.Loop();
+    return 0;
+}
@@ -0,0 +1,105 @@
+/// 模拟本机编码器：把H.264文件按帧率推入共享内存环形队列
+///
+/// 配合H264ShmSubsession使用，文件读完后从头循环。
+///
+/// usage: shm_h264_push <file.h264> [--name /muduo_live] [--fps 25]
+///                      [--slots 256] [--slot-size 262144]
+
+#include "logger/logger.h"
+#include "media/av_packet.h"
+#include "media/h264_file_source.h"
+#include "media/shm_ring.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <signal.h>
+
+static volatile sig_atomic_t g_quit = 0;
+
+static void OnSignal(int) { g_quit = 1; }
+
+int main(int argc, char *argv[]) {
+    const char *filename = nullptr;
+    std::string name = "/muduo_live";
+    int fps = 25;
+    uint32_t slots = 256;
+    uint32_t slot_size = 256 * 1024;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--slots") == 0 && i + 1 < argc) {
+            slots = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--slot-size") == 0 && i + 1 < argc) {
+            slot_size = (uint32_t)atoi(argv[++i]);
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (!filename || fps <= 0) {
+        fprintf(stderr, "usage: %s <file.h264> [--name /muduo_live] "
+                        "[--fps 25] [--slots 256] [--slot-size 262144]\n",
+                argv[0]);
+        return 1;
+    }
+
+    muduo::log::Logger::set_log_level(muduo::log::Logger::WARN);
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    auto producer =
+        muduo_media::ShmRingProducer::Create(name, slots, slot_size);
+    if (!producer) {
+        return 1;
+    }
+
+    const int64_t pts_step = 90000 / fps;
+    const auto frame_interval = std::chrono::microseconds(1000000 / fps);
+    auto next_frame = std::chrono::steady_clock::now();
+    int64_t pts = 0;
+    uint64_t frames = 0;
+
+    while (!g_quit) {
+        FILE *file = fopen(filename, "rb");
+        if (!file) {
+            perror(filename);
+            return 1;
+        }
+        muduo_media::H264FileSource source(file);
+
+        muduo_media::AVPacket packet;
+        while (!g_quit && source.GetNextFrame(&packet)) {
+            // 参数集和SEI与后面的slice属于同一个access unit
+            bool frame_end = packet.type != muduo_media::NALU_TYPE_SPS &&
+                             packet.type != muduo_media::NALU_TYPE_PPS &&
+                             packet.type != muduo_media::NALU_TYPE_SEI;
+
+            // 真实编码器直接在slot中输出码流，这里用拷贝代替
+            uint8_t *slot = producer->Reserve(packet.size);
+            if (slot) {
+                memcpy(slot, packet.buffer.get() + packet.prepend_size,
+                       packet.size);
+                producer->Commit(packet.size, packet.type, pts, frame_end);
+            }
+
+            if (frame_end) {
+                pts += pts_step;
+                ++frames;
+                next_frame += frame_interval;
+                std::this_thread::sleep_until(next_frame);
+            }
+        }
+    }
+
+    printf("pushed %llu frames, dropped %llu NALUs\n",
+           (unsigned long long)frames,
+           (unsigned long long)producer->dropped());
+    return 0;
+}